@@ -1,5 +1,9 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+	#define _GNU_SOURCE /* recvmmsg and sendmmsg */
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -13,6 +17,7 @@
 #include <sys/stat.h>
 
 #if defined(CONF_FAMILY_UNIX)
+	#include <sys/mman.h>
 	#include <sys/time.h>
 	#include <unistd.h>
 
@@ -39,6 +44,7 @@
 	#include <ws2tcpip.h>
 	#include <fcntl.h>
 	#include <direct.h>
+	#include <io.h>
 	#include <errno.h>
 	#include <process.h>
 	#include <wincrypt.h>
@@ -513,6 +519,48 @@ long int io_length(IOHANDLE io)
 	return length;
 }
 
+void *io_map(IOHANDLE io, unsigned *size)
+{
+	long int length = io_length(io);
+	*size = 0;
+	if(length <= 0)
+		return 0;
+#if defined(CONF_FAMILY_WINDOWS)
+	{
+		HANDLE file = (HANDLE)_get_osfhandle(_fileno((FILE*)io));
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		void *data;
+		if(!mapping)
+			return 0;
+		data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(mapping); /* the view keeps the mapping alive */
+		if(!data)
+			return 0;
+		*size = (unsigned)length;
+		return data;
+	}
+#else
+	{
+		void *data = mmap(0, length, PROT_READ|PROT_WRITE, MAP_PRIVATE, fileno((FILE*)io), 0);
+		if(data == MAP_FAILED)
+			return 0;
+		*size = (unsigned)length;
+		return data;
+	}
+#endif
+}
+
+void io_unmap(void *data, unsigned size)
+{
+	if(!data)
+		return;
+#if defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
 unsigned io_write(IOHANDLE io, const void *buffer, unsigned size)
 {
 	return fwrite(buffer, 1, size, (FILE*)io);
@@ -958,6 +1006,22 @@ void thread_detach(void *thread)
 #endif
 }
 
+int thread_set_affinity(void *thread, int cpu)
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np((pthread_t)(thread), sizeof(set), &set) == 0 ? 0 : -1;
+#elif defined(CONF_FAMILY_WINDOWS)
+	if(cpu >= (int)(sizeof(DWORD_PTR)*8))
+		return -1;
+	return SetThreadAffinityMask((HANDLE)thread, (DWORD_PTR)1<<cpu) ? 0 : -1;
+#else
+	return -1;
+#endif
+}
+
 void cpu_relax()
 {
 #if defined(CONF_ARCH_IA32) || defined(CONF_ARCH_AMD64)
@@ -1568,6 +1632,34 @@ NETSOCKET net_udp_create(NETADDR bindaddr, int use_random_port)
 	return sock;
 }
 
+static void priv_net_udp_sockaddr_in(const NETADDR *addr, struct sockaddr_in *sa)
+{
+	if(addr->type&NETTYPE_LINK_BROADCAST)
+	{
+		mem_zero(sa, sizeof(*sa));
+		sa->sin_port = htons(addr->port);
+		sa->sin_family = AF_INET;
+		sa->sin_addr.s_addr = INADDR_BROADCAST;
+	}
+	else
+		netaddr_to_sockaddr_in(addr, sa);
+}
+
+static void priv_net_udp_sockaddr_in6(const NETADDR *addr, struct sockaddr_in6 *sa)
+{
+	if(addr->type&NETTYPE_LINK_BROADCAST)
+	{
+		mem_zero(sa, sizeof(*sa));
+		sa->sin6_port = htons(addr->port);
+		sa->sin6_family = AF_INET6;
+		sa->sin6_addr.s6_addr[0] = 0xff; /* multicast */
+		sa->sin6_addr.s6_addr[1] = 0x02; /* link local scope */
+		sa->sin6_addr.s6_addr[15] = 1; /* all nodes */
+	}
+	else
+		netaddr_to_sockaddr_in6(addr, sa);
+}
+
 int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size)
 {
 	int d = -1;
@@ -1577,17 +1669,9 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 		if(sock.ipv4sock >= 0)
 		{
 			struct sockaddr_in sa;
-			if(addr->type&NETTYPE_LINK_BROADCAST)
-			{
-				mem_zero(&sa, sizeof(sa));
-				sa.sin_port = htons(addr->port);
-				sa.sin_family = AF_INET;
-				sa.sin_addr.s_addr = INADDR_BROADCAST;
-			}
-			else
-				netaddr_to_sockaddr_in(addr, &sa);
-
+			priv_net_udp_sockaddr_in(addr, &sa);
 			d = sendto((int)sock.ipv4sock, (const char*)data, size, 0, (struct sockaddr *)&sa, sizeof(sa));
+			network_stats.sent_calls++;
 		}
 		else
 			dbg_msg("net", "can't send ipv4 traffic to this socket");
@@ -1598,19 +1682,9 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 		if(sock.ipv6sock >= 0)
 		{
 			struct sockaddr_in6 sa;
-			if(addr->type&NETTYPE_LINK_BROADCAST)
-			{
-				mem_zero(&sa, sizeof(sa));
-				sa.sin6_port = htons(addr->port);
-				sa.sin6_family = AF_INET6;
-				sa.sin6_addr.s6_addr[0] = 0xff; /* multicast */
-				sa.sin6_addr.s6_addr[1] = 0x02; /* link local scope */
-				sa.sin6_addr.s6_addr[15] = 1; /* all nodes */
-			}
-			else
-				netaddr_to_sockaddr_in6(addr, &sa);
-
+			priv_net_udp_sockaddr_in6(addr, &sa);
 			d = sendto((int)sock.ipv6sock, (const char*)data, size, 0, (struct sockaddr *)&sa, sizeof(sa));
+			network_stats.sent_calls++;
 		}
 		else
 			dbg_msg("net", "can't send ipv6 traffic to this socket");
@@ -1646,12 +1720,14 @@ int net_udp_recv(NETSOCKET sock, NETADDR *addr, void *data, int maxsize)
 	{
 		fromlen = sizeof(struct sockaddr_in);
 		bytes = recvfrom(sock.ipv4sock, (char*)data, maxsize, 0, (struct sockaddr *)&sockaddrbuf, &fromlen);
+		network_stats.recv_calls++;
 	}
 
 	if(bytes <= 0 && sock.ipv6sock >= 0)
 	{
 		fromlen = sizeof(struct sockaddr_in6);
 		bytes = recvfrom(sock.ipv6sock, (char*)data, maxsize, 0, (struct sockaddr *)&sockaddrbuf, &fromlen);
+		network_stats.recv_calls++;
 	}
 
 	if(bytes > 0)
@@ -1666,6 +1742,183 @@ int net_udp_recv(NETSOCKET sock, NETADDR *addr, void *data, int maxsize)
 	return -1; /* error */
 }
 
+#if defined(CONF_PLATFORM_LINUX)
+enum
+{
+	NET_UDP_MMSG_MAX = 64
+};
+
+/* sends all messages, a message the kernel refuses is dropped like with sendto */
+static void priv_net_udp_sendmmsg(int socket, struct mmsghdr *msgs, int num)
+{
+	int sent = 0;
+	while(sent < num)
+	{
+		int result = sendmmsg(socket, msgs+sent, num-sent, 0);
+		network_stats.sent_calls++;
+		if(result > 0)
+			sent += result;
+		else
+			sent++;
+	}
+}
+
+static int priv_net_udp_recvmmsg(int socket, NETDATAGRAM *datagrams, int num)
+{
+	struct mmsghdr msgs[NET_UDP_MMSG_MAX];
+	struct iovec iovecs[NET_UDP_MMSG_MAX];
+	struct sockaddr_storage addrs[NET_UDP_MMSG_MAX];
+	int i, received;
+
+	if(num > NET_UDP_MMSG_MAX)
+		num = NET_UDP_MMSG_MAX;
+
+	mem_zero(msgs, sizeof(*msgs)*num);
+	for(i = 0; i < num; i++)
+	{
+		iovecs[i].iov_base = datagrams[i].data;
+		iovecs[i].iov_len = datagrams[i].size;
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+	}
+
+	received = recvmmsg(socket, msgs, num, MSG_DONTWAIT, 0);
+	network_stats.recv_calls++;
+	if(received <= 0)
+		return 0;
+
+	for(i = 0; i < received; i++)
+	{
+		sockaddr_to_netaddr((struct sockaddr *)&addrs[i], &datagrams[i].addr);
+		datagrams[i].size = msgs[i].msg_len;
+		network_stats.recv_bytes += msgs[i].msg_len;
+		network_stats.recv_packets++;
+	}
+	return received;
+}
+
+int net_udp_send_batch(NETSOCKET sock, const NETDATAGRAM *datagrams, int num)
+{
+	struct mmsghdr msgs4[NET_UDP_MMSG_MAX];
+	struct mmsghdr msgs6[NET_UDP_MMSG_MAX];
+	struct iovec iovecs[NET_UDP_MMSG_MAX];
+	struct sockaddr_in addrs4[NET_UDP_MMSG_MAX];
+	struct sockaddr_in6 addrs6[NET_UDP_MMSG_MAX];
+	int start, i;
+
+	for(start = 0; start < num; start += NET_UDP_MMSG_MAX)
+	{
+		int end = start+NET_UDP_MMSG_MAX < num ? start+NET_UDP_MMSG_MAX : num;
+		int num4 = 0, num6 = 0;
+
+		/* packets keep their order per address family */
+		for(i = start; i < end; i++)
+		{
+			const NETDATAGRAM *d = &datagrams[i];
+			struct iovec *iov = &iovecs[i-start];
+			iov->iov_base = d->data;
+			iov->iov_len = d->size;
+
+			if(d->addr.type&NETTYPE_IPV4)
+			{
+				if(sock.ipv4sock >= 0)
+				{
+					struct mmsghdr *msg = &msgs4[num4];
+					priv_net_udp_sockaddr_in(&d->addr, &addrs4[num4]);
+					mem_zero(msg, sizeof(*msg));
+					msg->msg_hdr.msg_name = &addrs4[num4];
+					msg->msg_hdr.msg_namelen = sizeof(addrs4[num4]);
+					msg->msg_hdr.msg_iov = iov;
+					msg->msg_hdr.msg_iovlen = 1;
+					num4++;
+				}
+				else
+					dbg_msg("net", "can't send ipv4 traffic to this socket");
+			}
+
+			if(d->addr.type&NETTYPE_IPV6)
+			{
+				if(sock.ipv6sock >= 0)
+				{
+					struct mmsghdr *msg = &msgs6[num6];
+					priv_net_udp_sockaddr_in6(&d->addr, &addrs6[num6]);
+					mem_zero(msg, sizeof(*msg));
+					msg->msg_hdr.msg_name = &addrs6[num6];
+					msg->msg_hdr.msg_namelen = sizeof(addrs6[num6]);
+					msg->msg_hdr.msg_iov = iov;
+					msg->msg_hdr.msg_iovlen = 1;
+					num6++;
+				}
+				else
+					dbg_msg("net", "can't send ipv6 traffic to this socket");
+			}
+
+			network_stats.sent_bytes += d->size;
+			network_stats.sent_packets++;
+		}
+
+		if(num4)
+			priv_net_udp_sendmmsg(sock.ipv4sock, msgs4, num4);
+		if(num6)
+			priv_net_udp_sendmmsg(sock.ipv6sock, msgs6, num6);
+	}
+	return num;
+}
+
+int net_udp_recv_batch(NETSOCKET sock, NETDATAGRAM *datagrams, int num)
+{
+	int received = 0;
+
+	if(sock.ipv4sock >= 0)
+	{
+		while(received < num)
+		{
+			int wanted = num-received < NET_UDP_MMSG_MAX ? num-received : NET_UDP_MMSG_MAX;
+			int result = priv_net_udp_recvmmsg(sock.ipv4sock, datagrams+received, wanted);
+			received += result;
+			if(result < wanted)
+				break;
+		}
+	}
+
+	if(sock.ipv6sock >= 0)
+	{
+		while(received < num)
+		{
+			int wanted = num-received < NET_UDP_MMSG_MAX ? num-received : NET_UDP_MMSG_MAX;
+			int result = priv_net_udp_recvmmsg(sock.ipv6sock, datagrams+received, wanted);
+			received += result;
+			if(result < wanted)
+				break;
+		}
+	}
+	return received;
+}
+#else
+int net_udp_send_batch(NETSOCKET sock, const NETDATAGRAM *datagrams, int num)
+{
+	int i;
+	for(i = 0; i < num; i++)
+		net_udp_send(sock, &datagrams[i].addr, datagrams[i].data, datagrams[i].size);
+	return num;
+}
+
+int net_udp_recv_batch(NETSOCKET sock, NETDATAGRAM *datagrams, int num)
+{
+	int received;
+	for(received = 0; received < num; received++)
+	{
+		int bytes = net_udp_recv(sock, &datagrams[received].addr, datagrams[received].data, datagrams[received].size);
+		if(bytes <= 0)
+			break;
+		datagrams[received].size = bytes;
+	}
+	return received;
+}
+#endif
+
 int net_udp_close(NETSOCKET sock)
 {
 	return priv_net_close_all_sockets(sock);
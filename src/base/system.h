@@ -345,6 +345,37 @@ long int io_tell(IOHANDLE io);
 */
 long int io_length(IOHANDLE io);
 
+/*
+	Function: io_map
+		Maps the whole file into memory.
+
+	Parameters:
+		io - Handle to the file.
+		size - Pointer that receives the size of the mapping.
+
+	Returns:
+		Returns a pointer to the start of the mapping or 0 if the file
+		couldn't be mapped or is empty.
+
+	Remarks:
+		- The mapping is copy on write, changes aren't carried to the file.
+		- The mapping stays valid after the file is closed, release it
+		with io_unmap.
+		- Truncating the file while it's mapped makes accesses to the cut
+		off pages fail. Replace mapped files by renaming over them.
+*/
+void *io_map(IOHANDLE io, unsigned *size);
+
+/*
+	Function: io_unmap
+		Releases a mapping that was created by io_map.
+
+	Parameters:
+		data - Pointer returned by io_map.
+		size - Size returned by io_map.
+*/
+void io_unmap(void *data, unsigned size);
+
 /*
 	Function: io_close
 		Closes a file.
@@ -594,6 +625,19 @@ void thread_yield();
 */
 void thread_detach(void *thread);
 
+/*
+	Function: thread_set_affinity
+		Pins a thread to one cpu.
+
+	Parameters:
+		thread - Thread handle to pin.
+		cpu - Index of the cpu, starting at 0.
+
+	Returns:
+		0 on success, -1 if it failed or isn't supported.
+*/
+int thread_set_affinity(void *thread, int cpu);
+
 /*
 	Function: cpu_relax
 		Lets the cpu relax a bit.
@@ -867,6 +911,58 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 */
 int net_udp_recv(NETSOCKET sock, NETADDR *addr, void *data, int maxsize);
 
+/*
+	Structure: NETDATAGRAM
+		A single packet for the batched UDP functions.
+
+	Members:
+		addr - Address the packet is sent to or was received from.
+		data - Pointer to the packet data.
+		size - Size of the packet. For receiving this has to be set
+			to the size of the buffer and is updated to the number
+			of bytes received.
+*/
+typedef struct
+{
+	NETADDR addr;
+	void *data;
+	int size;
+} NETDATAGRAM;
+
+/*
+	Function: net_udp_send_batch
+		Sends several packets over an UDP socket. Uses sendmmsg
+		where it is available, otherwise it behaves like calling
+		<net_udp_send> for each packet.
+
+	Parameters:
+		sock - Socket to use.
+		datagrams - Packets to send.
+		num - Number of packets.
+
+	Returns:
+		Returns the number of packets handed to the system.
+*/
+int net_udp_send_batch(NETSOCKET sock, const NETDATAGRAM *datagrams, int num);
+
+/*
+	Function: net_udp_recv_batch
+		Receives up to num packets over an UDP socket without
+		blocking. Uses recvmmsg where it is available, otherwise
+		it behaves like calling <net_udp_recv> until no packets
+		are left.
+
+	Parameters:
+		sock - Socket to use.
+		datagrams - Packets to fill in, see <NETDATAGRAM>.
+		num - Maximum number of packets to receive.
+
+	Returns:
+		Returns the number of packets received, 0 if there
+		are none waiting.
+*/
+int net_udp_recv_batch(NETSOCKET sock, NETDATAGRAM *datagrams, int num);
+
 /*
 	Function: net_udp_close
 		Closes an UDP socket.
@@ -1744,6 +1840,8 @@ typedef struct
 	int sent_bytes;
 	int recv_packets;
 	int recv_bytes;
+	int sent_calls;
+	int recv_calls;
 } NETSTATS;
 
 
@@ -9,6 +9,7 @@
 	atomic_inc - should return the value after increment
 	atomic_dec - should return the value after decrement
 	atomic_compswap - should return the value before the eventual swap
+	atomic_compswap_ptr - atomic_compswap for pointers
 	sync_barrier - creates a full hardware fence
 */
 
@@ -29,6 +30,11 @@
 		return __sync_val_compare_and_swap(pValue, comperand, value);
 	}
 
+	inline void *atomic_compswap_ptr(void *volatile *ppValue, void *comperand, void *value)
+	{
+		return __sync_val_compare_and_swap(ppValue, comperand, value);
+	}
+
 	inline void sync_barrier()
 	{
 		__sync_synchronize();
@@ -57,6 +63,11 @@
 		return _InterlockedCompareExchange((volatile long *)pValue, (long)value, (long)comperand);
 	}
 
+	inline void *atomic_compswap_ptr(void *volatile *ppValue, void *comperand, void *value)
+	{
+		return _InterlockedCompareExchangePointer(ppValue, value, comperand);
+	}
+
 	inline void sync_barrier()
 	{
 		MemoryBarrier();
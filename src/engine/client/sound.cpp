@@ -7,6 +7,7 @@
 #include <engine/storage.h>
 
 #include <engine/shared/config.h>
+#include <engine/shared/soundmixer.h>
 
 #include "SDL.h"
 
@@ -16,190 +17,31 @@ extern "C"
 {
 	#include <wavpack.h>
 }
-#include <math.h>
-#include <limits.h>
 
 enum
 {
 	NUM_SAMPLES = 512,
-	NUM_VOICES = 64,
-	NUM_CHANNELS = 16,
 };
 
-struct CSample
-{
-	short *m_pData;
-	int m_NumFrames;
-	int m_Rate;
-	int m_Channels;
-	int m_LoopStart;
-	int m_LoopEnd;
-	int m_PausedAt;
-};
-
-struct CChannel
-{
-	int m_Vol; // 0 - 255
-};
-
-struct CVoice
-{
-	CSample *m_pSample;
-	CChannel *m_pChannel;
-	int m_Tick;
-	int m_Vol; // 0 - 255
-	int m_Flags;
-	int m_X, m_Y;
-};
-
-static CSample m_aSamples[NUM_SAMPLES] = {{0}};
-static CVoice m_aVoices[NUM_VOICES] = {{0}};
-static CChannel m_aChannels[NUM_CHANNELS];
+static CSoundSample m_aSamples[NUM_SAMPLES] = {{0}};
+static CSoundMixer m_Mixer;
 
-static LOCK m_SoundLock = 0;
-
-static int m_CenterX = 0;
-static int m_CenterY = 0;
-
-static float m_MaxDistance = 1500.0f;
+static LOCK m_SoundLock = 0; // serializes loading, the mixer has its own queue
 
 static int m_MixingRate = 48000;
 static int m_SoundVolume = 100;
 
-static int m_NextVoice = 0;
-static int *m_pMixBuffer = 0;	// buffer only used by the thread callback function
-static unsigned m_MaxFrames = 0;
-
 static IOHANDLE s_File;
 
-static short Int2Short(int i)
-{
-	return clamp(i, SHRT_MIN, SHRT_MAX);
-}
-
-static void Mix(short *pFinalOut, unsigned Frames)
-{
-	int MasterVol;
-	mem_zero(m_pMixBuffer, m_MaxFrames*2*sizeof(int));
-	Frames = minimum(Frames, m_MaxFrames);
-
-	// aquire lock while we are mixing
-	lock_wait(m_SoundLock);
-
-	MasterVol = m_SoundVolume;
-
-	for(unsigned i = 0; i < NUM_VOICES; i++)
-	{
-		if(m_aVoices[i].m_pSample)
-		{
-			// mix voice
-			CVoice *v = &m_aVoices[i];
-			int *pOut = m_pMixBuffer;
-
-			int Step = v->m_pSample->m_Channels; // setup input sources
-			short *pInL = &v->m_pSample->m_pData[v->m_Tick*Step];
-			short *pInR = &v->m_pSample->m_pData[v->m_Tick*Step+1];
-
-			unsigned End = v->m_pSample->m_NumFrames-v->m_Tick;
-
-			int Rvol = v->m_pChannel->m_Vol;
-			int Lvol = v->m_pChannel->m_Vol;
-
-			// make sure that we don't go outside the sound data
-			if(Frames < End)
-				End = Frames;
-
-			// check if we have a mono sound
-			if(v->m_pSample->m_Channels == 1)
-				pInR = pInL;
-
-			// volume calculation
-			if(v->m_Flags&ISound::FLAG_POS)
-			{
-				int dx = v->m_X - m_CenterX;
-				int dy = v->m_Y - m_CenterY;
-				float Dist = sqrtf((float)dx*dx+dy*dy);
-				if(Dist >= 0.0f && Dist < m_MaxDistance)
-				{
-					// linear falloff
-					float Falloff = 1.0f - Dist/m_MaxDistance;
-
-					// amplitude after falloff
-					float FalloffAmp = v->m_pChannel->m_Vol * Falloff;
-
-					// distribute volume to the channels depending on x difference
-					float Lpan = 0.5f - dx/m_MaxDistance/2.0f;
-					float Rpan = 1.0f - Lpan;
-
-					// apply square root to preserve sound power after panning
-					float LampFactor = sqrt(Lpan);
-					float RampFactor = sqrt(Rpan);
-
-					// volume of the channels
-					Lvol = FalloffAmp*LampFactor;
-					Rvol = FalloffAmp*RampFactor;
-				}
-				else
-				{
-					Lvol = 0;
-					Rvol = 0;
-				}
-			}
-
-			// process all frames
-			for(unsigned s = 0; s < End; s++)
-			{
-				*pOut++ += (*pInL)*Lvol;
-				*pOut++ += (*pInR)*Rvol;
-				pInL += Step;
-				pInR += Step;
-				v->m_Tick++;
-			}
-
-			// free voice if not used any more
-			if(v->m_Tick == v->m_pSample->m_NumFrames)
-			{
-				if(v->m_Flags&ISound::FLAG_LOOP)
-					v->m_Tick = 0;
-				else
-					v->m_pSample = 0;
-			}
-		}
-	}
-
-
-	// release the lock
-	lock_unlock(m_SoundLock);
-
-	// clamp accumulated values
-	// TODO: this seams slow
-	for(unsigned i = 0; i < Frames; ++i)
-	{
-		int j = i<<1;
-		int vl = ((m_pMixBuffer[j]*MasterVol)/101)>>8;
-		int vr = ((m_pMixBuffer[j+1]*MasterVol)/101)>>8;
-
-		pFinalOut[j] = Int2Short(vl);
-		pFinalOut[j+1] = Int2Short(vr);
-	}
-
-#if defined(CONF_ARCH_ENDIAN_BIG)
-	swap_endian(pFinalOut, sizeof(short), Frames * 2);
-#endif
-}
-
 static void SdlCallback(void *pUnused, Uint8 *pStream, int Len)
 {
 	(void)pUnused;
-	Mix((short *)pStream, Len/2/2);
+	m_Mixer.Mix((short *)pStream, Len/2/2);
 }
 
 
 int CSound::Init()
 {
-	for(int i = 0; i < NUM_CHANNELS; ++i)
-		m_aChannels[i].m_Vol = 255;
-
 	m_SoundEnabled = 0;
 	m_pConfig = Kernel()->RequestInterface<IConfigManager>()->Values();
 	m_pGraphics = Kernel()->RequestInterface<IEngineGraphics>();
@@ -237,8 +79,7 @@ int CSound::Init()
 	else
 		dbg_msg("client/sound", "sound init successful");
 
-	m_MaxFrames = m_pConfig->m_SndBufferSize*2;
-	m_pMixBuffer = (int *)mem_alloc(m_MaxFrames*2*sizeof(int));
+	m_Mixer.Init(m_pConfig->m_SndBufferSize*2);
 
 	SDL_PauseAudio(0);
 
@@ -257,9 +98,8 @@ int CSound::Update()
 
 	if(WantedVolume != m_SoundVolume)
 	{
-		lock_wait(m_SoundLock);
 		m_SoundVolume = WantedVolume;
-		lock_unlock(m_SoundLock);
+		m_Mixer.SetMasterVolume(m_SoundVolume);
 	}
 
 	return 0;
@@ -270,11 +110,6 @@ int CSound::Shutdown()
 	SDL_CloseAudio();
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
 	lock_destroy(m_SoundLock);
-	if(m_pMixBuffer)
-	{
-		mem_free(m_pMixBuffer);
-		m_pMixBuffer = 0;
-	}
 	return 0;
 }
 
@@ -292,7 +127,7 @@ int CSound::AllocID()
 
 void CSound::RateConvert(int SampleID)
 {
-	CSample *pSample = &m_aSamples[SampleID];
+	CSoundSample *pSample = &m_aSamples[SampleID];
 	int NumFrames = 0;
 	short *pNewData = 0;
 
@@ -367,7 +202,7 @@ static int PushBackByte(void *pId, int Char)
 
 ISound::CSampleHandle CSound::LoadWV(const char *pFilename)
 {
-	CSample *pSample;
+	CSoundSample *pSample;
 	int SampleID = -1;
 	char aError[100];
 	WavpackContext *pContext;
@@ -470,6 +305,7 @@ ISound::CSampleHandle CSound::LoadWV(const char *pFilename)
 		pSample->m_LoopStart = -1;
 		pSample->m_LoopEnd = -1;
 		pSample->m_PausedAt = 0;
+		pSample->m_NumVoices = 0;
 	}
 	else
 	{
@@ -489,18 +325,17 @@ ISound::CSampleHandle CSound::LoadWV(const char *pFilename)
 
 void CSound::SetListenerPos(float x, float y)
 {
-	m_CenterX = (int)x;
-	m_CenterY = (int)y;
+	m_Mixer.SetListenerPos((int)x, (int)y);
 }
 
 void CSound::SetMaxDistance(float Distance)
 {
-	m_MaxDistance = Distance;
+	m_Mixer.SetMaxDistance(Distance);
 }
 
 void CSound::SetChannelVolume(int ChannelID, float Vol)
 {
-	m_aChannels[ChannelID].m_Vol = (int)(Vol*255.0f);
+	m_Mixer.SetChannelVolume(ChannelID, (int)(Vol*255.0f));
 }
 
 int CSound::Play(int ChannelID, CSampleHandle SampleID, int Flags, float x, float y)
@@ -508,40 +343,7 @@ int CSound::Play(int ChannelID, CSampleHandle SampleID, int Flags, float x, floa
 	if(!SampleID.IsValid())
 		return -1;
 
-	int VoiceID = -1;
-	int i;
-
-	lock_wait(m_SoundLock);
-
-	// search for voice
-	for(i = 0; i < NUM_VOICES; i++)
-	{
-		int id = (m_NextVoice + i) % NUM_VOICES;
-		if(!m_aVoices[id].m_pSample)
-		{
-			VoiceID = id;
-			m_NextVoice = id+1;
-			break;
-		}
-	}
-
-	// voice found, use it
-	if(VoiceID != -1)
-	{
-		m_aVoices[VoiceID].m_pSample = &m_aSamples[SampleID.Id()];
-		m_aVoices[VoiceID].m_pChannel = &m_aChannels[ChannelID];
-		if(Flags & FLAG_LOOP)
-			m_aVoices[VoiceID].m_Tick = m_aSamples[SampleID.Id()].m_PausedAt;
-		else
-			m_aVoices[VoiceID].m_Tick = 0;
-		m_aVoices[VoiceID].m_Vol = 255;
-		m_aVoices[VoiceID].m_Flags = Flags;
-		m_aVoices[VoiceID].m_X = (int)x;
-		m_aVoices[VoiceID].m_Y = (int)y;
-	}
-
-	lock_unlock(m_SoundLock);
-	return VoiceID;
+	return m_Mixer.Play(ChannelID, &m_aSamples[SampleID.Id()], Flags, (int)x, (int)y);
 }
 
 int CSound::PlayAt(int ChannelID, CSampleHandle SampleID, int Flags, float x, float y)
@@ -560,38 +362,14 @@ void CSound::Stop(CSampleHandle SampleID)
 		return;
 
 	// TODO: a nice fade out
-	lock_wait(m_SoundLock);
-	CSample *pSample = &m_aSamples[SampleID.Id()];
-	for(int i = 0; i < NUM_VOICES; i++)
-	{
-		if(m_aVoices[i].m_pSample == pSample)
-		{
-			if(m_aVoices[i].m_Flags & FLAG_LOOP)
-				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Tick;
-			else
-				m_aVoices[i].m_pSample->m_PausedAt = 0;
-			m_aVoices[i].m_pSample = 0;
-		}
-	}
-	lock_unlock(m_SoundLock);
+	m_Mixer.Stop(&m_aSamples[SampleID.Id()]);
 }
 
 void CSound::StopAll()
 {
 	// TODO: a nice fade out
-	lock_wait(m_SoundLock);
-	for(int i = 0; i < NUM_VOICES; i++)
-	{
-		if(m_aVoices[i].m_pSample)
-		{
-			if(m_aVoices[i].m_Flags & FLAG_LOOP)
-				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Tick;
-			else
-				m_aVoices[i].m_pSample->m_PausedAt = 0;
-		}
-		m_aVoices[i].m_pSample = 0;
-	}
-	lock_unlock(m_SoundLock);
+	if(m_SoundEnabled)
+		m_Mixer.StopAll();
 }
 
 bool CSound::IsPlaying(CSampleHandle SampleID)
@@ -599,18 +377,7 @@ bool CSound::IsPlaying(CSampleHandle SampleID)
 	if(!SampleID.IsValid())
 		return false;
 
-	bool Ret = false;
-	lock_wait(m_SoundLock);
-	CSample *pSample = &m_aSamples[SampleID.Id()];
-	for(int i = 0; i < NUM_VOICES; i++)
-	{
-		if(m_aVoices[i].m_pSample == pSample)
-		{
-			Ret = true;
-		}
-	}
-	lock_unlock(m_SoundLock);
-	return Ret;
+	return m_Mixer.IsPlaying(&m_aSamples[SampleID.Id()]);
 }
 
 IEngineSound *CreateEngineSound() { return new CSound; }
@@ -29,6 +29,9 @@ public:
 	virtual void Unload() = 0;
 	virtual SHA256_DIGEST Sha256() = 0;
 	virtual unsigned Crc() = 0;
+
+	// exchanges the loaded maps, pOther has to come from CreateEngineMap as well
+	virtual void Swap(IEngineMap *pOther) = 0;
 };
 
 extern IEngineMap *CreateEngineMap();
@@ -52,6 +52,10 @@ public:
 	virtual int SnapNewID() = 0;
 	virtual void SnapFreeID(int ID) = 0;
 	virtual void *SnapNewItem(int Type, int ID, int Size) = 0;
+	virtual int SnapNumItems() const = 0;
+	virtual void SnapHideItems(int First, int Num) = 0;
+	virtual void SnapSkipItem(int Index) = 0;
+	virtual void SnapKeepItem(int Index) = 0;
 
 	virtual void SnapSetStaticsize(int ItemType, int Size) = 0;
 
@@ -68,6 +72,8 @@ public:
 
 	virtual void DemoRecorder_HandleAutoStart() = 0;
 	virtual bool DemoRecorder_IsRecording() = 0;
+
+	virtual class CPerfTimers *PerfTimers() = 0;
 };
 
 class IGameServer : public IInterface
@@ -81,6 +87,7 @@ public:
 
 	virtual void OnTick() = 0;
 	virtual void OnPreSnap() = 0;
+	virtual void OnSnapShared() = 0;
 	virtual void OnSnap(int ClientID) = 0;
 	virtual void OnPostSnap() = 0;
 
@@ -245,6 +245,8 @@ void CServer::CClient::Reset()
 	m_SnapRate = CClient::SNAPRATE_INIT;
 	m_Score = 0;
 	m_MapChunk = 0;
+	m_MapChunksLeft = 0;
+	m_MapTokens = 0;
 }
 
 CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
@@ -253,13 +255,21 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 
 	m_pGameServer = 0;
 
+	// the shared base holds every entity of the map, not only what one client sees
+	m_SnapshotBuilder.SetCapacity(CSnapshotBuilder::MAX_ITEMS*8, CSnapshot::MAX_SIZE*8);
+
 	m_CurrentGameTick = 0;
 	m_RunServer = true;
 
 	str_copy(m_aShutdownReason, "Server shutdown", sizeof(m_aShutdownReason));
 
-	m_pCurrentMapData = 0;
-	m_CurrentMapSize = 0;
+	m_MapUploadTokens = 0;
+	m_LastMapUpload = 0;
+	m_FirstMapUploadClient = 0;
+	m_MapDownloadNextSecond = 0;
+	mem_zero(&m_MapDownloadCurrent, sizeof(m_MapDownloadCurrent));
+	mem_zero(&m_MapDownloadLastSecond, sizeof(m_MapDownloadLastSecond));
+	mem_zero(&m_MapDownloadTotal, sizeof(m_MapDownloadTotal));
 
 	m_MapReload = false;
 
@@ -269,6 +279,15 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 	m_RconPasswordSet = 0;
 	m_GeneratedRconPassword = 0;
 
+	static const char *s_apPerfNames[NUM_PERF_SECTIONS] = {
+		"tick", "tick.input", "tick.game",
+		"snap", "snap.build", "snap.delta", "snap.compress", "snap.send",
+		"map_download",
+		"net", "net.econ", "register"
+	};
+	for(int i = 0; i < NUM_PERF_SECTIONS; i++)
+		m_aPerfSections[i] = m_PerfTimers.Register(s_apPerfNames[i]);
+
 	Init();
 }
 
@@ -499,10 +518,95 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 	return 0;
 }
 
+int CServer::SnapshotDeltaJob(void *pUser)
+{
+	CSnapshotTask *pTask = (CSnapshotTask *)pUser;
+
+	// may run on a worker, the timings are added to the profile when sending
+	int64 Start = pTask->m_Timed ? time_get() : 0;
+	pTask->m_Crc = pTask->m_pTo->Crc();
+	pTask->m_DeltaSize = pTask->m_pSnapshotDelta->CreateDelta(pTask->m_pFrom, pTask->m_pTo, pTask->m_aDeltaData);
+	int64 DeltaEnd = pTask->m_Timed ? time_get() : 0;
+	pTask->m_CompSize = 0;
+	if(pTask->m_DeltaSize > 0)
+		pTask->m_CompSize = CVariableInt::Compress(pTask->m_aDeltaData, pTask->m_DeltaSize, pTask->m_aCompData, sizeof(pTask->m_aCompData));
+	if(pTask->m_Timed)
+	{
+		pTask->m_DeltaTime = DeltaEnd-Start;
+		pTask->m_CompressTime = time_get()-DeltaEnd;
+	}
+	return 0;
+}
+
+void CServer::SendSnapshot(const CSnapshotTask *pTask)
+{
+	const int ClientID = pTask->m_ClientID;
+	const int DeltaTick = pTask->m_DeltaTick;
+
+	if(pTask->m_DeltaSize > 0)
+	{
+		const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+		const int SnapshotSize = pTask->m_CompSize;
+		const int NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
+
+		for(int n = 0, Left = SnapshotSize; Left > 0; n++)
+		{
+			int Chunk = Left < MaxSize ? Left : MaxSize;
+			Left -= Chunk;
+
+			if(NumPackets == 1)
+			{
+				CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
+				Msg.AddInt(m_CurrentGameTick);
+				Msg.AddInt(m_CurrentGameTick-DeltaTick);
+				Msg.AddInt(pTask->m_Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pTask->m_aCompData[n*MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientID);
+			}
+			else
+			{
+				CMsgPacker Msg(NETMSG_SNAP, true);
+				Msg.AddInt(m_CurrentGameTick);
+				Msg.AddInt(m_CurrentGameTick-DeltaTick);
+				Msg.AddInt(NumPackets);
+				Msg.AddInt(n);
+				Msg.AddInt(pTask->m_Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pTask->m_aCompData[n*MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientID);
+			}
+		}
+	}
+	else
+	{
+		CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+		Msg.AddInt(m_CurrentGameTick);
+		Msg.AddInt(m_CurrentGameTick-DeltaTick);
+		SendMsg(&Msg, MSGFLAG_FLUSH, ClientID);
+
+		if(pTask->m_DeltaSize < 0)
+		{
+			char aBuf[64];
+			str_format(aBuf, sizeof(aBuf), "delta pack failed! (%d)", pTask->m_DeltaSize);
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
+		}
+	}
+}
+
 void CServer::DoSnapshot()
 {
+	CPerfScope SnapScope(&m_PerfTimers, m_aPerfSections[PERF_SNAP]);
+	int64 BuildStart = m_PerfTimers.Enabled() ? time_get() : 0;
+
 	GameServer()->OnPreSnap();
 
+	// build the items that look the same for every client only once,
+	// each snapshot below starts from this base and adds its own items
+	m_SnapshotBuilder.Init();
+	GameServer()->OnSnapShared();
+	m_SnapshotBuilder.FinishBase();
+
 	// create snapshot for demo recording
 	if(m_DemoRecorder.IsRecording())
 	{
@@ -510,7 +614,7 @@ void CServer::DoSnapshot()
 		int SnapshotSize;
 
 		// build snap and possibly add some messages
-		m_SnapshotBuilder.Init();
+		m_SnapshotBuilder.InitFromBase();
 		GameServer()->OnSnap(-1);
 		SnapshotSize = m_SnapshotBuilder.Finish(aData);
 
@@ -518,7 +622,12 @@ void CServer::DoSnapshot()
 		m_DemoRecorder.RecordSnapshot(Tick(), aData, SnapshotSize);
 	}
 
-	// create snapshots for all clients
+	// create snapshots for all clients. the game can only be snapped on the
+	// main thread, the deltas are independent and go to the job pool
+	static CSnapshot EmptySnap;
+	EmptySnap.Clear();
+	int NumTasks = 0;
+
 	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
 		// client must be ingame to receive snapshots
@@ -536,23 +645,17 @@ void CServer::DoSnapshot()
 		{
 			char aData[CSnapshot::MAX_SIZE];
 			CSnapshot *pData = (CSnapshot*)aData;	// Fix compiler warning for strict-aliasing
-			char aDeltaData[CSnapshot::MAX_SIZE];
-			char aCompData[CSnapshot::MAX_SIZE];
 			int SnapshotSize;
-			int Crc;
-			static CSnapshot EmptySnap;
 			CSnapshot *pDeltashot = &EmptySnap;
 			int DeltashotSize;
 			int DeltaTick = -1;
-			int DeltaSize;
 
-			m_SnapshotBuilder.Init();
+			m_SnapshotBuilder.InitFromBase();
 
 			GameServer()->OnSnap(i);
 
 			// finish snapshot
 			SnapshotSize = m_SnapshotBuilder.Finish(pData);
-			Crc = pData->Crc();
 
 			// remove old snapshos
 			// keep 3 seconds worth of snapshots
@@ -562,8 +665,6 @@ void CServer::DoSnapshot()
 			m_aClients[i].m_Snapshots.Add(m_CurrentGameTick, time_get(), SnapshotSize, pData, 0);
 
 			// find snapshot that we can perform delta against
-			EmptySnap.Clear();
-
 			{
 				DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, 0, &pDeltashot, 0);
 				if(DeltashotSize >= 0)
@@ -571,68 +672,40 @@ void CServer::DoSnapshot()
 				else
 				{
 					// no acked package found, force client to recover rate
+					pDeltashot = &EmptySnap;
 					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
 						m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
 				}
 			}
 
-			// create delta
-			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
-
-			if(DeltaSize > 0)
-			{
-				// compress it
-				int SnapshotSize;
-				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
-				int NumPackets;
-
-				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
-				NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
-
-				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
-				{
-					int Chunk = Left < MaxSize ? Left : MaxSize;
-					Left -= Chunk;
+			// create delta and compress it, works on the stored copy of the snapshot
+			CSnapshotTask *pTask = &m_aSnapshotTasks[NumTasks++];
+			pTask->m_pSnapshotDelta = &m_SnapshotDelta;
+			pTask->m_pFrom = pDeltashot;
+			pTask->m_pTo = m_aClients[i].m_Snapshots.m_pLast->m_pSnap;
+			pTask->m_ClientID = i;
+			pTask->m_DeltaTick = DeltaTick;
+			pTask->m_Timed = m_PerfTimers.Enabled();
+			m_SnapshotJobPool.Add(&pTask->m_Job, SnapshotDeltaJob, pTask);
+		}
+	}
 
-					if(NumPackets == 1)
-					{
-						CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick-DeltaTick);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n*MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-					else
-					{
-						CMsgPacker Msg(NETMSG_SNAP, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick-DeltaTick);
-						Msg.AddInt(NumPackets);
-						Msg.AddInt(n);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n*MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-				}
-			}
-			else
-			{
-				CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
-				Msg.AddInt(m_CurrentGameTick);
-				Msg.AddInt(m_CurrentGameTick-DeltaTick);
-				SendMsg(&Msg, MSGFLAG_FLUSH, i);
+	if(m_PerfTimers.Enabled())
+		m_PerfTimers.Add(m_aPerfSections[PERF_SNAP_BUILD], time_get()-BuildStart);
 
-				if(DeltaSize < 0)
-				{
-					char aBuf[64];
-					str_format(aBuf, sizeof(aBuf), "delta pack failed! (%d)", DeltaSize);
-					m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
-				}
-			}
+	// send in client order as soon as each delta is ready
+	for(int i = 0; i < NumTasks; i++)
+	{
+		CSnapshotTask *pTask = &m_aSnapshotTasks[i];
+		m_SnapshotJobPool.Wait(&pTask->m_Job);
+		if(pTask->m_Timed)
+		{
+			m_PerfTimers.Add(m_aPerfSections[PERF_SNAP_DELTA], pTask->m_DeltaTime);
+			m_PerfTimers.Add(m_aPerfSections[PERF_SNAP_COMPRESS], pTask->m_CompressTime);
 		}
+
+		CPerfScope SendScope(&m_PerfTimers, m_aPerfSections[PERF_SNAP_SEND]);
+		SendSnapshot(pTask);
 	}
 
 	GameServer()->OnPostSnap();
@@ -701,13 +774,109 @@ void CServer::SendMap(int ClientID)
 	CMsgPacker Msg(NETMSG_MAP_CHANGE, true);
 	Msg.AddString(GetMapName(), 0);
 	Msg.AddInt(m_CurrentMapCrc);
-	Msg.AddInt(m_CurrentMapSize);
+	Msg.AddInt(m_CurrentMapChunks.FileSize());
 	Msg.AddInt(m_MapChunksPerRequest);
 	Msg.AddInt(MAP_CHUNK_SIZE);
 	Msg.AddRaw(&m_CurrentMapSha256, sizeof(m_CurrentMapSha256));
 	SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, ClientID);
 }
 
+// sends the next prepared chunk of the map, returns its size in bytes
+int CServer::SendMapChunk(int ClientID)
+{
+	CClient *pClient = &m_aClients[ClientID];
+	int Chunk = pClient->m_MapChunk;
+
+	CNetChunk Packet;
+	mem_zero(&Packet, sizeof(CNetChunk));
+	Packet.m_ClientID = ClientID;
+	Packet.m_pData = m_CurrentMapChunks.Msg(Chunk);
+	Packet.m_DataSize = m_CurrentMapChunks.MsgSize(Chunk);
+	Packet.m_Flags = NETSENDFLAG_VITAL|NETSENDFLAG_FLUSH;
+	m_DemoRecorder.RecordMessage(Packet.m_pData, Packet.m_DataSize);
+	m_NetServer.Send(&Packet);
+
+	// check for last part
+	if(Chunk+1 >= m_CurrentMapChunks.NumChunks())
+	{
+		pClient->m_MapChunk = -1;
+		pClient->m_MapChunksLeft = 0;
+		m_MapDownloadCurrent.m_Completed++;
+	}
+	else
+	{
+		pClient->m_MapChunk++;
+		pClient->m_MapChunksLeft--;
+	}
+	m_MapDownloadCurrent.m_Bytes += Packet.m_DataSize;
+	m_MapDownloadCurrent.m_Chunks++;
+
+	if(Config()->m_Debug)
+	{
+		char aBuf[64];
+		str_format(aBuf, sizeof(aBuf), "sending chunk %d with size %d", Chunk, Packet.m_DataSize);
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
+	}
+	return Packet.m_DataSize;
+}
+
+// token buckets hold at most one tick worth of data, a chunk may overdraw them
+static int64 RefillTokens(int64 Tokens, int64 Rate, int64 Elapsed)
+{
+	if(!Rate)
+		return 0;
+	return minimum(Tokens+Elapsed*Rate/time_freq(), Rate/SERVER_TICK_SPEED);
+}
+
+// serves the requested map chunks once the snapshots of a tick are out. each
+// download is paced by its own token bucket and all of them by the upload
+// budget, so map data can only queue up so much in front of the next snapshots
+void CServer::SendMapChunks()
+{
+	CPerfScope Scope(&m_PerfTimers, m_aPerfSections[PERF_MAP_DOWNLOAD]);
+
+	int64 Now = time_get();
+	int64 Elapsed = minimum(Now-m_LastMapUpload, time_freq());
+	m_LastMapUpload = Now;
+
+	const int64 ClientRate = Config()->m_SvMapDownloadRate*(int64)1024;
+	const int64 UploadRate = Config()->m_SvMapUploadBudget*(int64)1024;
+	m_MapUploadTokens = RefillTokens(m_MapUploadTokens, UploadRate, Elapsed);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_aClients[i].m_MapTokens = RefillTokens(m_aClients[i].m_MapTokens, ClientRate, Elapsed);
+
+	// one chunk per client and round, starting with another client every tick
+	bool Sent = true;
+	while(Sent)
+	{
+		Sent = false;
+		for(int n = 0; n < MAX_CLIENTS && (!UploadRate || m_MapUploadTokens > 0); n++)
+		{
+			int ClientID = (m_FirstMapUploadClient+n)%MAX_CLIENTS;
+			CClient *pClient = &m_aClients[ClientID];
+			if((pClient->m_State != CClient::STATE_CONNECTING && pClient->m_State != CClient::STATE_CONNECTING_AS_SPEC) ||
+				pClient->m_MapChunksLeft <= 0 || pClient->m_MapChunk < 0 || (ClientRate && pClient->m_MapTokens <= 0))
+				continue;
+
+			int Size = SendMapChunk(ClientID);
+			pClient->m_MapTokens -= Size;
+			m_MapUploadTokens -= Size;
+			Sent = true;
+		}
+	}
+	m_FirstMapUploadClient = (m_FirstMapUploadClient+1)%MAX_CLIENTS;
+
+	if(Now >= m_MapDownloadNextSecond)
+	{
+		m_MapDownloadLastSecond = m_MapDownloadCurrent;
+		m_MapDownloadTotal.m_Bytes += m_MapDownloadCurrent.m_Bytes;
+		m_MapDownloadTotal.m_Chunks += m_MapDownloadCurrent.m_Chunks;
+		m_MapDownloadTotal.m_Completed += m_MapDownloadCurrent.m_Completed;
+		mem_zero(&m_MapDownloadCurrent, sizeof(m_MapDownloadCurrent));
+		m_MapDownloadNextSecond = Now+time_freq();
+	}
+}
+
 void CServer::SendConnectionReady(int ClientID)
 {
 	CMsgPacker Msg(NETMSG_CON_READY, true);
@@ -842,34 +1011,8 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 		{
 			if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0 && (m_aClients[ClientID].m_State == CClient::STATE_CONNECTING || m_aClients[ClientID].m_State == CClient::STATE_CONNECTING_AS_SPEC))
 			{
-				int ChunkSize = MAP_CHUNK_SIZE;
-
-				// send map chunks
-				for(int i = 0; i < m_MapChunksPerRequest && m_aClients[ClientID].m_MapChunk >= 0; ++i)
-				{
-					int Chunk = m_aClients[ClientID].m_MapChunk;
-					int Offset = Chunk * ChunkSize;
-
-					// check for last part
-					if(Offset+ChunkSize >= m_CurrentMapSize)
-					{
-						ChunkSize = m_CurrentMapSize-Offset;
-						m_aClients[ClientID].m_MapChunk = -1;
-					}
-					else
-						m_aClients[ClientID].m_MapChunk++;
-
-					CMsgPacker Msg(NETMSG_MAP_DATA, true);
-					Msg.AddRaw(&m_pCurrentMapData[Offset], ChunkSize);
-					SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, ClientID);
-
-					if(Config()->m_Debug)
-					{
-						char aBuf[64];
-						str_format(aBuf, sizeof(aBuf), "sending chunk %d with size %d", Chunk, ChunkSize);
-						Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
-					}
-				}
+				// the chunks go out after the next snapshots, see SendMapChunks
+				m_aClients[ClientID].m_MapChunksLeft = m_MapChunksPerRequest;
 			}
 		}
 		else if(Unpacker.Type() == NETMSG_READY)
@@ -1189,6 +1332,8 @@ void CServer::PumpNetwork()
 	}
 
 	m_ServerBan.Update();
+
+	CPerfScope EconScope(&m_PerfTimers, m_aPerfSections[PERF_NET_ECON]);
 	m_Econ.Update();
 }
 
@@ -1210,21 +1355,19 @@ void CServer::ChangeMap(const char *pMap)
 	m_MapReload = str_comp(Config()->m_SvMap, m_aCurrentMap) != 0;
 }
 
-int CServer::LoadMap(const char *pMapName)
+// takes the map that m_MapLoader is done with into use
+bool CServer::SwapMap()
 {
-	char aBuf[IO_MAX_PATH_LENGTH];
-	str_format(aBuf, sizeof(aBuf), "maps/%s.map", pMapName);
-
-	// check for valid standard map
-	if(!m_pMapChecker->ReadAndValidateMap(aBuf, IStorage::TYPE_ALL))
+	char aName[64];
+	str_copy(aName, m_MapLoader.Name(), sizeof(aName));
+	if(!m_MapLoader.Finish(m_pMap, &m_CurrentMapChunks))
 	{
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "mapchecker", "invalid standard map");
-		return 0;
+		char aBufMsg[256];
+		str_format(aBufMsg, sizeof(aBufMsg), "failed to load map. mapname='%s' error='%s'", aName, m_MapLoader.Error());
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBufMsg);
+		return false;
 	}
 
-	if(!m_pMap->Load(aBuf))
-		return 0;
-
 	// stop recording when we change map
 	if(m_DemoRecorder.IsRecording())
 		m_DemoRecorder.Stop();
@@ -1238,24 +1381,21 @@ int CServer::LoadMap(const char *pMapName)
 	char aSha256[SHA256_MAXSTRSIZE];
 	sha256_str(m_CurrentMapSha256, aSha256, sizeof(aSha256));
 	char aBufMsg[256];
-	str_format(aBufMsg, sizeof(aBufMsg), "%s sha256 is %s", aBuf, aSha256);
+	str_format(aBufMsg, sizeof(aBufMsg), "maps/%s.map sha256 is %s", aName, aSha256);
+	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBufMsg);
+	str_format(aBufMsg, sizeof(aBufMsg), "maps/%s.map crc is %08x", aName, m_CurrentMapCrc);
 	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBufMsg);
-	str_format(aBufMsg, sizeof(aBufMsg), "%s crc is %08x", aBuf, m_CurrentMapCrc);
+	str_format(aBufMsg, sizeof(aBufMsg), "maps/%s.map loaded in %d ms", aName, (int)(m_MapLoader.LoadTime()*1000/time_freq()));
 	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBufMsg);
 
-	str_copy(m_aCurrentMap, pMapName, sizeof(m_aCurrentMap));
+	str_copy(m_aCurrentMap, aName, sizeof(m_aCurrentMap));
+	return true;
+}
 
-	// load complete map into memory for download
-	{
-		IOHANDLE File = Storage()->OpenFile(aBuf, IOFLAG_READ, IStorage::TYPE_ALL);
-		m_CurrentMapSize = (int)io_length(File);
-		if(m_pCurrentMapData)
-			mem_free(m_pCurrentMapData);
-		m_pCurrentMapData = (unsigned char *)mem_alloc(m_CurrentMapSize);
-		io_read(File, m_pCurrentMapData, m_CurrentMapSize);
-		io_close(File);
-	}
-	return 1;
+int CServer::LoadMap(const char *pMapName)
+{
+	m_MapLoader.Start(pMapName, 0);
+	return SwapMap();
 }
 
 void CServer::InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, CConfig *pConfig, IConsole *pConsole)
@@ -1271,6 +1411,7 @@ void CServer::InitInterfaces(IKernel *pKernel)
 	m_pMap = pKernel->RequestInterface<IEngineMap>();
 	m_pMapChecker = pKernel->RequestInterface<IMapChecker>();
 	m_pStorage = pKernel->RequestInterface<IStorage>();
+	m_MapLoader.Init(m_pStorage, m_pMapChecker, MAP_CHUNK_SIZE);
 }
 
 int CServer::Run()
@@ -1314,6 +1455,8 @@ int CServer::Run()
 
 	m_Econ.Init(Config(), Console(), &m_ServerBan);
 
+	m_SnapshotJobPool.Init(Config()->m_SvSnapThreads, Config()->m_SvSnapThreadsCpu);
+
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "server name is '%s'", Config()->m_SvName);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
@@ -1344,13 +1487,18 @@ int CServer::Run()
 
 		while(m_RunServer)
 		{
-			// load new map
-			if(m_MapReload || m_CurrentGameTick >= 0x6FFFFFFF) //	force reload to make sure the ticks stay within a valid range
+			// load new map in the background, the current one keeps running until it's ready
+			if((m_MapReload || m_CurrentGameTick >= 0x6FFFFFFF) && !m_MapLoader.Pending()) //	force reload to make sure the ticks stay within a valid range
 			{
 				m_MapReload = false;
+				m_MapLoader.Start(Config()->m_SvMap, Kernel()->RequestInterface<IEngine>());
+			}
 
-				// load map
-				if(LoadMap(Config()->m_SvMap))
+			if(m_MapLoader.Done())
+			{
+				char aLoadedMap[64];
+				str_copy(aLoadedMap, m_MapLoader.Name(), sizeof(aLoadedMap));
+				if(SwapMap())
 				{
 					// new map loaded
 					bool aSpecs[MAX_CLIENTS];
@@ -1374,10 +1522,9 @@ int CServer::Run()
 					Kernel()->ReregisterInterface(GameServer());
 					GameServer()->OnInit();
 				}
-				else
+				else if(str_comp(Config()->m_SvMap, aLoadedMap) == 0)
 				{
-					str_format(aBuf, sizeof(aBuf), "failed to load map. mapname='%s'", Config()->m_SvMap);
-					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+					// keep the current map unless another one was set in the meantime
 					str_copy(Config()->m_SvMap, m_aCurrentMap, sizeof(Config()->m_SvMap));
 				}
 			}
@@ -1392,7 +1539,10 @@ int CServer::Run()
 				if((m_CurrentGameTick%2) == 0)
 					ShouldSnap = true;
 
+				CPerfScope TickScope(&m_PerfTimers, m_aPerfSections[PERF_TICK]);
+
 				// apply new input
+				int64 InputStart = m_PerfTimers.Enabled() ? time_get() : 0;
 				for(int c = 0; c < MAX_CLIENTS; c++)
 				{
 					if(m_aClients[c].m_State == CClient::STATE_EMPTY)
@@ -1407,7 +1557,10 @@ int CServer::Run()
 						}
 					}
 				}
+				if(m_PerfTimers.Enabled())
+					m_PerfTimers.Add(m_aPerfSections[PERF_TICK_INPUT], time_get()-InputStart);
 
+				CPerfScope GameScope(&m_PerfTimers, m_aPerfSections[PERF_TICK_GAME]);
 				GameServer()->OnTick();
 			}
 
@@ -1416,15 +1569,25 @@ int CServer::Run()
 			{
 				if(Config()->m_SvHighBandwidth || ShouldSnap)
 					DoSnapshot();
+				SendMapChunks();
 
 				UpdateClientRconCommands();
 				UpdateClientMapListEntries();
 			}
 
 			// master server stuff
-			m_Register.RegisterUpdate(m_NetServer.NetType());
+			{
+				CPerfScope RegisterScope(&m_PerfTimers, m_aPerfSections[PERF_REGISTER]);
+				m_Register.RegisterUpdate(m_NetServer.NetType());
+			}
+
+			{
+				CPerfScope NetScope(&m_PerfTimers, m_aPerfSections[PERF_NET]);
+				PumpNetwork();
+			}
 
-			PumpNetwork();
+			m_PerfTimers.SetEnabled(Config()->m_SvPerfTimers != 0);
+			m_PerfTimers.Update(time_get());
 
 			// wait for incoming data
 			m_NetServer.Wait(clamp(int((TickStartTime(m_CurrentGameTick+1)-time_get())*1000/time_freq()), 1, 1000/SERVER_TICK_SPEED/2));
@@ -1439,6 +1602,7 @@ int CServer::Run()
 	// disconnect all clients on shutdown
 	m_NetServer.Close(m_aShutdownReason);
 	m_Econ.Shutdown();
+	m_SnapshotJobPool.Shutdown();
 
 	GameServer()->OnShutdown();
 	Free();
@@ -1448,16 +1612,14 @@ int CServer::Run()
 
 void CServer::Free()
 {
+	m_MapLoader.Wait();
+
 	if(m_pMap)
 	{
 		m_pMap->Unload();
 	}
 
-	if(m_pCurrentMapData)
-	{
-		mem_free(m_pCurrentMapData);
-		m_pCurrentMapData = 0;
-	}
+	m_CurrentMapChunks.Clear();
 }
 
 struct CSubdirCallbackUserdata
@@ -1584,7 +1746,7 @@ void CServer::DemoRecorder_HandleAutoStart()
 		char aDate[20];
 		str_timestamp(aDate, sizeof(aDate));
 		str_format(aFilename, sizeof(aFilename), "demos/%s_%s.demo", "auto/autorecord", aDate);
-		m_DemoRecorder.Start(aFilename, GameServer()->NetVersion(), m_aCurrentMap, m_CurrentMapSha256, m_CurrentMapCrc, "server");
+		m_DemoRecorder.Start(aFilename, GameServer()->NetVersion(), m_aCurrentMap, m_CurrentMapSha256, m_CurrentMapCrc, "server", Config()->m_SvDemoKeyframeInterval);
 		if(Config()->m_SvAutoDemoMax)
 		{
 			// clean up auto recorded demos
@@ -1611,7 +1773,7 @@ void CServer::ConRecord(IConsole::IResult *pResult, void *pUser)
 		str_timestamp(aDate, sizeof(aDate));
 		str_format(aFilename, sizeof(aFilename), "demos/demo_%s.demo", aDate);
 	}
-	pServer->m_DemoRecorder.Start(aFilename, pServer->GameServer()->NetVersion(), pServer->m_aCurrentMap, pServer->m_CurrentMapSha256, pServer->m_CurrentMapCrc, "server");
+	pServer->m_DemoRecorder.Start(aFilename, pServer->GameServer()->NetVersion(), pServer->m_aCurrentMap, pServer->m_CurrentMapSha256, pServer->m_CurrentMapCrc, "server", pServer->Config()->m_SvDemoKeyframeInterval);
 }
 
 void CServer::ConStopRecord(IConsole::IResult *pResult, void *pUser)
@@ -1624,6 +1786,75 @@ void CServer::ConMapReload(IConsole::IResult *pResult, void *pUser)
 	((CServer *)pUser)->m_MapReload = true;
 }
 
+void CServer::ConPerf(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	CPerfTimers *pTimers = &pThis->m_PerfTimers;
+	if(!pTimers->Enabled())
+	{
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", "timers are disabled, enable them with sv_perf_timers 1");
+		return;
+	}
+
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", "section                   count   p50 us   p99 us   max us  total us");
+
+	// sorted by name, sub sections follow their parent
+	const char *pLast = "";
+	for(int n = 0; n < pTimers->NumSections(); n++)
+	{
+		int Next = -1;
+		for(int i = 0; i < pTimers->NumSections(); i++)
+			if(str_comp(pTimers->Name(i), pLast) > 0 && (Next == -1 || str_comp(pTimers->Name(i), pTimers->Name(Next)) < 0))
+				Next = i;
+		if(Next == -1)
+			break;
+		pLast = pTimers->Name(Next);
+
+		int Depth = 0;
+		const char *pName = pLast;
+		for(const char *p = pLast; *p; p++)
+			if(*p == '.')
+			{
+				Depth++;
+				pName = p+1;
+			}
+
+		char aName[64];
+		str_format(aName, sizeof(aName), "%*s%s", Depth*2, "", pName);
+		const CPerfTimers::CResult *pResult = pTimers->Result(Next);
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%-24s %6d %8d %8d %8d %9lld", aName, pResult->m_Count, pResult->m_P50, pResult->m_P99, pResult->m_Max, pResult->m_Total);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", aBuf);
+	}
+}
+
+void CServer::ConMapDownloads(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+
+	int Active = 0;
+	int Queued = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CClient *pClient = &pThis->m_aClients[i];
+		if((pClient->m_State != CClient::STATE_CONNECTING && pClient->m_State != CClient::STATE_CONNECTING_AS_SPEC) || pClient->m_MapChunk < 0)
+			continue;
+		Active++;
+		if(pClient->m_MapChunksLeft > 0)
+			Queued++;
+	}
+
+	char aBuf[256];
+	const CMapDownloadStats *pLast = &pThis->m_MapDownloadLastSecond;
+	const CMapDownloadStats *pTotal = &pThis->m_MapDownloadTotal;
+	str_format(aBuf, sizeof(aBuf), "downloads=%d queued=%d map_size=%d chunks=%d", Active, Queued, pThis->m_CurrentMapChunks.FileSize(), pThis->m_CurrentMapChunks.NumChunks());
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "map_download", aBuf);
+	str_format(aBuf, sizeof(aBuf), "last second: %d KiB/s chunks=%d completed=%d", (int)(pLast->m_Bytes/1024), pLast->m_Chunks, pLast->m_Completed);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "map_download", aBuf);
+	str_format(aBuf, sizeof(aBuf), "total: %lld KiB chunks=%d completed=%d", pTotal->m_Bytes/1024, pTotal->m_Chunks, pTotal->m_Completed);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "map_download", aBuf);
+}
+
 void CServer::ConLogout(IConsole::IResult *pResult, void *pUser)
 {
 	CServer *pServer = (CServer *)pUser;
@@ -1757,6 +1988,9 @@ void CServer::RegisterCommands()
 
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
 
+	Console()->Register("sv_perf", "", CFGFLAG_SERVER|CFGFLAG_ECON, ConPerf, this, "Show how long the parts of a server tick took in the last second");
+	Console()->Register("sv_map_downloads", "", CFGFLAG_SERVER|CFGFLAG_ECON, ConMapDownloads, this, "Show the running map downloads and their throughput");
+
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
 
@@ -1794,6 +2028,26 @@ void *CServer::SnapNewItem(int Type, int ID, int Size)
 	return ID < 0 ? 0 : m_SnapshotBuilder.NewItem(Type, ID, Size);
 }
 
+int CServer::SnapNumItems() const
+{
+	return m_SnapshotBuilder.NumItems();
+}
+
+void CServer::SnapHideItems(int First, int Num)
+{
+	m_SnapshotBuilder.HideItems(First, Num);
+}
+
+void CServer::SnapSkipItem(int Index)
+{
+	m_SnapshotBuilder.SkipItem(Index);
+}
+
+void CServer::SnapKeepItem(int Index)
+{
+	m_SnapshotBuilder.KeepItem(Index);
+}
+
 void CServer::SnapSetStaticsize(int ItemType, int Size)
 {
 	m_SnapshotDelta.SetStaticsize(ItemType, Size);
@@ -6,7 +6,9 @@
 #include <base/tl/sorted_array.h>
 
 #include <engine/server.h>
+#include <engine/shared/maploader.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/perf.h>
 
 class CSnapIDPool
 {
@@ -134,6 +136,8 @@ public:
 		int m_AuthTries;
 
 		int m_MapChunk;
+		int m_MapChunksLeft; // requested but not yet sent
+		int64 m_MapTokens; // bytes the download may send, see sv_map_download_rate
 		bool m_NoRconNote;
 		bool m_Quitting;
 		const IConsole::CCommandInfo *m_pRconCmdToSend;
@@ -144,6 +148,48 @@ public:
 
 	CClient m_aClients[MAX_CLIENTS];
 
+	// delta and compression of one client's snapshot, done on the job pool
+	class CSnapshotTask
+	{
+	public:
+		CJob m_Job;
+		CSnapshotDelta *m_pSnapshotDelta;
+		const CSnapshot *m_pFrom;
+		CSnapshot *m_pTo;
+		int m_ClientID;
+		int m_DeltaTick;
+		int m_Crc;
+		int m_DeltaSize;
+		int m_CompSize;
+		bool m_Timed;
+		int64 m_DeltaTime;
+		int64 m_CompressTime;
+		char m_aDeltaData[CSnapshot::MAX_SIZE];
+		char m_aCompData[CSnapshot::MAX_SIZE];
+	};
+
+	CSnapshotTask m_aSnapshotTasks[MAX_CLIENTS];
+	CJobPool m_SnapshotJobPool;
+
+	enum
+	{
+		PERF_TICK=0,
+		PERF_TICK_INPUT,
+		PERF_TICK_GAME,
+		PERF_SNAP,
+		PERF_SNAP_BUILD,
+		PERF_SNAP_DELTA,
+		PERF_SNAP_COMPRESS,
+		PERF_SNAP_SEND,
+		PERF_MAP_DOWNLOAD,
+		PERF_NET,
+		PERF_NET_ECON,
+		PERF_REGISTER,
+		NUM_PERF_SECTIONS
+	};
+	CPerfTimers m_PerfTimers;
+	int m_aPerfSections[NUM_PERF_SECTIONS];
+
 	CSnapshotDelta m_SnapshotDelta;
 	CSnapshotBuilder m_SnapshotBuilder;
 	CSnapIDPool m_IDPool;
@@ -170,9 +216,24 @@ public:
 	char m_aCurrentMap[64];
 	SHA256_DIGEST m_CurrentMapSha256;
 	unsigned m_CurrentMapCrc;
-	unsigned char *m_pCurrentMapData;
-	int m_CurrentMapSize;
+	CMapChunks m_CurrentMapChunks;
 	int m_MapChunksPerRequest;
+	CMapLoader m_MapLoader;
+
+	// map downloads share the upload budget, see sv_map_upload_budget
+	struct CMapDownloadStats
+	{
+		int64 m_Bytes;
+		int m_Chunks;
+		int m_Completed;
+	};
+	int64 m_MapUploadTokens;
+	int64 m_LastMapUpload;
+	int m_FirstMapUploadClient;
+	int64 m_MapDownloadNextSecond;
+	CMapDownloadStats m_MapDownloadCurrent;
+	CMapDownloadStats m_MapDownloadLastSecond;
+	CMapDownloadStats m_MapDownloadTotal;
 
 	// maplist
 	struct CMapListEntry
@@ -223,12 +284,16 @@ public:
 
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID);
 
+	static int SnapshotDeltaJob(void *pUser);
+	void SendSnapshot(const CSnapshotTask *pTask);
 	void DoSnapshot();
 
 	static int NewClientCallback(int ClientID, void *pUser);
 	static int DelClientCallback(int ClientID, const char *pReason, void *pUser);
 
 	void SendMap(int ClientID);
+	int SendMapChunk(int ClientID);
+	void SendMapChunks();
 	void SendConnectionReady(int ClientID);
 	void SendRconLine(int ClientID, const char *pLine);
 	static void SendRconLineAuthed(const char *pLine, void *pUser, bool Highlighted);
@@ -249,6 +314,7 @@ public:
 
 	virtual void ChangeMap(const char *pMap);
 	const char *GetMapName();
+	bool SwapMap();
 	int LoadMap(const char *pMapName);
 
 	void InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, CConfig *pConfig, IConsole *pConsole);
@@ -267,6 +333,8 @@ public:
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
 	static void ConSaveConfig(IConsole::IResult *pResult, void *pUser);
 	static void ConLogout(IConsole::IResult *pResult, void *pUser);
+	static void ConPerf(IConsole::IResult *pResult, void *pUser);
+	static void ConMapDownloads(IConsole::IResult *pResult, void *pUser);
 	static void ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainPlayerSlotsUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainMaxclientsUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -282,7 +350,13 @@ public:
 	virtual int SnapNewID();
 	virtual void SnapFreeID(int ID);
 	virtual void *SnapNewItem(int Type, int ID, int Size);
+	virtual int SnapNumItems() const;
+	virtual void SnapHideItems(int First, int Num);
+	virtual void SnapSkipItem(int Index);
+	virtual void SnapKeepItem(int Index);
 	void SnapSetStaticsize(int ItemType, int Size);
+
+	virtual CPerfTimers *PerfTimers() { return &m_PerfTimers; }
 };
 
 #endif
@@ -57,79 +57,227 @@ struct CDatafileInfo
 	char *m_pDataStart;
 };
 
-struct CDatafile
+// the raw contents of a datafile. readers that open the same file share one
+// mapping, items are handed out straight from it
+struct CDatafileMapping
 {
-	IOHANDLE m_File;
+	char m_aFullPath[IO_MAX_PATH_LENGTH];
+	time_t m_Modified;
+	int m_RefCount;
+	char *m_pData;
+	unsigned m_Size;
+	bool m_Mapped; // false if the file was read into memory
 	SHA256_DIGEST m_Sha256;
 	unsigned m_Crc;
+	CDatafileMapping *m_pNext;
+};
+
+class CDatafileMappings
+{
+	LOCK m_Lock;
+	CDatafileMapping *m_pFirst;
+
+	static CDatafileMapping *Create(IOHANDLE File, bool Map)
+	{
+		CDatafileMapping *pMapping = new CDatafileMapping;
+		pMapping->m_RefCount = 1;
+		pMapping->m_Size = 0;
+		pMapping->m_pData = Map ? (char *)io_map(File, &pMapping->m_Size) : 0;
+		pMapping->m_Mapped = pMapping->m_pData != 0;
+		if(!pMapping->m_pData)
+		{
+			void *pData;
+			io_read_all(File, &pData, &pMapping->m_Size);
+			pMapping->m_pData = (char *)pData;
+		}
+
+		// take the hashes of the file and store them
+		SHA256_CTX Sha256Ctx;
+		sha256_init(&Sha256Ctx);
+		sha256_update(&Sha256Ctx, pMapping->m_pData, pMapping->m_Size);
+		pMapping->m_Sha256 = sha256_finish(&Sha256Ctx);
+		pMapping->m_Crc = crc32(crc32(0L, 0x0, 0), (const Bytef *)pMapping->m_pData, pMapping->m_Size);
+
+#if defined(CONF_ARCH_ENDIAN_BIG)
+		// the header and the item section are stored as little endian ints,
+		// swap them once for all readers. the mapping is copy on write
+		if(pMapping->m_Size >= sizeof(CDatafileHeader))
+		{
+			CDatafileHeader *pHeader = (CDatafileHeader *)pMapping->m_pData;
+			swap_endian(&pHeader->m_Version, sizeof(int), sizeof(CDatafileHeader)/sizeof(int)-1);
+			unsigned SwapSize = minimum(static_cast<unsigned>(pHeader->m_Swaplen), pMapping->m_Size-static_cast<unsigned>(sizeof(CDatafileHeader)));
+			swap_endian(pHeader+1, sizeof(int), SwapSize/sizeof(int));
+		}
+#endif
+		return pMapping;
+	}
+
+	static void Destroy(CDatafileMapping *pMapping)
+	{
+		if(pMapping->m_Mapped)
+			io_unmap(pMapping->m_pData, pMapping->m_Size);
+		else
+			mem_free(pMapping->m_pData);
+		delete pMapping;
+	}
+
+public:
+	CDatafileMappings() : m_Lock(lock_create()), m_pFirst(0) {}
+	~CDatafileMappings() { lock_destroy(m_Lock); }
+
+	CDatafileMapping *Acquire(IOHANDLE File, const char *pFullPath, bool Map)
+	{
+		time_t Created, Modified;
+		if(fs_file_time(pFullPath, &Created, &Modified) != 0)
+			Modified = 0;
+		const unsigned Size = (unsigned)io_length(File);
+
+		lock_wait(m_Lock);
+		for(CDatafileMapping *pMapping = m_pFirst; pMapping; pMapping = pMapping->m_pNext)
+		{
+			if(pMapping->m_Size == Size && pMapping->m_Modified == Modified && str_comp(pMapping->m_aFullPath, pFullPath) == 0)
+			{
+				pMapping->m_RefCount++;
+				lock_unlock(m_Lock);
+				return pMapping;
+			}
+		}
+		lock_unlock(m_Lock);
+
+		CDatafileMapping *pMapping = Create(File, Map);
+		str_copy(pMapping->m_aFullPath, pFullPath, sizeof(pMapping->m_aFullPath));
+		pMapping->m_Modified = Modified;
+
+		lock_wait(m_Lock);
+		pMapping->m_pNext = m_pFirst;
+		m_pFirst = pMapping;
+		lock_unlock(m_Lock);
+		return pMapping;
+	}
+
+	void Release(CDatafileMapping *pMapping)
+	{
+		lock_wait(m_Lock);
+		if(--pMapping->m_RefCount > 0)
+		{
+			lock_unlock(m_Lock);
+			return;
+		}
+		for(CDatafileMapping **ppMapping = &m_pFirst; *ppMapping; ppMapping = &(*ppMapping)->m_pNext)
+		{
+			if(*ppMapping == pMapping)
+			{
+				*ppMapping = pMapping->m_pNext;
+				break;
+			}
+		}
+		lock_unlock(m_Lock);
+		Destroy(pMapping);
+	}
+
+	int Num()
+	{
+		int Num = 0;
+		lock_wait(m_Lock);
+		for(CDatafileMapping *pMapping = m_pFirst; pMapping; pMapping = pMapping->m_pNext)
+			Num++;
+		lock_unlock(m_Lock);
+		return Num;
+	}
+};
+
+static CDatafileMappings gs_Mappings;
+
+// a mapped file that is truncated or rewritten in place kills the reader with
+// SIGBUS. the editor saves into the user directory, so only files outside of
+// it are mapped. downloaded maps are renamed into place once complete and are
+// safe as well. small files and files that don't have the size their header
+// claims are read into memory instead.
+// this leaves the data directories: their files come with the game or are put
+// there by the admin, and overwriting one in place while it is open still
+// crashes. replacing it with a new file (e.g. copy and rename) is fine
+static bool CanMapFile(IStorage *pStorage, IOHANDLE File, const char *pFullPath)
+{
+	enum
+	{
+		MIN_MAPPED_SIZE=64*1024,
+	};
+
+	const long int Length = io_length(File);
+	if(Length < MIN_MAPPED_SIZE)
+		return false;
+
+	char aSavePath[IO_MAX_PATH_LENGTH];
+	pStorage->GetCompletePath(IStorage::TYPE_SAVE, "", aSavePath, sizeof(aSavePath));
+	const char *pSavePath = str_startswith(pFullPath, aSavePath);
+	if(pSavePath && !str_startswith(pSavePath, "downloadedmaps/"))
+		return false;
+
+	CDatafileHeader Header;
+	const bool Read = io_read(File, &Header, sizeof(Header)) == sizeof(Header);
+	io_seek(File, 0, IOSEEK_START);
+	if(!Read)
+		return false;
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	swap_endian(&Header.m_Size, sizeof(int), 1);
+#endif
+	// the size field doesn't count the signature, the version and itself
+	return Header.m_Size >= 0 && Header.m_Size + 16 == Length;
+}
+
+struct CDatafile
+{
+	CDatafileMapping *m_pMapping;
 	CDatafileInfo m_Info;
 	CDatafileHeader m_Header;
 	int m_DataStartOffset;
 	char **m_ppDataPtrs;
 	int *m_pDataSizes;
-	char *m_pData;
 };
 
 bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
 {
 	dbg_msg("datafile", "loading. filename='%s'", pFilename);
 
-	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType);
+	char aFullPath[IO_MAX_PATH_LENGTH];
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aFullPath, sizeof(aFullPath));
 	if(!File)
 	{
 		dbg_msg("datafile", "could not open '%s'", pFilename);
 		return false;
 	}
 
+	// the mapping stays valid after the file is closed
+	CDatafileMapping *pMapping = gs_Mappings.Acquire(File, aFullPath, CanMapFile(pStorage, File, aFullPath));
+	io_close(File);
 
-	// take the hashes of the file and store them
-	SHA256_CTX Sha256Ctx;
-	sha256_init(&Sha256Ctx);
-	unsigned Crc = crc32(0L, 0x0, 0);
+	if(pMapping->m_Size < sizeof(CDatafileHeader))
 	{
-		enum
-		{
-			BUFFER_SIZE = 64*1024
-		};
-
-		unsigned char aBuffer[BUFFER_SIZE];
-
-		while(1)
-		{
-			unsigned Bytes = io_read(File, aBuffer, BUFFER_SIZE);
-			if(Bytes == 0)
-				break;
-			sha256_update(&Sha256Ctx, aBuffer, Bytes);
-			Crc = crc32(Crc, aBuffer, Bytes);
-		}
-
-		io_seek(File, 0, IOSEEK_START);
+		dbg_msg("datafile", "file too small. size=%u", pMapping->m_Size);
+		gs_Mappings.Release(pMapping);
+		return false;
 	}
 
 	// TODO: change this header
-	CDatafileHeader Header;
-	io_read(File, &Header, sizeof(Header));
+	CDatafileHeader Header = *(CDatafileHeader *)pMapping->m_pData;
 	if(Header.m_aID[0] != 'A' || Header.m_aID[1] != 'T' || Header.m_aID[2] != 'A' || Header.m_aID[3] != 'D')
 	{
 		if(Header.m_aID[0] != 'D' || Header.m_aID[1] != 'A' || Header.m_aID[2] != 'T' || Header.m_aID[3] != 'A')
 		{
 			dbg_msg("datafile", "wrong signature. %x %x %x %x", Header.m_aID[0], Header.m_aID[1], Header.m_aID[2], Header.m_aID[3]);
-			io_close(File);
-			return 0;
+			gs_Mappings.Release(pMapping);
+			return false;
 		}
 	}
 
-#if defined(CONF_ARCH_ENDIAN_BIG)
-	swap_endian(&Header, sizeof(int), sizeof(Header)/sizeof(int));
-#endif
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
 		dbg_msg("datafile", "wrong version. version=%x", Header.m_Version);
-		io_close(File);
-		return 0;
+		gs_Mappings.Release(pMapping);
+		return false;
 	}
 
-	// read in the rest except the data
+	// the rest except the data is used in place
 	int64 Size = 0;
 	Size += Header.m_NumItemTypes*sizeof(CDatafileItemType);
 	Size += (Header.m_NumItems+Header.m_NumRawData)*sizeof(int);
@@ -137,58 +285,46 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		Size += Header.m_NumRawData*sizeof(int); // v4 has uncompressed data sizes aswell
 	Size += Header.m_ItemSize;
 
-	int64 AllocSize = Size;
+	int64 AllocSize = 0;
 	AllocSize += sizeof(CDatafile); // add space for info structure
 	AllocSize += Header.m_NumRawData*sizeof(void*); // add space for data pointers
 	AllocSize += Header.m_NumRawData*sizeof(int); // add space for data sizes
 	if(Size > (int64(1)<<31) || Header.m_NumItemTypes < 0 || Header.m_NumItems < 0 || Header.m_NumRawData < 0 || Header.m_ItemSize < 0)
 	{
-		io_close(File);
+		gs_Mappings.Release(pMapping);
 		dbg_msg("datafile", "unable to load file, invalid file information");
 		return false;
 	}
+	if(sizeof(CDatafileHeader)+Size > pMapping->m_Size)
+	{
+		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", unsigned(Size), unsigned(pMapping->m_Size-sizeof(CDatafileHeader)));
+		gs_Mappings.Release(pMapping);
+		return false;
+	}
 
 	CDatafile *pTmpDataFile = (CDatafile*)mem_alloc(AllocSize);
 	pTmpDataFile->m_Header = Header;
 	pTmpDataFile->m_DataStartOffset = sizeof(CDatafileHeader) + Size;
 	pTmpDataFile->m_ppDataPtrs = (char **)(pTmpDataFile+1);
 	pTmpDataFile->m_pDataSizes = (int *)(pTmpDataFile->m_ppDataPtrs + Header.m_NumRawData);
-	pTmpDataFile->m_pData = (char *)(pTmpDataFile->m_pDataSizes + Header.m_NumRawData);
-	pTmpDataFile->m_File = File;
-	pTmpDataFile->m_Sha256 = sha256_finish(&Sha256Ctx);
-	pTmpDataFile->m_Crc = Crc;
+	pTmpDataFile->m_pMapping = pMapping;
 
 	// clear the data pointers and sizes
 	mem_zero(pTmpDataFile->m_ppDataPtrs, Header.m_NumRawData*sizeof(void*));
 	mem_zero(pTmpDataFile->m_pDataSizes, Header.m_NumRawData*sizeof(int));
 
-	// read types, offsets, sizes and item data
-	unsigned ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
-	if(ReadSize != Size)
-	{
-		io_close(pTmpDataFile->m_File);
-		mem_free(pTmpDataFile);
-		pTmpDataFile = 0;
-		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", unsigned(Size), ReadSize);
-		return false;
-	}
-
 	Close();
 	m_pDataFile = pTmpDataFile;
 
-#if defined(CONF_ARCH_ENDIAN_BIG)
-	swap_endian(m_pDataFile->m_pData, sizeof(int), minimum(static_cast<unsigned>(Header.m_Swaplen), static_cast<unsigned>(Size)) / sizeof(int));
-#endif
-
 	//if(DEBUG)
 	{
 		dbg_msg("datafile", "allocsize=%d", unsigned(AllocSize));
-		dbg_msg("datafile", "readsize=%d", ReadSize);
+		dbg_msg("datafile", "filesize=%u mapped=%d shared=%d", pMapping->m_Size, pMapping->m_Mapped, pMapping->m_RefCount > 1);
 		dbg_msg("datafile", "swaplen=%d", Header.m_Swaplen);
 		dbg_msg("datafile", "item_size=%d", m_pDataFile->m_Header.m_ItemSize);
 	}
 
-	m_pDataFile->m_Info.m_pItemTypes = (CDatafileItemType *)m_pDataFile->m_pData;
+	m_pDataFile->m_Info.m_pItemTypes = (CDatafileItemType *)(pMapping->m_pData+sizeof(CDatafileHeader));
 	m_pDataFile->m_Info.m_pItemOffsets = (int *)&m_pDataFile->m_Info.m_pItemTypes[m_pDataFile->m_Header.m_NumItemTypes];
 	m_pDataFile->m_Info.m_pDataOffsets = (int *)&m_pDataFile->m_Info.m_pItemOffsets[m_pDataFile->m_Header.m_NumItems];
 	m_pDataFile->m_Info.m_pDataSizes = (int *)&m_pDataFile->m_Info.m_pDataOffsets[m_pDataFile->m_Header.m_NumRawData];
@@ -286,16 +422,22 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 	// load it if needed
 	if(!m_pDataFile->m_ppDataPtrs[Index])
 	{
-		// fetch the data size
+		// fetch the data size and find it in the mapping
 		int DataSize = GetFileDataSize(Index);
+		int64 FileOffset = m_pDataFile->m_DataStartOffset+(int64)m_pDataFile->m_Info.m_pDataOffsets[Index];
+		if(DataSize < 0 || m_pDataFile->m_Info.m_pDataOffsets[Index] < 0 || FileOffset+DataSize > m_pDataFile->m_pMapping->m_Size)
+		{
+			dbg_msg("datafile", "data index=%d is outside of the file. offset=%d size=%d", Index, int(FileOffset), DataSize);
+			return 0;
+		}
+		const char *pFileData = m_pDataFile->m_pMapping->m_pData+FileOffset;
 #if defined(CONF_ARCH_ENDIAN_BIG)
 		int SwapSize = DataSize;
 #endif
 
 		if(m_pDataFile->m_Header.m_Version == 4)
 		{
-			// v4 has compressed data
-			void *pTemp = (char *)mem_alloc(DataSize);
+			// v4 has compressed data, inflate it straight from the mapping
 			unsigned long UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
 			unsigned long s;
 
@@ -303,28 +445,20 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 			m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(UncompressedSize);
 			m_pDataFile->m_pDataSizes[Index] = UncompressedSize;
 
-			// read the compressed data
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, pTemp, DataSize);
-
-			// decompress the data, TODO: check for errors
 			s = UncompressedSize;
-			uncompress((Bytef*)m_pDataFile->m_ppDataPtrs[Index], &s, (Bytef*)pTemp, DataSize);
+			if(uncompress((Bytef*)m_pDataFile->m_ppDataPtrs[Index], &s, (const Bytef*)pFileData, DataSize) != Z_OK)
+				dbg_msg("datafile", "failed to decompress data index=%d", Index);
 #if defined(CONF_ARCH_ENDIAN_BIG)
 			SwapSize = s;
 #endif
-
-			// clean up the temporary buffers
-			mem_free(pTemp);
 		}
 		else
 		{
-			// load the data
+			// copy the data, the mapping is shared with other readers
 			dbg_msg("datafile", "loading data index=%d size=%d", Index, DataSize);
 			m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(DataSize);
 			m_pDataFile->m_pDataSizes[Index] = DataSize;
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
+			mem_copy(m_pDataFile->m_ppDataPtrs[Index], pFileData, DataSize);
 		}
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
@@ -461,22 +595,39 @@ bool CDataFileReader::Close()
 		m_pDataFile->m_pDataSizes[i] = 0;
 	}
 
-	io_close(m_pDataFile->m_File);
+	gs_Mappings.Release(m_pDataFile->m_pMapping);
 	mem_free(m_pDataFile);
 	m_pDataFile = 0;
 	return true;
 }
 
+void CDataFileReader::Swap(CDataFileReader *pOther)
+{
+	CDatafile *pDataFile = m_pDataFile;
+	m_pDataFile = pOther->m_pDataFile;
+	pOther->m_pDataFile = pDataFile;
+}
+
 SHA256_DIGEST CDataFileReader::Sha256() const
 {
 	if(!m_pDataFile) return SHA256_ZEROED;
-	return m_pDataFile->m_Sha256;
+	return m_pDataFile->m_pMapping->m_Sha256;
 }
 
 unsigned CDataFileReader::Crc() const
 {
 	if(!m_pDataFile) return 0xFFFFFFFF;
-	return m_pDataFile->m_Crc;
+	return m_pDataFile->m_pMapping->m_Crc;
+}
+
+bool CDataFileReader::Mapped() const
+{
+	return m_pDataFile && m_pDataFile->m_pMapping->m_Mapped;
+}
+
+int CDataFileReader::NumSharedFiles()
+{
+	return gs_Mappings.Num();
 }
 
 bool CDataFileReader::CheckSha256(IOHANDLE Handle, const void *pSha256)
@@ -21,6 +21,7 @@ public:
 
 	bool Open(class IStorage *pStorage, const char *pFilename, int StorageType);
 	bool Close();
+	void Swap(CDataFileReader *pOther);
 
 	void *GetData(int Index);
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
@@ -37,6 +38,10 @@ public:
 
 	SHA256_DIGEST Sha256() const;
 	unsigned Crc() const;
+	bool Mapped() const; // the file is mapped instead of read into memory
+
+	// number of files held open by readers, each counted once however many readers share it
+	static int NumSharedFiles();
 
 	static bool CheckSha256(IOHANDLE Handle, const void *pSha256);
 };
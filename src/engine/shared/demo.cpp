@@ -19,6 +19,8 @@ static const unsigned char gs_OldVersion = 4;
 static const unsigned char gs_VersionTickCompression = 5; // demo files with this version or higher will use `CHUNKTICKFLAG_TICK_COMPRESSED`
 static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
+static const unsigned char gs_aIndexMarker[4] = {'T', 'W', 'I', 'X'};
+static const int gs_IndexVersion = 1;
 
 CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta)
 {
@@ -35,7 +37,7 @@ void CDemoRecorder::Init(class IConsole *pConsole, class IStorage *pStorage)
 }
 
 // Record
-int CDemoRecorder::Start(const char *pFilename, const char *pNetVersion, const char *pMap, SHA256_DIGEST Sha256, unsigned Crc, const char *pType)
+int CDemoRecorder::Start(const char *pFilename, const char *pNetVersion, const char *pMap, SHA256_DIGEST Sha256, unsigned Crc, const char *pType, int KeyFrameInterval)
 {
 	CDemoHeader Header;
 	if(m_File)
@@ -118,9 +120,11 @@ int CDemoRecorder::Start(const char *pFilename, const char *pNetVersion, const c
 	io_close(MapFile);
 
 	m_LastKeyFrame = -1;
+	m_KeyFrameInterval = maximum(KeyFrameInterval, 1);
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
 	m_NumTimelineMarkers = 0;
+	m_lKeyFrames.clear();
 
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
@@ -153,6 +157,7 @@ enum
 	CHUNKMASK_TYPE = 0x60,
 	CHUNKMASK_SIZE = 0x1f,
 
+	CHUNKTYPE_INDEX = 0, // only at the end of the file, players before the index skip it
 	CHUNKTYPE_SNAPSHOT = 1,
 	CHUNKTYPE_MESSAGE = 2,
 	CHUNKTYPE_DELTA = 3,
@@ -185,6 +190,33 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 		m_FirstTick = Tick;
 }
 
+static void WriteChunkHeader(IOHANDLE File, int Type, int Size)
+{
+	unsigned char aChunk[3];
+	aChunk[0] = ((Type&0x3)<<5);
+	if(Size < 30)
+	{
+		aChunk[0] |= Size;
+		io_write(File, aChunk, 1);
+	}
+	else
+	{
+		if(Size < 256)
+		{
+			aChunk[0] |= 30;
+			aChunk[1] = Size&0xff;
+			io_write(File, aChunk, 2);
+		}
+		else
+		{
+			aChunk[0] |= 31;
+			aChunk[1] = Size&0xff;
+			aChunk[2] = Size>>8;
+			io_write(File, aChunk, 3);
+		}
+	}
+}
+
 void CDemoRecorder::Write(int Type, const void *pData, int Size)
 {
 	if(!m_File)
@@ -211,30 +243,7 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 		return;
 	}
 
-	unsigned char aChunk[3];
-	aChunk[0] = ((Type&0x3)<<5);
-	if(Size < 30)
-	{
-		aChunk[0] |= Size;
-		io_write(m_File, aChunk, 1);
-	}
-	else
-	{
-		if(Size < 256)
-		{
-			aChunk[0] |= 30;
-			aChunk[1] = Size&0xff;
-			io_write(m_File, aChunk, 2);
-		}
-		else
-		{
-			aChunk[0] |= 31;
-			aChunk[1] = Size&0xff;
-			aChunk[2] = Size>>8;
-			io_write(m_File, aChunk, 3);
-		}
-	}
-
+	WriteChunkHeader(m_File, Type, Size);
 	io_write(m_File, aBuffer2, Size);
 }
 
@@ -242,8 +251,14 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 {
 	char aTmpData[CSnapshot::MAX_SIZE];
 
-	if(m_LastKeyFrame == -1 || (Tick-m_LastKeyFrame) > SERVER_TICK_SPEED*5)
+	if(m_LastKeyFrame == -1 || Tick-m_LastKeyFrame > m_KeyFrameInterval)
 	{
+		// remember it for the index
+		CDemoKeyFrame KeyFrame;
+		KeyFrame.m_Filepos = io_tell(m_File);
+		KeyFrame.m_Tick = Tick;
+		m_lKeyFrames.add(KeyFrame);
+
 		// write full tickmarker
 		WriteTickMarker(Tick, 1);
 
@@ -275,6 +290,72 @@ void CDemoRecorder::RecordMessage(const void *pData, int Size)
 	Write(CHUNKTYPE_MESSAGE, pData, Size);
 }
 
+/*
+	Index
+		The keyframes are stored in a single chunk of type CHUNKTYPE_INDEX
+		after all the others. It is compressed like every chunk, older
+		players decompress it and skip it as an unknown type. The raw
+		footer at the end of the chunk comes after the huffman eof so they
+		never look at it.
+
+	Data (ints)
+		version, first tick, last tick, number of keyframes
+		for every keyframe: tick delta, file position delta
+
+	Footer
+		4 = File position of the chunk (big endian)
+		4 = gs_aIndexMarker
+*/
+
+bool CDemoRecorder::WriteIndex(IOHANDLE File, const CHuffman *pHuffman, const CDemoKeyFrame *pKeyFrames, int NumKeyFrames, int FirstTick, int LastTick)
+{
+	enum
+	{
+		FOOTER_SIZE=8,
+		MAX_CHUNK_SIZE=0xffff,
+	};
+
+	int NumData = 4+NumKeyFrames*2;
+	int *pData = (int *)mem_alloc(NumData*sizeof(int));
+	pData[0] = gs_IndexVersion;
+	pData[1] = FirstTick;
+	pData[2] = LastTick;
+	pData[3] = NumKeyFrames;
+	CDemoKeyFrame Prev = {0, 0};
+	for(int i = 0; i < NumKeyFrames; i++)
+	{
+		pData[4+i*2] = pKeyFrames[i].m_Tick - Prev.m_Tick;
+		pData[4+i*2+1] = pKeyFrames[i].m_Filepos - Prev.m_Filepos;
+		Prev = pKeyFrames[i];
+	}
+
+	// an int never packs into more than 5 bytes
+	int PackedSize = NumData*5;
+	unsigned char *pPacked = (unsigned char *)mem_alloc(PackedSize);
+	unsigned char *pChunk = (unsigned char *)mem_alloc(MAX_CHUNK_SIZE);
+	int Size = CVariableInt::Compress(pData, NumData*sizeof(int), pPacked, PackedSize);
+	if(Size >= 0)
+		Size = pHuffman->Compress(pPacked, Size, pChunk, MAX_CHUNK_SIZE-FOOTER_SIZE);
+
+	bool Written = false;
+	if(Size >= 0)
+	{
+		long IndexPos = io_tell(File);
+		int_to_bytes_be(pChunk+Size, IndexPos);
+		mem_copy(pChunk+Size+4, gs_aIndexMarker, sizeof(gs_aIndexMarker));
+		Size += FOOTER_SIZE;
+
+		WriteChunkHeader(File, CHUNKTYPE_INDEX, Size);
+		io_write(File, pChunk, Size);
+		Written = true;
+	}
+
+	mem_free(pData);
+	mem_free(pPacked);
+	mem_free(pChunk);
+	return Written;
+}
+
 int CDemoRecorder::Stop()
 {
 	if(!m_File)
@@ -301,12 +382,18 @@ int CDemoRecorder::Stop()
 		io_write(m_File, aMarker, sizeof(aMarker));
 	}
 
+	// add the keyframe index to the end
+	io_seek(m_File, 0, IOSEEK_END);
+	if(!WriteIndex(m_File, &m_Huffman, m_lKeyFrames.base_ptr(), m_lKeyFrames.size(), m_FirstTick, m_LastTickMarker))
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_recorder", "too many keyframes for the index");
+
 	io_close(m_File);
 	m_File = 0;
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
 	m_NumTimelineMarkers = 0;
+	m_lKeyFrames.clear();
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", "Stopped recording");
 
 	return 0;
@@ -353,6 +440,16 @@ CDemoPlayer::CDemoPlayer(class CSnapshotDelta *pSnapshotDelta)
 
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_LastSnapshotDataSize = -1;
+
+	mem_zero(m_aSnapCache, sizeof(m_aSnapCache));
+	m_SnapCacheUseCounter = 0;
+	ClearSnapCache();
+}
+
+CDemoPlayer::~CDemoPlayer()
+{
+	for(int i = 0; i < SNAPCACHE_SIZE; i++)
+		mem_free(m_aSnapCache[i].m_pData);
 }
 
 void CDemoPlayer::Init(class IConsole *pConsole, class IStorage *pStorage)
@@ -425,6 +522,91 @@ int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
 	return 0;
 }
 
+bool CDemoPlayer::ReadIndex()
+{
+	long StartPos = io_tell(m_File);
+	long FileLength = io_length(m_File);
+
+	// check the footer
+	unsigned char aFooter[8];
+	bool Found = false;
+	if(FileLength-StartPos >= (long)sizeof(aFooter))
+	{
+		io_seek(m_File, FileLength-sizeof(aFooter), IOSEEK_START);
+		Found = io_read(m_File, aFooter, sizeof(aFooter)) == sizeof(aFooter) && mem_comp(aFooter+4, gs_aIndexMarker, sizeof(gs_aIndexMarker)) == 0;
+	}
+	if(!Found)
+	{
+		io_seek(m_File, StartPos, IOSEEK_START);
+		return false;
+	}
+
+	// read the index chunk, it has to end with the file
+	long IndexPos = bytes_be_to_int(aFooter);
+	int ChunkType = -1, ChunkSize = 0, ChunkTick = 0;
+	if(IndexPos >= StartPos && IndexPos < FileLength)
+	{
+		io_seek(m_File, IndexPos, IOSEEK_START);
+		if(ReadChunkHeader(&ChunkType, &ChunkSize, &ChunkTick) || ChunkSize <= (int)sizeof(aFooter) || io_tell(m_File)+ChunkSize != FileLength)
+			ChunkType = -1;
+	}
+	if(ChunkType != CHUNKTYPE_INDEX)
+	{
+		io_seek(m_File, StartPos, IOSEEK_START);
+		return false;
+	}
+
+	// every huffman symbol takes at least a bit and every int at least a byte
+	int PackedSize = ChunkSize*8;
+	int DataSize = PackedSize*sizeof(int);
+	unsigned char *pChunk = (unsigned char *)mem_alloc(ChunkSize);
+	unsigned char *pPacked = (unsigned char *)mem_alloc(PackedSize);
+	int *pData = (int *)mem_alloc(DataSize);
+	int Size = -1;
+	if(io_read(m_File, pChunk, ChunkSize) == (unsigned)ChunkSize)
+		Size = m_Huffman.Decompress(pChunk, ChunkSize, pPacked, PackedSize);
+	if(Size >= 0)
+		Size = CVariableInt::Decompress(pPacked, Size, pData, DataSize);
+
+	int NumInts = Size/(int)sizeof(int);
+	int NumKeyFrames = NumInts >= 4 ? pData[3] : -1;
+	bool Valid = NumInts >= 4 && pData[0] == gs_IndexVersion && NumKeyFrames >= 0 && NumInts == 4+NumKeyFrames*2;
+	CDemoKeyFrame *pKeyFrames = 0;
+	if(Valid)
+	{
+		pKeyFrames = (CDemoKeyFrame *)mem_alloc(NumKeyFrames*sizeof(CDemoKeyFrame));
+		CDemoKeyFrame Prev = {0, 0};
+		for(int i = 0; i < NumKeyFrames && Valid; i++)
+		{
+			pKeyFrames[i].m_Tick = Prev.m_Tick + pData[4+i*2];
+			pKeyFrames[i].m_Filepos = Prev.m_Filepos + pData[4+i*2+1];
+			Valid = pKeyFrames[i].m_Filepos >= StartPos && pKeyFrames[i].m_Filepos < IndexPos &&
+				(i == 0 || (pKeyFrames[i].m_Tick >= Prev.m_Tick && pKeyFrames[i].m_Filepos > Prev.m_Filepos));
+			Prev = pKeyFrames[i];
+		}
+	}
+
+	if(Valid)
+	{
+		m_pKeyFrames = pKeyFrames;
+		m_Info.m_SeekablePoints = NumKeyFrames;
+		m_Info.m_Info.m_FirstTick = pData[1];
+		m_Info.m_Info.m_LastTick = pData[2];
+		m_Info.m_HasIndex = true;
+	}
+	else
+	{
+		mem_free(pKeyFrames);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "broken keyframe index");
+	}
+
+	mem_free(pChunk);
+	mem_free(pPacked);
+	mem_free(pData);
+	io_seek(m_File, StartPos, IOSEEK_START);
+	return Valid;
+}
+
 void CDemoPlayer::ScanFile()
 {
 	CHeap Heap;
@@ -471,7 +653,7 @@ void CDemoPlayer::ScanFile()
 
 	// copy all the frames to an array instead for fast access
 	int i;
-	m_pKeyFrames = (CKeyFrame*)mem_alloc(m_Info.m_SeekablePoints*sizeof(CKeyFrame));
+	m_pKeyFrames = (CDemoKeyFrame*)mem_alloc(m_Info.m_SeekablePoints*sizeof(CDemoKeyFrame));
 	for(pCurrentKey = pFirstKey, i = 0; pCurrentKey; pCurrentKey = pCurrentKey->m_pNext, i++)
 		m_pKeyFrames[i] = pCurrentKey->m_Frame;
 
@@ -481,10 +663,6 @@ void CDemoPlayer::ScanFile()
 
 void CDemoPlayer::DoTick()
 {
-	static char aCompressedData[CSnapshot::MAX_SIZE];
-	static char aDecompressed[CSnapshot::MAX_SIZE];
-	static char aData[CSnapshot::MAX_SIZE];
-	static char aNewSnap[CSnapshot::MAX_SIZE];
 	bool GotSnapshot = false;
 
 	// update ticks
@@ -510,10 +688,17 @@ void CDemoPlayer::DoTick()
 			break;
 		}
 
+		// nothing to play in the index
+		if(ChunkType == CHUNKTYPE_INDEX)
+		{
+			io_skip(m_File, ChunkSize);
+			continue;
+		}
+
 		// read the chunk
 		if(ChunkSize)
 		{
-			if(io_read(m_File, aCompressedData, ChunkSize) != (unsigned)ChunkSize)
+			if(io_read(m_File, m_aCompressedData, ChunkSize) != (unsigned)ChunkSize)
 			{
 				// stop on error or eof
 				m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "error reading chunk");
@@ -521,7 +706,7 @@ void CDemoPlayer::DoTick()
 				break;
 			}
 
-			DataSize = m_Huffman.Decompress(aCompressedData, ChunkSize, aDecompressed, sizeof(aDecompressed));
+			DataSize = m_Huffman.Decompress(m_aCompressedData, ChunkSize, m_aDecompressed, sizeof(m_aDecompressed));
 			if(DataSize < 0)
 			{
 				// stop on error or eof
@@ -530,7 +715,7 @@ void CDemoPlayer::DoTick()
 				break;
 			}
 
-			DataSize = CVariableInt::Decompress(aDecompressed, DataSize, aData, sizeof(aData));
+			DataSize = CVariableInt::Decompress(m_aDecompressed, DataSize, m_aData, sizeof(m_aData));
 			if(DataSize < 0)
 			{
 				m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "error during intpack decompression");
@@ -548,14 +733,14 @@ void CDemoPlayer::DoTick()
 			if(m_LastSnapshotDataSize == -1)
 				continue;
 
-			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot*)m_aLastSnapshotData, (CSnapshot*)aNewSnap, aData, DataSize);
+			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot*)m_aLastSnapshotData, (CSnapshot*)m_aNewSnap, m_aData, DataSize);
 			if(DataSize >= 0)
 			{
 				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(aNewSnap, DataSize);
+					m_pListener->OnDemoPlayerSnapshot(m_aNewSnap, DataSize);
 
 				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, aNewSnap, DataSize);
+				mem_copy(m_aLastSnapshotData, m_aNewSnap, DataSize);
 			}
 			else
 			{
@@ -570,17 +755,17 @@ void CDemoPlayer::DoTick()
 			CSnapshotBuilder Builder;
 			GotSnapshot = true;
 
-			if(Builder.UnserializeSnap(aData, DataSize))
-				DataSize = Builder.Finish(aNewSnap);
+			if(Builder.UnserializeSnap(m_aData, DataSize))
+				DataSize = Builder.Finish(m_aNewSnap);
 			else
 				DataSize = -1;
 
 			if(DataSize >= 0)
 			{
 				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, aNewSnap, DataSize);
+				mem_copy(m_aLastSnapshotData, m_aNewSnap, DataSize);
 				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(aNewSnap, DataSize);
+					m_pListener->OnDemoPlayerSnapshot(m_aNewSnap, DataSize);
 			}
 			else
 			{
@@ -602,16 +787,72 @@ void CDemoPlayer::DoTick()
 			if(ChunkType&CHUNKTYPEFLAG_TICKMARKER)
 			{
 				m_Info.m_NextTick = ChunkTick;
+				CacheSnapshot();
 				break;
 			}
 			else if(ChunkType == CHUNKTYPE_MESSAGE && m_pListener && m_LastSnapshotDataSize != -1)
 			{
-				m_pListener->OnDemoPlayerMessage(aData, DataSize);
+				m_pListener->OnDemoPlayerMessage(m_aData, DataSize);
 			}
 		}
 	}
 }
 
+void CDemoPlayer::CacheSnapshot()
+{
+	if(m_LastSnapshotDataSize == -1 || m_Info.m_PreviousTick == -1)
+		return;
+
+	// keep some distance between the cached snapshots and replace the least recently used one
+	CSnapCacheEntry *pEntry = 0;
+	for(int i = 0; i < SNAPCACHE_SIZE; i++)
+	{
+		CSnapCacheEntry *pCur = &m_aSnapCache[i];
+		if(pCur->m_CurrentTick != -1 && absolute(pCur->m_CurrentTick-m_Info.m_Info.m_CurrentTick) < SNAPCACHE_INTERVAL)
+			return;
+		if(!pEntry || pCur->m_LastUsed < pEntry->m_LastUsed)
+			pEntry = pCur;
+	}
+
+	if(pEntry->m_DataCapacity < m_LastSnapshotDataSize)
+	{
+		mem_free(pEntry->m_pData);
+		pEntry->m_pData = (unsigned char *)mem_alloc(m_LastSnapshotDataSize);
+		pEntry->m_DataCapacity = m_LastSnapshotDataSize;
+	}
+	mem_copy(pEntry->m_pData, m_aLastSnapshotData, m_LastSnapshotDataSize);
+	pEntry->m_DataSize = m_LastSnapshotDataSize;
+	pEntry->m_PreviousTick = m_Info.m_PreviousTick;
+	pEntry->m_CurrentTick = m_Info.m_Info.m_CurrentTick;
+	pEntry->m_NextTick = m_Info.m_NextTick;
+	pEntry->m_Filepos = io_tell(m_File);
+	pEntry->m_LastUsed = ++m_SnapCacheUseCounter;
+}
+
+CDemoPlayer::CSnapCacheEntry *CDemoPlayer::FindCachedSnapshot(int Tick)
+{
+	// the latest cached snapshot at or before the tick
+	CSnapCacheEntry *pBest = 0;
+	for(int i = 0; i < SNAPCACHE_SIZE; i++)
+	{
+		CSnapCacheEntry *pCur = &m_aSnapCache[i];
+		if(pCur->m_CurrentTick != -1 && pCur->m_CurrentTick <= Tick && (!pBest || pCur->m_CurrentTick > pBest->m_CurrentTick))
+			pBest = pCur;
+	}
+	return pBest;
+}
+
+void CDemoPlayer::ClearSnapCache()
+{
+	// keep the buffers around for the next demo
+	for(int i = 0; i < SNAPCACHE_SIZE; i++)
+	{
+		m_aSnapCache[i].m_CurrentTick = -1;
+		m_aSnapCache[i].m_LastUsed = 0;
+	}
+	m_SnapCacheUseCounter = 0;
+}
+
 void CDemoPlayer::Pause()
 {
 	m_Info.m_Info.m_Paused = true;
@@ -647,6 +888,7 @@ const char *CDemoPlayer::Load(const char *pFilename, int StorageType, const char
 	m_Info.m_Info.m_SpeedIndex = 5;
 
 	m_LastSnapshotDataSize = -1;
+	ClearSnapCache();
 
 	// read the header
 	io_read(m_File, &m_Info.m_Header, sizeof(m_Info.m_Header));
@@ -708,8 +950,11 @@ const char *CDemoPlayer::Load(const char *pFilename, int StorageType, const char
 
 		// save map
 		MapFile = m_pStorage->OpenFile(aMapFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
-		io_write(MapFile, pMapData, MapSize);
-		io_close(MapFile);
+		if(MapFile)
+		{
+			io_write(MapFile, pMapData, MapSize);
+			io_close(MapFile);
+		}
 
 		// free data
 		mem_free(pMapData);
@@ -720,8 +965,9 @@ const char *CDemoPlayer::Load(const char *pFilename, int StorageType, const char
 	for(int i = 0; i < m_Info.m_Info.m_NumTimelineMarkers; i++)
 		m_Info.m_Info.m_aTimelineMarkers[i] = bytes_be_to_int(m_Info.m_Header.m_aTimelineMarkers[i]);
 
-	// scan the file for interesting points
-	ScanFile();
+	// take the keyframes from the index or scan the file for them
+	if(!ReadIndex())
+		ScanFile();
 
 	// ready for playback
 	return 0;
@@ -762,12 +1008,28 @@ int CDemoPlayer::SetPos(int WantedTick)
 	while(Keyframe > 0 && m_pKeyFrames[Keyframe].m_Tick > KeyframeWantedTick)
 		Keyframe--;
 
-	// seek to the correct keyframe
-	io_seek(m_File, m_pKeyFrames[Keyframe].m_Filepos, IOSEEK_START);
+	// start from a cached snapshot if there is one between the keyframe and our tick
+	CSnapCacheEntry *pCached = FindCachedSnapshot(KeyframeWantedTick);
+	if(pCached && pCached->m_CurrentTick >= m_pKeyFrames[Keyframe].m_Tick)
+	{
+		io_seek(m_File, pCached->m_Filepos, IOSEEK_START);
+
+		m_Info.m_NextTick = pCached->m_NextTick;
+		m_Info.m_Info.m_CurrentTick = pCached->m_CurrentTick;
+		m_Info.m_PreviousTick = pCached->m_PreviousTick;
+		mem_copy(m_aLastSnapshotData, pCached->m_pData, pCached->m_DataSize);
+		m_LastSnapshotDataSize = pCached->m_DataSize;
+		pCached->m_LastUsed = ++m_SnapCacheUseCounter;
+	}
+	else
+	{
+		// seek to the correct keyframe
+		io_seek(m_File, m_pKeyFrames[Keyframe].m_Filepos, IOSEEK_START);
 
-	m_Info.m_NextTick = -1;
-	m_Info.m_Info.m_CurrentTick = -1;
-	m_Info.m_PreviousTick = -1;
+		m_Info.m_NextTick = -1;
+		m_Info.m_Info.m_CurrentTick = -1;
+		m_Info.m_PreviousTick = -1;
+	}
 
 	// playback everything until we hit our tick
 	while(m_Info.m_NextTick < WantedTick)
@@ -836,6 +1098,17 @@ int CDemoPlayer::Update()
 	return 0;
 }
 
+int CDemoPlayer::NextTick()
+{
+	if(!IsPlaying() || m_Info.m_Info.m_Paused)
+		return -1;
+
+	DoTick();
+	if(!IsPlaying() || m_Info.m_Info.m_Paused)
+		return -1;
+	return 0;
+}
+
 int CDemoPlayer::Stop()
 {
 	if(!m_File)
@@ -846,6 +1119,7 @@ int CDemoPlayer::Stop()
 	m_File = 0;
 	mem_free(m_pKeyFrames);
 	m_pKeyFrames = 0;
+	ClearSnapCache();
 	m_aFilename[0] = '\0';
 	return 0;
 }
@@ -890,3 +1164,10 @@ int CDemoPlayer::GetDemoType() const
 		return m_DemoType;
 	return DEMOTYPE_INVALID;
 }
+
+bool CDemoPlayer::WriteIndex(IOHANDLE File) const
+{
+	if(!m_File)
+		return false;
+	return CDemoRecorder::WriteIndex(File, &m_Huffman, m_pKeyFrames, m_Info.m_SeekablePoints, m_Info.m_Info.m_FirstTick, m_Info.m_Info.m_LastTick);
+}
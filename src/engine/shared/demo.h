@@ -3,12 +3,20 @@
 #ifndef ENGINE_SHARED_DEMO_H
 #define ENGINE_SHARED_DEMO_H
 
+#include <base/tl/array.h>
+
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
 
 #include "huffman.h"
 #include "snapshot.h"
 
+struct CDemoKeyFrame
+{
+	long m_Filepos;
+	int m_Tick;
+};
+
 class CDemoRecorder : public IDemoRecorder
 {
 	class IConsole *m_pConsole;
@@ -17,11 +25,13 @@ class CDemoRecorder : public IDemoRecorder
 	IOHANDLE m_File;
 	int m_LastTickMarker;
 	int m_LastKeyFrame;
+	int m_KeyFrameInterval;
 	int m_FirstTick;
 	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
 	class CSnapshotDelta *m_pSnapshotDelta;
 	int m_NumTimelineMarkers;
 	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
+	array<CDemoKeyFrame> m_lKeyFrames;
 
 	void WriteTickMarker(int Tick, int Keyframe);
 	void Write(int Type, const void *pData, int Size);
@@ -29,7 +39,7 @@ public:
 	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta);
 	void Init(class IConsole *pConsole, class IStorage *pStorage);
 
-	int Start(const char *pFilename, const char *pNetversion, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc, const char *pType);
+	int Start(const char *pFilename, const char *pNetversion, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc, const char *pType, int KeyFrameInterval);
 	int Stop();
 	void AddDemoMarker();
 
@@ -39,6 +49,9 @@ public:
 	bool IsRecording() const { return m_File != 0; }
 
 	int Length() const { return (m_LastTickMarker - m_FirstTick)/SERVER_TICK_SPEED; }
+
+	// appends the keyframe index that lets players skip scanning the file
+	static bool WriteIndex(IOHANDLE File, const CHuffman *pHuffman, const CDemoKeyFrame *pKeyFrames, int NumKeyFrames, int FirstTick, int LastTick);
 };
 
 class CDemoPlayer : public IDemoPlayer
@@ -62,6 +75,7 @@ public:
 		int64 m_CurrentTime;
 
 		int m_SeekablePoints;
+		bool m_HasIndex;
 
 		int m_NextTick;
 		int m_PreviousTick;
@@ -77,15 +91,9 @@ private:
 
 
 	// Playback
-	struct CKeyFrame
-	{
-		long m_Filepos;
-		int m_Tick;
-	};
-
 	struct CKeyFrameSearch
 	{
-		CKeyFrame m_Frame;
+		CDemoKeyFrame m_Frame;
 		CKeyFrameSearch *m_pNext;
 	};
 
@@ -95,7 +103,7 @@ private:
 	IOHANDLE m_File;
 	char m_aFilename[256];
 	char m_aErrorMsg[256];
-	CKeyFrame *m_pKeyFrames;
+	CDemoKeyFrame *m_pKeyFrames;
 
 	CPlaybackInfo m_Info;
 	int m_DemoType;
@@ -103,13 +111,47 @@ private:
 	int m_LastSnapshotDataSize;
 	class CSnapshotDelta *m_pSnapshotDelta;
 
+	// buffers for DoTick, not static so several players can run on different threads
+	char m_aCompressedData[CSnapshot::MAX_SIZE];
+	char m_aDecompressed[CSnapshot::MAX_SIZE];
+	char m_aData[CSnapshot::MAX_SIZE];
+	char m_aNewSnap[CSnapshot::MAX_SIZE];
+
+	// snapshots reconstructed during playback, seeking starts from these when they are closer than a keyframe
+	enum
+	{
+		SNAPCACHE_SIZE=128,
+		SNAPCACHE_INTERVAL=10,
+	};
+
+	struct CSnapCacheEntry
+	{
+		int m_PreviousTick;
+		int m_CurrentTick;
+		int m_NextTick;
+		long m_Filepos;
+		unsigned m_LastUsed;
+		int m_DataSize;
+		int m_DataCapacity;
+		unsigned char *m_pData;
+	};
+
+	CSnapCacheEntry m_aSnapCache[SNAPCACHE_SIZE];
+	unsigned m_SnapCacheUseCounter;
+
+	void CacheSnapshot();
+	CSnapCacheEntry *FindCachedSnapshot(int Tick);
+	void ClearSnapCache();
+
 	int ReadChunkHeader(int *pType, int *pSize, int *pTick);
 	void DoTick();
+	bool ReadIndex();
 	void ScanFile();
 
 public:
 
 	CDemoPlayer(class CSnapshotDelta *pSnapshotDelta);
+	~CDemoPlayer();
 	void Init(class IConsole *pConsole, class IStorage *pStorage);
 	void SetListener(IListener *pListener);
 
@@ -126,9 +168,13 @@ public:
 	void GetDemoName(char *pBuffer, int BufferSize) const;
 	bool GetDemoInfo(const char *pFilename, int StorageType, CDemoHeader *pDemoHeader) const;
 	int GetDemoType() const;
+	bool WriteIndex(IOHANDLE File) const;
 
 	int Update();
 
+	// plays back the next tick right away instead of waiting for it, returns -1 at the end of the demo
+	int NextTick();
+
 	const CPlaybackInfo *Info() const { return &m_Info; }
 	int IsPlaying() const { return m_File != 0; }
 };
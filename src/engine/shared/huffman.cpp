@@ -2,6 +2,7 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include "huffman.h"
 #include <algorithm>
+#include <stdint.h>
 #include <base/system.h>
 
 const unsigned CHuffman::ms_aFreqTable[HUFFMAN_MAX_SYMBOLS] = {
@@ -69,10 +70,21 @@ void CHuffman::ConstructTree(const unsigned *pFrequencies)
 
 	m_NumNodes = HUFFMAN_MAX_SYMBOLS;
 
+	// the list stays sorted, after the first sort only the merged node has to move
+	std::stable_sort(apNodesLeft, apNodesLeft + NumNodesLeft, CompareNodesByFrequencyDesc);
+
 	// construct the table
 	while(NumNodesLeft > 1)
 	{
-		std::stable_sort(apNodesLeft, apNodesLeft + NumNodesLeft, CompareNodesByFrequencyDesc);
+		// moving it behind all nodes with the same frequency keeps the order a stable sort gives
+		CHuffmanConstructNode *pMerged = apNodesLeft[NumNodesLeft-1];
+		int Pos = NumNodesLeft-1;
+		while(Pos > 0 && apNodesLeft[Pos-1]->m_Frequency < pMerged->m_Frequency)
+		{
+			apNodesLeft[Pos] = apNodesLeft[Pos-1];
+			Pos--;
+		}
+		apNodesLeft[Pos] = pMerged;
 
 		m_aNodes[m_NumNodes].m_NumBits = 0;
 		m_aNodes[m_NumNodes].m_aLeafs[0] = apNodesLeft[NumNodesLeft-1]->m_NodeId;
@@ -91,109 +103,111 @@ void CHuffman::ConstructTree(const unsigned *pFrequencies)
 	Setbits_r(m_pStartNode, 0, 0);
 }
 
-void CHuffman::Init(const unsigned *pFrequencies)
+void CHuffman::BuildDecodeLut()
 {
-	// make sure to cleanout every thing
-	mem_zero(m_aNodes, sizeof(m_aNodes));
-	mem_zero(m_apDecodeLut, sizeof(m_apDecodeLut));
-	m_pStartNode = 0x0;
-	m_NumNodes = 0;
-
-	// construct the tree
-	ConstructTree(pFrequencies);
-
-	// build decode LUT
 	for(int i = 0; i < HUFFMAN_LUTSIZE; i++)
 	{
-		unsigned Bits = i;
-		int k;
-		CNode *pNode = m_pStartNode;
-		for(k = 0; k < HUFFMAN_LUTBITS; k++)
+		CDecodeEntry *pEntry = &m_aDecodeLut[i];
+		pEntry->m_NumSymbols = 0;
+		pEntry->m_NumBits = 0;
+		pEntry->m_Node = 0;
+
+		// decode as many whole symbols as fit into the bits
+		while(pEntry->m_NumSymbols < HUFFMAN_LUTSYMBOLS)
 		{
-			pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
-			Bits >>= 1;
+			const CNode *pNode = m_pStartNode;
+			int k = pEntry->m_NumBits;
+			while(k < HUFFMAN_LUTBITS && !pNode->m_NumBits)
+				pNode = &m_aNodes[pNode->m_aLeafs[(i>>k++)&1]];
 
-			if(!pNode)
+			if(!pNode->m_NumBits)
+			{
+				// not even one symbol, the decoder walks on from here
+				if(pEntry->m_NumSymbols == 0)
+				{
+					pEntry->m_NumBits = HUFFMAN_LUTBITS;
+					pEntry->m_Node = (unsigned short)(pNode - m_aNodes);
+				}
 				break;
+			}
 
-			if(pNode->m_NumBits)
+			pEntry->m_NumBits = k;
+			if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
 			{
-				m_apDecodeLut[i] = pNode;
+				pEntry->m_Node = HUFFMAN_EOF_SYMBOL;
 				break;
 			}
+			pEntry->m_aSymbols[pEntry->m_NumSymbols++] = pNode->m_Symbol;
 		}
-
-		if(k == HUFFMAN_LUTBITS)
-			m_apDecodeLut[i] = pNode;
 	}
+}
 
+void CHuffman::Init(const unsigned *pFrequencies)
+{
+	// make sure to cleanout every thing
+	mem_zero(m_aNodes, sizeof(m_aNodes));
+	mem_zero(m_aDecodeLut, sizeof(m_aDecodeLut));
+	m_pStartNode = 0x0;
+	m_NumNodes = 0;
+
+	// construct the tree
+	ConstructTree(pFrequencies);
+
+	// build decode LUT
+	BuildDecodeLut();
 }
 
 //***************************************************************
 int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize) const
 {
-	// this macro loads a symbol for a byte into bits and bitcount
-#define HUFFMAN_MACRO_LOADSYMBOL(Sym) \
-	Bits |= m_aNodes[Sym].m_Bits << Bitcount; \
-	Bitcount += m_aNodes[Sym].m_NumBits;
-
-	// this macro writes the symbol stored in bits and bitcount to the dst pointer
-#define HUFFMAN_MACRO_WRITE() \
-	while(Bitcount >= 8) \
-	{ \
-		*pDst++ = (unsigned char)(Bits&0xff); \
-		if(pDst == pDstEnd) \
-			return -1; \
-		Bits >>= 8; \
-		Bitcount -= 8; \
-	}
-
 	// setup buffer pointers
 	const unsigned char *pSrc = (const unsigned char *)pInput;
 	const unsigned char *pSrcEnd = pSrc + InputSize;
 	unsigned char *pDst = (unsigned char *)pOutput;
 	unsigned char *pDstEnd = pDst + OutputSize;
 
-	// symbol variables
-	unsigned Bits = 0;
+	// symbol variables, codes are at most 32 bits so 32 bits can always be added
+	uint64_t Bits = 0;
 	unsigned Bitcount = 0;
 
-	// make sure that we have data that we want to compress
-	if(InputSize)
+	for(; pSrc != pSrcEnd; pSrc++)
 	{
-		// {A} load the first symbol
-		int Symbol = *pSrc++;
+		const CNode *pNode = &m_aNodes[*pSrc];
+		Bits |= (uint64_t)pNode->m_Bits << Bitcount;
+		Bitcount += pNode->m_NumBits;
 
-		while(pSrc != pSrcEnd)
+		if(Bitcount >= 32)
 		{
-			// {B} load the symbol
-			HUFFMAN_MACRO_LOADSYMBOL(Symbol)
-
-			// {C} fetch next symbol, this is done here because it will reduce dependency in the code
-			Symbol = *pSrc++;
-
-			// {B} write the symbol loaded at
-			HUFFMAN_MACRO_WRITE()
+			// the output has to have room for the last partial byte
+			if(pDstEnd - pDst <= 4)
+				return -1;
+			pDst[0] = (unsigned char)Bits;
+			pDst[1] = (unsigned char)(Bits>>8);
+			pDst[2] = (unsigned char)(Bits>>16);
+			pDst[3] = (unsigned char)(Bits>>24);
+			pDst += 4;
+			Bits >>= 32;
+			Bitcount -= 32;
 		}
-
-		// write the last symbol loaded from {C} or {A} in the case of only 1 byte input buffer
-		HUFFMAN_MACRO_LOADSYMBOL(Symbol)
-		HUFFMAN_MACRO_WRITE()
 	}
 
 	// write EOF symbol
-	HUFFMAN_MACRO_LOADSYMBOL(HUFFMAN_EOF_SYMBOL)
-	HUFFMAN_MACRO_WRITE()
+	Bits |= (uint64_t)m_aNodes[HUFFMAN_EOF_SYMBOL].m_Bits << Bitcount;
+	Bitcount += m_aNodes[HUFFMAN_EOF_SYMBOL].m_NumBits;
+	while(Bitcount >= 8)
+	{
+		*pDst++ = (unsigned char)Bits;
+		if(pDst == pDstEnd)
+			return -1;
+		Bits >>= 8;
+		Bitcount -= 8;
+	}
 
 	// write out the last bits
-	*pDst++ = Bits;
+	*pDst++ = (unsigned char)Bits;
 
 	// return the size of the output
 	return (int)(pDst - (const unsigned char *)pOutput);
-
-	// remove macros
-#undef HUFFMAN_MACRO_LOADSYMBOL
-#undef HUFFMAN_MACRO_WRITE
 }
 
 //***************************************************************
@@ -201,68 +215,79 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 {
 	// setup buffer pointers
 	unsigned char *pDst = (unsigned char *)pOutput;
-	unsigned char *pSrc = (unsigned char *)pInput;
+	const unsigned char *pSrc = (const unsigned char *)pInput;
 	unsigned char *pDstEnd = pDst + OutputSize;
-	unsigned char *pSrcEnd = pSrc + InputSize;
+	const unsigned char *pSrcEnd = pSrc + InputSize;
 
-	unsigned Bits = 0;
+	uint64_t Bits = 0;
 	unsigned Bitcount = 0;
 
 	const CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
-	const CNode *pNode = 0;
 
 	while(true)
 	{
-		// {A} try to load a node now, this will reduce dependency at location {D}
-		pNode = 0;
-		if(Bitcount >= HUFFMAN_LUTBITS)
-			pNode = m_apDecodeLut[Bits&HUFFMAN_LUTMASK];
-
-		// {B} fill with new bits
-		while(Bitcount < 24 && pSrc != pSrcEnd)
+		// fill with new bits, 8 bytes at once while there are enough
+		if(pSrcEnd - pSrc >= 8)
 		{
-			Bits |= (*pSrc++) << Bitcount;
-			Bitcount += 8;
+			uint64_t Word = (uint64_t)pSrc[0] | (uint64_t)pSrc[1]<<8 | (uint64_t)pSrc[2]<<16 | (uint64_t)pSrc[3]<<24 |
+				(uint64_t)pSrc[4]<<32 | (uint64_t)pSrc[5]<<40 | (uint64_t)pSrc[6]<<48 | (uint64_t)pSrc[7]<<56;
+			Bits |= Word << Bitcount;
+			pSrc += (63-Bitcount)>>3;
+			Bitcount |= 56;
 		}
-
-		// {C} load symbol now if we didn't that earlier at location {A}
-		if(!pNode)
-			pNode = m_apDecodeLut[Bits&HUFFMAN_LUTMASK];
-
-		if(!pNode)
-			return -1;
-
-		// {D} check if we hit a symbol already
-		if(pNode->m_NumBits)
+		else
 		{
-			// remove the bits for that symbol
-			Bits >>= pNode->m_NumBits;
-			Bitcount -= pNode->m_NumBits;
+			while(Bitcount <= 56 && pSrc != pSrcEnd)
+			{
+				Bits |= (uint64_t)(*pSrc++) << Bitcount;
+				Bitcount += 8;
+			}
 		}
-		else
+
+		// a lookup decodes up to HUFFMAN_LUTSYMBOLS symbols
+		const CDecodeEntry *pEntry = &m_aDecodeLut[Bits&HUFFMAN_LUTMASK];
+		const CNode *pNode;
+		if(pEntry->m_NumBits <= Bitcount)
 		{
+			if(pEntry->m_Node == 0 || pEntry->m_Node == HUFFMAN_EOF_SYMBOL)
+			{
+				int NumSymbols = pEntry->m_NumSymbols;
+				if(pDstEnd - pDst >= HUFFMAN_LUTSYMBOLS)
+					mem_copy(pDst, pEntry->m_aSymbols, HUFFMAN_LUTSYMBOLS);
+				else if(pDstEnd - pDst >= NumSymbols)
+					mem_copy(pDst, pEntry->m_aSymbols, NumSymbols);
+				else
+					return -1;
+				pDst += NumSymbols;
+				Bits >>= pEntry->m_NumBits;
+				Bitcount -= pEntry->m_NumBits;
+
+				if(pEntry->m_Node == HUFFMAN_EOF_SYMBOL)
+					break;
+				continue;
+			}
+
 			// remove the bits that the lut checked up for us
+			pNode = &m_aNodes[pEntry->m_Node];
 			Bits >>= HUFFMAN_LUTBITS;
 			Bitcount -= HUFFMAN_LUTBITS;
+		}
+		else
+		{
+			// the lut looked past the end of the input, go slowly
+			pNode = m_pStartNode;
+		}
 
-			// walk the tree bit by bit
-			while(true)
-			{
-				// traverse tree
-				pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
-
-				// remove bit
-				Bitcount--;
-				Bits >>= 1;
-
-				// check if we hit a symbol
-				if(pNode->m_NumBits)
-					break;
+		// walk the tree bit by bit
+		while(!pNode->m_NumBits)
+		{
+			// no more bits, decoding error
+			if(Bitcount == 0)
+				return -1;
 
-				// no more bits, decoding error
-				if(Bitcount == 0)
-					return -1;
-			}
+			pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
+			Bits >>= 1;
+			Bitcount--;
 		}
 
 		// check for eof
@@ -278,3 +303,52 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 	// return the size of the decompressed buffer
 	return (int)(pDst - (const unsigned char *)pOutput);
 }
+
+//***************************************************************
+void CAdaptiveHuffman::Init()
+{
+	m_Huffman.Init();
+	mem_zero(m_aCounts, sizeof(m_aCounts));
+	m_NumCounted = 0;
+}
+
+void CAdaptiveHuffman::Count(const unsigned char *pData, int Size)
+{
+	for(int i = 0; i < Size; i++)
+		m_aCounts[pData[i]]++;
+	m_NumCounted += Size;
+	if(m_NumCounted < ADAPT_INTERVAL)
+		return;
+
+	// scale the counts down so the tree can't get deeper than the 32 bits
+	// a code may have. every byte keeps a frequency so it can still be coded
+	uint64_t Total = 0;
+	for(int i = 0; i < 256; i++)
+		Total += m_aCounts[i];
+
+	unsigned aFrequencies[256];
+	for(int i = 0; i < 256; i++)
+		aFrequencies[i] = 1 + (unsigned)(m_aCounts[i]*(uint64_t)(MAX_TOTAL_FREQUENCY-256)/Total);
+	m_Huffman.Init(aFrequencies);
+
+	// older data counts less and less
+	for(int i = 0; i < 256; i++)
+		m_aCounts[i] >>= 1;
+	m_NumCounted = 0;
+}
+
+int CAdaptiveHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize)
+{
+	int Size = m_Huffman.Compress(pInput, InputSize, pOutput, OutputSize);
+	if(Size >= 0)
+		Count((const unsigned char *)pInput, InputSize);
+	return Size;
+}
+
+int CAdaptiveHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int OutputSize)
+{
+	int Size = m_Huffman.Decompress(pInput, InputSize, pOutput, OutputSize);
+	if(Size >= 0)
+		Count((const unsigned char *)pOutput, Size);
+	return Size;
+}
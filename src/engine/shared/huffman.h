@@ -12,9 +12,10 @@ class CHuffman
 		HUFFMAN_MAX_SYMBOLS=HUFFMAN_EOF_SYMBOL+1,
 		HUFFMAN_MAX_NODES=HUFFMAN_MAX_SYMBOLS*2-1,
 
-		HUFFMAN_LUTBITS = 10,
+		HUFFMAN_LUTBITS = 12,
 		HUFFMAN_LUTSIZE = (1<<HUFFMAN_LUTBITS),
-		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1)
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1),
+		HUFFMAN_LUTSYMBOLS = 4,
 	};
 
 	struct CNode
@@ -30,15 +31,28 @@ class CHuffman
 		unsigned char m_Symbol;
 	};
 
+	// the symbols the next HUFFMAN_LUTBITS bits decode to
+	struct CDecodeEntry
+	{
+		unsigned char m_aSymbols[HUFFMAN_LUTSYMBOLS];
+		unsigned char m_NumSymbols;
+		unsigned char m_NumBits;
+
+		// HUFFMAN_EOF_SYMBOL if the symbols end with eof, the node to walk
+		// the tree on from if not even one symbol fits into the bits, else 0
+		unsigned short m_Node;
+	};
+
 	static const unsigned ms_aFreqTable[HUFFMAN_MAX_SYMBOLS];
 
 	CNode m_aNodes[HUFFMAN_MAX_NODES];
-	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
+	CDecodeEntry m_aDecodeLut[HUFFMAN_LUTSIZE];
 	CNode *m_pStartNode;
 	int m_NumNodes;
 
 	void Setbits_r(CNode *pNode, int Bits, unsigned Depth);
 	void ConstructTree(const unsigned *pFrequencies);
+	void BuildDecodeLut();
 
 public:
 	/*
@@ -84,4 +98,34 @@ public:
 	*/
 	int Decompress(const void *pInput, int InputSize, void *pOutput, int OutputSize) const;
 };
+
+/*
+	Class: CAdaptiveHuffman
+		Huffman coder that adapts its frequencies to the data it has
+		coded so far. The table is rebuilt from the byte counts every
+		ADAPT_INTERVAL bytes, so both ends have to code the same
+		buffers in the same order. Only for streams both ends agreed
+		on, the network and demo formats use the static table.
+*/
+class CAdaptiveHuffman
+{
+	enum
+	{
+		ADAPT_INTERVAL=16*1024,
+		MAX_TOTAL_FREQUENCY=1<<16,
+	};
+
+	CHuffman m_Huffman;
+	unsigned m_aCounts[256];
+	int m_NumCounted;
+
+	void Count(const unsigned char *pData, int Size);
+
+public:
+	void Init();
+
+	// see CHuffman, both only count and adapt when they succeed
+	int Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize);
+	int Decompress(const void *pInput, int InputSize, void *pOutput, int OutputSize);
+};
 #endif // ENGINE_SHARED_HUFFMAN_H
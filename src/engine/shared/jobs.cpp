@@ -1,6 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/system.h>
+#include <base/tl/threading.h>
 #include "jobs.h"
 
 CJobPool::CJobPool()
@@ -8,9 +9,14 @@ CJobPool::CJobPool()
 	// empty the pool
 	m_NumThreads = 0;
 	m_Shutdown = false;
-	m_Lock = lock_create();
-	m_pFirstJob = 0;
-	m_pLastJob = 0;
+	for(int i = 0; i < MAX_THREADS+1; i++)
+	{
+		m_aQueues[i].m_Lock = lock_create();
+		m_aQueues[i].m_pFirstJob = 0;
+		m_aQueues[i].m_pLastJob = 0;
+	}
+	m_pInbox = 0;
+	sphore_init(&m_Semaphore);
 }
 
 CJobPool::~CJobPool()
@@ -24,74 +30,211 @@ void CJobPool::Shutdown()
 		return;
 
 	m_Shutdown = true;
+	for(int i = 0; i < m_NumThreads; i++)
+		sphore_signal(&m_Semaphore);
 	for(int i = 0; i < m_NumThreads; i++)
 	{
-		thread_wait(m_apThreads[i]);
-		thread_destroy(m_apThreads[i]);
+		thread_wait(m_aWorkers[i].m_pThread);
+		thread_destroy(m_aWorkers[i].m_pThread);
 	}
-	lock_destroy(m_Lock);
+	sphore_destroy(&m_Semaphore);
+	for(int i = 0; i < MAX_THREADS+1; i++)
+		lock_destroy(m_aQueues[i].m_Lock);
 }
 
-void CJobPool::WorkerThread(void *pUser)
+// the owner of a queue takes the oldest job
+CJob *CJobPool::PopJob(int Queue)
 {
-	CJobPool *pPool = (CJobPool *)pUser;
+	CQueue *pQueue = &m_aQueues[Queue];
+	CJob *pJob = 0;
 
-	while(!pPool->m_Shutdown)
+	lock_wait(pQueue->m_Lock);
+	if(pQueue->m_pFirstJob)
 	{
-		CJob *pJob = 0;
+		pJob = pQueue->m_pFirstJob;
+		pQueue->m_pFirstJob = pJob->m_pNext;
+		if(pQueue->m_pFirstJob)
+			pQueue->m_pFirstJob->m_pPrev = 0;
+		else
+			pQueue->m_pLastJob = 0;
+	}
+	lock_unlock(pQueue->m_Lock);
+	return pJob;
+}
+
+// others take the newest one, so they rarely fight with the owner over the same end
+CJob *CJobPool::StealJob(int Thief)
+{
+	for(int n = 1; n <= m_NumThreads; n++)
+	{
+		CQueue *pQueue = &m_aQueues[(Thief+n)%(m_NumThreads+1)];
+		if(!pQueue->m_pLastJob)
+			continue;
 
-		// fetch job from queue
-		lock_wait(pPool->m_Lock);
-		if(pPool->m_pFirstJob)
+		CJob *pJob = 0;
+		lock_wait(pQueue->m_Lock);
+		if(pQueue->m_pLastJob)
 		{
-			pJob = pPool->m_pFirstJob;
-			pPool->m_pFirstJob = pPool->m_pFirstJob->m_pNext;
-			if(pPool->m_pFirstJob)
-				pPool->m_pFirstJob->m_pPrev = 0;
+			pJob = pQueue->m_pLastJob;
+			pQueue->m_pLastJob = pJob->m_pPrev;
+			if(pQueue->m_pLastJob)
+				pQueue->m_pLastJob->m_pNext = 0;
 			else
-				pPool->m_pLastJob = 0;
+				pQueue->m_pFirstJob = 0;
 		}
-		lock_unlock(pPool->m_Lock);
-
-		// do the job if we have one
+		lock_unlock(pQueue->m_Lock);
 		if(pJob)
+			return pJob;
+	}
+	return 0;
+}
+
+// moves everything from the inbox to the end of a queue
+bool CJobPool::TakeInbox(int Queue)
+{
+	CJob *pList = m_pInbox;
+	while(pList)
+	{
+		CJob *pOld = (CJob *)atomic_compswap_ptr((void *volatile *)&m_pInbox, pList, 0);
+		if(pOld == pList)
+			break;
+		pList = pOld;
+	}
+	if(!pList)
+		return false;
+
+	// the inbox is newest first, turn it around
+	CJob *pFirst = 0;
+	CJob *pLast = pList;
+	while(pList)
+	{
+		CJob *pNext = pList->m_pNext;
+		pList->m_pNext = pFirst;
+		if(pFirst)
+			pFirst->m_pPrev = pList;
+		pFirst = pList;
+		pList = pNext;
+	}
+	pFirst->m_pPrev = 0;
+
+	CQueue *pQueue = &m_aQueues[Queue];
+	lock_wait(pQueue->m_Lock);
+	if(pQueue->m_pLastJob)
+	{
+		pQueue->m_pLastJob->m_pNext = pFirst;
+		pFirst->m_pPrev = pQueue->m_pLastJob;
+	}
+	else
+		pQueue->m_pFirstJob = pFirst;
+	pQueue->m_pLastJob = pLast;
+	lock_unlock(pQueue->m_Lock);
+	return true;
+}
+
+CJob *CJobPool::FindJob(int Queue)
+{
+	CJob *pJob = PopJob(Queue);
+	if(!pJob && TakeInbox(Queue))
+		pJob = PopJob(Queue);
+	if(!pJob)
+		pJob = StealJob(Queue);
+	return pJob;
+}
+
+void CJobPool::RunJob(CJob *pJob)
+{
+	pJob->m_Status = CJob::STATE_RUNNING;
+	int Result = pJob->m_pfnFunc(pJob->m_pFuncData);
+
+	// the job may be reused as soon as it is done
+	CJobGroup *pGroup = pJob->m_pGroup;
+	pJob->m_Result = Result;
+	sync_barrier();
+	pJob->m_Status = CJob::STATE_DONE;
+	if(pGroup)
+		atomic_dec(&pGroup->m_NumPending);
+}
+
+void CJobPool::WorkerThread(void *pUser)
+{
+	CWorker *pWorker = (CWorker *)pUser;
+	CJobPool *pPool = pWorker->m_pPool;
+
+	while(!pPool->m_Shutdown)
+	{
+		// sleep until there is something to do
+		sphore_wait(&pPool->m_Semaphore);
+
+		// work until there is nothing left to take or steal
+		while(!pPool->m_Shutdown)
 		{
-			pJob->m_Status = CJob::STATE_RUNNING;
-			pJob->m_Result = pJob->m_pfnFunc(pJob->m_pFuncData);
-			pJob->m_Status = CJob::STATE_DONE;
+			CJob *pJob = pPool->FindJob(pWorker->m_Index);
+			if(!pJob)
+				break;
+			RunJob(pJob);
 		}
-		else
-			thread_sleep(10);
 	}
-
 }
 
-int CJobPool::Init(int NumThreads)
+int CJobPool::Init(int NumThreads, int FirstCpu)
 {
 	// start threads
 	m_NumThreads = NumThreads > MAX_THREADS ? MAX_THREADS : NumThreads;
 	for(int i = 0; i < m_NumThreads; i++)
-		m_apThreads[i] = thread_init(WorkerThread, this);
+	{
+		m_aWorkers[i].m_pPool = this;
+		m_aWorkers[i].m_Index = i;
+		m_aWorkers[i].m_pThread = thread_init(WorkerThread, &m_aWorkers[i]);
+		if(FirstCpu >= 0 && thread_set_affinity(m_aWorkers[i].m_pThread, FirstCpu+i) != 0)
+			dbg_msg("jobs", "failed to pin worker %d to cpu %d", i, FirstCpu+i);
+	}
 	return 0;
 }
 
-int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData)
+int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup)
 {
 	mem_zero(pJob, sizeof(CJob));
 	pJob->m_pfnFunc = pfnFunc;
 	pJob->m_pFuncData = pData;
+	pJob->m_pGroup = pGroup;
+	if(pGroup)
+		atomic_inc(&pGroup->m_NumPending);
 
-	lock_wait(m_Lock);
-
-	// add job to queue
-	pJob->m_pPrev = m_pLastJob;
-	if(m_pLastJob)
-		m_pLastJob->m_pNext = pJob;
-	m_pLastJob = pJob;
-	if(!m_pFirstJob)
-		m_pFirstJob = pJob;
+	// add job to the inbox
+	CJob *pHead;
+	do
+	{
+		pHead = m_pInbox;
+		pJob->m_pNext = pHead;
+	}
+	while(atomic_compswap_ptr((void *volatile *)&m_pInbox, pHead, pJob) != pHead);
 
-	lock_unlock(m_Lock);
+	if(m_NumThreads)
+		sphore_signal(&m_Semaphore);
 	return 0;
 }
 
+void CJobPool::Wait(CJob *pJob)
+{
+	while(pJob->Status() != CJob::STATE_DONE)
+	{
+		// help out instead of idling, this also makes a pool without threads work
+		CJob *pOther = FindJob(m_NumThreads);
+		if(pOther)
+			RunJob(pOther);
+		else
+			thread_yield();
+	}
+}
+
+void CJobPool::Wait(CJobGroup *pGroup)
+{
+	while(!pGroup->Done())
+	{
+		CJob *pOther = FindJob(m_NumThreads);
+		if(pOther)
+			RunJob(pOther);
+		else
+			thread_yield();
+	}
+}
@@ -2,10 +2,26 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef ENGINE_SHARED_JOBS_H
 #define ENGINE_SHARED_JOBS_H
+
+#include <base/system.h>
+
 typedef int (*JOBFUNC)(void *pData);
 
 class CJobPool;
 
+// counts the unfinished jobs added with it, see CJobPool::Wait
+class CJobGroup
+{
+	friend class CJobPool;
+
+	volatile unsigned m_NumPending;
+
+public:
+	CJobGroup() { m_NumPending = 0; }
+
+	bool Done() const { return m_NumPending == 0; }
+};
+
 class CJob
 {
 	friend class CJobPool;
@@ -18,6 +34,7 @@ class CJob
 
 	JOBFUNC m_pfnFunc;
 	void *m_pFuncData;
+	CJobGroup *m_pGroup;
 public:
 	CJob()
 	{
@@ -36,28 +53,63 @@ public:
 	int Result() const {return m_Result; }
 };
 
+/*
+	Class: CJobPool
+		Runs jobs on a set of worker threads. New jobs go to a lock
+		free inbox, a worker takes all of them at once into its own
+		queue and the others steal from the back of it when they run
+		dry. Threads that wait for jobs help out in the meantime, so
+		a pool without threads runs everything on the waiting thread.
+*/
 class CJobPool
 {
 	enum
 	{
 		MAX_THREADS=32
 	};
+
+	// jobs taken from the inbox by one worker, the last one is shared by all other threads
+	struct CQueue
+	{
+		LOCK m_Lock;
+		CJob *m_pFirstJob;
+		CJob *m_pLastJob;
+	};
+
+	struct CWorker
+	{
+		CJobPool *m_pPool;
+		int m_Index;
+		void *m_pThread;
+	};
+
 	int m_NumThreads;
-	void *m_apThreads[MAX_THREADS];
+	CWorker m_aWorkers[MAX_THREADS];
+	CQueue m_aQueues[MAX_THREADS+1];
 	volatile bool m_Shutdown;
 
-	LOCK m_Lock;
-	CJob *m_pFirstJob;
-	CJob *m_pLastJob;
+	CJob *volatile m_pInbox; // newest first
+	SEMAPHORE m_Semaphore;
 
+	CJob *PopJob(int Queue);
+	CJob *StealJob(int Thief);
+	bool TakeInbox(int Queue);
+	CJob *FindJob(int Queue);
+	static void RunJob(CJob *pJob);
 	static void WorkerThread(void *pUser);
 
 public:
 	CJobPool();
 	~CJobPool();
 
-	int Init(int NumThreads);
+	// FirstCpu pins the workers to the cpus FirstCpu, FirstCpu+1, ..., -1 leaves them to the os
+	int Init(int NumThreads, int FirstCpu = -1);
 	void Shutdown();
-	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData);
+	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup = 0);
+
+	// block until the job or all jobs of the group are done, run queued jobs in the meantime
+	void Wait(CJob *pJob);
+	void Wait(CJobGroup *pGroup);
+	int NumThreads() const { return m_NumThreads; }
 };
 #endif
@@ -105,6 +105,11 @@ public:
 	{
 		return m_DataFile.Crc();
 	}
+
+	virtual void Swap(IEngineMap *pOther)
+	{
+		m_DataFile.Swap(&static_cast<CMap *>(pOther)->m_DataFile);
+	}
 };
 
 extern IEngineMap *CreateEngineMap() { return new CMap; }
@@ -0,0 +1,194 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include <engine/engine.h>
+#include <engine/map.h>
+#include <engine/mapchecker.h>
+#include <engine/message.h>
+#include <engine/storage.h>
+
+#include "maploader.h"
+#include "protocol.h"
+
+CMapChunks::CMapChunks()
+{
+	m_pData = 0;
+	m_pOffsets = 0;
+	m_NumChunks = 0;
+	m_FileSize = 0;
+}
+
+CMapChunks::~CMapChunks()
+{
+	Clear();
+}
+
+void CMapChunks::Clear()
+{
+	if(m_pData)
+		mem_free(m_pData);
+	if(m_pOffsets)
+		mem_free(m_pOffsets);
+	m_pData = 0;
+	m_pOffsets = 0;
+	m_NumChunks = 0;
+	m_FileSize = 0;
+}
+
+void CMapChunks::Swap(CMapChunks *pOther)
+{
+	unsigned char *pData = m_pData; m_pData = pOther->m_pData; pOther->m_pData = pData;
+	int *pOffsets = m_pOffsets; m_pOffsets = pOther->m_pOffsets; pOther->m_pOffsets = pOffsets;
+	int NumChunks = m_NumChunks; m_NumChunks = pOther->m_NumChunks; pOther->m_NumChunks = NumChunks;
+	int FileSize = m_FileSize; m_FileSize = pOther->m_FileSize; pOther->m_FileSize = FileSize;
+}
+
+bool CMapChunks::Prepare(IOHANDLE File, int ChunkSize)
+{
+	Clear();
+	m_FileSize = (int)io_length(File);
+	m_NumChunks = maximum(1, (m_FileSize+ChunkSize-1)/ChunkSize);
+
+	// the message header is a single varint, at most 5 bytes
+	m_pData = (unsigned char *)mem_alloc(m_FileSize+m_NumChunks*5);
+	m_pOffsets = (int *)mem_alloc((m_NumChunks+1)*sizeof(int));
+	unsigned char *pBuf = (unsigned char *)mem_alloc(ChunkSize);
+
+	int Offset = 0;
+	for(int i = 0; i < m_NumChunks; i++)
+	{
+		int Size = minimum(ChunkSize, m_FileSize-i*ChunkSize);
+		if(io_read(File, pBuf, Size) != (unsigned)Size)
+		{
+			mem_free(pBuf);
+			Clear();
+			return false;
+		}
+
+		CMsgPacker Msg(NETMSG_MAP_DATA, true);
+		Msg.AddRaw(pBuf, Size);
+		m_pOffsets[i] = Offset;
+		mem_copy(m_pData+Offset, Msg.Data(), Msg.Size());
+		Offset += Msg.Size();
+	}
+	m_pOffsets[m_NumChunks] = Offset;
+	mem_free(pBuf);
+	return true;
+}
+
+CMapLoader::CMapLoader()
+{
+	m_pStorage = 0;
+	m_pMapChecker = 0;
+	m_pMap = CreateEngineMap();
+	m_aName[0] = 0;
+	m_Pending = false;
+	m_pError = 0;
+	m_ChunkSize = 0;
+	m_LoadTime = 0;
+}
+
+CMapLoader::~CMapLoader()
+{
+	Wait();
+	Reset();
+	delete m_pMap;
+}
+
+void CMapLoader::Init(IStorage *pStorage, IMapChecker *pMapChecker, int ChunkSize)
+{
+	m_pStorage = pStorage;
+	m_pMapChecker = pMapChecker;
+	m_ChunkSize = ChunkSize;
+}
+
+void CMapLoader::Reset()
+{
+	m_pMap->Unload();
+	m_Chunks.Clear();
+}
+
+// runs on the job thread, only touches the loader and thread safe interfaces
+int CMapLoader::LoadJob(void *pUser)
+{
+	CMapLoader *pThis = (CMapLoader *)pUser;
+	int64 StartTime = time_get();
+
+	char aBuf[IO_MAX_PATH_LENGTH];
+	str_format(aBuf, sizeof(aBuf), "maps/%s.map", pThis->m_aName);
+
+	// check for valid standard map
+	if(pThis->m_pMapChecker && !pThis->m_pMapChecker->ReadAndValidateMap(aBuf, IStorage::TYPE_ALL))
+	{
+		pThis->m_pError = "invalid standard map";
+		return 0;
+	}
+
+	if(!pThis->m_pMap->Load(aBuf, pThis->m_pStorage))
+	{
+		pThis->m_pError = "couldn't load map";
+		return 0;
+	}
+
+	// cut the complete map into messages for download
+	IOHANDLE File = pThis->m_pStorage->OpenFile(aBuf, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(!File)
+	{
+		pThis->m_pError = "couldn't open map file";
+		return 0;
+	}
+	bool Prepared = pThis->m_Chunks.Prepare(File, pThis->m_ChunkSize);
+	io_close(File);
+	if(!Prepared)
+	{
+		pThis->m_pError = "couldn't read map file";
+		return 0;
+	}
+
+	pThis->m_LoadTime = time_get()-StartTime;
+	return 1;
+}
+
+void CMapLoader::Start(const char *pMapName, IEngine *pEngine)
+{
+	dbg_assert(!m_Pending, "map loader is busy");
+
+	Reset();
+	str_copy(m_aName, pMapName, sizeof(m_aName));
+	m_pError = 0;
+	m_LoadTime = 0;
+	m_Pending = true;
+
+	if(pEngine)
+		pEngine->AddJob(&m_Job, LoadJob, this);
+	else
+		LoadJob(this);
+}
+
+void CMapLoader::Wait() const
+{
+	while(m_Pending && m_Job.Status() != CJob::STATE_DONE)
+		thread_sleep(1);
+}
+
+bool CMapLoader::Finish(IEngineMap *pMap, CMapChunks *pChunks)
+{
+	dbg_assert(m_Pending, "no map load to finish");
+	Wait();
+	m_Pending = false;
+
+	if(m_pError)
+	{
+		Reset();
+		return false;
+	}
+
+	// the old map ends up in the loader and is released right away
+	pMap->Swap(m_pMap);
+	m_pMap->Unload();
+
+	pChunks->Swap(&m_Chunks);
+	m_Chunks.Clear();
+	return true;
+}
@@ -0,0 +1,83 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_MAPLOADER_H
+#define ENGINE_SHARED_MAPLOADER_H
+
+#include <base/system.h>
+
+#include "jobs.h"
+
+/*
+	Class: CMapChunks
+		The map file cut into ready to send NETMSG_MAP_DATA messages,
+		so serving a download is only a copy into the network buffer.
+*/
+class CMapChunks
+{
+	unsigned char *m_pData;
+	int *m_pOffsets; // m_NumChunks+1 entries into m_pData
+	int m_NumChunks;
+	int m_FileSize;
+
+public:
+	CMapChunks();
+	~CMapChunks();
+
+	// packs the file into messages carrying ChunkSize bytes of it each
+	bool Prepare(IOHANDLE File, int ChunkSize);
+	void Clear();
+	void Swap(CMapChunks *pOther);
+
+	int NumChunks() const { return m_NumChunks; }
+	int FileSize() const { return m_FileSize; }
+	const unsigned char *Msg(int Chunk) const { return m_pData+m_pOffsets[Chunk]; }
+	int MsgSize(int Chunk) const { return m_pOffsets[Chunk+1]-m_pOffsets[Chunk]; }
+};
+
+/*
+	Class: CMapLoader
+		Loads a map, checks it against the standard maps and prepares
+		the download chunks on the engine's job thread. The current
+		map keeps running until the new one is done and gets swapped in
+		with <Finish>.
+*/
+class CMapLoader
+{
+	CJob m_Job;
+	class IStorage *m_pStorage;
+	class IMapChecker *m_pMapChecker;
+	class IEngineMap *m_pMap;
+
+	char m_aName[64];
+	bool m_Pending;
+	const char *m_pError;
+	int m_ChunkSize;
+	CMapChunks m_Chunks;
+	int64 m_LoadTime;
+
+	static int LoadJob(void *pUser);
+	void Reset();
+
+public:
+	CMapLoader();
+	~CMapLoader();
+
+	void Init(class IStorage *pStorage, class IMapChecker *pMapChecker, int ChunkSize);
+
+	// loads maps/<pMapName>.map on the engine's job thread or right away without an engine
+	void Start(const char *pMapName, class IEngine *pEngine);
+
+	// blocks until the running load is done
+	void Wait() const;
+
+	// swaps the loaded map into pMap and its chunks into pChunks, the previous ones are freed
+	bool Finish(class IEngineMap *pMap, CMapChunks *pChunks);
+
+	bool Pending() const { return m_Pending; }
+	bool Done() const { return m_Pending && m_Job.Status() == CJob::STATE_DONE; }
+	const char *Name() const { return m_aName; }
+	const char *Error() const { return m_pError; }
+	int64 LoadTime() const { return m_LoadTime; }
+};
+
+#endif
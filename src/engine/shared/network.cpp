@@ -112,6 +112,7 @@ CNetBase::CNetBase()
 	m_pEngine = 0;
 	m_DataLogSent = 0;
 	m_DataLogRecv = 0;
+	m_pBatch = 0;
 }
 
 CNetBase::~CNetBase()
@@ -120,57 +121,142 @@ CNetBase::~CNetBase()
 		Shutdown();
 }
 
-void CNetBase::Init(NETSOCKET Socket, CConfig *pConfig, IConsole *pConsole, IEngine *pEngine)
+void CNetBase::Init(NETSOCKET Socket, CConfig *pConfig, IConsole *pConsole, IEngine *pEngine, bool Batching)
 {
 	m_Socket = Socket;
 	m_pConfig = pConfig;
 	m_pEngine = pEngine;
 	m_Huffman.Init();
 	mem_zero(m_aRequestTokenBuf, sizeof(m_aRequestTokenBuf));
+	m_pBatch = 0;
+	if(Batching)
+	{
+		m_pBatch = new CBatch;
+		m_pBatch->m_NumSend = 0;
+		m_pBatch->m_NumRecv = 0;
+		m_pBatch->m_RecvPos = 0;
+		m_pBatch->m_RecvDrained = false;
+	}
 	if(pEngine)
 		pConsole->Chain("dbg_lognetwork", ConchainDbgLognetwork, this);
 }
 
 void CNetBase::Shutdown()
 {
+	FlushBatch();
+	delete m_pBatch;
+	m_pBatch = 0;
+
 	net_udp_close(m_Socket);
 	net_invalidate_socket(&m_Socket);
 }
 
 void CNetBase::Wait(int Time)
 {
+	// everything queued so far has to be out before we sleep
+	FlushBatch();
 	net_socket_read_wait(m_Socket, Time);
 }
 
+void CNetBase::FlushBatch()
+{
+	if(!m_pBatch || !m_pBatch->m_NumSend)
+		return;
+
+	net_udp_send_batch(m_Socket, m_pBatch->m_aSend, m_pBatch->m_NumSend);
+	m_pBatch->m_NumSend = 0;
+}
+
+// returns the buffer to construct the next outgoing datagram in
+unsigned char *CNetBase::SendBuffer(unsigned char *pBuffer)
+{
+	if(!m_pBatch)
+		return pBuffer;
+
+	if(m_pBatch->m_NumSend == NET_BATCH_SIZE)
+		FlushBatch();
+	return m_pBatch->m_aaSendData[m_pBatch->m_NumSend];
+}
+
+// sends a datagram built in the buffer from SendBuffer, or queues it when batching
+void CNetBase::SendDatagram(const NETADDR *pAddr, unsigned char *pData, int Size)
+{
+	if(!m_pBatch)
+	{
+		net_udp_send(m_Socket, pAddr, pData, Size);
+		return;
+	}
+
+	NETDATAGRAM *pDatagram = &m_pBatch->m_aSend[m_pBatch->m_NumSend++];
+	pDatagram->addr = *pAddr;
+	pDatagram->data = pData;
+	pDatagram->size = Size;
+}
+
+// fetches the next incoming datagram, ppData points to the buffer to receive into
+int CNetBase::RecvDatagram(NETADDR *pAddr, unsigned char **ppData)
+{
+	if(!m_pBatch)
+		return net_udp_recv(m_Socket, pAddr, *ppData, NET_MAX_PACKETSIZE);
+
+	if(m_pBatch->m_RecvPos == m_pBatch->m_NumRecv)
+	{
+		// a short batch emptied the socket, save the call that would only tell us that
+		if(m_pBatch->m_RecvDrained)
+		{
+			m_pBatch->m_RecvDrained = false;
+			return 0;
+		}
+
+		for(int i = 0; i < NET_BATCH_SIZE; i++)
+		{
+			m_pBatch->m_aRecv[i].data = m_pBatch->m_aaRecvData[i];
+			m_pBatch->m_aRecv[i].size = NET_MAX_PACKETSIZE;
+		}
+		m_pBatch->m_NumRecv = net_udp_recv_batch(m_Socket, m_pBatch->m_aRecv, NET_BATCH_SIZE);
+		m_pBatch->m_RecvPos = 0;
+		if(!m_pBatch->m_NumRecv)
+			return 0;
+		m_pBatch->m_RecvDrained = m_pBatch->m_NumRecv < NET_BATCH_SIZE;
+	}
+
+	const NETDATAGRAM *pDatagram = &m_pBatch->m_aRecv[m_pBatch->m_RecvPos++];
+	*pAddr = pDatagram->addr;
+	*ppData = (unsigned char *)pDatagram->data;
+	return pDatagram->size;
+}
+
 // packs the data tight and sends it
 void CNetBase::SendPacketConnless(const NETADDR *pAddr, TOKEN Token, TOKEN ResponseToken, const void *pData, int DataSize)
 {
 	unsigned char aBuffer[NET_MAX_PACKETSIZE];
+	unsigned char *pBuffer = SendBuffer(aBuffer);
 
 	dbg_assert(DataSize <= NET_MAX_PAYLOAD, "packet data size too high");
 	dbg_assert((Token&~NET_TOKEN_MASK) == 0, "token out of range");
 	dbg_assert((ResponseToken&~NET_TOKEN_MASK) == 0, "resp token out of range");
 
 	int i = 0;
-	aBuffer[i++] = ((NET_PACKETFLAG_CONNLESS<<2)&0xfc) | (NET_PACKETVERSION&0x03); // connless flag and version
-	aBuffer[i++] = (Token>>24)&0xff; // token
-	aBuffer[i++] = (Token>>16)&0xff;
-	aBuffer[i++] = (Token>>8)&0xff;
-	aBuffer[i++] = (Token)&0xff;
-	aBuffer[i++] = (ResponseToken>>24)&0xff; // response token
-	aBuffer[i++] = (ResponseToken>>16)&0xff;
-	aBuffer[i++] = (ResponseToken>>8)&0xff;
-	aBuffer[i++] = (ResponseToken)&0xff;
+	pBuffer[i++] = ((NET_PACKETFLAG_CONNLESS<<2)&0xfc) | (NET_PACKETVERSION&0x03); // connless flag and version
+	pBuffer[i++] = (Token>>24)&0xff; // token
+	pBuffer[i++] = (Token>>16)&0xff;
+	pBuffer[i++] = (Token>>8)&0xff;
+	pBuffer[i++] = (Token)&0xff;
+	pBuffer[i++] = (ResponseToken>>24)&0xff; // response token
+	pBuffer[i++] = (ResponseToken>>16)&0xff;
+	pBuffer[i++] = (ResponseToken>>8)&0xff;
+	pBuffer[i++] = (ResponseToken)&0xff;
 
 	dbg_assert(i == NET_PACKETHEADERSIZE_CONNLESS, "inconsistency");
 
-	mem_copy(&aBuffer[i], pData, DataSize);
-	net_udp_send(m_Socket, pAddr, aBuffer, i+DataSize);
+	mem_copy(&pBuffer[i], pData, DataSize);
+	SendDatagram(pAddr, pBuffer, i+DataSize);
 }
 
 void CNetBase::SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket)
 {
 	unsigned char aBuffer[NET_MAX_PACKETSIZE];
+	unsigned char *pBuffer = SendBuffer(aBuffer);
 	int CompressedSize = -1;
 	int FinalSize = -1;
 
@@ -188,7 +274,7 @@ void CNetBase::SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket)
 
 	// compress if not ctrl msg
 	if(!(pPacket->m_Flags&NET_PACKETFLAG_CONTROL))
-		CompressedSize = m_Huffman.Compress(pPacket->m_aChunkData, pPacket->m_DataSize, &aBuffer[NET_PACKETHEADERSIZE], NET_MAX_PAYLOAD);
+		CompressedSize = m_Huffman.Compress(pPacket->m_aChunkData, pPacket->m_DataSize, &pBuffer[NET_PACKETHEADERSIZE], NET_MAX_PAYLOAD);
 
 	// check if the compression was enabled, successful and good enough
 	if(CompressedSize > 0 && CompressedSize < pPacket->m_DataSize)
@@ -200,7 +286,7 @@ void CNetBase::SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket)
 	{
 		// use uncompressed data
 		FinalSize = pPacket->m_DataSize;
-		mem_copy(&aBuffer[NET_PACKETHEADERSIZE], pPacket->m_aChunkData, pPacket->m_DataSize);
+		mem_copy(&pBuffer[NET_PACKETHEADERSIZE], pPacket->m_aChunkData, pPacket->m_DataSize);
 		pPacket->m_Flags &= ~NET_PACKETFLAG_COMPRESSION;
 	}
 
@@ -210,17 +296,17 @@ void CNetBase::SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket)
 		FinalSize += NET_PACKETHEADERSIZE;
 
 		int i = 0;
-		aBuffer[i++] = ((pPacket->m_Flags<<2)&0xfc) | ((pPacket->m_Ack>>8)&0x03); // flags and ack
-		aBuffer[i++] = (pPacket->m_Ack)&0xff; // ack
-		aBuffer[i++] = (pPacket->m_NumChunks)&0xff; // num chunks
-		aBuffer[i++] = (pPacket->m_Token>>24)&0xff; // token
-		aBuffer[i++] = (pPacket->m_Token>>16)&0xff;
-		aBuffer[i++] = (pPacket->m_Token>>8)&0xff;
-		aBuffer[i++] = (pPacket->m_Token)&0xff;
+		pBuffer[i++] = ((pPacket->m_Flags<<2)&0xfc) | ((pPacket->m_Ack>>8)&0x03); // flags and ack
+		pBuffer[i++] = (pPacket->m_Ack)&0xff; // ack
+		pBuffer[i++] = (pPacket->m_NumChunks)&0xff; // num chunks
+		pBuffer[i++] = (pPacket->m_Token>>24)&0xff; // token
+		pBuffer[i++] = (pPacket->m_Token>>16)&0xff;
+		pBuffer[i++] = (pPacket->m_Token>>8)&0xff;
+		pBuffer[i++] = (pPacket->m_Token)&0xff;
 
 		dbg_assert(i == NET_PACKETHEADERSIZE, "inconsistency");
 
-		net_udp_send(m_Socket, pAddr, aBuffer, FinalSize);
+		SendDatagram(pAddr, pBuffer, FinalSize);
 
 		// log raw socket data
 		if(m_DataLogSent)
@@ -228,7 +314,7 @@ void CNetBase::SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket)
 			int Type = 0;
 			io_write(m_DataLogSent, &Type, sizeof(Type));
 			io_write(m_DataLogSent, &FinalSize, sizeof(FinalSize));
-			io_write(m_DataLogSent, aBuffer, FinalSize);
+			io_write(m_DataLogSent, pBuffer, FinalSize);
 			io_flush(m_DataLogSent);
 		}
 	}
@@ -237,7 +323,7 @@ void CNetBase::SendPacket(const NETADDR *pAddr, CNetPacketConstruct *pPacket)
 // TODO: rename this function
 int CNetBase::UnpackPacket(NETADDR *pAddr, unsigned char *pBuffer, CNetPacketConstruct *pPacket)
 {
-	int Size = net_udp_recv(m_Socket, pAddr, pBuffer, NET_MAX_PACKETSIZE);
+	int Size = RecvDatagram(pAddr, &pBuffer);
 	// no more packets for now
 	if(Size <= 0)
 		return 1;
@@ -85,6 +85,9 @@ enum
 
 	NET_MAX_PACKET_CHUNKS=256,
 
+	// packets per batched socket call
+	NET_BATCH_SIZE = 32,
+
 	// token
 	NET_SEEDTIME = 16,
 
@@ -128,7 +131,7 @@ enum
 	NET_CTRLMSG_CLOSE=4,
 	NET_CTRLMSG_TOKEN=5,
 
-	NET_CONN_BUFFERSIZE=1024*32,
+	NET_CONN_BUFFERSIZE=1024*64,
 
 	NET_ENUM_TERMINATOR
 };
@@ -207,6 +210,24 @@ class CNetBase
 	CHuffman m_Huffman;
 	unsigned char m_aRequestTokenBuf[NET_TOKENREQUEST_DATASIZE];
 
+	// queued outgoing and pending incoming datagrams when batching is enabled
+	struct CBatch
+	{
+		NETDATAGRAM m_aSend[NET_BATCH_SIZE];
+		NETDATAGRAM m_aRecv[NET_BATCH_SIZE];
+		unsigned char m_aaSendData[NET_BATCH_SIZE][NET_MAX_PACKETSIZE];
+		unsigned char m_aaRecvData[NET_BATCH_SIZE][NET_MAX_PACKETSIZE];
+		int m_NumSend;
+		int m_NumRecv;
+		int m_RecvPos;
+		bool m_RecvDrained;
+	};
+	CBatch *m_pBatch;
+
+	unsigned char *SendBuffer(unsigned char *pBuffer);
+	void SendDatagram(const NETADDR *pAddr, unsigned char *pData, int Size);
+	int RecvDatagram(NETADDR *pAddr, unsigned char **ppData);
+
 public:
 	CNetBase();
 	~CNetBase();
@@ -214,10 +235,11 @@ public:
 	class IEngine *Engine() { return m_pEngine; }
 	int NetType() { return m_Socket.type; }
 	
-	void Init(NETSOCKET Socket, class CConfig *pConfig, class IConsole *pConsole, class IEngine *pEngine);
+	void Init(NETSOCKET Socket, class CConfig *pConfig, class IConsole *pConsole, class IEngine *pEngine, bool Batching = false);
 	void Shutdown();
 	void UpdateLogHandles();
 	void Wait(int Time);
+	void FlushBatch();
 
 	void SendControlMsg(const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, const void *pExtra, int ExtraSize);
 	void SendControlMsgWithToken(const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, TOKEN MyToken, bool Extended);
@@ -327,7 +349,15 @@ private:
 	int m_RemoteClosed;
 	bool m_BlockCloseMsg;
 
+	// unacked vital chunks, in sequence order starting at the first one. the
+	// first m_NumResend are in flight, the held ones after them wait for acks
 	TStaticRingBuffer<CNetChunkResend, NET_CONN_BUFFERSIZE> m_Buffer;
+	int m_NumResend;
+	int m_NumHeld;
+
+	// smoothed round trip time of vital chunks and its variation
+	int64 m_Rtt;
+	int64 m_RttVar;
 
 	int64 m_LastUpdateTime;
 	int64 m_LastRecvTime;
@@ -349,8 +379,11 @@ private:
 	void ResetStats();
 	void SetError(const char *pString);
 	void AckChunks(int Ack);
+	void UpdateRtt(int64 Sample);
 
+	void PackChunk(int Flags, int DataSize, const void *pData, int Sequence);
 	int QueueChunkEx(int Flags, int DataSize, const void *pData, int Sequence);
+	void SendHeldChunks();
 	void SendControl(int ControlMsg, const void *pExtra, int ExtraSize);
 	void SendControlWithToken(int ControlMsg);
 	void ResendChunk(CNetChunkResend *pResend);
@@ -389,6 +422,12 @@ public:
 	int64 ConnectTime() const { return m_LastUpdateTime; }
 
 	int AckSequence() const { return m_Ack; }
+
+	// vital chunks waiting for their ack, and the ones held back until acks make room for them
+	int NumInFlight() const { return m_NumResend; }
+	int NumHeld() const { return m_NumHeld; }
+	int64 ResendTimeout() const;
+
 	// The backroom is ack-NET_MAX_SEQUENCE/2. Used for knowing if we acked a packet or not
 	static int IsSeqInBackroom(int Seq, int Ack);
 };
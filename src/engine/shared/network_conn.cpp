@@ -27,6 +27,10 @@ void CNetConnection::Reset()
 	mem_zero(&m_PeerAddr, sizeof(m_PeerAddr));
 
 	m_Buffer.Init();
+	m_NumResend = 0;
+	m_NumHeld = 0;
+	m_Rtt = 0;
+	m_RttVar = 0;
 
 	mem_zero(&m_Construct, sizeof(m_Construct));
 }
@@ -66,19 +70,51 @@ void CNetConnection::Init(CNetBase *pNetBase, bool BlockCloseMsg)
 
 void CNetConnection::AckChunks(int Ack)
 {
-	while(1)
+	// the buffer holds consecutive sequences, so the ack directly tells how many chunks it covers
+	CNetChunkResend *pResend = m_Buffer.First();
+	if(!pResend)
+		return;
+
+	int NumAcked = ((Ack-pResend->m_Sequence)&NET_SEQUENCE_MASK)+1;
+	if(NumAcked > m_NumResend)
+		return;
+
+	// the newest acked chunk gives the best round trip sample, as long as it wasn't resent
+	int64 Now = time_get();
+	for(int i = 0; i < NumAcked; i++)
 	{
-		CNetChunkResend *pResend = m_Buffer.First();
-		if(!pResend)
-			break;
+		pResend = m_Buffer.First();
+		if(i == NumAcked-1 && pResend->m_LastSendTime == pResend->m_FirstSendTime)
+			UpdateRtt(Now-pResend->m_FirstSendTime);
+		m_Buffer.PopFirst();
+	}
+	m_NumResend -= NumAcked;
 
-		if(IsSeqInBackroom(pResend->m_Sequence, Ack))
-			m_Buffer.PopFirst();
-		else
-			break;
+	SendHeldChunks();
+}
+
+void CNetConnection::UpdateRtt(int64 Sample)
+{
+	if(!m_Rtt)
+	{
+		m_Rtt = Sample;
+		m_RttVar = Sample/2;
+	}
+	else
+	{
+		m_RttVar = (3*m_RttVar + absolute(m_Rtt-Sample))/4;
+		m_Rtt = (7*m_Rtt + Sample)/8;
 	}
 }
 
+int64 CNetConnection::ResendTimeout() const
+{
+	// one second until we know better, which also stays the upper limit
+	if(!m_Rtt)
+		return time_freq();
+	return clamp(m_Rtt + 4*m_RttVar, time_freq()/5, time_freq());
+}
+
 void CNetConnection::SignalResend()
 {
 	m_Construct.m_Flags |= NET_PACKETFLAG_RESEND;
@@ -103,7 +139,7 @@ int CNetConnection::Flush()
 	return NumChunks;
 }
 
-int CNetConnection::QueueChunkEx(int Flags, int DataSize, const void *pData, int Sequence)
+void CNetConnection::PackChunk(int Flags, int DataSize, const void *pData, int Sequence)
 {
 	unsigned char *pChunkData;
 
@@ -124,34 +160,64 @@ int CNetConnection::QueueChunkEx(int Flags, int DataSize, const void *pData, int
 	//
 	m_Construct.m_NumChunks++;
 	m_Construct.m_DataSize = (int)(pChunkData-m_Construct.m_aChunkData);
+}
 
-	// set packet flags aswell
-
+int CNetConnection::QueueChunkEx(int Flags, int DataSize, const void *pData, int Sequence)
+{
 	if(Flags&NET_CHUNKFLAG_VITAL && !(Flags&NET_CHUNKFLAG_RESEND))
 	{
 		// save packet if we need to resend
 		CNetChunkResend *pResend = m_Buffer.Allocate(sizeof(CNetChunkResend)+DataSize);
-		if(pResend)
-		{
-			pResend->m_Sequence = Sequence;
-			pResend->m_Flags = Flags;
-			pResend->m_DataSize = DataSize;
-			pResend->m_pData = (unsigned char *)(pResend+1);
-			pResend->m_FirstSendTime = time_get();
-			pResend->m_LastSendTime = pResend->m_FirstSendTime;
-			mem_copy(pResend->m_pData, pData, DataSize);
-		}
-		else
+		if(!pResend)
 		{
 			// out of buffer
 			Disconnect("too weak connection (out of buffer)");
 			return -1;
 		}
+
+		pResend->m_Sequence = Sequence;
+		pResend->m_Flags = Flags;
+		pResend->m_DataSize = DataSize;
+		pResend->m_pData = (unsigned char *)(pResend+1);
+		pResend->m_FirstSendTime = time_get();
+		pResend->m_LastSendTime = pResend->m_FirstSendTime;
+		mem_copy(pResend->m_pData, pData, DataSize);
+
+		// more than half the sequence space in flight can't be acked correctly,
+		// so the chunk waits in the buffer until acks make room for it
+		if(m_NumHeld || m_NumResend >= NET_MAX_SEQUENCE/2)
+		{
+			m_NumHeld++;
+			return 0;
+		}
+		m_NumResend++;
 	}
 
+	PackChunk(Flags, DataSize, pData, Sequence);
 	return 0;
 }
 
+void CNetConnection::SendHeldChunks()
+{
+	if(!m_NumHeld || m_NumResend >= NET_MAX_SEQUENCE/2)
+		return;
+
+	// the held chunks come right after the ones in flight
+	CNetChunkResend *pResend = m_Buffer.First();
+	for(int i = 0; i < m_NumResend; i++)
+		pResend = m_Buffer.Next(pResend);
+
+	int64 Now = time_get();
+	for(; pResend && m_NumResend < NET_MAX_SEQUENCE/2; pResend = m_Buffer.Next(pResend))
+	{
+		PackChunk(pResend->m_Flags, pResend->m_DataSize, pResend->m_pData, pResend->m_Sequence);
+		pResend->m_FirstSendTime = Now;
+		pResend->m_LastSendTime = Now;
+		m_NumResend++;
+		m_NumHeld--;
+	}
+}
+
 int CNetConnection::QueueChunk(int Flags, int DataSize, const void *pData)
 {
 	if(Flags&NET_CHUNKFLAG_VITAL)
@@ -185,7 +251,15 @@ void CNetConnection::ResendChunk(CNetChunkResend *pResend)
 
 void CNetConnection::Resend()
 {
-	for(CNetChunkResend *pResend = m_Buffer.First(); pResend; pResend = m_Buffer.Next(pResend))
+	// chunks we already resent within the last round trip are still on their way
+	int64 Now = time_get();
+	CNetChunkResend *pResend = m_Buffer.First();
+	int i = 0;
+	for(; i < m_NumResend && pResend->m_LastSendTime != pResend->m_FirstSendTime && Now-pResend->m_LastSendTime < m_Rtt; i++)
+		pResend = m_Buffer.Next(pResend);
+
+	// the peer drops everything after a missing chunk, so the rest in flight has to follow
+	for(; i < m_NumResend; i++, pResend = m_Buffer.Next(pResend))
 		ResendChunk(pResend);
 }
 
@@ -397,8 +471,9 @@ int CNetConnection::Update()
 		}
 		else
 		{
-			// resend packet if we haven't got it acked in 1 second
-			if(Now-pResend->m_LastSendTime > time_freq())
+			// resend the chunks whose timer ran out, the newer ones still have time
+			int64 Timeout = ResendTimeout();
+			for(int i = 0; i < m_NumResend && Now-pResend->m_LastSendTime > Timeout; i++, pResend = m_Buffer.Next(pResend))
 				ResendChunk(pResend);
 		}
 	}
@@ -22,7 +22,7 @@ bool CNetServer::Open(NETADDR BindAddr, CConfig *pConfig, IConsole *pConsole, IE
 
 	// init
 	m_pNetBan = pNetBan;
-	Init(Socket, pConfig, pConsole, pEngine);
+	Init(Socket, pConfig, pConsole, pEngine, true);
 
 	m_TokenManager.Init(this);
 	m_TokenCache.Init(this, &m_TokenManager);
@@ -0,0 +1,122 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include "perf.h"
+
+CPerfTimers::CPerfTimers()
+{
+	m_Enabled = false;
+	m_NextSecond = 0;
+	m_NumSections = 0;
+}
+
+int CPerfTimers::Bucket(int Time)
+{
+	if(Time < 16)
+		return maximum(Time, 0);
+	Time = minimum(Time, (1<<30)-1);
+
+	int Log = 4;
+	while(Time >> (Log+1))
+		Log++;
+	return (Log-2)*8 + ((Time >> (Log-3))&7);
+}
+
+int CPerfTimers::BucketMax(int Bucket)
+{
+	if(Bucket < 16)
+		return Bucket;
+
+	int Log = Bucket/8+2;
+	return ((8+Bucket%8) << (Log-3)) + (1 << (Log-3)) - 1;
+}
+
+void CPerfTimers::Reset(CSection *pSection)
+{
+	mem_zero(pSection->m_aBuckets, sizeof(pSection->m_aBuckets));
+	pSection->m_Count = 0;
+	pSection->m_Total = 0;
+	pSection->m_Max = 0;
+}
+
+void CPerfTimers::SetEnabled(bool Enabled)
+{
+	if(Enabled == m_Enabled)
+		return;
+
+	m_Enabled = Enabled;
+	m_NextSecond = 0;
+	for(int i = 0; i < m_NumSections; i++)
+	{
+		Reset(&m_aSections[i]);
+		mem_zero(&m_aSections[i].m_Result, sizeof(m_aSections[i].m_Result));
+	}
+}
+
+int CPerfTimers::Register(const char *pName)
+{
+	for(int i = 0; i < m_NumSections; i++)
+		if(str_comp(m_aSections[i].m_aName, pName) == 0)
+			return i;
+	if(m_NumSections == MAX_SECTIONS)
+		return -1;
+
+	CSection *pSection = &m_aSections[m_NumSections];
+	str_copy(pSection->m_aName, pName, sizeof(pSection->m_aName));
+	Reset(pSection);
+	mem_zero(&pSection->m_Result, sizeof(pSection->m_Result));
+	return m_NumSections++;
+}
+
+void CPerfTimers::Add(int Section, int64 Time)
+{
+	if(Section < 0)
+		return;
+
+	CSection *pSection = &m_aSections[Section];
+	int Micro = (int)minimum(Time*1000000/time_freq(), (int64)0x7fffffff);
+	pSection->m_aBuckets[Bucket(Micro)]++;
+	pSection->m_Count++;
+	pSection->m_Total += Micro;
+	pSection->m_Max = maximum(pSection->m_Max, Micro);
+}
+
+int CPerfTimers::Percentile(const CSection *pSection, int Percent)
+{
+	int Rank = (pSection->m_Count*Percent+99)/100;
+	int Sum = 0;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		Sum += pSection->m_aBuckets[i];
+		if(Sum >= Rank)
+			return minimum(BucketMax(i), pSection->m_Max);
+	}
+	return pSection->m_Max;
+}
+
+void CPerfTimers::Update(int64 Now)
+{
+	if(!m_Enabled)
+		return;
+	if(!m_NextSecond)
+		m_NextSecond = Now+time_freq();
+	if(Now < m_NextSecond)
+		return;
+
+	for(int i = 0; i < m_NumSections; i++)
+	{
+		CSection *pSection = &m_aSections[i];
+		pSection->m_Result.m_Count = pSection->m_Count;
+		pSection->m_Result.m_Total = pSection->m_Total;
+		pSection->m_Result.m_P50 = Percentile(pSection, 50);
+		pSection->m_Result.m_P99 = Percentile(pSection, 99);
+		pSection->m_Result.m_Max = pSection->m_Max;
+		Reset(pSection);
+	}
+
+	// don't try to catch up after a stall
+	m_NextSecond += time_freq();
+	if(m_NextSecond <= Now)
+		m_NextSecond = Now+time_freq();
+}
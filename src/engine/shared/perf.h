@@ -0,0 +1,108 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_PERF_H
+#define ENGINE_SHARED_PERF_H
+
+#include <base/system.h>
+
+/*
+	Class: CPerfTimers
+		Collects how long named sections of the main loop take and
+		sums them up once per second. Only to be used from the main
+		thread.
+*/
+class CPerfTimers
+{
+public:
+	enum
+	{
+		MAX_SECTIONS=32,
+		MAX_NAME_LENGTH=32,
+
+		// 8 buckets per power of two, exact below 16us
+		NUM_BUCKETS=232,
+	};
+
+	// the last full second of a section, times in microseconds
+	struct CResult
+	{
+		int m_Count;
+		int64 m_Total;
+		int m_P50;
+		int m_P99;
+		int m_Max;
+	};
+
+private:
+	struct CSection
+	{
+		char m_aName[MAX_NAME_LENGTH];
+		int m_aBuckets[NUM_BUCKETS];
+		int m_Count;
+		int64 m_Total;
+		int m_Max;
+		CResult m_Result;
+	};
+
+	bool m_Enabled;
+	int64 m_NextSecond;
+	int m_NumSections;
+	CSection m_aSections[MAX_SECTIONS];
+
+	void Reset(CSection *pSection);
+	static int Percentile(const CSection *pSection, int Percent);
+
+public:
+	static int Bucket(int Time);
+	static int BucketMax(int Bucket);
+
+	CPerfTimers();
+
+	bool Enabled() const { return m_Enabled; }
+	void SetEnabled(bool Enabled);
+
+	/*
+		Function: Register
+			Adds a section or finds the one with the same name.
+			Dots in the name nest it below another section.
+
+		Returns:
+			The id to pass to Add, -1 if there are too many sections.
+	*/
+	int Register(const char *pName);
+
+	// adds one measurement in time_get() units
+	void Add(int Section, int64 Time);
+
+	// closes the second once it's over
+	void Update(int64 Now);
+
+	int NumSections() const { return m_NumSections; }
+	const char *Name(int Section) const { return m_aSections[Section].m_aName; }
+	const CResult *Result(int Section) const { return &m_aSections[Section].m_Result; }
+};
+
+// measures the time until the end of the scope
+class CPerfScope
+{
+	CPerfTimers *m_pTimers;
+	int m_Section;
+	int64 m_Start;
+
+public:
+	CPerfScope(CPerfTimers *pTimers, int Section)
+	{
+		m_pTimers = pTimers->Enabled() ? pTimers : 0;
+		m_Section = Section;
+		if(m_pTimers)
+			m_Start = time_get();
+	}
+
+	~CPerfScope()
+	{
+		if(m_pTimers)
+			m_pTimers->Add(m_Section, time_get()-m_Start);
+	}
+};
+
+#endif
@@ -3,11 +3,20 @@
 #include <algorithm>
 #include <limits.h>
 
+#include <base/math.h>
 #include <base/tl/algorithm.h>
 
 #include "snapshot.h"
 #include "compression.h"
 
+#if defined(CONF_ARCH_AMD64) || defined(__SSE2__)
+	#define SNAPSHOT_SSE2 1
+	#include <emmintrin.h>
+#elif defined(CONF_ARCH_ARM64)
+	#define SNAPSHOT_NEON 1
+	#include <arm_neon.h>
+#endif
+
 // CSnapshot
 
 const CSnapshotItem *CSnapshot::GetItem(int Index) const
@@ -84,61 +93,28 @@ void CSnapshot::DebugDump() const
 
 // CSnapshotDelta
 
-enum
-{
-	HASHLIST_SIZE = 256,
-	HASHLIST_BUCKET_SIZE = 64,
-};
-
-struct CItemList
-{
-	int m_Num;
-	int m_aKeys[HASHLIST_BUCKET_SIZE];
-	int m_aIndex[HASHLIST_BUCKET_SIZE];
-};
-
-inline unsigned CalcHashID(int Key)
-{
-	// djb2 (http://www.cse.yorku.ca/~oz/hash.html)
-	unsigned Hash = 5381;
-	for(unsigned Shift = 0; Shift < sizeof(int); Shift++)
-		Hash = ((Hash << 5) + Hash) + ((Key >> (Shift * 8)) & 0xFF);
-	return Hash % HASHLIST_SIZE;
-}
-
-static void GenerateHash(CItemList *pHashlist, const CSnapshot *pSnapshot)
+static int DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
 {
-	for(int i = 0; i < HASHLIST_SIZE; i++)
-		pHashlist[i].m_Num = 0;
-
-	for(int i = 0; i < pSnapshot->NumItems(); i++)
+	int Needed = 0;
+#if defined(SNAPSHOT_SSE2)
+	__m128i NeededVec = _mm_setzero_si128();
+	for(; Size >= 4; Size -= 4, pPast += 4, pCurrent += 4, pOut += 4)
 	{
-		int Key = pSnapshot->GetItem(i)->Key();
-		unsigned HashID = CalcHashID(Key);
-		if(pHashlist[HashID].m_Num < HASHLIST_BUCKET_SIZE)
-		{
-			pHashlist[HashID].m_aIndex[pHashlist[HashID].m_Num] = i;
-			pHashlist[HashID].m_aKeys[pHashlist[HashID].m_Num] = Key;
-			pHashlist[HashID].m_Num++;
-		}
+		__m128i Diff = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)pCurrent), _mm_loadu_si128((const __m128i *)pPast));
+		_mm_storeu_si128((__m128i *)pOut, Diff);
+		NeededVec = _mm_or_si128(NeededVec, Diff);
 	}
-}
-
-static int GetItemIndexHashed(int Key, const CItemList *pHashlist)
-{
-		unsigned HashID = CalcHashID(Key);
-		for(int i = 0; i < pHashlist[HashID].m_Num; i++)
-		{
-			if(pHashlist[HashID].m_aKeys[i] == Key)
-				return pHashlist[HashID].m_aIndex[i];
+	Needed = _mm_movemask_epi8(_mm_cmpeq_epi32(NeededVec, _mm_setzero_si128())) != 0xffff;
+#elif defined(SNAPSHOT_NEON)
+	uint32x4_t NeededVec = vdupq_n_u32(0);
+	for(; Size >= 4; Size -= 4, pPast += 4, pCurrent += 4, pOut += 4)
+	{
+		int32x4_t Diff = vsubq_s32(vld1q_s32(pCurrent), vld1q_s32(pPast));
+		vst1q_s32(pOut, Diff);
+		NeededVec = vorrq_u32(NeededVec, vreinterpretq_u32_s32(Diff));
 	}
-
-	return -1;
-}
-
-static int DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
-{
-	int Needed = 0;
+	Needed = vmaxvq_u32(NeededVec) != 0;
+#endif
 	while(Size)
 	{
 		*pOut = *pCurrent-*pPast;
@@ -152,21 +128,33 @@ static int DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
 	return Needed;
 }
 
+// number of bytes CVariableInt::Pack needs for the value
+static inline int PackedSize(int i)
+{
+	unsigned Value = i < 0 ? ~i : i;
+	int Size = 1;
+	for(Value >>= 6; Value; Value >>= 7)
+		Size++;
+	return Size;
+}
+
 static void UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size, int *pDataRate)
 {
+	int DataRate = 0;
+	for(int i = 0; i < Size; i++)
+		DataRate += pDiff[i] == 0 ? 1 : PackedSize(pDiff[i]) * 8;
+	*pDataRate += DataRate;
+
+#if defined(SNAPSHOT_SSE2)
+	for(; Size >= 4; Size -= 4, pPast += 4, pDiff += 4, pOut += 4)
+		_mm_storeu_si128((__m128i *)pOut, _mm_add_epi32(_mm_loadu_si128((const __m128i *)pPast), _mm_loadu_si128((const __m128i *)pDiff)));
+#elif defined(SNAPSHOT_NEON)
+	for(; Size >= 4; Size -= 4, pPast += 4, pDiff += 4, pOut += 4)
+		vst1q_s32(pOut, vaddq_s32(vld1q_s32(pPast), vld1q_s32(pDiff)));
+#endif
 	while(Size)
 	{
 		*pOut = *pPast+*pDiff;
-
-		if(*pDiff == 0)
-			*pDataRate += 1;
-		else
-		{
-			unsigned char aBuf[CVariableInt::MAX_BYTES_PACKED];
-			unsigned char *pEnd = CVariableInt::Pack(aBuf, *pDiff, sizeof(aBuf));
-			*pDataRate += (int)(pEnd - (unsigned char*)aBuf) * 8;
-		}
-
 		pOut++;
 		pPast++;
 		pDiff++;
@@ -194,13 +182,11 @@ const CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta() const
 	return &m_Empty;
 }
 
-// TODO: OPT: this should be made much faster
 int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
 {
 	CData *pDelta = (CData *)pDstData;
 	int *pData = (int *)pDelta->m_aData;
 	int i, ItemSize, PastIndex;
-	const CSnapshotItem *pFromItem;
 	const CSnapshotItem *pCurItem;
 	const CSnapshotItem *pPastItem;
 
@@ -208,32 +194,38 @@ int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pD
 	pDelta->m_NumUpdateItems = 0;
 	pDelta->m_NumTempItems = 0;
 
-	CItemList Hashlist[HASHLIST_SIZE];
-	GenerateHash(Hashlist, pTo);
+	// both snapshots have their keys sorted, so one merge pass over them
+	// finds the deleted items and the previous index of every current item
+	const int *pFromKeys = pFrom->SortedKeys();
+	const int *pToKeys = pTo->SortedKeys();
+	const int NumFromItems = pFrom->NumItems();
+	const int NumItems = pTo->NumItems();
+	int aPastIndecies[1024];
+	int FromIndex = 0;
 
-	// pack deleted stuff
-	for(i = 0; i < pFrom->NumItems(); i++)
+	for(i = 0; i < NumItems; i++)
 	{
-		pFromItem = pFrom->GetItem(i);
-		if(GetItemIndexHashed(pFromItem->Key(), Hashlist) == -1)
+		const int Key = pToKeys[i];
+		for(; FromIndex < NumFromItems && pFromKeys[FromIndex] < Key; FromIndex++)
 		{
 			// deleted
 			pDelta->m_NumDeletedItems++;
-			*pData = pFromItem->Key();
+			*pData = pFromKeys[FromIndex];
 			pData++;
 		}
-	}
 
-	GenerateHash(Hashlist, pFrom);
-	int aPastIndecies[1024];
+		if(FromIndex < NumFromItems && pFromKeys[FromIndex] == Key)
+			aPastIndecies[i] = FromIndex++;
+		else
+			aPastIndecies[i] = -1;
+	}
 
-	// fetch previous indices
-	// we do this as a separate pass because it helps the cache
-	const int NumItems = pTo->NumItems();
-	for(i = 0; i < NumItems; i++)
+	for(; FromIndex < NumFromItems; FromIndex++)
 	{
-		pCurItem = pTo->GetItem(i); // O(1) .. O(n)
-		aPastIndecies[i] = GetItemIndexHashed(pCurItem->Key(), Hashlist); // O(n) .. O(n^n)
+		// deleted
+		pDelta->m_NumDeletedItems++;
+		*pData = pFromKeys[FromIndex];
+		pData++;
 	}
 
 	for(i = 0; i < NumItems; i++)
@@ -514,14 +506,87 @@ int CSnapshotStorage::Get(int Tick, int64 *pTagtime, CSnapshot **ppData, CSnapsh
 
 // CSnapshotBuilder
 
+CSnapshotBuilder::CSnapshotBuilder()
+{
+	m_pData = m_aData;
+	m_pOffsets = m_aOffsets;
+	m_pItemMarks = m_aItemMarks;
+	m_pKeptItems = m_aKeptItems;
+	m_MaxDataSize = CSnapshot::MAX_SIZE;
+	m_MaxItems = MAX_ITEMS;
+	m_Generation = 0;
+	mem_zero(m_aItemMarks, sizeof(m_aItemMarks));
+	Init();
+}
+
+CSnapshotBuilder::~CSnapshotBuilder()
+{
+	SetCapacity(MAX_ITEMS, CSnapshot::MAX_SIZE);
+}
+
+void CSnapshotBuilder::SetCapacity(int MaxItems, int MaxDataSize)
+{
+	if(m_pData != m_aData)
+	{
+		mem_free(m_pData);
+		mem_free(m_pOffsets);
+		mem_free(m_pItemMarks);
+		mem_free(m_pKeptItems);
+	}
+
+	if(MaxItems <= MAX_ITEMS && MaxDataSize <= CSnapshot::MAX_SIZE)
+	{
+		m_pData = m_aData;
+		m_pOffsets = m_aOffsets;
+		m_pItemMarks = m_aItemMarks;
+		m_pKeptItems = m_aKeptItems;
+		m_MaxDataSize = CSnapshot::MAX_SIZE;
+		m_MaxItems = MAX_ITEMS;
+	}
+	else
+	{
+		m_MaxDataSize = maximum(MaxDataSize, (int)CSnapshot::MAX_SIZE);
+		m_MaxItems = maximum(MaxItems, (int)MAX_ITEMS);
+		m_pData = (char *)mem_alloc(m_MaxDataSize);
+		m_pOffsets = (int *)mem_alloc(sizeof(int)*m_MaxItems);
+		m_pItemMarks = (int *)mem_alloc(sizeof(int)*m_MaxItems);
+		m_pKeptItems = (int *)mem_alloc(sizeof(int)*m_MaxItems);
+	}
+	m_Generation = 0;
+	mem_zero(m_pItemMarks, sizeof(int)*m_MaxItems);
+	Init();
+}
+
+void CSnapshotBuilder::NextGeneration()
+{
+	// marks of earlier snapshots are outdated by moving on, clear them on wrap around
+	m_NumKeptItems = 0;
+	if(++m_Generation == 0x7fffffff)
+	{
+		mem_zero(m_pItemMarks, sizeof(int)*m_MaxItems);
+		m_Generation = 1;
+	}
+}
+
 void CSnapshotBuilder::Init()
 {
 	m_DataSize = 0;
 	m_NumItems = 0;
+	m_BaseDataSize = 0;
+	m_BaseNumItems = 0;
+	m_FirstHiddenItem = 0;
+	m_NumHiddenItems = 0;
+	NextGeneration();
 }
 
 void CSnapshotBuilder::Init(const CSnapshot *pSnapshot)
 {
+	m_BaseDataSize = 0;
+	m_BaseNumItems = 0;
+	m_FirstHiddenItem = 0;
+	m_NumHiddenItems = 0;
+	NextGeneration();
+
 	if(pSnapshot->m_DataSize + sizeof(CSnapshot) + pSnapshot->m_NumItems * sizeof(int)*2 > CSnapshot::MAX_SIZE || pSnapshot->m_NumItems > MAX_ITEMS)
 	{
 		// key and offset per item
@@ -535,14 +600,20 @@ void CSnapshotBuilder::Init(const CSnapshot *pSnapshot)
 
 	m_DataSize = pSnapshot->m_DataSize;
 	m_NumItems = pSnapshot->m_NumItems;
-	mem_copy(m_aOffsets, pSnapshot->Offsets(), sizeof(int)*m_NumItems);
-	mem_copy(m_aData, pSnapshot->DataStart(), m_DataSize);
+	mem_copy(m_pOffsets, pSnapshot->Offsets(), sizeof(int)*m_NumItems);
+	mem_copy(m_pData, pSnapshot->DataStart(), m_DataSize);
+	mem_zero(m_pItemMarks, sizeof(int)*m_NumItems);
 }
 
 bool CSnapshotBuilder::UnserializeSnap(const char *pSrcData, int SrcSize)
 {
 	m_DataSize = 0;
 	m_NumItems = 0;
+	m_BaseDataSize = 0;
+	m_BaseNumItems = 0;
+	m_FirstHiddenItem = 0;
+	m_NumHiddenItems = 0;
+	NextGeneration();
 
 	const int *pData = (const int*)pSrcData;
 	if(SrcSize < (int)sizeof(int)*2)
@@ -568,14 +639,66 @@ bool CSnapshotBuilder::UnserializeSnap(const char *pSrcData, int SrcSize)
 
 	m_DataSize = DataSize;
 	m_NumItems = NumItems;
-	mem_copy(m_aOffsets, pOffsets, sizeof(int)*m_NumItems);
-	mem_copy(m_aData, pOffsets+m_NumItems, m_DataSize);
+	mem_copy(m_pOffsets, pOffsets, sizeof(int)*m_NumItems);
+	mem_copy(m_pData, pOffsets+m_NumItems, m_DataSize);
+	mem_zero(m_pItemMarks, sizeof(int)*m_NumItems);
 	return true;
 }
 
+void CSnapshotBuilder::FinishBase()
+{
+	m_BaseDataSize = m_DataSize;
+	m_BaseNumItems = m_NumItems;
+	NextGeneration();
+}
+
+void CSnapshotBuilder::InitFromBase()
+{
+	// the base items are still in place, just drop everything added after them
+	m_DataSize = m_BaseDataSize;
+	m_NumItems = m_BaseNumItems;
+	NextGeneration();
+}
+
+// leaves the items out of every snapshot built from the base, they are added back per snapshot with KeepItem()
+void CSnapshotBuilder::HideItems(int First, int Num)
+{
+	m_FirstHiddenItem = clamp(First, 0, m_NumItems);
+	m_NumHiddenItems = clamp(Num, 0, m_NumItems-m_FirstHiddenItem);
+}
+
+void CSnapshotBuilder::SkipItem(int Index)
+{
+	if(Index < 0 || Index >= m_NumItems)
+		return;
+	if(!Hidden(Index))
+		m_pItemMarks[Index] = m_Generation;
+	else if(m_pItemMarks[Index] == m_Generation)
+		m_pItemMarks[Index] = -m_Generation; // stays in the kept list, but is passed over
+}
+
+void CSnapshotBuilder::KeepItem(int Index)
+{
+	if(Index < 0 || Index >= m_NumItems)
+		return;
+	if(!Hidden(Index))
+	{
+		// takes back a skip
+		if(m_pItemMarks[Index] == m_Generation)
+			m_pItemMarks[Index] = 0;
+	}
+	else if(m_pItemMarks[Index] == -m_Generation)
+		m_pItemMarks[Index] = m_Generation;
+	else if(m_pItemMarks[Index] != m_Generation)
+	{
+		m_pItemMarks[Index] = m_Generation;
+		m_pKeptItems[m_NumKeptItems++] = Index;
+	}
+}
+
 CSnapshotItem *CSnapshotBuilder::GetItem(int Index) const
 {
-	return (CSnapshotItem *)&(m_aData[m_aOffsets[Index]]);
+	return (CSnapshotItem *)&(m_pData[m_pOffsets[Index]]);
 }
 
 int *CSnapshotBuilder::GetItemData(int Key) const
@@ -592,32 +715,52 @@ int CSnapshotBuilder::Finish(void *pSnapdata)
 {
 	// flattern and make the snapshot
 	CSnapshot *pSnap = (CSnapshot *)pSnapdata;
-	int OffsetSize = sizeof(int)*m_NumItems;
-	int KeySize = sizeof(int)*m_NumItems;
-	pSnap->m_DataSize = m_DataSize;
-	pSnap->m_NumItems = m_NumItems;
-
-	const int NumItems = m_NumItems;
-	for(int i = 0; i < NumItems; i++)
-	{
-		pSnap->SortedKeys()[i] = GetItem(i)->Key();
-	}
 
-	// get full item sizes
+	// get full item sizes and leave out skipped items. work on a copy of the
+	// offsets so the shared base stays intact for the next snapshot
+	int aOffsets[CSnapshotBuilder::MAX_ITEMS];
 	int aItemSizes[CSnapshotBuilder::MAX_ITEMS];
+	int NumItems = 0;
+	int DataSize = 0;
 
-	for(int i = 0; i < NumItems; i++)
+	// the items added after the base go first so a crowded base can't push
+	// them out, the base fills up what is left of the snapshot limits. of
+	// the hidden items only the kept ones are looked at
+	for(int Pass = 0; Pass < 3; Pass++)
 	{
-		if(i < NumItems - 1)
+		int Num = Pass == 0 ? m_NumItems-m_BaseNumItems : Pass == 1 ? m_BaseNumItems-m_NumHiddenItems : m_NumKeptItems;
+		for(int j = 0; j < Num; j++)
 		{
-			aItemSizes[i] = m_aOffsets[i+1] - m_aOffsets[i];
-		}
-		else
-		{
-			aItemSizes[i] = m_DataSize - m_aOffsets[i];
+			int i;
+			if(Pass == 0)
+				i = m_BaseNumItems+j;
+			else if(Pass == 1)
+				i = j < m_FirstHiddenItem ? j : j+m_NumHiddenItems;
+			else
+				i = m_pKeptItems[j];
+
+			// marked means skipped, for the kept hidden items it means they are in
+			if((m_pItemMarks[i] == m_Generation) != (Pass == 2))
+				continue;
+
+			int ItemSize = (i < m_NumItems - 1 ? m_pOffsets[i+1] : m_DataSize) - m_pOffsets[i];
+			if(NumItems+1 >= MAX_ITEMS ||
+				sizeof(CSnapshot) + (NumItems+1) * sizeof(int)*2 + DataSize + ItemSize > CSnapshot::MAX_SIZE)
+				continue;
+
+			aOffsets[NumItems] = m_pOffsets[i];
+			aItemSizes[NumItems] = ItemSize;
+			pSnap->SortedKeys()[NumItems] = GetItem(i)->Key();
+			DataSize += ItemSize;
+			NumItems++;
 		}
 	}
 
+	int OffsetSize = sizeof(int)*NumItems;
+	int KeySize = sizeof(int)*NumItems;
+	pSnap->m_DataSize = DataSize;
+	pSnap->m_NumItems = NumItems;
+
 	// bubble sort by keys
 	bool Sorting = true;
 	while(Sorting)
@@ -630,7 +773,7 @@ int CSnapshotBuilder::Finish(void *pSnapdata)
 			{
 				Sorting = true;
 				std::swap(pSnap->SortedKeys()[i], pSnap->SortedKeys()[i-1]);
-				std::swap(m_aOffsets[i], m_aOffsets[i-1]);
+				std::swap(aOffsets[i], aOffsets[i-1]);
 				std::swap(aItemSizes[i], aItemSizes[i-1]);
 			}
 		}
@@ -641,29 +784,30 @@ int CSnapshotBuilder::Finish(void *pSnapdata)
 	for(int i = 0; i < NumItems; i++)
 	{
 		pSnap->Offsets()[i] = OffsetCur;
-		mem_copy(pSnap->DataStart()+OffsetCur, m_aData + m_aOffsets[i], aItemSizes[i]);
+		mem_copy(pSnap->DataStart()+OffsetCur, m_pData + aOffsets[i], aItemSizes[i]);
 		OffsetCur += aItemSizes[i];
 	}
 
-	return sizeof(CSnapshot) + KeySize + OffsetSize + m_DataSize;
+	return sizeof(CSnapshot) + KeySize + OffsetSize + DataSize;
 }
 
 void *CSnapshotBuilder::NewItem(int Type, int ID, int Size)
 {
-	if(m_DataSize + sizeof(CSnapshot) + sizeof(CSnapshotItem) + Size + (m_NumItems+1) * sizeof(int)*2 >= CSnapshot::MAX_SIZE ||
-		m_NumItems+1 >= MAX_ITEMS)
+	if(m_DataSize + sizeof(CSnapshot) + sizeof(CSnapshotItem) + Size + (m_NumItems+1) * sizeof(int)*2 >= (unsigned)m_MaxDataSize ||
+		m_NumItems+1 >= m_MaxItems)
 	{
 		// key and offset per item
-		dbg_assert(m_DataSize + sizeof(CSnapshot) + m_NumItems * sizeof(int)*2 < CSnapshot::MAX_SIZE, "too much data");
-		dbg_assert(m_NumItems < MAX_ITEMS, "too many items");
+		dbg_assert(m_DataSize + sizeof(CSnapshot) + m_NumItems * sizeof(int)*2 < (unsigned)m_MaxDataSize, "too much data");
+		dbg_assert(m_NumItems < m_MaxItems, "too many items");
 		return 0;
 	}
 
-	CSnapshotItem *pObj = (CSnapshotItem *)(m_aData + m_DataSize);
+	CSnapshotItem *pObj = (CSnapshotItem *)(m_pData + m_DataSize);
 
 	mem_zero(pObj, sizeof(CSnapshotItem) + Size);
 	pObj->SetKey(Type, ID);
-	m_aOffsets[m_NumItems] = m_DataSize;
+	m_pOffsets[m_NumItems] = m_DataSize;
+	m_pItemMarks[m_NumItems] = 0;
 	m_DataSize += sizeof(CSnapshotItem) + Size;
 	m_NumItems++;
 
@@ -27,6 +27,7 @@ public:
 class CSnapshot
 {
 	friend class CSnapshotBuilder;
+	friend class CSnapshotDelta;
 	int m_DataSize;
 	int m_NumItems;
 
@@ -125,23 +126,71 @@ public:
 
 class CSnapshotBuilder
 {
+public:
 	enum
 	{
 		MAX_ITEMS = 1024
 	};
 
+private:
 	char m_aData[CSnapshot::MAX_SIZE];
 	int m_DataSize;
 
 	int m_aOffsets[MAX_ITEMS];
 	int m_NumItems;
 
+	// shared base that every snapshot started with InitFromBase() contains,
+	// except for the hidden items that are only in when kept
+	int m_BaseDataSize;
+	int m_BaseNumItems;
+	int m_FirstHiddenItem;
+	int m_NumHiddenItems;
+
+	// per snapshot: an item whose mark is the current generation is skipped,
+	// or kept when it's hidden. kept items are listed so Finish() doesn't
+	// have to look at all hidden ones
+	int m_aItemMarks[MAX_ITEMS];
+	int m_aKeptItems[MAX_ITEMS];
+	int m_NumKeptItems;
+	int m_Generation;
+
+	// the buffers items are built in, the ones above unless SetCapacity()
+	// made room for more. Finish() still keeps to the snapshot limits
+	char *m_pData;
+	int *m_pOffsets;
+	int *m_pItemMarks;
+	int *m_pKeptItems;
+	int m_MaxDataSize;
+	int m_MaxItems;
+
+	bool Hidden(int Index) const { return Index >= m_FirstHiddenItem && Index < m_FirstHiddenItem+m_NumHiddenItems; }
+	void NextGeneration();
+
+	CSnapshotBuilder(const CSnapshotBuilder &);
+	CSnapshotBuilder &operator=(const CSnapshotBuilder &);
+
 public:
+	CSnapshotBuilder();
+	~CSnapshotBuilder();
+
+	// a shared base can hold more than one snapshot would, each snapshot
+	// built from it gets its own items first and as much of the base as fits
+	void SetCapacity(int MaxItems, int MaxDataSize);
+
 	void Init();
 	void Init(const CSnapshot *pSnapshot);
 	bool UnserializeSnap(const char *pSrcData, int SrcSize);
 
+	// two-phase building: add the items that are equal for everyone once,
+	// then start each per-client snapshot from that base and add the rest
+	void FinishBase();
+	void InitFromBase();
+	void HideItems(int First, int Num);
+	void SkipItem(int Index);
+	void KeepItem(int Index);
+
 	void *NewItem(int Type, int ID, int Size);
+	int NumItems() const { return m_NumItems; }
 
 	CSnapshotItem *GetItem(int Index) const;
 	int *GetItemData(int Key) const;
@@ -0,0 +1,449 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/tl/threading.h>
+
+#include <engine/sound.h>
+
+#include "soundmixer.h"
+
+#include <math.h>
+#include <limits.h>
+
+#if defined(CONF_ARCH_AMD64) || defined(__SSE2__)
+	#define SOUNDMIXER_SSE2 1
+	#include <emmintrin.h>
+#elif defined(CONF_ARCH_ARM64)
+	#define SOUNDMIXER_NEON 1
+	#include <arm_neon.h>
+#endif
+
+#if defined(SOUNDMIXER_SSE2)
+// adds 4 stereo frames times the interleaved volumes to the mix buffer
+static inline void Accumulate(int *pOut, __m128i In, __m128i Vol)
+{
+	__m128i Lo = _mm_mullo_epi16(In, Vol);
+	__m128i Hi = _mm_mulhi_epi16(In, Vol);
+	__m128i *pDst = (__m128i *)pOut;
+	_mm_storeu_si128(pDst, _mm_add_epi32(_mm_loadu_si128(pDst), _mm_unpacklo_epi16(Lo, Hi)));
+	_mm_storeu_si128(pDst+1, _mm_add_epi32(_mm_loadu_si128(pDst+1), _mm_unpackhi_epi16(Lo, Hi)));
+}
+#endif
+
+static void MixStereo(int *pOut, const short *pIn, unsigned Frames, int LeftVol, int RightVol)
+{
+	unsigned i = 0;
+#if defined(SOUNDMIXER_SSE2)
+	const __m128i Vol = _mm_set_epi16(RightVol, LeftVol, RightVol, LeftVol, RightVol, LeftVol, RightVol, LeftVol);
+	for(; i+4 <= Frames; i += 4)
+		Accumulate(pOut+i*2, _mm_loadu_si128((const __m128i *)(pIn+i*2)), Vol);
+#elif defined(SOUNDMIXER_NEON)
+	const short aVol[4] = { (short)LeftVol, (short)RightVol, (short)LeftVol, (short)RightVol };
+	const int16x4_t Vol = vld1_s16(aVol);
+	for(; i+4 <= Frames; i += 4)
+	{
+		int16x8_t In = vld1q_s16(pIn+i*2);
+		vst1q_s32(pOut+i*2, vmlal_s16(vld1q_s32(pOut+i*2), vget_low_s16(In), Vol));
+		vst1q_s32(pOut+i*2+4, vmlal_s16(vld1q_s32(pOut+i*2+4), vget_high_s16(In), Vol));
+	}
+#endif
+	for(; i < Frames; i++)
+	{
+		pOut[i*2] += pIn[i*2]*LeftVol;
+		pOut[i*2+1] += pIn[i*2+1]*RightVol;
+	}
+}
+
+static void MixMono(int *pOut, const short *pIn, unsigned Frames, int LeftVol, int RightVol)
+{
+	unsigned i = 0;
+#if defined(SOUNDMIXER_SSE2)
+	const __m128i Vol = _mm_set_epi16(RightVol, LeftVol, RightVol, LeftVol, RightVol, LeftVol, RightVol, LeftVol);
+	for(; i+8 <= Frames; i += 8)
+	{
+		__m128i In = _mm_loadu_si128((const __m128i *)(pIn+i));
+		Accumulate(pOut+i*2, _mm_unpacklo_epi16(In, In), Vol);
+		Accumulate(pOut+i*2+8, _mm_unpackhi_epi16(In, In), Vol);
+	}
+#elif defined(SOUNDMIXER_NEON)
+	const short aVol[4] = { (short)LeftVol, (short)RightVol, (short)LeftVol, (short)RightVol };
+	const int16x4_t Vol = vld1_s16(aVol);
+	for(; i+4 <= Frames; i += 4)
+	{
+		int16x4_t In = vld1_s16(pIn+i);
+		int16x4x2_t Both = vzip_s16(In, In);
+		vst1q_s32(pOut+i*2, vmlal_s16(vld1q_s32(pOut+i*2), Both.val[0], Vol));
+		vst1q_s32(pOut+i*2+4, vmlal_s16(vld1q_s32(pOut+i*2+4), Both.val[1], Vol));
+	}
+#endif
+	for(; i < Frames; i++)
+	{
+		pOut[i*2] += pIn[i]*LeftVol;
+		pOut[i*2+1] += pIn[i]*RightVol;
+	}
+}
+
+// applies the master volume and clamps the mix to 16 bit
+static void WriteOutput(short *pOut, const int *pIn, unsigned Samples, int MasterVol)
+{
+	// the voices add up 8 bit volumes, the master volume goes from 0 to 100
+	const float Scale = MasterVol/(101.0f*256.0f);
+	unsigned i = 0;
+#if defined(SOUNDMIXER_SSE2)
+	const __m128 ScaleVec = _mm_set1_ps(Scale);
+	for(; i+8 <= Samples; i += 8)
+	{
+		__m128i A = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(pIn+i))), ScaleVec));
+		__m128i B = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(pIn+i+4))), ScaleVec));
+		_mm_storeu_si128((__m128i *)(pOut+i), _mm_packs_epi32(A, B));
+	}
+#elif defined(SOUNDMIXER_NEON)
+	for(; i+8 <= Samples; i += 8)
+	{
+		int32x4_t A = vcvtq_s32_f32(vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(pIn+i)), Scale));
+		int32x4_t B = vcvtq_s32_f32(vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(pIn+i+4)), Scale));
+		vst1q_s16(pOut+i, vcombine_s16(vqmovn_s32(A), vqmovn_s32(B)));
+	}
+#endif
+	for(; i < Samples; i++)
+		pOut[i] = clamp((int)(pIn[i]*Scale), SHRT_MIN, SHRT_MAX);
+}
+
+CSoundMixer::CSoundMixer()
+{
+	m_CommandWrite = 0;
+	m_CommandRead = 0;
+	m_NextVoice = 0;
+	m_OverflowLock = lock_create();
+	m_NumOverflowCommands = 0;
+
+	m_ListenerX = 0;
+	m_ListenerY = 0;
+	m_MaxDistance = 1500.0f;
+	for(int i = 0; i < NUM_CHANNELS; i++)
+		m_aChannelVol[i] = 255;
+	m_MasterVol = 100;
+	m_SettingsVersion = 1;
+
+	mem_zero(m_aVoices, sizeof(m_aVoices));
+	for(int i = 0; i < NUM_VOICES; i++)
+		m_aVoiceUsed[i] = 0;
+	m_MixedSettingsVersion = 0;
+	m_CenterX = 0;
+	m_CenterY = 0;
+	m_MixMaxDistance = 1500.0f;
+	for(int i = 0; i < NUM_CHANNELS; i++)
+		m_aMixChannelVol[i] = 255;
+
+	m_pMixBuffer = 0;
+	m_MaxFrames = 0;
+}
+
+CSoundMixer::~CSoundMixer()
+{
+	lock_destroy(m_OverflowLock);
+	mem_free(m_pMixBuffer);
+}
+
+void CSoundMixer::Init(unsigned MaxFrames)
+{
+	mem_free(m_pMixBuffer);
+	m_MaxFrames = MaxFrames;
+	m_pMixBuffer = (int *)mem_alloc(m_MaxFrames*2*sizeof(int));
+}
+
+bool CSoundMixer::PushCommand(const CCommand *pCommand)
+{
+	unsigned Write = m_CommandWrite;
+	if(Write - m_CommandRead >= NUM_COMMANDS)
+		return false;
+
+	m_aCommands[Write%NUM_COMMANDS] = *pCommand;
+	sync_barrier();
+	m_CommandWrite = Write+1;
+	return true;
+}
+
+void CSoundMixer::PushStopCommand(CCommand *pCommand)
+{
+	if(PushCommand(pCommand))
+		return;
+
+	// the queue only fills up when the mixer doesn't run for a while
+	lock_wait(m_OverflowLock);
+	pCommand->m_Pos = m_CommandWrite;
+	if(m_NumOverflowCommands < NUM_OVERFLOW_COMMANDS)
+		m_aOverflowCommands[m_NumOverflowCommands++] = *pCommand;
+	else
+	{
+		// stopping too much beats sounds that never end
+		CCommand *pLast = &m_aOverflowCommands[NUM_OVERFLOW_COMMANDS-1];
+		pLast->m_Type = COMMAND_STOP_ALL;
+		pLast->m_Pos = pCommand->m_Pos;
+	}
+	lock_unlock(m_OverflowLock);
+}
+
+int CSoundMixer::Play(int ChannelID, CSoundSample *pSample, int Flags, int x, int y)
+{
+	// search for a voice the mixer is done with
+	int VoiceID = -1;
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		int ID = (m_NextVoice + i) % NUM_VOICES;
+		if(!m_aVoiceUsed[ID])
+		{
+			VoiceID = ID;
+			break;
+		}
+	}
+	if(VoiceID == -1)
+		return -1;
+
+	CCommand Command;
+	Command.m_Type = COMMAND_PLAY;
+	Command.m_VoiceID = VoiceID;
+	Command.m_pSample = pSample;
+	Command.m_ChannelID = ChannelID;
+	Command.m_Flags = Flags;
+	Command.m_X = x;
+	Command.m_Y = y;
+
+	m_aVoiceUsed[VoiceID] = 1;
+	atomic_inc(&pSample->m_NumVoices);
+	if(!PushCommand(&Command))
+	{
+		atomic_dec(&pSample->m_NumVoices);
+		m_aVoiceUsed[VoiceID] = 0;
+		return -1;
+	}
+
+	m_NextVoice = VoiceID+1;
+	return VoiceID;
+}
+
+void CSoundMixer::Stop(CSoundSample *pSample)
+{
+	CCommand Command;
+	mem_zero(&Command, sizeof(Command));
+	Command.m_Type = COMMAND_STOP;
+	Command.m_pSample = pSample;
+	PushStopCommand(&Command);
+}
+
+void CSoundMixer::StopAll()
+{
+	CCommand Command;
+	mem_zero(&Command, sizeof(Command));
+	Command.m_Type = COMMAND_STOP_ALL;
+	PushStopCommand(&Command);
+}
+
+void CSoundMixer::SetListenerPos(int x, int y)
+{
+	// called every frame, most of the time without moving
+	if(x == m_ListenerX && y == m_ListenerY)
+		return;
+	m_ListenerX = x;
+	m_ListenerY = y;
+	sync_barrier();
+	m_SettingsVersion++;
+}
+
+void CSoundMixer::SetMaxDistance(float Distance)
+{
+	m_MaxDistance = Distance;
+	sync_barrier();
+	m_SettingsVersion++;
+}
+
+void CSoundMixer::SetChannelVolume(int ChannelID, int Vol)
+{
+	m_aChannelVol[ChannelID] = clamp(Vol, 0, 255);
+	sync_barrier();
+	m_SettingsVersion++;
+}
+
+void CSoundMixer::SetMasterVolume(int Vol)
+{
+	m_MasterVol = Vol;
+}
+
+void CSoundMixer::FreeVoice(int VoiceID, bool Pause)
+{
+	CVoice *pVoice = &m_aVoices[VoiceID];
+	if(Pause)
+		pVoice->m_pSample->m_PausedAt = (pVoice->m_Flags&ISound::FLAG_LOOP) ? pVoice->m_Tick : 0;
+	atomic_dec(&pVoice->m_pSample->m_NumVoices);
+	pVoice->m_pSample = 0;
+	sync_barrier();
+	m_aVoiceUsed[VoiceID] = 0;
+}
+
+void CSoundMixer::ApplyCommand(const CCommand *pCommand)
+{
+	if(pCommand->m_Type == COMMAND_PLAY)
+	{
+		CVoice *pVoice = &m_aVoices[pCommand->m_VoiceID];
+		pVoice->m_pSample = pCommand->m_pSample;
+		pVoice->m_ChannelID = pCommand->m_ChannelID;
+		pVoice->m_Tick = (pCommand->m_Flags&ISound::FLAG_LOOP) ? pCommand->m_pSample->m_PausedAt : 0;
+		pVoice->m_Flags = pCommand->m_Flags;
+		pVoice->m_X = pCommand->m_X;
+		pVoice->m_Y = pCommand->m_Y;
+		UpdateVolume(pVoice);
+	}
+	else
+	{
+		for(int i = 0; i < NUM_VOICES; i++)
+		{
+			if(m_aVoices[i].m_pSample && (pCommand->m_Type == COMMAND_STOP_ALL || m_aVoices[i].m_pSample == pCommand->m_pSample))
+				FreeVoice(i, true);
+		}
+	}
+}
+
+// applies the overflowed stops that were given before the command at Read,
+// the overflow lock must be held
+void CSoundMixer::ApplyOverflowCommands(unsigned Read)
+{
+	int Num = 0;
+	for(int i = 0; i < m_NumOverflowCommands; i++)
+	{
+		if((int)(m_aOverflowCommands[i].m_Pos - Read) <= 0)
+			ApplyCommand(&m_aOverflowCommands[i]);
+		else
+			m_aOverflowCommands[Num++] = m_aOverflowCommands[i];
+	}
+	m_NumOverflowCommands = Num;
+}
+
+void CSoundMixer::ProcessCommands()
+{
+	unsigned Read = m_CommandRead;
+	unsigned Write = m_CommandWrite;
+	sync_barrier();
+
+	const bool Overflow = m_NumOverflowCommands != 0;
+	if(Overflow)
+		lock_wait(m_OverflowLock);
+
+	for(; Read != Write; Read++)
+	{
+		if(Overflow)
+			ApplyOverflowCommands(Read);
+		ApplyCommand(&m_aCommands[Read%NUM_COMMANDS]);
+	}
+
+	if(Overflow)
+	{
+		ApplyOverflowCommands(Read);
+		lock_unlock(m_OverflowLock);
+	}
+
+	sync_barrier();
+	m_CommandRead = Read;
+}
+
+void CSoundMixer::UpdateSettings()
+{
+	unsigned Version = m_SettingsVersion;
+	if(Version == m_MixedSettingsVersion)
+		return;
+	sync_barrier();
+
+	m_MixedSettingsVersion = Version;
+	m_CenterX = m_ListenerX;
+	m_CenterY = m_ListenerY;
+	m_MixMaxDistance = m_MaxDistance;
+	for(int i = 0; i < NUM_CHANNELS; i++)
+		m_aMixChannelVol[i] = m_aChannelVol[i];
+
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		if(m_aVoices[i].m_pSample)
+			UpdateVolume(&m_aVoices[i]);
+	}
+}
+
+void CSoundMixer::UpdateVolume(CVoice *pVoice)
+{
+	int ChannelVol = m_aMixChannelVol[pVoice->m_ChannelID];
+	if(!(pVoice->m_Flags&ISound::FLAG_POS))
+	{
+		pVoice->m_LeftVol = ChannelVol;
+		pVoice->m_RightVol = ChannelVol;
+		return;
+	}
+
+	// out of hearing range, the voice only advances
+	int dx = pVoice->m_X - m_CenterX;
+	int dy = pVoice->m_Y - m_CenterY;
+	float DistSq = (float)dx*dx+(float)dy*dy;
+	if(DistSq >= m_MixMaxDistance*m_MixMaxDistance)
+	{
+		pVoice->m_LeftVol = 0;
+		pVoice->m_RightVol = 0;
+		return;
+	}
+
+	// linear falloff
+	float Falloff = 1.0f - sqrtf(DistSq)/m_MixMaxDistance;
+
+	// amplitude after falloff
+	float FalloffAmp = ChannelVol * Falloff;
+
+	// distribute volume to the channels depending on x difference
+	float Lpan = 0.5f - dx/m_MixMaxDistance/2.0f;
+	float Rpan = 1.0f - Lpan;
+
+	// apply square root to preserve sound power after panning
+	pVoice->m_LeftVol = (int)(FalloffAmp*sqrtf(Lpan));
+	pVoice->m_RightVol = (int)(FalloffAmp*sqrtf(Rpan));
+}
+
+void CSoundMixer::Mix(short *pFinalOut, unsigned Frames)
+{
+	Frames = minimum(Frames, m_MaxFrames);
+
+	ProcessCommands();
+	UpdateSettings();
+	int MasterVol = m_MasterVol;
+
+	mem_zero(m_pMixBuffer, Frames*2*sizeof(int));
+
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		CVoice *pVoice = &m_aVoices[i];
+		CSoundSample *pSample = pVoice->m_pSample;
+		if(!pSample)
+			continue;
+
+		// make sure that we don't go outside the sound data
+		unsigned End = minimum(Frames, (unsigned)(pSample->m_NumFrames-pVoice->m_Tick));
+		if(pVoice->m_LeftVol || pVoice->m_RightVol)
+		{
+			const short *pIn = &pSample->m_pData[pVoice->m_Tick*pSample->m_Channels];
+			if(pSample->m_Channels == 1)
+				MixMono(m_pMixBuffer, pIn, End, pVoice->m_LeftVol, pVoice->m_RightVol);
+			else
+				MixStereo(m_pMixBuffer, pIn, End, pVoice->m_LeftVol, pVoice->m_RightVol);
+		}
+		pVoice->m_Tick += End;
+
+		// free voice if not used any more
+		if(pVoice->m_Tick == pSample->m_NumFrames)
+		{
+			if(pVoice->m_Flags&ISound::FLAG_LOOP)
+				pVoice->m_Tick = 0;
+			else
+				FreeVoice(i, false);
+		}
+	}
+
+	WriteOutput(pFinalOut, m_pMixBuffer, Frames*2, MasterVol);
+
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	swap_endian(pFinalOut, sizeof(short), Frames * 2);
+#endif
+}
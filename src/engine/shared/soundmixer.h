@@ -0,0 +1,134 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_SOUNDMIXER_H
+#define ENGINE_SHARED_SOUNDMIXER_H
+
+#include <base/system.h>
+
+struct CSoundSample
+{
+	short *m_pData;
+	int m_NumFrames;
+	int m_Rate;
+	int m_Channels;
+	int m_LoopStart;
+	int m_LoopEnd;
+	int m_PausedAt; // only touched by the mixer
+	volatile unsigned m_NumVoices; // voices that play the sample or are about to
+};
+
+/*
+	Class: CSoundMixer
+		Mixes the playing voices into 16 bit stereo. The game thread
+		changes the voices through a lock free command queue that
+		the audio thread applies before each mix, the listener and
+		the volumes are shared values it picks up when they changed.
+		Voice volumes are only recomputed when something they depend
+		on changes, voices out of hearing range are not mixed at all.
+*/
+class CSoundMixer
+{
+public:
+	enum
+	{
+		NUM_VOICES=64,
+		NUM_CHANNELS=16,
+	};
+
+private:
+	enum
+	{
+		NUM_COMMANDS=256,
+		NUM_OVERFLOW_COMMANDS=64,
+
+		COMMAND_PLAY=0,
+		COMMAND_STOP,
+		COMMAND_STOP_ALL,
+	};
+
+	struct CCommand
+	{
+		unsigned m_Pos; // queue position, only used for overflowed stops
+		int m_Type;
+		int m_VoiceID;
+		CSoundSample *m_pSample;
+		int m_ChannelID;
+		int m_Flags;
+		int m_X;
+		int m_Y;
+	};
+
+	struct CVoice
+	{
+		CSoundSample *m_pSample;
+		int m_ChannelID;
+		int m_Tick;
+		int m_Flags;
+		int m_X;
+		int m_Y;
+		int m_LeftVol; // 0 - 255
+		int m_RightVol;
+	};
+
+	// written by the game thread
+	CCommand m_aCommands[NUM_COMMANDS];
+	volatile unsigned m_CommandWrite;
+	int m_NextVoice;
+
+	// stops that didn't fit into the queue. they must not get lost, so they
+	// wait here until the mixer reaches the queue position they were given at
+	LOCK m_OverflowLock;
+	CCommand m_aOverflowCommands[NUM_OVERFLOW_COMMANDS];
+	volatile int m_NumOverflowCommands;
+
+	volatile int m_ListenerX;
+	volatile int m_ListenerY;
+	volatile float m_MaxDistance;
+	volatile int m_aChannelVol[NUM_CHANNELS]; // 0 - 255
+	volatile int m_MasterVol; // 0 - 100
+	volatile unsigned m_SettingsVersion;
+
+	// written by the audio thread
+	volatile unsigned m_CommandRead;
+	volatile unsigned m_aVoiceUsed[NUM_VOICES];
+	CVoice m_aVoices[NUM_VOICES];
+	unsigned m_MixedSettingsVersion;
+	int m_CenterX;
+	int m_CenterY;
+	float m_MixMaxDistance;
+	int m_aMixChannelVol[NUM_CHANNELS];
+
+	int *m_pMixBuffer;
+	unsigned m_MaxFrames;
+
+	bool PushCommand(const CCommand *pCommand);
+	void PushStopCommand(CCommand *pCommand);
+	void ApplyCommand(const CCommand *pCommand);
+	void ApplyOverflowCommands(unsigned Read);
+	void ProcessCommands();
+	void UpdateSettings();
+	void UpdateVolume(CVoice *pVoice);
+	void FreeVoice(int VoiceID, bool Pause);
+
+public:
+	CSoundMixer();
+	~CSoundMixer();
+
+	void Init(unsigned MaxFrames);
+
+	// game thread
+	int Play(int ChannelID, CSoundSample *pSample, int Flags, int x, int y);
+	void Stop(CSoundSample *pSample);
+	void StopAll();
+	bool IsPlaying(const CSoundSample *pSample) const { return pSample->m_NumVoices != 0; }
+
+	void SetListenerPos(int x, int y);
+	void SetMaxDistance(float Distance);
+	void SetChannelVolume(int ChannelID, int Vol);
+	void SetMasterVolume(int Vol);
+
+	// audio thread, mixes at most MaxFrames frames
+	void Mix(short *pFinalOut, unsigned Frames);
+};
+
+#endif
@@ -1,5 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <math.h>
+
 #include <base/math.h>
 #include <engine/graphics.h>
 #include <engine/demo.h>
@@ -21,45 +23,33 @@ CParticles::CParticles()
 void CParticles::OnReset()
 {
 	// reset particles
-	for(int i = 0; i < MAX_PARTICLES; i++)
-	{
-		m_aParticles[i].m_PrevPart = i-1;
-		m_aParticles[i].m_NextPart = i+1;
-	}
-
-	m_aParticles[0].m_PrevPart = 0;
-	m_aParticles[MAX_PARTICLES-1].m_NextPart = -1;
-	m_FirstFree = 0;
-
-	for(int i = 0; i < NUM_GROUPS; i++)
-		m_aFirstPart[i] = -1;
+	m_NumParticles = 0;
+	m_FrictionFraction = 0.0f;
 }
 
 void CParticles::Add(int Group, CParticle *pPart)
 {
 	if(m_pClient->IsWorldPaused() || m_pClient->IsDemoPlaybackPaused())
 		return;
-	if (m_FirstFree == -1)
+	if(m_NumParticles == MAX_PARTICLES)
 		return;
 
-	// remove from the free list
-	int Id = m_FirstFree;
-	m_FirstFree = m_aParticles[Id].m_NextPart;
-	if(m_FirstFree != -1)
-		m_aParticles[m_FirstFree].m_PrevPart = -1;
-
-	// copy data
-	m_aParticles[Id] = *pPart;
-
-	// insert to the group list
-	m_aParticles[Id].m_PrevPart = -1;
-	m_aParticles[Id].m_NextPart = m_aFirstPart[Group];
-	if(m_aFirstPart[Group] != -1)
-		m_aParticles[m_aFirstPart[Group]].m_PrevPart = Id;
-	m_aFirstPart[Group] = Id;
-
-	// set some parameters
-	m_aParticles[Id].m_Life = 0;
+	int Id = m_NumParticles++;
+	m_aPosX[Id] = pPart->m_Pos.x;
+	m_aPosY[Id] = pPart->m_Pos.y;
+	m_aVelX[Id] = pPart->m_Vel.x;
+	m_aVelY[Id] = pPart->m_Vel.y;
+	m_aGravity[Id] = pPart->m_Gravity;
+	m_aFriction[Id] = pPart->m_Friction;
+	m_aLife[Id] = 0;
+	m_aLifeSpan[Id] = pPart->m_LifeSpan;
+	m_aRot[Id] = pPart->m_Rot;
+	m_aRotspeed[Id] = pPart->m_Rotspeed;
+	m_aStartSize[Id] = pPart->m_StartSize;
+	m_aEndSize[Id] = pPart->m_EndSize;
+	m_aSpr[Id] = pPart->m_Spr;
+	m_aColor[Id] = pPart->m_Color;
+	m_aGroup[Id] = Group;
 }
 
 void CParticles::Update(float TimePassed)
@@ -67,62 +57,95 @@ void CParticles::Update(float TimePassed)
 	if(TimePassed <= 0.0f)
 		return;
 
-	static float s_FrictionFraction = 0.0f;
-	s_FrictionFraction += TimePassed;
+	m_FrictionFraction += TimePassed;
 
-	if(s_FrictionFraction > 2.0f) // safety messure
-		s_FrictionFraction = 0.0f;
+	if(m_FrictionFraction > 2.0f) // safety messure
+		m_FrictionFraction = 0.0f;
 
 	int FrictionCount = 0;
-	while(s_FrictionFraction > 0.05f)
+	while(m_FrictionFraction > 0.05f)
 	{
 		FrictionCount++;
-		s_FrictionFraction -= 0.05f;
+		m_FrictionFraction -= 0.05f;
 	}
 
-	for(int g = 0; g < NUM_GROUPS; g++)
+	int Num = m_NumParticles;
+
+	// plain loops over the fields so the compiler can vectorize them
+	for(int i = 0; i < Num; i++)
+	{
+		m_aVelY[i] += m_aGravity[i]*TimePassed;
+		m_aLife[i] += TimePassed;
+		m_aRot[i] += TimePassed*m_aRotspeed[i];
+	}
+
+	// apply friction, usually once every few frames
+	if(FrictionCount == 1)
+	{
+		for(int i = 0; i < Num; i++)
+		{
+			m_aVelX[i] *= m_aFriction[i];
+			m_aVelY[i] *= m_aFriction[i];
+		}
+	}
+	else if(FrictionCount > 1)
 	{
-		int i = m_aFirstPart[g];
-		while(i != -1)
+		for(int i = 0; i < Num; i++)
 		{
-			int Next = m_aParticles[i].m_NextPart;
-			//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
-			m_aParticles[i].m_Vel.y += m_aParticles[i].m_Gravity*TimePassed;
-
-			for(int f = 0; f < FrictionCount; f++) // apply friction
-				m_aParticles[i].m_Vel *= m_aParticles[i].m_Friction;
-
-			// move the point
-			vec2 Vel = m_aParticles[i].m_Vel*TimePassed;
-			Collision()->MovePoint(&m_aParticles[i].m_Pos, &Vel, 0.1f+0.9f*random_float(), NULL);
-			m_aParticles[i].m_Vel = Vel* (1.0f/TimePassed);
-
-			m_aParticles[i].m_Life += TimePassed;
-			m_aParticles[i].m_Rot += TimePassed * m_aParticles[i].m_Rotspeed;
-
-			// check particle death
-			if(m_aParticles[i].m_Life > m_aParticles[i].m_LifeSpan)
-			{
-				// remove it from the group list
-				if(m_aParticles[i].m_PrevPart != -1)
-					m_aParticles[m_aParticles[i].m_PrevPart].m_NextPart = m_aParticles[i].m_NextPart;
-				else
-					m_aFirstPart[g] = m_aParticles[i].m_NextPart;
-
-				if(m_aParticles[i].m_NextPart != -1)
-					m_aParticles[m_aParticles[i].m_NextPart].m_PrevPart = m_aParticles[i].m_PrevPart;
-
-				// insert to the free list
-				if(m_FirstFree != -1)
-					m_aParticles[m_FirstFree].m_PrevPart = i;
-				m_aParticles[i].m_PrevPart = -1;
-				m_aParticles[i].m_NextPart = m_FirstFree;
-				m_FirstFree = i;
-			}
-
-			i = Next;
+			float Friction = powf(m_aFriction[i], (float)FrictionCount);
+			m_aVelX[i] *= Friction;
+			m_aVelY[i] *= Friction;
 		}
 	}
+
+	// move the points, only the ones close to a tile need the collision
+	for(int i = 0; i < Num; i++)
+	{
+		vec2 Pos = vec2(m_aPosX[i], m_aPosY[i]);
+		vec2 Vel = vec2(m_aVelX[i], m_aVelY[i])*TimePassed;
+		if(maximum(absolute(Vel.x), absolute(Vel.y)) < Collision()->FreeDistance(Pos))
+		{
+			m_aPosX[i] = Pos.x + Vel.x;
+			m_aPosY[i] = Pos.y + Vel.y;
+		}
+		else
+		{
+			Collision()->MovePoint(&Pos, &Vel, 0.1f+0.9f*random_float(), NULL);
+			m_aPosX[i] = Pos.x;
+			m_aPosY[i] = Pos.y;
+			m_aVelX[i] = Vel.x/TimePassed;
+			m_aVelY[i] = Vel.y/TimePassed;
+		}
+	}
+
+	// remove dead particles, the living ones keep their order for drawing
+	int NumAlive = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		if(m_aLife[i] > m_aLifeSpan[i])
+			continue;
+
+		if(i != NumAlive)
+		{
+			m_aPosX[NumAlive] = m_aPosX[i];
+			m_aPosY[NumAlive] = m_aPosY[i];
+			m_aVelX[NumAlive] = m_aVelX[i];
+			m_aVelY[NumAlive] = m_aVelY[i];
+			m_aGravity[NumAlive] = m_aGravity[i];
+			m_aFriction[NumAlive] = m_aFriction[i];
+			m_aLife[NumAlive] = m_aLife[i];
+			m_aLifeSpan[NumAlive] = m_aLifeSpan[i];
+			m_aRot[NumAlive] = m_aRot[i];
+			m_aRotspeed[NumAlive] = m_aRotspeed[i];
+			m_aStartSize[NumAlive] = m_aStartSize[i];
+			m_aEndSize[NumAlive] = m_aEndSize[i];
+			m_aSpr[NumAlive] = m_aSpr[i];
+			m_aColor[NumAlive] = m_aColor[i];
+			m_aGroup[NumAlive] = m_aGroup[i];
+		}
+		NumAlive++;
+	}
+	m_NumParticles = NumAlive;
 }
 
 void CParticles::OnRender()
@@ -143,26 +166,23 @@ void CParticles::RenderGroup(int Group)
 	Graphics()->TextureSet(g_pData->m_aImages[IMAGE_PARTICLES].m_Id);
 	Graphics()->QuadsBegin();
 
-	int i = m_aFirstPart[Group];
-	while(i != -1)
+	// newest first, like the particle lists used to
+	for(int i = m_NumParticles-1; i >= 0; i--)
 	{
-		RenderTools()->SelectSprite(m_aParticles[i].m_Spr);
-		float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-		vec2 p = m_aParticles[i].m_Pos;
-		float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
+		if(m_aGroup[i] != Group)
+			continue;
 
-		Graphics()->QuadsSetRotation(m_aParticles[i].m_Rot);
+		RenderTools()->SelectSprite(m_aSpr[i]);
+		float a = m_aLife[i] / m_aLifeSpan[i];
+		float Size = mix(m_aStartSize[i], m_aEndSize[i], a);
 
-		Graphics()->SetColor(
-			m_aParticles[i].m_Color.r,
-			m_aParticles[i].m_Color.g,
-			m_aParticles[i].m_Color.b,
-			m_aParticles[i].m_Color.a); // pow(a, 0.75f) *
+		Graphics()->QuadsSetRotation(m_aRot[i]);
 
-		IGraphics::CQuadItem QuadItem(p.x, p.y, Size, Size);
-		Graphics()->QuadsDraw(&QuadItem, 1);
+		const vec4 &Color = m_aColor[i];
+		Graphics()->SetColor(Color.r, Color.g, Color.b, Color.a); // pow(a, 0.75f) *
 
-		i = m_aParticles[i].m_NextPart;
+		IGraphics::CQuadItem QuadItem(m_aPosX[i], m_aPosY[i], Size, Size);
+		Graphics()->QuadsDraw(&QuadItem, 1);
 	}
 	Graphics()->QuadsEnd();
 	Graphics()->BlendNormal();
@@ -41,11 +41,6 @@ struct CParticle
 	float m_Friction;
 
 	vec4 m_Color;
-
-	// set by the particle system
-	float m_Life;
-	int m_PrevPart;
-	int m_NextPart;
 };
 
 class CParticles : public CComponent
@@ -74,9 +69,26 @@ private:
 		MAX_PARTICLES=1024*8,
 	};
 
-	CParticle m_aParticles[MAX_PARTICLES];
-	int m_FirstFree;
-	int m_aFirstPart[NUM_GROUPS];
+	// the particles of all groups as separate arrays per field, the living
+	// ones packed at the front in the order they were added
+	int m_NumParticles;
+	float m_aPosX[MAX_PARTICLES];
+	float m_aPosY[MAX_PARTICLES];
+	float m_aVelX[MAX_PARTICLES];
+	float m_aVelY[MAX_PARTICLES];
+	float m_aGravity[MAX_PARTICLES];
+	float m_aFriction[MAX_PARTICLES];
+	float m_aLife[MAX_PARTICLES];
+	float m_aLifeSpan[MAX_PARTICLES];
+	float m_aRot[MAX_PARTICLES];
+	float m_aRotspeed[MAX_PARTICLES];
+	float m_aStartSize[MAX_PARTICLES];
+	float m_aEndSize[MAX_PARTICLES];
+	int m_aSpr[MAX_PARTICLES];
+	vec4 m_aColor[MAX_PARTICLES];
+	unsigned char m_aGroup[MAX_PARTICLES];
+
+	float m_FrictionFraction;
 
 	void RenderGroup(int Group);
 	void Update(float TimePassed);
@@ -1576,7 +1576,7 @@ void CGameClient::OnPredict()
 		Tick <= Client()->PredGameTick();
 		Tick++)
 	{
-		// first calculate where everyone should move
+		bool aUseInput[MAX_CLIENTS] = { false };
 		for(int c = 0; c < MAX_CLIENTS; c++)
 		{
 			if(!World.m_apCharacters[c])
@@ -1590,33 +1590,19 @@ void CGameClient::OnPredict()
 
 			mem_zero(&World.m_apCharacters[c]->m_Input, sizeof(World.m_apCharacters[c]->m_Input));
 
+			// don't apply inputs for non-local players
 			if(m_LocalClientID == c)
 			{
 				// apply player input
 				const int *pInput = Client()->GetInput(Tick);
 				if(pInput)
 					World.m_apCharacters[c]->m_Input = *((const CNetObj_PlayerInput*)pInput);
-
-				World.m_apCharacters[c]->Tick(true);
-			}
-			else
-			{
-				// don't apply inputs for non-local players
-				World.m_apCharacters[c]->Tick(false);
+				aUseInput[c] = true;
 			}
 		}
 
-		// move all players and quantize their data
-		for(int c = 0; c < MAX_CLIENTS; c++)
-		{
-			if (!World.m_apCharacters[c])
-				continue;
-
-			World.m_apCharacters[c]->AddDragVelocity();
-			World.m_apCharacters[c]->ResetDragVelocity();
-			World.m_apCharacters[c]->Move();
-			World.m_apCharacters[c]->Quantize();
-		}
+		// calculate where everyone should move, then move all players and quantize their data
+		World.Tick(aUseInput);
 
 		// check if we want to trigger effects
 		if(Tick > m_LastNewPredictedTick)
@@ -18,14 +18,28 @@ CCollision::CCollision()
 	m_Width = 0;
 	m_Height = 0;
 	m_pLayers = 0;
+	m_pFlags = 0;
+	m_pDistance = 0;
+}
+
+CCollision::~CCollision()
+{
+	delete[] m_pFlags;
+	delete[] m_pDistance;
 }
 
 void CCollision::Init(class CLayers *pLayers)
 {
 	m_pLayers = pLayers;
-	m_Width = m_pLayers->GameLayer()->m_Width;
-	m_Height = m_pLayers->GameLayer()->m_Height;
-	m_pTiles = static_cast<CTile *>(m_pLayers->Map()->GetData(m_pLayers->GameLayer()->m_Data));
+	Init(static_cast<CTile *>(m_pLayers->Map()->GetData(m_pLayers->GameLayer()->m_Data)),
+		m_pLayers->GameLayer()->m_Width, m_pLayers->GameLayer()->m_Height);
+}
+
+void CCollision::Init(CTile *pTiles, int Width, int Height)
+{
+	m_Width = Width;
+	m_Height = Height;
+	m_pTiles = pTiles;
 
 	for(int i = 0; i < m_Width*m_Height; i++)
 	{
@@ -49,40 +63,115 @@ void CCollision::Init(class CLayers *pLayers)
 			m_pTiles[i].m_Index = 0;
 		}
 	}
+
+	// one byte per tile so lookups touch less memory
+	delete[] m_pFlags;
+	m_pFlags = new unsigned char[m_Width*m_Height];
+	for(int i = 0; i < m_Width*m_Height; i++)
+		m_pFlags[i] = m_pTiles[i].m_Index > 128 ? 0 : m_pTiles[i].m_Index;
+
+	InitDistance();
 }
 
-int CCollision::GetTile(int x, int y) const
+void CCollision::InitDistance()
 {
-	int Nx = clamp(x/32, 0, m_Width-1);
-	int Ny = clamp(y/32, 0, m_Height-1);
+	delete[] m_pDistance;
+	m_pDistance = new unsigned char[m_Width*m_Height];
 
-	return m_pTiles[Ny*m_Width+Nx].m_Index > 128 ? 0 : m_pTiles[Ny*m_Width+Nx].m_Index;
+	// two pass chamfer transform with the chessboard metric
+	for(int y = 0; y < m_Height; y++)
+		for(int x = 0; x < m_Width; x++)
+		{
+			int Dist = m_pFlags[y*m_Width+x] ? 0 : 255;
+			if(Dist && x > 0)
+				Dist = minimum(Dist, m_pDistance[y*m_Width+x-1]+1);
+			if(Dist && y > 0)
+			{
+				for(int i = maximum(x-1, 0); i <= minimum(x+1, m_Width-1); i++)
+					Dist = minimum(Dist, m_pDistance[(y-1)*m_Width+i]+1);
+			}
+			m_pDistance[y*m_Width+x] = Dist;
+		}
+
+	for(int y = m_Height-1; y >= 0; y--)
+		for(int x = m_Width-1; x >= 0; x--)
+		{
+			int Dist = m_pDistance[y*m_Width+x];
+			if(Dist && x < m_Width-1)
+				Dist = minimum(Dist, m_pDistance[y*m_Width+x+1]+1);
+			if(Dist && y < m_Height-1)
+			{
+				for(int i = maximum(x-1, 0); i <= minimum(x+1, m_Width-1); i++)
+					Dist = minimum(Dist, m_pDistance[(y+1)*m_Width+i]+1);
+			}
+			m_pDistance[y*m_Width+x] = Dist;
+		}
+}
+
+// number of steps a box can move from Pos without getting close to any
+// solid or death tile, so the box tests can be left out for them
+int CCollision::FreeSteps(vec2 Pos, vec2 Step, vec2 Size) const
+{
+	int Dist = m_pDistance[GetTileIndex(round_to_int(Pos.x), round_to_int(Pos.y))];
+
+	// every point closer than Dist-1 tiles to the tile of Pos is in a free tile.
+	// keep a margin for the rounding of the test points and float error.
+	float Budget = (Dist-1)*32.0f - maximum(Size.x, Size.y)*0.5f - 4.0f - (absolute(Pos.x)+absolute(Pos.y))/65536.0f;
+	float StepSize = maximum(absolute(Step.x), absolute(Step.y));
+	if(!(Budget > StepSize))
+		return 0;
+	return (int)minimum(Budget/StepSize, 1000000.0f);
 }
 
-bool CCollision::IsTile(int x, int y, int Flag) const
+// how far a point can move from Pos along either axis and stay out of any
+// tile with flags. same margins as FreeSteps, without a box around it.
+float CCollision::FreeDistance(vec2 Pos) const
 {
-	return GetTile(x, y)&Flag;
+	int Dist = m_pDistance[GetTileIndex(round_to_int(Pos.x), round_to_int(Pos.y))];
+	return (Dist-1)*32.0f - 4.0f - (absolute(Pos.x)+absolute(Pos.y))/65536.0f;
+}
+
+// number of samples the line can advance from Pos and certainly stay in
+// the same tile column or row. samples are rounded to whole units before
+// the tile lookup and accumulate float error, Margin accounts for both.
+static float TileSteps(float Pos, float Delta, int Tile, int NumTiles, float Margin)
+{
+	if(Delta > 0.0f)
+		return Tile == NumTiles-1 ? 1e30f : (Tile*32+31.5f-Margin-Pos)/Delta;
+	if(Delta < 0.0f)
+		return Tile == 0 ? 1e30f : (Tile*32-0.5f+Margin-Pos)/Delta;
+	return 1e30f;
 }
 
-// TODO: rewrite this smarter!
 int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
+	// the line is sampled once per unit of length, but only the samples
+	// that could be in a new tile are computed. every tile the line crosses
+	// is looked at only a few times while the result stays exactly the one
+	// of testing every sample.
 	const int End = distance(Pos0, Pos1)+1;
 	const float InverseEnd = 1.0f/End;
-	vec2 Last = Pos0;
+	const vec2 Delta = (Pos1-Pos0)*InverseEnd;
+	const vec2 Margin(0.25f + (absolute(Pos0.x)+absolute(Pos1.x))/65536.0f, 0.25f + (absolute(Pos0.y)+absolute(Pos1.y))/65536.0f);
 
 	for(int i = 0; i <= End; i++)
 	{
 		vec2 Pos = mix(Pos0, Pos1, i*InverseEnd);
-		if(CheckPoint(Pos.x, Pos.y))
+		int Nx = clamp(round_to_int(Pos.x)/32, 0, m_Width-1);
+		int Ny = clamp(round_to_int(Pos.y)/32, 0, m_Height-1);
+		int Flags = m_pFlags[Ny*m_Width+Nx];
+		if(Flags&COLFLAG_SOLID)
 		{
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
-			return GetCollisionAt(Pos.x, Pos.y);
+				*pOutBeforeCollision = i ? mix(Pos0, Pos1, (i-1)*InverseEnd) : Pos0;
+			return Flags;
 		}
-		Last = Pos;
+
+		float Steps = minimum(TileSteps(Pos.x, Delta.x, Nx, m_Width, Margin.x), TileSteps(Pos.y, Delta.y, Ny, m_Height, Margin.y));
+		if(Steps >= 1.0f)
+			i += (int)minimum(Steps, (float)(End-i));
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -159,10 +248,21 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elas
 	if(Distance > 0.00001f)
 	{
 		const float Fraction = 1.0f/(Max+1);
+		int Free = 0;
 		for(int i = 0; i <= Max; i++)
 		{
 			vec2 NewPos = Pos + Vel*Fraction; // TODO: this row is not nice
 
+			// nothing to hit in the free space around the box
+			if(!Free)
+				Free = FreeSteps(Pos, Vel*Fraction, Size);
+			if(Free)
+			{
+				Free--;
+				Pos = NewPos;
+				continue;
+			}
+
 			//You hit a deathtile, congrats to that :)
 			//Deathtiles are a bit smaller
 			if(pDeath && TestBox(vec2(NewPos.x, NewPos.y), Size*(2.0f/3.0f), COLFLAG_DEATH))
@@ -3,6 +3,7 @@
 #ifndef GAME_COLLISION_H
 #define GAME_COLLISION_H
 
+#include <base/math.h>
 #include <base/vmath.h>
 
 class CCollision
@@ -12,8 +13,17 @@ class CCollision
 	int m_Height;
 	class CLayers *m_pLayers;
 
-	bool IsTile(int x, int y, int Flag=COLFLAG_SOLID) const;
-	int GetTile(int x, int y) const;
+	// collision flags of every tile
+	unsigned char *m_pFlags;
+	// distance in tiles to the closest tile with any flag, at most 255
+	unsigned char *m_pDistance;
+
+	void InitDistance();
+	int FreeSteps(vec2 Pos, vec2 Step, vec2 Size) const;
+
+	bool IsTile(int x, int y, int Flag=COLFLAG_SOLID) const { return GetTile(x, y)&Flag; }
+	int GetTileIndex(int x, int y) const { return clamp(y/32, 0, m_Height-1)*m_Width + clamp(x/32, 0, m_Width-1); }
+	int GetTile(int x, int y) const { return m_pFlags[GetTileIndex(x, y)]; }
 
 public:
 	enum
@@ -24,12 +34,15 @@ public:
 	};
 
 	CCollision();
+	~CCollision();
 	void Init(class CLayers *pLayers);
+	void Init(struct CTile *pTiles, int Width, int Height);
 	bool CheckPoint(float x, float y, int Flag=COLFLAG_SOLID) const { return IsTile(round_to_int(x), round_to_int(y), Flag); }
 	bool CheckPoint(vec2 Pos, int Flag=COLFLAG_SOLID) const { return CheckPoint(Pos.x, Pos.y, Flag); }
 	int GetCollisionAt(float x, float y) const { return GetTile(round_to_int(x), round_to_int(y)); }
 	int GetWidth() const { return m_Width; }
 	int GetHeight() const { return m_Height; }
+	float FreeDistance(vec2 Pos) const;
 	int IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const;
 	void MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces) const;
 	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath=0) const;
@@ -66,6 +66,71 @@ float VelocityRamp(float Value, float Start, float Range, float Curvature)
 
 const float CCharacterCore::PHYS_SIZE = 28.0f;
 
+int CWorldCore::FindCharacters(vec2 Pos, float Radius, const CCharacterCore *pExclude, int *pIDs) const
+{
+	// only a prefilter, generous enough to never miss anything the exact check accepts
+	const float Limit = (Radius*1.01f+1.0f)*(Radius*1.01f+1.0f);
+	int Num = 0;
+
+	if(m_Batched)
+	{
+		// no branches, so the compiler can turn this into simd code
+		float aDistSquared[MAX_CLIENTS];
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			float dx = Pos.x-m_aPosX[i];
+			float dy = Pos.y-m_aPosY[i];
+			aDistSquared[i] = dx*dx+dy*dy;
+		}
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			if(aDistSquared[i] < Limit && m_apCharacters[i] != pExclude)
+				pIDs[Num++] = i;
+		return Num;
+	}
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CCharacterCore *pCharCore = m_apCharacters[i];
+		if(!pCharCore || pCharCore == pExclude)
+			continue;
+		vec2 Diff = Pos-pCharCore->m_Pos;
+		if(dot(Diff, Diff) < Limit)
+			pIDs[Num++] = i;
+	}
+	return Num;
+}
+
+void CWorldCore::Tick(const bool *pUseInput)
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aPosX[i] = m_apCharacters[i] ? m_apCharacters[i]->m_Pos.x : 1e10f;
+		m_aPosY[i] = m_apCharacters[i] ? m_apCharacters[i]->m_Pos.y : 1e10f;
+	}
+	m_Batched = true;
+
+	// positions don't change while ticking
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		if(m_apCharacters[i])
+			m_apCharacters[i]->Tick(pUseInput[i]);
+
+	// everyone moves against the ones that already moved
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CCharacterCore *pCharCore = m_apCharacters[i];
+		if(!pCharCore)
+			continue;
+		pCharCore->AddDragVelocity();
+		pCharCore->ResetDragVelocity();
+		pCharCore->Move();
+		pCharCore->Quantize();
+		m_aPosX[i] = pCharCore->m_Pos.x;
+		m_aPosY[i] = pCharCore->m_Pos.y;
+	}
+
+	m_Batched = false;
+}
+
 void CCharacterCore::Init(CWorldCore *pWorld, CCollision *pCollision)
 {
 	m_pWorld = pWorld;
@@ -302,20 +367,15 @@ void CCharacterCore::Tick(bool UseInput)
 
 	if(m_pWorld)
 	{
-		for(int i = 0; i < MAX_CLIENTS; i++)
+		// handle player <-> player collision, only the close ones can collide
+		int aIDs[MAX_CLIENTS];
+		int NumIDs = m_pWorld->m_Tuning.m_PlayerCollision ? m_pWorld->FindCharacters(m_Pos, PHYS_SIZE*1.25f, this, aIDs) : 0;
+		for(int n = 0; n < NumIDs; n++)
 		{
-			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
-			if(!pCharCore)
-				continue;
-
-			//player *p = (player*)ent;
-			if(pCharCore == this) // || !(p->flags&FLAG_ALIVE)
-				continue; // make sure that we don't nudge our self
-
-			// handle player <-> player collision
+			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[aIDs[n]];
 			float Distance = distance(m_Pos, pCharCore->m_Pos);
 			vec2 Dir = normalize(m_Pos - pCharCore->m_Pos);
-			if(m_pWorld->m_Tuning.m_PlayerCollision && Distance < PHYS_SIZE*1.25f && Distance > 0.0f)
+			if(Distance < PHYS_SIZE*1.25f && Distance > 0.0f)
 			{
 				float a = (PHYS_SIZE*1.45f - Distance);
 				float Velocity = 0.5f;
@@ -328,20 +388,23 @@ void CCharacterCore::Tick(bool UseInput)
 				m_Vel += Dir*a*(Velocity*0.75f);
 				m_Vel *= 0.85f;
 			}
+		}
 
-			// handle hook influence
-			if(m_HookedPlayer == i && m_pWorld->m_Tuning.m_PlayerHooking)
+		// handle hook influence
+		CCharacterCore *pCharCore = m_HookedPlayer >= 0 && m_HookedPlayer < MAX_CLIENTS ? m_pWorld->m_apCharacters[m_HookedPlayer] : 0;
+		if(pCharCore && pCharCore != this && m_pWorld->m_Tuning.m_PlayerHooking)
+		{
+			float Distance = distance(m_Pos, pCharCore->m_Pos);
+			vec2 Dir = normalize(m_Pos - pCharCore->m_Pos);
+			if(Distance > PHYS_SIZE*1.50f) // TODO: fix tweakable variable
 			{
-				if(Distance > PHYS_SIZE*1.50f) // TODO: fix tweakable variable
-				{
-					float Accel = m_pWorld->m_Tuning.m_HookDragAccel * (Distance/m_pWorld->m_Tuning.m_HookLength);
+				float Accel = m_pWorld->m_Tuning.m_HookDragAccel * (Distance/m_pWorld->m_Tuning.m_HookLength);
 
-					// add force to the hooked player
-					pCharCore->m_HookDragVel += Dir*Accel*1.5f;
+				// add force to the hooked player
+				pCharCore->m_HookDragVel += Dir*Accel*1.5f;
 
-					// add a little bit force to the guy who has the grip
-					m_HookDragVel -= Dir*Accel*0.25f;
-				}
+				// add a little bit force to the guy who has the grip
+				m_HookDragVel -= Dir*Accel*0.25f;
 			}
 		}
 	}
@@ -385,15 +448,17 @@ void CCharacterCore::Move()
 		float Distance = distance(m_Pos, NewPos);
 		int End = Distance+1;
 		vec2 LastPos = m_Pos;
-		for(int i = 0; i < End; i++)
+
+		// only the ones close to the path can be in the way
+		int aIDs[MAX_CLIENTS];
+		int NumIDs = m_pWorld->FindCharacters(m_Pos, PHYS_SIZE+Distance, this, aIDs);
+		for(int i = 0; i < End && NumIDs; i++)
 		{
 			float a = i/Distance;
 			vec2 Pos = mix(m_Pos, NewPos, a);
-			for(int p = 0; p < MAX_CLIENTS; p++)
+			for(int n = 0; n < NumIDs; n++)
 			{
-				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
-				if(!pCharCore || pCharCore == this)
-					continue;
+				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[aIDs[n]];
 				float D = distance(Pos, pCharCore->m_Pos);
 				if(D < PHYS_SIZE && D >= 0.0f)
 				{
@@ -133,14 +133,30 @@ enum
 
 class CWorldCore
 {
+	// positions of all characters as structure of arrays while Tick runs,
+	// empty slots are far away so they never come close to anything
+	bool m_Batched;
+	float m_aPosX[MAX_CLIENTS];
+	float m_aPosY[MAX_CLIENTS];
+
 public:
 	CWorldCore()
 	{
 		mem_zero(m_apCharacters, sizeof(m_apCharacters));
+		m_Batched = false;
 	}
 
 	CTuningParams m_Tuning;
 	class CCharacterCore *m_apCharacters[MAX_CLIENTS];
+
+	// finds the characters that may be closer than Radius to Pos in client id order,
+	// the callers check the exact distance themselves
+	int FindCharacters(vec2 Pos, float Radius, const class CCharacterCore *pExclude, int *pIDs) const;
+
+	// ticks all characters together: every core ticks in client id order, then each
+	// one applies its drag velocity, moves and gets quantized. gives the same results
+	// as doing that one character at a time
+	void Tick(const bool *pUseInput);
 };
 
 class CCharacterCore
@@ -0,0 +1,127 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "alloc.h"
+
+CSlabPool *CSlabPool::ms_pFirstPool = 0;
+
+CSlabPool::CSlabPool(const char *pName, int ObjectSize)
+{
+	m_pName = pName;
+	m_ObjectSize = ObjectSize;
+	m_SlotSize = (ObjectSize+1+CACHE_LINE_SIZE-1)/CACHE_LINE_SIZE*CACHE_LINE_SIZE;
+	m_pFirstSlab = 0;
+	m_pFirstFree = 0;
+	m_NumSlabs = 0;
+	m_NumLive = 0;
+	m_PeakLive = 0;
+	m_NumAllocs = 0;
+
+	m_pNextPool = ms_pFirstPool;
+	ms_pFirstPool = this;
+}
+
+CSlabPool::~CSlabPool()
+{
+	Reset();
+
+	for(CSlabPool **ppPool = &ms_pFirstPool; *ppPool; ppPool = &(*ppPool)->m_pNextPool)
+	{
+		if(*ppPool == this)
+		{
+			*ppPool = m_pNextPool;
+			break;
+		}
+	}
+}
+
+char *CSlabPool::SlabSlots(CSlab *pSlab) const
+{
+	return (char *)(((size_t)pSlab+sizeof(CSlab)+CACHE_LINE_SIZE-1)&~(size_t)(CACHE_LINE_SIZE-1));
+}
+
+bool CSlabPool::Owns(const void *pPtr) const
+{
+	for(CSlab *pSlab = m_pFirstSlab; pSlab; pSlab = pSlab->m_pNext)
+	{
+		const char *pSlots = SlabSlots(pSlab);
+		if((const char *)pPtr >= pSlots && (const char *)pPtr < pSlots+SLAB_SLOTS*m_SlotSize)
+			return ((const char *)pPtr-pSlots)%m_SlotSize == 0;
+	}
+	return false;
+}
+
+void CSlabPool::AddSlab()
+{
+	// the slab header sits in front of the first aligned slot
+	char *pMemory = (char *)mem_alloc(sizeof(CSlab)+CACHE_LINE_SIZE-1+SLAB_SLOTS*m_SlotSize);
+	CSlab *pSlab = (CSlab *)pMemory;
+	pSlab->m_pNext = m_pFirstSlab;
+	m_pFirstSlab = pSlab;
+	m_NumSlabs++;
+
+	char *pSlots = SlabSlots(pSlab);
+	for(int i = SLAB_SLOTS-1; i >= 0; i--)
+	{
+		CFreeSlot *pSlot = (CFreeSlot *)(pSlots+i*m_SlotSize);
+		*SlotState(pSlot) = SLOT_FREE;
+		pSlot->m_pNext = m_pFirstFree;
+		m_pFirstFree = pSlot;
+	}
+}
+
+void *CSlabPool::Alloc(int Size)
+{
+	dbg_assert(Size == m_ObjectSize, "size error");
+	if(!m_pFirstFree)
+		AddSlab();
+
+	CFreeSlot *pSlot = m_pFirstFree;
+	m_pFirstFree = pSlot->m_pNext;
+	mem_zero(pSlot, m_ObjectSize);
+	*SlotState(pSlot) = SLOT_USED;
+
+	m_NumAllocs++;
+	m_NumLive++;
+	if(m_NumLive > m_PeakLive)
+		m_PeakLive = m_NumLive;
+	return pSlot;
+}
+
+void CSlabPool::Free(void *pPtr)
+{
+	if(!pPtr)
+		return;
+	dbg_assert(Owns(pPtr), "not from this pool");
+	dbg_assert(*SlotState(pPtr) == SLOT_USED, "not used");
+
+	CFreeSlot *pSlot = (CFreeSlot *)pPtr;
+	*SlotState(pSlot) = SLOT_FREE;
+	pSlot->m_pNext = m_pFirstFree;
+	m_pFirstFree = pSlot;
+	m_NumLive--;
+}
+
+void CSlabPool::Reset()
+{
+	if(m_NumLive)
+	{
+		dbg_msg("alloc", "%s: not releasing slabs, %d slots still in use", m_pName, m_NumLive);
+		return;
+	}
+
+	while(m_pFirstSlab)
+	{
+		CSlab *pSlab = m_pFirstSlab;
+		m_pFirstSlab = pSlab->m_pNext;
+		mem_free(pSlab);
+	}
+	m_pFirstFree = 0;
+	m_NumSlabs = 0;
+	m_PeakLive = 0;
+}
+
+void CSlabPool::ResetAll()
+{
+	for(CSlabPool *pPool = ms_pFirstPool; pPool; pPool = pPool->m_pNextPool)
+		pPool->Reset();
+}
@@ -23,6 +23,94 @@
 	} \
 	private:
 
+/*
+	Class: CSlabPool
+		Hands out cache line aligned slots of one size from slabs that
+		hold many of them. Freed slots go to a free list and are used
+		again first, the slabs are only given back with <Reset>. Slots
+		are zeroed when they are handed out, like MACRO_ALLOC_HEAP does.
+		Freeing a slot twice or a pointer of another pool asserts.
+*/
+class CSlabPool
+{
+	enum
+	{
+		CACHE_LINE_SIZE=64,
+		SLAB_SLOTS=64,
+
+		// kept in the last byte of each slot
+		SLOT_FREE=0,
+		SLOT_USED,
+	};
+
+	struct CSlab
+	{
+		CSlab *m_pNext;
+	};
+
+	struct CFreeSlot
+	{
+		CFreeSlot *m_pNext;
+	};
+
+	const char *m_pName;
+	int m_ObjectSize;
+	int m_SlotSize;
+	CSlab *m_pFirstSlab;
+	CFreeSlot *m_pFirstFree;
+
+	int m_NumSlabs;
+	int m_NumLive;
+	int m_PeakLive;
+	int64 m_NumAllocs;
+
+	CSlabPool *m_pNextPool;
+	static CSlabPool *ms_pFirstPool;
+
+	void AddSlab();
+	char *SlabSlots(CSlab *pSlab) const;
+	unsigned char *SlotState(void *pSlot) const { return (unsigned char *)pSlot+m_SlotSize-1; }
+	bool Owns(const void *pPtr) const;
+
+public:
+	CSlabPool(const char *pName, int ObjectSize);
+	~CSlabPool();
+
+	void *Alloc(int Size);
+	void Free(void *pPtr);
+
+	// gives all slabs back, only does so when no slot is in use
+	void Reset();
+	static void ResetAll();
+
+	static CSlabPool *First() { return ms_pFirstPool; }
+	CSlabPool *Next() const { return m_pNextPool; }
+
+	const char *Name() const { return m_pName; }
+	int SlotSize() const { return m_SlotSize; }
+	int NumSlabs() const { return m_NumSlabs; }
+	int NumLive() const { return m_NumLive; }
+	int PeakLive() const { return m_PeakLive; }
+	int64 NumAllocs() const { return m_NumAllocs; }
+};
+
+#define MACRO_ALLOC_SLAB() \
+	public: \
+	void *operator new(size_t Size); \
+	void operator delete(void *pPtr); \
+	private:
+
+#define MACRO_ALLOC_SLAB_IMPL(POOLTYPE) \
+	static CSlabPool ms_SlabPool##POOLTYPE(#POOLTYPE, sizeof(POOLTYPE)); \
+	void *POOLTYPE::operator new(size_t Size) \
+	{ \
+		return ms_SlabPool##POOLTYPE.Alloc(Size); \
+	} \
+	void POOLTYPE::operator delete(void *pPtr) \
+	{ \
+		ms_SlabPool##POOLTYPE.Free(pPtr); \
+	}
+
 #define MACRO_ALLOC_POOL_ID() \
 	public: \
 	void *operator new(size_t Size, int id); \
@@ -48,7 +136,6 @@
 		dbg_assert(id == (POOLTYPE*)p - (POOLTYPE*)ms_PoolData##POOLTYPE, "invalid id"); \
 		/*dbg_msg("pool", "-- %s %d", #POOLTYPE, id);*/ \
 		ms_PoolUsed##POOLTYPE[id] = 0; \
-		mem_zero(ms_PoolData##POOLTYPE[id], sizeof(POOLTYPE)); \
 	} \
 	void POOLTYPE::operator delete(void *p) /* NOLINT(misc-new-delete-overloads) */ \
 	{ \
@@ -56,7 +143,6 @@
 		dbg_assert(ms_PoolUsed##POOLTYPE[id], "not used"); \
 		/*dbg_msg("pool", "-- %s %d", #POOLTYPE, id);*/ \
 		ms_PoolUsed##POOLTYPE[id] = 0; \
-		mem_zero(ms_PoolData##POOLTYPE[id], sizeof(POOLTYPE)); \
 	}
 
 #endif
@@ -6,6 +6,8 @@
 #include "character.h"
 #include "flag.h"
 
+MACRO_ALLOC_SLAB_IMPL(CFlag)
+
 CFlag::CFlag(CGameWorld *pGameWorld, int Team, vec2 StandPos)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_FLAG, StandPos, ms_PhysSize)
 {
@@ -21,7 +23,7 @@ void CFlag::Reset()
 {
 	m_pCarrier = 0;
 	m_AtStand = true;
-	m_Pos = m_StandPos;
+	SetPos(m_StandPos);
 	m_Vel = vec2(0, 0);
 	m_GrabTick = 0;
 }
@@ -46,7 +48,7 @@ void CFlag::TickDefered()
 	if(m_pCarrier)
 	{
 		// update flag position
-		m_Pos = m_pCarrier->GetPos();
+		SetPos(m_pCarrier->GetPos());
 	}
 	else
 	{
@@ -68,7 +70,9 @@ void CFlag::TickDefered()
 			else
 			{
 				m_Vel.y += GameWorld()->m_Core.m_Tuning.m_Gravity;
-				GameServer()->Collision()->MoveBox(&m_Pos, &m_Vel, vec2(ms_PhysSize, ms_PhysSize), 0.5f);
+				vec2 Pos = m_Pos;
+				GameServer()->Collision()->MoveBox(&Pos, &m_Vel, vec2(ms_PhysSize, ms_PhysSize), 0.5f);
+				SetPos(Pos);
 			}
 		}
 	}
@@ -81,16 +85,14 @@ void CFlag::TickPaused()
 		m_GrabTick++;
 }
 
-void CFlag::Snap(int SnappingClient)
+bool CFlag::SnapShared()
 {
-	if(NetworkClipped(SnappingClient))
-		return;
-
-	CNetObj_Flag *pFlag = (CNetObj_Flag *)Server()->SnapNewItem(NETOBJTYPE_FLAG, m_Team, sizeof(CNetObj_Flag));
+	CNetObj_Flag *pFlag = (CNetObj_Flag *)SnapNewSharedItem(NETOBJTYPE_FLAG, m_Team, sizeof(CNetObj_Flag));
 	if(!pFlag)
-		return;
+		return true;
 
 	pFlag->m_X = round_to_int(m_Pos.x);
 	pFlag->m_Y = round_to_int(m_Pos.y);
 	pFlag->m_Team = m_Team;
+	return true;
 }
@@ -7,6 +7,8 @@
 
 class CFlag : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 private:
 	/* Identity */
 	int m_Team;
@@ -36,7 +38,7 @@ public:
 	/* CEntity functions */
 	virtual void Reset();
 	virtual void TickPaused();
-	virtual void Snap(int SnappingClient);
+	virtual bool SnapShared();
 	virtual void TickDefered();
 
 	/* Functions */
@@ -6,6 +6,8 @@
 #include "character.h"
 #include "laser.h"
 
+MACRO_ALLOC_SLAB_IMPL(CLaser)
+
 CLaser::CLaser(CGameWorld *pGameWorld, vec2 Pos, vec2 Direction, float StartEnergy, int Owner)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_LASER, Pos)
 {
@@ -28,7 +30,7 @@ bool CLaser::HitCharacter(vec2 From, vec2 To)
 		return false;
 
 	m_From = From;
-	m_Pos = At;
+	SetPos(At);
 	m_Energy = -1;
 	pHit->TakeDamage(vec2(0.f, 0.f), normalize(To-From), g_pData->m_Weapons.m_aId[WEAPON_LASER].m_Damage, m_Owner, WEAPON_LASER);
 	return true;
@@ -52,13 +54,13 @@ void CLaser::DoBounce()
 		{
 			// intersected
 			m_From = m_Pos;
-			m_Pos = To;
+			SetPos(To);
 
 			vec2 TempPos = m_Pos;
 			vec2 TempDir = m_Dir * 4.0f;
 
 			GameServer()->Collision()->MovePoint(&TempPos, &TempDir, 1.0f, 0);
-			m_Pos = TempPos;
+			SetPos(TempPos);
 			m_Dir = normalize(TempDir);
 
 			m_Energy -= distance(m_From, m_Pos) + GameServer()->Tuning()->m_LaserBounceCost;
@@ -75,7 +77,7 @@ void CLaser::DoBounce()
 		if(!HitCharacter(m_Pos, To))
 		{
 			m_From = m_Pos;
-			m_Pos = To;
+			SetPos(To);
 			m_Energy = -1;
 		}
 	}
@@ -97,18 +99,28 @@ void CLaser::TickPaused()
 	++m_EvalTick;
 }
 
-void CLaser::Snap(int SnappingClient)
+bool CLaser::SnapShared()
 {
-	if(NetworkClipped(SnappingClient) && NetworkClipped(SnappingClient, m_From))
-		return;
-
-	CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, GetID(), sizeof(CNetObj_Laser)));
+	CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(SnapNewSharedItem(NETOBJTYPE_LASER, GetID(), sizeof(CNetObj_Laser)));
 	if(!pObj)
-		return;
+		return true;
 
 	pObj->m_X = round_to_int(m_Pos.x);
 	pObj->m_Y = round_to_int(m_Pos.y);
 	pObj->m_FromX = round_to_int(m_From.x);
 	pObj->m_FromY = round_to_int(m_From.y);
 	pObj->m_StartTick = m_EvalTick;
+	return true;
+}
+
+bool CLaser::SharedClipped(int SnappingClient)
+{
+	return NetworkClipped(SnappingClient) && NetworkClipped(SnappingClient, m_From);
+}
+
+void CLaser::SnapArea(vec2 *pCenter, float *pRadius)
+{
+	// both ends of the beam
+	*pCenter = (m_Pos+m_From)*0.5f;
+	*pRadius = distance(m_Pos, m_From)*0.5f+1.0f;
 }
@@ -7,13 +7,17 @@
 
 class CLaser : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CLaser(CGameWorld *pGameWorld, vec2 Pos, vec2 Direction, float StartEnergy, int Owner);
 
 	virtual void Reset();
 	virtual void Tick();
 	virtual void TickPaused();
-	virtual void Snap(int SnappingClient);
+	virtual bool SnapShared();
+	virtual bool SharedClipped(int SnappingClient);
+	virtual void SnapArea(vec2 *pCenter, float *pRadius);
 
 protected:
 	bool HitCharacter(vec2 From, vec2 To);
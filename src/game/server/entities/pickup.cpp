@@ -7,6 +7,8 @@
 #include "character.h"
 #include "pickup.h"
 
+MACRO_ALLOC_SLAB_IMPL(CPickup)
+
 CPickup::CPickup(CGameWorld *pGameWorld, int Type, vec2 Pos)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_PICKUP, Pos, PickupPhysSize)
 {
@@ -134,16 +136,17 @@ void CPickup::TickPaused()
 		++m_SpawnTick;
 }
 
-void CPickup::Snap(int SnappingClient)
+bool CPickup::SnapShared()
 {
-	if(m_SpawnTick != -1 || NetworkClipped(SnappingClient))
-		return;
+	if(m_SpawnTick != -1)
+		return true;
 
-	CNetObj_Pickup *pP = static_cast<CNetObj_Pickup *>(Server()->SnapNewItem(NETOBJTYPE_PICKUP, GetID(), sizeof(CNetObj_Pickup)));
+	CNetObj_Pickup *pP = static_cast<CNetObj_Pickup *>(SnapNewSharedItem(NETOBJTYPE_PICKUP, GetID(), sizeof(CNetObj_Pickup)));
 	if(!pP)
-		return;
+		return true;
 
 	pP->m_X = round_to_int(m_Pos.x);
 	pP->m_Y = round_to_int(m_Pos.y);
 	pP->m_Type = m_Type;
+	return true;
 }
@@ -6,6 +6,8 @@
 #include "character.h"
 #include "projectile.h"
 
+MACRO_ALLOC_SLAB_IMPL(CProjectile)
+
 CProjectile::CProjectile(CGameWorld *pGameWorld, int Type, int Owner, vec2 Pos, vec2 Dir, int Span,
 		int Damage, bool Explosive, float Force, int SoundImpact, int Weapon)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_PROJECTILE, vec2(round_to_int(Pos.x), round_to_int(Pos.y)))
@@ -108,14 +110,24 @@ void CProjectile::FillInfo(CNetObj_Projectile *pProj)
 	pProj->m_Type = m_Type;
 }
 
-void CProjectile::Snap(int SnappingClient)
+bool CProjectile::SnapShared()
 {
 	float Ct = (Server()->Tick()-m_StartTick)/(float)Server()->TickSpeed();
+	m_SnapPos = GetPos(Ct);
 
-	if(NetworkClipped(SnappingClient, GetPos(Ct)))
-		return;
-
-	CNetObj_Projectile *pProj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, GetID(), sizeof(CNetObj_Projectile)));
+	CNetObj_Projectile *pProj = static_cast<CNetObj_Projectile *>(SnapNewSharedItem(NETOBJTYPE_PROJECTILE, GetID(), sizeof(CNetObj_Projectile)));
 	if(pProj)
 		FillInfo(pProj);
+	return true;
+}
+
+bool CProjectile::SharedClipped(int SnappingClient)
+{
+	return NetworkClipped(SnappingClient, m_SnapPos);
+}
+
+void CProjectile::SnapArea(vec2 *pCenter, float *pRadius)
+{
+	*pCenter = m_SnapPos;
+	*pRadius = 0.0f;
 }
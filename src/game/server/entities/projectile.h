@@ -13,6 +13,8 @@ enum
 
 class CProjectile : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CProjectile(CGameWorld *pGameWorld, int Type, int Owner, vec2 Pos, vec2 Dir, int Span,
 		int Damage, bool Explosive, float Force, int SoundImpact, int Weapon);
@@ -26,7 +28,9 @@ public:
 	virtual void Reset();
 	virtual void Tick();
 	virtual void TickPaused();
-	virtual void Snap(int SnappingClient);
+	virtual bool SnapShared();
+	virtual bool SharedClipped(int SnappingClient);
+	virtual void SnapArea(vec2 *pCenter, float *pRadius);
 
 private:
 	vec2 m_Direction;
@@ -40,6 +44,7 @@ private:
 	float m_Force;
 	int m_StartTick;
 	bool m_Explosive;
+	vec2 m_SnapPos;
 };
 
 #endif
@@ -18,6 +18,10 @@ CEntity::CEntity(CGameWorld *pGameWorld, int ObjType, vec2 Pos, int ProximityRad
 	m_ProximityRadius = ProximityRadius;
 
 	m_MarkedForDestroy = false;
+	m_SharedSnapItem = -1;
+	m_SnappedShared = false;
+	m_AlwaysRelevant = false;
+	m_pNextAlwaysRelevant = 0;
 	m_Pos = Pos;
 }
 
@@ -27,6 +31,21 @@ CEntity::~CEntity()
 	Server()->SnapFreeID(m_ID);
 }
 
+void CEntity::SetPos(vec2 Pos)
+{
+	m_Pos = Pos;
+	GameWorld()->m_aGrids[m_ObjType].Move(&m_GridNode, Pos);
+}
+
+void *CEntity::SnapNewSharedItem(int Type, int ID, int Size)
+{
+	int Index = Server()->SnapNumItems();
+	void *pItem = Server()->SnapNewItem(Type, ID, Size);
+	if(pItem)
+		m_SharedSnapItem = Index;
+	return pItem;
+}
+
 int CEntity::NetworkClipped(int SnappingClient)
 {
 	return NetworkClipped(SnappingClient, m_Pos);
@@ -34,13 +53,13 @@ int CEntity::NetworkClipped(int SnappingClient)
 
 int CEntity::NetworkClipped(int SnappingClient, vec2 CheckPos)
 {
-	if(SnappingClient == -1)
+	if(SnappingClient == -1 || m_AlwaysRelevant)
 		return 0;
 
 	float dx = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.x-CheckPos.x;
 	float dy = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.y-CheckPos.y;
 
-	if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
+	if(absolute(dx) > (float)CGameWorld::VIEW_RANGE_X || absolute(dy) > (float)CGameWorld::VIEW_RANGE_Y)
 		return 1;
 
 	if(distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos) > 1100.0f)
@@ -5,6 +5,8 @@
 
 #include <base/vmath.h>
 
+#include <game/spatialgrid.h>
+
 #include "alloc.h"
 #include "gameworld.h"
 
@@ -26,6 +28,10 @@ private:
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
 
+	CSpatialGrid::CNode m_GridNode;
+	CSpatialGrid::CNode m_SnapNode;
+	CEntity *m_pNextAlwaysRelevant;
+
 	int m_ID;
 	int m_ObjType;
 
@@ -38,18 +44,44 @@ private:
 	/* State */
 	bool m_MarkedForDestroy;
 
+	/*
+		Variable: m_SharedSnapItem
+			Index of the item the entity added to the shared snapshot,
+			-1 if it didn't add one this tick.
+	*/
+	int m_SharedSnapItem;
+	bool m_SnappedShared;
+
+	/*
+		Variable: m_AlwaysRelevant
+			The entity is snapped for every client no matter
+			where they look.
+	*/
+	bool m_AlwaysRelevant;
+
 protected:
 	/* State */
 
 	/*
 		Variable: m_Pos
-			Contains the current posititon of the entity.
+			Contains the current posititon of the entity. Only change
+			it with SetPos so the world's spatial grid stays in sync.
 	*/
 	vec2 m_Pos;
 
+	/* Setters */
+	void SetPos(vec2 Pos);
+
 	/* Getters */
 	int GetID() const					{ return m_ID; }
 
+	/*
+		Function: SnapNewSharedItem
+			Adds an item to the shared snapshot. Only to be used
+			from SnapShared.
+	*/
+	void *SnapNewSharedItem(int Type, int ID, int Size);
+
 public:
 	/* Constructor */
 	CEntity(CGameWorld *pGameWorld, int Objtype, vec2 Pos, int ProximityRadius=0);
@@ -70,8 +102,11 @@ public:
 	float GetProximityRadius() const	{ return m_ProximityRadius; }
 	bool IsMarkedForDestroy() const		{ return m_MarkedForDestroy; }
 
+	bool IsAlwaysRelevant() const		{ return m_AlwaysRelevant; }
+
 	/* Setters */
 	void MarkForDestroy()				{ m_MarkedForDestroy = true; }
+	void SetAlwaysRelevant(bool AlwaysRelevant) { m_AlwaysRelevant = AlwaysRelevant; }
 
 	/* Other functions */
 
@@ -120,6 +155,43 @@ public:
 	*/
 	virtual void Snap(int SnappingClient) {}
 
+	/*
+		Function: SnapShared
+			Called once per snapshot before any client snap. Entities
+			that look the same for every client add their item here
+			with SnapNewSharedItem instead of in Snap.
+
+		Returns:
+			True if the entity is handled by the shared snapshot and
+			Snap must not be called for it.
+	*/
+	virtual bool SnapShared() { return false; }
+
+	/*
+		Function: SharedClipped
+			Visibility test for the item added in SnapShared.
+
+		Arguments:
+			SnappingClient - ID of the client which snapshot is
+				being generated.
+
+		Returns:
+			True if the item should be left out of the client's snapshot.
+	*/
+	virtual bool SharedClipped(int SnappingClient) { return NetworkClipped(SnappingClient); }
+
+	/*
+		Function: SnapArea
+			Circle around everything the entity puts into snapshots.
+			Clients only get the entity when their view overlaps it,
+			Snap and SharedClipped still decide in the end.
+
+		Arguments:
+			pCenter - Set to the center of the circle.
+			pRadius - Set to the radius of the circle.
+	*/
+	virtual void SnapArea(vec2 *pCenter, float *pRadius) { *pCenter = m_Pos; *pRadius = 0.0f; }
+
 	virtual void PostSnap() {}
 
 	/*
@@ -135,6 +207,7 @@ public:
 
 		Returns:
 			Non-zero if the entity doesn't have to be in the snapshot.
+			Always zero for entities that are always relevant.
 	*/
 	int NetworkClipped(int SnappingClient);
 	int NetworkClipped(int SnappingClient, vec2 CheckPos);
@@ -42,19 +42,33 @@ void CEventHandler::Clear()
 	m_CurrentOffset = 0;
 }
 
+void CEventHandler::SnapShared()
+{
+	for(int i = 0; i < m_NumEvents; i++)
+	{
+		m_aSnapItems[i] = GameServer()->Server()->SnapNumItems();
+		void *d = GameServer()->Server()->SnapNewItem(m_aTypes[i], i, m_aSizes[i]);
+		if(d)
+			mem_copy(d, &m_aData[m_aOffsets[i]], m_aSizes[i]);
+		else
+			m_aSnapItems[i] = -1;
+	}
+}
+
 void CEventHandler::Snap(int SnappingClient)
 {
+	// the events are in the shared snapshot, hide the ones this client shouldn't get
+	if(SnappingClient == -1)
+		return;
+
 	for(int i = 0; i < m_NumEvents; i++)
 	{
-		if(SnappingClient == -1 || CmaskIsSet(m_aClientMasks[i], SnappingClient))
-		{
-			CNetEvent_Common *ev = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
-			if(SnappingClient == -1 || distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, vec2(ev->m_X, ev->m_Y)) < 1500.0f)
-			{
-				void *d = GameServer()->Server()->SnapNewItem(m_aTypes[i], i, m_aSizes[i]);
-				if(d)
-					mem_copy(d, &m_aData[m_aOffsets[i]], m_aSizes[i]);
-			}
-		}
+		if(m_aSnapItems[i] == -1)
+			continue;
+
+		CNetEvent_Common *ev = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
+		if(!CmaskIsSet(m_aClientMasks[i], SnappingClient) ||
+			distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, vec2(ev->m_X, ev->m_Y)) >= 1500.0f)
+			GameServer()->Server()->SnapSkipItem(m_aSnapItems[i]);
 	}
 }
@@ -13,6 +13,7 @@ class CEventHandler
 	int m_aOffsets[MAX_EVENTS];
 	int m_aSizes[MAX_EVENTS];
 	int64 m_aClientMasks[MAX_EVENTS];
+	int m_aSnapItems[MAX_EVENTS];
 	char m_aData[MAX_DATASIZE];
 
 	class CGameContext *m_pGameServer;
@@ -26,6 +27,7 @@ public:
 	CEventHandler();
 	void *Create(int Type, int Size, int64 Mask = -1);
 	void Clear();
+	void SnapShared();
 	void Snap(int SnappingClient);
 };
 
@@ -4,6 +4,7 @@
 
 #include <engine/shared/config.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/perf.h>
 #include <engine/storage.h>
 #include <engine/map.h>
 
@@ -540,23 +541,35 @@ void CGameContext::OnTick()
 	// check tuning
 	CheckPureTuning();
 
+	CPerfTimers *pPerfTimers = Server()->PerfTimers();
+
 	// copy tuning
 	m_World.m_Core.m_Tuning = m_Tuning;
-	m_World.Tick();
+	{
+		CPerfScope Scope(pPerfTimers, m_aPerfSections[PERF_WORLD]);
+		m_World.Tick();
+	}
 
 	//if(world.paused) // make sure that the game object always updates
-	m_pController->Tick();
+	{
+		CPerfScope Scope(pPerfTimers, m_aPerfSections[PERF_CONTROLLER]);
+		m_pController->Tick();
+	}
 
-	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
-		if(m_apPlayers[i])
+		CPerfScope Scope(pPerfTimers, m_aPerfSections[PERF_PLAYERS]);
+		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
-			m_apPlayers[i]->Tick();
-			m_apPlayers[i]->PostTick();
+			if(m_apPlayers[i])
+			{
+				m_apPlayers[i]->Tick();
+				m_apPlayers[i]->PostTick();
+			}
 		}
 	}
 
 	// update voting
+	int64 VoteStart = pPerfTimers->Enabled() ? time_get() : 0;
 	if(m_VoteCloseTime)
 	{
 		// abort the kick-vote on player-leave
@@ -623,6 +636,9 @@ void CGameContext::OnTick()
 		}
 	}
 
+	if(pPerfTimers->Enabled())
+		pPerfTimers->Add(m_aPerfSections[PERF_VOTES], time_get()-VoteStart);
+
 
 #ifdef CONF_DEBUG
 	for(int i = 0; i < MAX_CLIENTS; i++)
@@ -1246,6 +1262,19 @@ void CGameContext::ConTunes(IConsole::IResult *pResult, void *pUserData)
 	}
 }
 
+void CGameContext::ConEntityPools(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	char aBuf[256];
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "alloc", "pool          slot  live  peak slabs     allocs");
+	for(const CSlabPool *pPool = CSlabPool::First(); pPool; pPool = pPool->Next())
+	{
+		str_format(aBuf, sizeof(aBuf), "%-12s %5d %5d %5d %5d %10lld", pPool->Name(), pPool->SlotSize(),
+			pPool->NumLive(), pPool->PeakLive(), pPool->NumSlabs(), pPool->NumAllocs());
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "alloc", aBuf);
+	}
+}
+
 void CGameContext::ConPause(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *)pUserData;
@@ -1564,6 +1593,7 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("tune", "s[tuning] ?i[value]", CFGFLAG_SERVER, ConTuneParam, this, "Tune variable to value or show current value");
 	Console()->Register("tune_reset", "?s[tuning]", CFGFLAG_SERVER, ConTuneReset, this, "Reset all or one tuning variable to default");
 	Console()->Register("tunes", "", CFGFLAG_SERVER, ConTunes, this, "List all tuning variables and their values");
+	Console()->Register("entity_pools", "", CFGFLAG_SERVER, ConEntityPools, this, "Show the allocation statistics of the entity pools");
 
 	Console()->Register("pause", "?i[seconds]", CFGFLAG_SERVER|CFGFLAG_STORE, ConPause, this, "Pause/unpause game");
 	Console()->Register("change_map", "?r[map]", CFGFLAG_SERVER|CFGFLAG_STORE, ConChangeMap, this, "Change map");
@@ -1602,6 +1632,12 @@ void CGameContext::OnInit()
 	m_pConfig = Kernel()->RequestInterface<IConfigManager>()->Values();
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
+
+	m_aPerfSections[PERF_WORLD] = Server()->PerfTimers()->Register("tick.game.world");
+	m_aPerfSections[PERF_CONTROLLER] = Server()->PerfTimers()->Register("tick.game.controller");
+	m_aPerfSections[PERF_PLAYERS] = Server()->PerfTimers()->Register("tick.game.players");
+	m_aPerfSections[PERF_VOTES] = Server()->PerfTimers()->Register("tick.game.votes");
+
 	m_World.SetGameServer(this);
 	m_Events.SetGameServer(this);
 	m_CommandManager.Init(m_pConsole, this, NewCommandHook, RemoveCommandHook);
@@ -1614,6 +1650,7 @@ void CGameContext::OnInit()
 
 	m_Layers.Init(Kernel());
 	m_Collision.Init(&m_Layers);
+	m_World.InitGrid(m_Collision.GetWidth(), m_Collision.GetHeight());
 
 	// select gametype
 	if(str_comp_nocase(Config()->m_SvGametype, "mod") == 0)
@@ -1682,6 +1719,16 @@ void CGameContext::OnShutdown()
 	delete m_pController;
 	m_pController = 0;
 	Clear();
+
+	// all entities are gone with the world, start the next map with empty pools
+	CSlabPool::ResetAll();
+}
+
+void CGameContext::OnSnapShared()
+{
+	m_World.SnapShared();
+	m_pController->SnapShared();
+	m_Events.SnapShared();
 }
 
 void CGameContext::OnSnap(int ClientID)
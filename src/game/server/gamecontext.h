@@ -45,9 +45,20 @@ class CGameContext : public IGameServer
 	CNetObjHandler m_NetObjHandler;
 	CTuningParams m_Tuning;
 
+	enum
+	{
+		PERF_WORLD=0,
+		PERF_CONTROLLER,
+		PERF_PLAYERS,
+		PERF_VOTES,
+		NUM_PERF_SECTIONS
+	};
+	int m_aPerfSections[NUM_PERF_SECTIONS];
+
 	static void ConTuneParam(IConsole::IResult *pResult, void *pUserData);
 	static void ConTuneReset(IConsole::IResult *pResult, void *pUserData);
 	static void ConTunes(IConsole::IResult *pResult, void *pUserData);
+	static void ConEntityPools(IConsole::IResult *pResult, void *pUserData);
 	static void ConPause(IConsole::IResult *pResult, void *pUserData);
 	static void ConChangeMap(IConsole::IResult *pResult, void *pUserData);
 	static void ConRestart(IConsole::IResult *pResult, void *pUserData);
@@ -177,6 +188,7 @@ public:
 
 	virtual void OnTick();
 	virtual void OnPreSnap();
+	virtual void OnSnapShared();
 	virtual void OnSnap(int ClientID);
 	virtual void OnPostSnap();
 
@@ -670,7 +670,7 @@ void IGameController::SwapTeamscore()
 }
 
 // general
-void IGameController::Snap(int SnappingClient)
+void IGameController::SnapShared()
 {
 	CNetObj_GameData *pGameData = static_cast<CNetObj_GameData *>(Server()->SnapNewItem(NETOBJTYPE_GAMEDATA, 0, sizeof(CNetObj_GameData)));
 	if(!pGameData)
@@ -721,7 +721,10 @@ void IGameController::Snap(int SnappingClient)
 		pGameDataTeam->m_TeamscoreRed = m_aTeamscore[TEAM_RED];
 		pGameDataTeam->m_TeamscoreBlue = m_aTeamscore[TEAM_BLUE];
 	}
+}
 
+void IGameController::Snap(int SnappingClient)
+{
 	// demo recording
 	if(SnappingClient == -1)
 	{
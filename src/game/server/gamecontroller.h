@@ -196,6 +196,7 @@ public:
 	void SwapTeamscore();
 
 	// general
+	virtual void SnapShared();
 	virtual void Snap(int SnappingClient);
 	virtual void Tick();
 
@@ -6,6 +6,7 @@
 #include "gamecontext.h"
 #include "gamecontroller.h"
 #include "gameworld.h"
+#include "player.h"
 
 
 //////////////////////////////////////////////////
@@ -21,6 +22,8 @@ CGameWorld::CGameWorld()
 	m_ResetRequested = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		m_apFirstEntityTypes[i] = 0;
+
+	m_pFirstAlwaysRelevant = 0;
 }
 
 CGameWorld::~CGameWorld()
@@ -38,6 +41,13 @@ void CGameWorld::SetGameServer(CGameContext *pGameServer)
 	m_pServer = m_pGameServer->Server();
 }
 
+void CGameWorld::InitGrid(int Width, int Height)
+{
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		m_aGrids[i].Init(Width*32.0f, Height*32.0f, GRID_CELL_SIZE);
+	m_SnapGrid.Init(Width*32.0f, Height*32.0f, SNAP_GRID_CELL_SIZE);
+}
+
 CEntity *CGameWorld::FindFirst(int Type)
 {
 	return Type < 0 || Type >= NUM_ENTTYPES ? 0 : m_apFirstEntityTypes[Type];
@@ -48,20 +58,7 @@ int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max,
 	if(Type < 0 || Type >= NUM_ENTTYPES)
 		return 0;
 
-	int Num = 0;
-	for(CEntity *pEnt = m_apFirstEntityTypes[Type];	pEnt; pEnt = pEnt->m_pNextTypeEntity)
-	{
-		if(distance(pEnt->m_Pos, Pos) < Radius+pEnt->m_ProximityRadius)
-		{
-			if(ppEnts)
-				ppEnts[Num] = pEnt;
-			Num++;
-			if(Num == Max)
-				break;
-		}
-	}
-
-	return Num;
+	return m_aGrids[Type].FindItems(Pos, Radius, (void **)ppEnts, Max);
 }
 
 void CGameWorld::InsertEntity(CEntity *pEnt)
@@ -77,6 +74,8 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = 0x0;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+
+	m_aGrids[pEnt->m_ObjType].Insert(&pEnt->m_GridNode, pEnt, pEnt->m_Pos, pEnt->m_ProximityRadius);
 }
 
 void CGameWorld::DestroyEntity(CEntity *pEnt)
@@ -86,6 +85,9 @@ void CGameWorld::DestroyEntity(CEntity *pEnt)
 
 void CGameWorld::RemoveEntity(CEntity *pEnt)
 {
+	m_aGrids[pEnt->m_ObjType].Remove(&pEnt->m_GridNode);
+	m_SnapGrid.Remove(&pEnt->m_SnapNode);
+
 	// not in the list
 	if(!pEnt->m_pNextTypeEntity && !pEnt->m_pPrevTypeEntity && m_apFirstEntityTypes[pEnt->m_ObjType] != pEnt)
 		return;
@@ -106,14 +108,81 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 	pEnt->m_pPrevTypeEntity = 0;
 }
 
+void CGameWorld::UpdateSnapArea(CEntity *pEnt)
+{
+	// shared entities without an item have nothing to show
+	if(pEnt->m_AlwaysRelevant || (pEnt->m_SnappedShared && pEnt->m_SharedSnapItem == -1))
+	{
+		m_SnapGrid.Remove(&pEnt->m_SnapNode);
+		if(pEnt->m_AlwaysRelevant)
+		{
+			pEnt->m_pNextAlwaysRelevant = m_pFirstAlwaysRelevant;
+			m_pFirstAlwaysRelevant = pEnt;
+		}
+		return;
+	}
+
+	vec2 Center;
+	float Radius;
+	pEnt->SnapArea(&Center, &Radius);
+	if(pEnt->m_SnapNode.InGrid())
+		m_SnapGrid.Move(&pEnt->m_SnapNode, Center, Radius);
+	else
+		m_SnapGrid.Insert(&pEnt->m_SnapNode, pEnt, Center, Radius);
+}
+
 //
+void CGameWorld::SnapShared()
+{
+	m_pFirstAlwaysRelevant = 0;
+	int FirstSharedItem = Server()->SnapNumItems();
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
+		{
+			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
+			pEnt->m_SharedSnapItem = -1;
+			pEnt->m_SnappedShared = pEnt->SnapShared();
+			UpdateSnapArea(pEnt);
+			pEnt = m_pNextTraverseEntity;
+		}
+
+	// the items are left out of each client's snapshot unless a visible entity takes its item back
+	Server()->SnapHideItems(FirstSharedItem, Server()->SnapNumItems()-FirstSharedItem);
+}
+
+void CGameWorld::SnapEntity(CEntity *pEnt, int SnappingClient)
+{
+	if(!pEnt->m_SnappedShared)
+		pEnt->Snap(SnappingClient);
+	else if(pEnt->m_SharedSnapItem != -1 && (SnappingClient == -1 || !pEnt->SharedClipped(SnappingClient)))
+		Server()->SnapKeepItem(pEnt->m_SharedSnapItem);
+}
+
 void CGameWorld::Snap(int SnappingClient)
 {
+	int Num = -1;
+	if(SnappingClient != -1)
+	{
+		vec2 ViewPos = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos;
+		vec2 ViewRange(VIEW_RANGE_X+1.0f, VIEW_RANGE_Y+1.0f);
+		Num = m_SnapGrid.FindItemsInRect(ViewPos-ViewRange, ViewPos+ViewRange, (void **)m_apSnapEntities, MAX_SNAP_ENTITIES);
+	}
+
+	if(Num != -1 && Num < MAX_SNAP_ENTITIES)
+	{
+		for(int i = 0; i < Num; i++)
+			SnapEntity(m_apSnapEntities[i], SnappingClient);
+		for(CEntity *pEnt = m_pFirstAlwaysRelevant; pEnt; pEnt = pEnt->m_pNextAlwaysRelevant)
+			SnapEntity(pEnt, SnappingClient);
+		return;
+	}
+
+	// the demo and crowded views go through everything
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 		{
 			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-			pEnt->Snap(SnappingClient);
+			SnapEntity(pEnt, SnappingClient);
 			pEnt = m_pNextTraverseEntity;
 		}
 }
@@ -207,55 +276,15 @@ void CGameWorld::Tick()
 CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, vec2& NewPos, CEntity *pNotThis)
 {
 	// Find other players
-	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
-	CCharacter *pClosest = 0;
-
-	CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *)p->TypeNext())
- 	{
-		if(p == pNotThis)
-			continue;
-
-		vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, p->m_Pos);
-		float Len = distance(p->m_Pos, IntersectPos);
-		if(Len < p->m_ProximityRadius+Radius)
-		{
-			Len = distance(Pos0, IntersectPos);
-			if(Len < ClosestLen)
-			{
-				NewPos = IntersectPos;
-				ClosestLen = Len;
-				pClosest = p;
-			}
-		}
-	}
-
-	return pClosest;
+	return (CCharacter *)m_aGrids[ENTTYPE_CHARACTER].IntersectItem(Pos0, Pos1, Radius, &NewPos, pNotThis);
 }
 
 
 CEntity *CGameWorld::ClosestEntity(vec2 Pos, float Radius, int Type, CEntity *pNotThis)
 {
-	// Find other players
-	float ClosestRange = Radius*2;
-	CEntity *pClosest = 0;
-
-	CEntity *p = FindFirst(Type);
-	for(; p; p = p->TypeNext())
- 	{
-		if(p == pNotThis)
-			continue;
-
-		float Len = distance(Pos, p->m_Pos);
-		if(Len < p->m_ProximityRadius+Radius)
-		{
-			if(Len < ClosestRange)
-			{
-				ClosestRange = Len;
-				pClosest = p;
-			}
-		}
-	}
+	if(Type < 0 || Type >= NUM_ENTTYPES)
+		return 0;
 
-	return pClosest;
+	// Find other players
+	return (CEntity *)m_aGrids[Type].ClosestItem(Pos, Radius, pNotThis);
 }
@@ -4,6 +4,7 @@
 #define GAME_SERVER_GAMEWORLD_H
 
 #include <game/gamecore.h>
+#include <game/spatialgrid.h>
 
 class CEntity;
 class CCharacter;
@@ -26,12 +27,37 @@ public:
 		NUM_ENTTYPES
 	};
 
+	// how far a client can see from its view position, see CEntity::NetworkClipped
+	enum
+	{
+		VIEW_RANGE_X=1000,
+		VIEW_RANGE_Y=800,
+	};
+
 private:
+	friend class CEntity; // for grid updates
+
+	enum
+	{
+		GRID_CELL_SIZE=256,
+		SNAP_GRID_CELL_SIZE=512,
+		MAX_SNAP_ENTITIES=1024,
+	};
+
 	void Reset();
 	void RemoveEntities();
+	void UpdateSnapArea(CEntity *pEnt);
+	void SnapEntity(CEntity *pEnt, int SnappingClient);
 
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
+	CSpatialGrid m_aGrids[NUM_ENTTYPES];
+
+	// interest management: the snap areas of all entities that are in
+	// the shared snapshot or snap per client, and the ones every client gets
+	CSpatialGrid m_SnapGrid;
+	CEntity *m_pFirstAlwaysRelevant;
+	CEntity *m_apSnapEntities[MAX_SNAP_ENTITIES];
 
 	class CGameContext *m_pGameServer;
 	class CConfig *m_pConfig;
@@ -51,6 +77,13 @@ public:
 
 	void SetGameServer(CGameContext *pGameServer);
 
+	/*
+		Function: InitGrid
+			Sets up the spatial grids used by the entity queries
+			for a map of the given size in tiles.
+	*/
+	void InitGrid(int Width, int Height);
+
 	CEntity *FindFirst(int Type);
 
 	/*
@@ -128,10 +161,18 @@ public:
 	*/
 	void DestroyEntity(CEntity *pEntity);
 
+	/*
+		Function: snap_shared
+			Calls snap_shared on all the entities in the world to
+			create the part of the snapshot shared by all clients.
+	*/
+	void SnapShared();
+
 	/*
 		Function: snap
-			Calls snap on all the entities in the world to create
-			the snapshot.
+			Calls snap on the entities in the world the client can
+			see and the ones that are always relevant to create the
+			snapshot. Everything is snapped for the demo recording.
 
 		Arguments:
 			snapping_client - ID of the client which snapshot
@@ -0,0 +1,336 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include "spatialgrid.h"
+
+CSpatialGrid::CSpatialGrid()
+{
+	m_CellSize = 1.0f;
+	m_Width = 1;
+	m_Height = 1;
+	m_apCells = new CNode*[2];
+	m_apCells[0] = 0;
+	m_apCells[1] = 0;
+
+	m_pFirstItem = 0;
+	m_NumItems = 0;
+	m_NextSeq = 0;
+	m_LargeRadius = 0.0f;
+}
+
+CSpatialGrid::~CSpatialGrid()
+{
+	delete[] m_apCells;
+}
+
+void CSpatialGrid::Init(float Width, float Height, float CellSize)
+{
+	m_CellSize = CellSize;
+	m_Width = maximum(1, (int)(Width/CellSize)+1);
+	m_Height = maximum(1, (int)(Height/CellSize)+1);
+	m_LargeRadius = CellSize/8;
+	delete[] m_apCells;
+	m_apCells = new CNode*[m_Width*m_Height+1];
+	for(int i = 0; i <= m_Width*m_Height; i++)
+		m_apCells[i] = 0;
+
+	// resort the items, walking the item list backwards keeps the cells sorted
+	CNode *pLast = m_pFirstItem;
+	while(pLast && pLast->m_pNextItem)
+		pLast = pLast->m_pNextItem;
+	for(CNode *pNode = pLast; pNode; pNode = pNode->m_pPrevItem)
+	{
+		int Cell = CellIndex(pNode->m_Pos, pNode->m_Radius);
+		pNode->m_Cell = Cell;
+		pNode->m_pPrevCell = 0;
+		pNode->m_pNextCell = m_apCells[Cell];
+		if(m_apCells[Cell])
+			m_apCells[Cell]->m_pPrevCell = pNode;
+		m_apCells[Cell] = pNode;
+	}
+}
+
+int CSpatialGrid::CellCoord(float Value, int Size) const
+{
+	float Cell = Value/m_CellSize;
+	// also catches nan
+	if(!(Cell > 0.0f))
+		return 0;
+	if(Cell >= (float)(Size-1))
+		return Size-1;
+	return (int)Cell;
+}
+
+int CSpatialGrid::CellRange(vec2 Min, vec2 Max, int *pX0, int *pY0, int *pX1, int *pY1) const
+{
+	*pX0 = CellCoord(Min.x, m_Width);
+	*pY0 = CellCoord(Min.y, m_Height);
+	*pX1 = CellCoord(Max.x, m_Width);
+	*pY1 = CellCoord(Max.y, m_Height);
+	return (*pX1-*pX0+1)*(*pY1-*pY0+1);
+}
+
+void CSpatialGrid::LinkCell(CNode *pNode, int Cell)
+{
+	// find the first older node, nodes moving in are usually the newest
+	CNode *pPrev = 0;
+	CNode *pNext = m_apCells[Cell];
+	while(pNext && pNext->m_Seq > pNode->m_Seq)
+	{
+		pPrev = pNext;
+		pNext = pNext->m_pNextCell;
+	}
+
+	pNode->m_Cell = Cell;
+	pNode->m_pPrevCell = pPrev;
+	pNode->m_pNextCell = pNext;
+	if(pPrev)
+		pPrev->m_pNextCell = pNode;
+	else
+		m_apCells[Cell] = pNode;
+	if(pNext)
+		pNext->m_pPrevCell = pNode;
+}
+
+void CSpatialGrid::UnlinkCell(CNode *pNode)
+{
+	if(pNode->m_pPrevCell)
+		pNode->m_pPrevCell->m_pNextCell = pNode->m_pNextCell;
+	else
+		m_apCells[pNode->m_Cell] = pNode->m_pNextCell;
+	if(pNode->m_pNextCell)
+		pNode->m_pNextCell->m_pPrevCell = pNode->m_pPrevCell;
+	pNode->m_Cell = -1;
+}
+
+void CSpatialGrid::Insert(CNode *pNode, void *pItem, vec2 Pos, float Radius)
+{
+	dbg_assert(!pNode->InGrid(), "node already in a grid");
+
+	pNode->m_pItem = pItem;
+	pNode->m_Pos = Pos;
+	pNode->m_Radius = Radius;
+	pNode->m_Seq = m_NextSeq++;
+
+	pNode->m_pPrevItem = 0;
+	pNode->m_pNextItem = m_pFirstItem;
+	if(m_pFirstItem)
+		m_pFirstItem->m_pPrevItem = pNode;
+	m_pFirstItem = pNode;
+	m_NumItems++;
+
+	LinkCell(pNode, CellIndex(Pos, Radius));
+}
+
+void CSpatialGrid::Remove(CNode *pNode)
+{
+	if(!pNode->InGrid())
+		return;
+
+	UnlinkCell(pNode);
+
+	if(pNode->m_pPrevItem)
+		pNode->m_pPrevItem->m_pNextItem = pNode->m_pNextItem;
+	else
+		m_pFirstItem = pNode->m_pNextItem;
+	if(pNode->m_pNextItem)
+		pNode->m_pNextItem->m_pPrevItem = pNode->m_pPrevItem;
+	m_NumItems--;
+}
+
+void CSpatialGrid::Move(CNode *pNode, vec2 Pos)
+{
+	if(!pNode->InGrid())
+		return;
+
+	pNode->m_Pos = Pos;
+	int Cell = CellIndex(Pos, pNode->m_Radius);
+	if(Cell != pNode->m_Cell)
+	{
+		UnlinkCell(pNode);
+		LinkCell(pNode, Cell);
+	}
+}
+
+void CSpatialGrid::Move(CNode *pNode, vec2 Pos, float Radius)
+{
+	if(!pNode->InGrid())
+		return;
+
+	pNode->m_Radius = Radius;
+	Move(pNode, Pos);
+}
+
+int CSpatialGrid::FindItems(vec2 Pos, float Radius, void **ppItems, int Max) const
+{
+	// one extra unit so float rounding can't put an item outside of the range
+	float Range = Radius+m_LargeRadius+1.0f;
+	int X0, Y0, X1, Y1;
+	int NumCells = CellRange(Pos-vec2(Range, Range), Pos+vec2(Range, Range), &X0, &Y0, &X1, &Y1);
+
+	int Num = 0;
+	if(NumCells > MAX_MERGE_CELLS || NumCells > m_NumItems)
+	{
+		for(CNode *pNode = m_pFirstItem; pNode; pNode = pNode->m_pNextItem)
+		{
+			if(distance(pNode->m_Pos, Pos) < Radius+pNode->m_Radius)
+			{
+				if(ppItems)
+					ppItems[Num] = pNode->m_pItem;
+				Num++;
+				if(Num == Max)
+					break;
+			}
+		}
+		return Num;
+	}
+
+	// merge the cells newest first so the result is cut off at the same item
+	CNode *apCursors[MAX_MERGE_CELLS+1];
+	int NumCursors = 0;
+	for(int y = Y0; y <= Y1; y++)
+		for(int x = X0; x <= X1; x++)
+			if(m_apCells[y*m_Width+x])
+				apCursors[NumCursors++] = m_apCells[y*m_Width+x];
+	if(m_apCells[LargeCell()])
+		apCursors[NumCursors++] = m_apCells[LargeCell()];
+
+	while(NumCursors)
+	{
+		int Newest = 0;
+		for(int i = 1; i < NumCursors; i++)
+			if(apCursors[i]->m_Seq > apCursors[Newest]->m_Seq)
+				Newest = i;
+
+		CNode *pNode = apCursors[Newest];
+		if(pNode->m_pNextCell)
+			apCursors[Newest] = pNode->m_pNextCell;
+		else
+			apCursors[Newest] = apCursors[--NumCursors];
+
+		if(distance(pNode->m_Pos, Pos) < Radius+pNode->m_Radius)
+		{
+			if(ppItems)
+				ppItems[Num] = pNode->m_pItem;
+			Num++;
+			if(Num == Max)
+				break;
+		}
+	}
+	return Num;
+}
+
+int CSpatialGrid::FindItemsInRect(const CNode *pFirst, bool Linear, vec2 Min, vec2 Max, void **ppItems, int Num, int MaxItems) const
+{
+	for(const CNode *pNode = pFirst; pNode && Num < MaxItems; pNode = Linear ? pNode->m_pNextItem : pNode->m_pNextCell)
+	{
+		// distance from the closest point of the rectangle
+		vec2 Closest(clamp(pNode->m_Pos.x, Min.x, Max.x), clamp(pNode->m_Pos.y, Min.y, Max.y));
+		if(distance(pNode->m_Pos, Closest) <= pNode->m_Radius)
+			ppItems[Num++] = pNode->m_pItem;
+	}
+	return Num;
+}
+
+int CSpatialGrid::FindItemsInRect(vec2 Min, vec2 Max, void **ppItems, int MaxItems) const
+{
+	float Range = m_LargeRadius+1.0f;
+	int X0, Y0, X1, Y1;
+	int NumCells = CellRange(Min-vec2(Range, Range), Max+vec2(Range, Range), &X0, &Y0, &X1, &Y1);
+	// walk the item list once instead if that's less work
+	if(NumCells > m_NumItems)
+		return FindItemsInRect(m_pFirstItem, true, Min, Max, ppItems, 0, MaxItems);
+
+	int Num = FindItemsInRect(m_apCells[LargeCell()], false, Min, Max, ppItems, 0, MaxItems);
+	for(int y = Y0; y <= Y1; y++)
+		for(int x = X0; x <= X1; x++)
+			Num = FindItemsInRect(m_apCells[y*m_Width+x], false, Min, Max, ppItems, Num, MaxItems);
+	return Num;
+}
+
+void CSpatialGrid::ClosestItem(const CNode *pFirst, bool Linear, vec2 Pos, float Radius, const void *pNotThis, float *pClosestRange, const CNode **ppClosest) const
+{
+	for(const CNode *pNode = pFirst; pNode; pNode = Linear ? pNode->m_pNextItem : pNode->m_pNextCell)
+	{
+		if(pNode->m_pItem == pNotThis)
+			continue;
+
+		// ties go to the newest item like in the linear walk
+		float Len = distance(Pos, pNode->m_Pos);
+		if(Len < pNode->m_Radius+Radius && (Len < *pClosestRange || (*ppClosest && Len == *pClosestRange && pNode->m_Seq > (*ppClosest)->m_Seq)))
+		{
+			*pClosestRange = Len;
+			*ppClosest = pNode;
+		}
+	}
+}
+
+void *CSpatialGrid::ClosestItem(vec2 Pos, float Radius, const void *pNotThis) const
+{
+	float Range = Radius+m_LargeRadius+1.0f;
+	int X0, Y0, X1, Y1;
+	int NumCells = CellRange(Pos-vec2(Range, Range), Pos+vec2(Range, Range), &X0, &Y0, &X1, &Y1);
+
+	float ClosestRange = Radius*2;
+	const CNode *pClosest = 0;
+	// walk the item list once instead if that's less work
+	if(NumCells > m_NumItems)
+		ClosestItem(m_pFirstItem, true, Pos, Radius, pNotThis, &ClosestRange, &pClosest);
+	else
+	{
+		ClosestItem(m_apCells[LargeCell()], false, Pos, Radius, pNotThis, &ClosestRange, &pClosest);
+		for(int y = Y0; y <= Y1; y++)
+			for(int x = X0; x <= X1; x++)
+				ClosestItem(m_apCells[y*m_Width+x], false, Pos, Radius, pNotThis, &ClosestRange, &pClosest);
+	}
+
+	return pClosest ? pClosest->m_pItem : 0;
+}
+
+void CSpatialGrid::IntersectItem(const CNode *pFirst, bool Linear, vec2 Pos0, vec2 Pos1, float Radius, vec2 *pNewPos, const void *pNotThis, float *pClosestLen, const CNode **ppClosest) const
+{
+	for(const CNode *pNode = pFirst; pNode; pNode = Linear ? pNode->m_pNextItem : pNode->m_pNextCell)
+	{
+		if(pNode->m_pItem == pNotThis)
+			continue;
+
+		vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, pNode->m_Pos);
+		float Len = distance(pNode->m_Pos, IntersectPos);
+		if(Len < pNode->m_Radius+Radius)
+		{
+			Len = distance(Pos0, IntersectPos);
+			if(Len < *pClosestLen || (*ppClosest && Len == *pClosestLen && pNode->m_Seq > (*ppClosest)->m_Seq))
+			{
+				*pNewPos = IntersectPos;
+				*pClosestLen = Len;
+				*ppClosest = pNode;
+			}
+		}
+	}
+}
+
+void *CSpatialGrid::IntersectItem(vec2 Pos0, vec2 Pos1, float Radius, vec2 *pNewPos, const void *pNotThis) const
+{
+	float Range = Radius+m_LargeRadius+1.0f;
+	vec2 Min(minimum(Pos0.x, Pos1.x)-Range, minimum(Pos0.y, Pos1.y)-Range);
+	vec2 Max(maximum(Pos0.x, Pos1.x)+Range, maximum(Pos0.y, Pos1.y)+Range);
+	int X0, Y0, X1, Y1;
+	int NumCells = CellRange(Min, Max, &X0, &Y0, &X1, &Y1);
+
+	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
+	const CNode *pClosest = 0;
+	// walk the item list once instead if that's less work
+	if(NumCells > m_NumItems)
+		IntersectItem(m_pFirstItem, true, Pos0, Pos1, Radius, pNewPos, pNotThis, &ClosestLen, &pClosest);
+	else
+	{
+		IntersectItem(m_apCells[LargeCell()], false, Pos0, Pos1, Radius, pNewPos, pNotThis, &ClosestLen, &pClosest);
+		for(int y = Y0; y <= Y1; y++)
+			for(int x = X0; x <= X1; x++)
+				IntersectItem(m_apCells[y*m_Width+x], false, Pos0, Pos1, Radius, pNewPos, pNotThis, &ClosestLen, &pClosest);
+	}
+
+	return pClosest ? pClosest->m_pItem : 0;
+}
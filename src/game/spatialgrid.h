@@ -0,0 +1,151 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_SPATIALGRID_H
+#define GAME_SPATIALGRID_H
+
+#include <base/vmath.h>
+
+/*
+	Class: CSpatialGrid
+		Uniform grid over the map that sorts items into cells by their
+		position, so proximity queries only have to look at the cells
+		around the query instead of every item. Items outside of the
+		map are kept in the border cells. Items with a large radius,
+		like long laser beams, are kept in an extra list that every
+		query walks, so they don't widen the cell range of all queries.
+
+		Results are exactly the ones of a linear walk over all items,
+		newest first, including the order and the tie breaking.
+*/
+class CSpatialGrid
+{
+public:
+	class CNode
+	{
+		friend class CSpatialGrid;
+
+		void *m_pItem;
+		vec2 m_Pos;
+		float m_Radius;
+		int m_Seq;
+		int m_Cell;
+
+		// cell lists are sorted newest first like the item list
+		CNode *m_pPrevCell;
+		CNode *m_pNextCell;
+		CNode *m_pPrevItem;
+		CNode *m_pNextItem;
+
+	public:
+		CNode() : m_Cell(-1) {}
+		bool InGrid() const { return m_Cell != -1; }
+	};
+
+private:
+	enum
+	{
+		MAX_MERGE_CELLS=64,
+	};
+
+	float m_CellSize;
+	int m_Width;
+	int m_Height;
+	CNode **m_apCells;
+
+	CNode *m_pFirstItem;
+	int m_NumItems;
+	int m_NextSeq;
+
+	// items above this radius are in the large cell after the grid cells
+	float m_LargeRadius;
+
+	int CellCoord(float Value, int Size) const;
+	int CellIndex(vec2 Pos) const { return CellCoord(Pos.y, m_Height)*m_Width + CellCoord(Pos.x, m_Width); }
+	int CellIndex(vec2 Pos, float Radius) const { return Radius > m_LargeRadius ? LargeCell() : CellIndex(Pos); }
+	int LargeCell() const { return m_Width*m_Height; }
+	int CellRange(vec2 Min, vec2 Max, int *pX0, int *pY0, int *pX1, int *pY1) const;
+	void LinkCell(CNode *pNode, int Cell);
+	void UnlinkCell(CNode *pNode);
+
+	// the query parts for one list, the cell list or all items when Linear
+	int FindItemsInRect(const CNode *pFirst, bool Linear, vec2 Min, vec2 Max, void **ppItems, int Num, int MaxItems) const;
+	void ClosestItem(const CNode *pFirst, bool Linear, vec2 Pos, float Radius, const void *pNotThis, float *pClosestRange, const CNode **ppClosest) const;
+	void IntersectItem(const CNode *pFirst, bool Linear, vec2 Pos0, vec2 Pos1, float Radius, vec2 *pNewPos, const void *pNotThis, float *pClosestLen, const CNode **ppClosest) const;
+
+public:
+	CSpatialGrid();
+	~CSpatialGrid();
+
+	/*
+		Function: Init
+			Sets up the cells, items already in the grid are kept.
+
+		Arguments:
+			Width - Width of the covered area in world units.
+			Height - Height of the covered area in world units.
+			CellSize - Edge length of a cell in world units.
+	*/
+	void Init(float Width, float Height, float CellSize);
+
+	void Insert(CNode *pNode, void *pItem, vec2 Pos, float Radius);
+	void Remove(CNode *pNode);
+
+	/*
+		Function: Move
+			Updates the position of an item, does nothing for
+			nodes that aren't in the grid.
+	*/
+	void Move(CNode *pNode, vec2 Pos);
+	void Move(CNode *pNode, vec2 Pos, float Radius);
+
+	int NumItems() const { return m_NumItems; }
+
+	/*
+		Function: FindItems
+			Finds the items whose radius overlaps the circle at Pos.
+
+		Arguments:
+			Pos - Center of the circle.
+			Radius - Radius of the circle.
+			ppItems - Filled with the found items, newest first.
+				Can be null to only count them.
+			Max - Size of ppItems.
+
+		Returns:
+			Number of items found.
+	*/
+	int FindItems(vec2 Pos, float Radius, void **ppItems, int Max) const;
+
+	/*
+		Function: FindItemsInRect
+			Finds the items whose radius overlaps the rectangle from
+			Min to Max, in no particular order.
+
+		Arguments:
+			Min - Top left corner of the rectangle.
+			Max - Bottom right corner of the rectangle.
+			ppItems - Filled with the found items.
+			MaxItems - Size of ppItems.
+
+		Returns:
+			Number of items found.
+	*/
+	int FindItemsInRect(vec2 Min, vec2 Max, void **ppItems, int MaxItems) const;
+
+	/*
+		Function: ClosestItem
+			Finds the item closest to Pos whose radius overlaps the
+			circle at Pos, ignoring pNotThis.
+	*/
+	void *ClosestItem(vec2 Pos, float Radius, const void *pNotThis) const;
+
+	/*
+		Function: IntersectItem
+			Finds the item closest to Pos0 whose radius overlaps the
+			line from Pos0 to Pos1 widened by Radius, ignoring pNotThis.
+			pNewPos is set to the point of the line closest to it.
+	*/
+	void *IntersectItem(vec2 Pos0, vec2 Pos1, float Radius, vec2 *pNewPos, const void *pNotThis) const;
+};
+
+#endif
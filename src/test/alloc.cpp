@@ -0,0 +1,111 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <game/server/alloc.h>
+
+static const int OBJECT_SIZE = 100;
+
+static bool IsZero(const void *pPtr, int Size)
+{
+	for(int i = 0; i < Size; i++)
+	{
+		if(((const unsigned char *)pPtr)[i])
+			return false;
+	}
+	return true;
+}
+
+TEST(SlabPool, AllocAndFree)
+{
+	CSlabPool Pool("test", OBJECT_SIZE);
+	EXPECT_EQ(Pool.SlotSize(), 128);
+
+	// spread over several slabs, the last one only partly used
+	static const int NUM_SLOTS = 64*3+5;
+	int *apSlots[NUM_SLOTS];
+	for(int i = 0; i < NUM_SLOTS; i++)
+	{
+		apSlots[i] = (int *)Pool.Alloc(OBJECT_SIZE);
+		ASSERT_TRUE(apSlots[i]);
+		EXPECT_EQ((size_t)apSlots[i]%64, 0u);
+		EXPECT_TRUE(IsZero(apSlots[i], OBJECT_SIZE));
+		for(int j = 0; j < OBJECT_SIZE/(int)sizeof(int); j++)
+			apSlots[i][j] = i;
+	}
+	EXPECT_EQ(Pool.NumSlabs(), 4);
+	EXPECT_EQ(Pool.NumLive(), NUM_SLOTS);
+
+	// no two slots overlap
+	for(int i = 0; i < NUM_SLOTS; i++)
+	{
+		for(int j = 0; j < OBJECT_SIZE/(int)sizeof(int); j++)
+			ASSERT_EQ(apSlots[i][j], i);
+	}
+
+	// freed slots are handed out again first, zeroed, before a new slab is needed
+	Pool.Free(apSlots[10]);
+	Pool.Free(apSlots[70]);
+	EXPECT_EQ(Pool.NumLive(), NUM_SLOTS-2);
+	int *pFirst = (int *)Pool.Alloc(OBJECT_SIZE);
+	int *pSecond = (int *)Pool.Alloc(OBJECT_SIZE);
+	EXPECT_EQ(pFirst, apSlots[70]);
+	EXPECT_EQ(pSecond, apSlots[10]);
+	EXPECT_TRUE(IsZero(pFirst, OBJECT_SIZE));
+	EXPECT_TRUE(IsZero(pSecond, OBJECT_SIZE));
+	EXPECT_EQ(Pool.NumSlabs(), 4);
+	EXPECT_EQ(Pool.NumAllocs(), NUM_SLOTS+2);
+
+	// slabs stay while slots are in use
+	Pool.Reset();
+	EXPECT_EQ(Pool.NumSlabs(), 4);
+
+	Pool.Free(0);
+	for(int i = 0; i < NUM_SLOTS; i++)
+		Pool.Free(apSlots[i]);
+	EXPECT_EQ(Pool.NumLive(), 0);
+	EXPECT_EQ(Pool.PeakLive(), NUM_SLOTS);
+
+	Pool.Reset();
+	EXPECT_EQ(Pool.NumSlabs(), 0);
+	EXPECT_EQ(Pool.PeakLive(), 0);
+}
+
+TEST(SlabPool, List)
+{
+	CSlabPool *pOuter = new CSlabPool("outer", OBJECT_SIZE);
+	{
+		CSlabPool Inner("inner", OBJECT_SIZE);
+		EXPECT_EQ(CSlabPool::First(), &Inner);
+		EXPECT_EQ(Inner.Next(), pOuter);
+	}
+	EXPECT_EQ(CSlabPool::First(), pOuter);
+	delete pOuter;
+}
+
+TEST(SlabPoolDeathTest, DoubleFree)
+{
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+	CSlabPool Pool("test", OBJECT_SIZE);
+	void *pFirst = Pool.Alloc(OBJECT_SIZE);
+	void *pSecond = Pool.Alloc(OBJECT_SIZE);
+	Pool.Free(pFirst);
+	EXPECT_DEATH(Pool.Free(pFirst), "");
+	Pool.Free(pSecond);
+}
+
+TEST(SlabPoolDeathTest, ForeignPointer)
+{
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+	CSlabPool Pool("test", OBJECT_SIZE);
+	CSlabPool Other("other", OBJECT_SIZE);
+	void *pSlot = Pool.Alloc(OBJECT_SIZE);
+	void *pOtherSlot = Other.Alloc(OBJECT_SIZE);
+	int Local;
+	EXPECT_DEATH(Pool.Free(pOtherSlot), "");
+	EXPECT_DEATH(Pool.Free(&Local), "");
+	EXPECT_DEATH(Pool.Free((char *)pSlot+8), "");
+	Pool.Free(pSlot);
+	Other.Free(pOtherSlot);
+}
@@ -0,0 +1,87 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include "bench.h"
+
+CBenchConfig g_BenchConfig = { 64, 96, 24, 8, 3 };
+
+static const char *s_pFilter = 0;
+static bool s_Failed = false;
+
+void BenchRun(const char *pName, FBenchFunc pfnFunc, void *pUser)
+{
+	if(s_pFilter && !str_find(pName, s_pFilter))
+		return;
+
+	// warm up caches and branch predictors before measuring
+	pfnFunc(pUser, 1);
+
+	const int64 MinTime = time_freq() / 4;
+	int Iterations = 1;
+	while(1)
+	{
+		int64 Start = time_get();
+		int64 Bytes = pfnFunc(pUser, Iterations);
+		int64 Elapsed = time_get() - Start;
+
+		if(Elapsed >= MinTime || Iterations >= (1 << 28))
+		{
+			double NsPerOp = (double)Elapsed * 1000000000.0 / (double)time_freq() / Iterations;
+			if(Bytes)
+				dbg_msg("bench", "%-36s %10d ops %14.1f ns/op %10lld bytes/op", pName, Iterations, NsPerOp, Bytes / Iterations);
+			else
+				dbg_msg("bench", "%-36s %10d ops %14.1f ns/op", pName, Iterations, NsPerOp);
+			return;
+		}
+		Iterations *= 2;
+	}
+}
+
+void BenchFail(const char *pName, const char *pReason)
+{
+	dbg_msg("bench", "%s: FAILED: %s", pName, pReason);
+	s_Failed = true;
+}
+
+int main(int argc, const char **argv)
+{
+	cmdline_fix(&argc, &argv);
+	dbg_logger_stdout();
+
+	for(int i = 1; i < argc; i++)
+	{
+		int *pValue = 0;
+		int Min = 0; // no entities of a kind is a valid baseline
+		int Max = 0;
+		if(str_comp(argv[i], "-c") == 0) { pValue = &g_BenchConfig.m_NumCharacters; Max = BENCH_MAX_CHARACTERS; }
+		else if(str_comp(argv[i], "-p") == 0) { pValue = &g_BenchConfig.m_NumProjectiles; Max = BENCH_MAX_PROJECTILES; }
+		else if(str_comp(argv[i], "-u") == 0) { pValue = &g_BenchConfig.m_NumPickups; Max = BENCH_MAX_PICKUPS; }
+		else if(str_comp(argv[i], "-l") == 0) { pValue = &g_BenchConfig.m_NumLasers; Max = BENCH_MAX_LASERS; }
+		else if(str_comp(argv[i], "-j") == 0) { pValue = &g_BenchConfig.m_JitterTicks; Min = 1; Max = 8; }
+
+		if(pValue && i+1 < argc)
+			*pValue = clamp(str_toint(argv[++i]), Min, Max);
+		else if(argv[i][0] == '-')
+		{
+			dbg_msg("bench", "usage: %s [-c characters] [-p projectiles] [-u pickups] [-l lasers] [-j jitter ticks] [filter]", argv[0]);
+			cmdline_free(argc, argv);
+			return 1;
+		}
+		else
+			s_pFilter = argv[i];
+	}
+
+	dbg_msg("bench", "world: %d characters, %d projectiles, %d pickups, %d lasers, %d ticks jitter",
+		g_BenchConfig.m_NumCharacters, g_BenchConfig.m_NumProjectiles, g_BenchConfig.m_NumPickups,
+		g_BenchConfig.m_NumLasers, g_BenchConfig.m_JitterTicks);
+
+	BenchSnapshot();
+	BenchCompression();
+	BenchJobs();
+	BenchPhysics();
+	BenchSound();
+
+	cmdline_free(argc, argv);
+	return s_Failed ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef TEST_BENCH_BENCH_H
+#define TEST_BENCH_BENCH_H
+
+#include <base/system.h>
+
+// runs the benchmarked operation Iterations times and returns the number
+// of bytes it produced in total, 0 if that doesn't apply
+typedef int64 (*FBenchFunc)(void *pUser, int Iterations);
+
+/*
+	Function: BenchRun
+		Runs a benchmark with growing iteration counts until the
+		run is long enough to be measured and prints the time and
+		output size per operation.
+*/
+void BenchRun(const char *pName, FBenchFunc pfnFunc, void *pUser);
+
+// fails the whole benchmark run, used when implementations disagree
+void BenchFail(const char *pName, const char *pReason);
+
+// deterministic pseudo random numbers so runs are comparable
+class CBenchRandom
+{
+	unsigned m_State;
+
+public:
+	CBenchRandom(unsigned Seed) : m_State(Seed ? Seed : 1) {}
+	unsigned Next()
+	{
+		m_State ^= m_State << 13;
+		m_State ^= m_State >> 17;
+		m_State ^= m_State << 5;
+		return m_State;
+	}
+	int Range(int Min, int Max) { return Min + (int)(Next() % (unsigned)(Max - Min + 1)); }
+};
+
+enum
+{
+	BENCH_MAX_CHARACTERS=64,
+	BENCH_MAX_PROJECTILES=512,
+	BENCH_MAX_PICKUPS=128,
+	BENCH_MAX_LASERS=64,
+};
+
+// size of the synthetic world, set from the command line
+struct CBenchConfig
+{
+	int m_NumCharacters;
+	int m_NumProjectiles;
+	int m_NumPickups;
+	int m_NumLasers;
+	int m_JitterTicks; // delta bases are up to this many ticks old
+};
+
+extern CBenchConfig g_BenchConfig;
+
+void BenchCompression();
+void BenchJobs();
+void BenchPhysics();
+void BenchSnapshot();
+void BenchSound();
+
+#endif
@@ -0,0 +1,162 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include <engine/shared/compression.h>
+#include <engine/shared/huffman.h>
+#include <engine/shared/protocol.h>
+
+#include "world.h"
+
+// the snapshot deltas of all clients, split into packets the way
+// CServer::DoSnapshot sends them
+struct CCompressionBench
+{
+	enum
+	{
+		MAX_PACKETS=BENCH_MAX_CHARACTERS*(CSnapshot::MAX_SIZE/MAX_SNAPSHOT_PACKSIZE+1),
+		MAX_PACKET_SIZE=CSnapshot::MAX_SIZE,
+	};
+
+	CHuffman m_Huffman;
+	CAdaptiveHuffman m_AdaptiveSender;
+	CAdaptiveHuffman m_AdaptiveReceiver;
+	int m_NumDeltas;
+	int m_aDeltaSize[BENCH_MAX_CHARACTERS];
+	char m_aaDelta[BENCH_MAX_CHARACTERS][CSnapshot::MAX_SIZE];
+	int m_aVarIntSize[BENCH_MAX_CHARACTERS];
+	char m_aaVarInt[BENCH_MAX_CHARACTERS][CSnapshot::MAX_SIZE];
+
+	int m_NumPackets;
+	int m_aPacketSize[MAX_PACKETS];
+	const char *m_apPacket[MAX_PACKETS];
+	int m_aHuffmanSize[MAX_PACKETS];
+	char m_aaHuffman[MAX_PACKETS][MAX_SNAPSHOT_PACKSIZE*2];
+
+	char m_aBuffer[CSnapshot::MAX_SIZE];
+
+	CCompressionBench()
+	{
+		m_Huffman.Init();
+		m_AdaptiveSender.Init();
+		m_AdaptiveReceiver.Init();
+
+		CBenchSnapshots *pSnaps = new CBenchSnapshots;
+		m_NumDeltas = 0;
+		m_NumPackets = 0;
+		for(int i = 0; i < pSnaps->m_NumClients; i++)
+		{
+			int DeltaSize = pSnaps->m_SnapshotDelta.CreateDelta(pSnaps->From(i), pSnaps->To(i), m_aaDelta[m_NumDeltas]);
+			if(!DeltaSize)
+				continue;
+			m_aDeltaSize[m_NumDeltas] = DeltaSize;
+			int VarIntSize = (int)CVariableInt::Compress(m_aaDelta[m_NumDeltas], DeltaSize, m_aaVarInt[m_NumDeltas], CSnapshot::MAX_SIZE);
+			m_aVarIntSize[m_NumDeltas] = VarIntSize;
+
+			for(int Offset = 0; Offset < VarIntSize; Offset += MAX_SNAPSHOT_PACKSIZE)
+			{
+				int Size = minimum((int)MAX_SNAPSHOT_PACKSIZE, VarIntSize - Offset);
+				m_apPacket[m_NumPackets] = m_aaVarInt[m_NumDeltas] + Offset;
+				m_aPacketSize[m_NumPackets] = Size;
+				m_aHuffmanSize[m_NumPackets] = m_Huffman.Compress(m_apPacket[m_NumPackets], Size, m_aaHuffman[m_NumPackets], sizeof(m_aaHuffman[0]));
+				m_NumPackets++;
+			}
+			m_NumDeltas++;
+		}
+		delete pSnaps;
+	}
+};
+
+static int64 BenchVarIntCompress(void *pUser, int Iterations)
+{
+	CCompressionBench *pBench = (CCompressionBench *)pUser;
+	int64 Bytes = 0;
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pBench->m_NumDeltas; i++)
+			Bytes += CVariableInt::Compress(pBench->m_aaDelta[i], pBench->m_aDeltaSize[i], pBench->m_aBuffer, sizeof(pBench->m_aBuffer));
+	return Bytes;
+}
+
+static int64 BenchVarIntDecompress(void *pUser, int Iterations)
+{
+	CCompressionBench *pBench = (CCompressionBench *)pUser;
+	int64 Bytes = 0;
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pBench->m_NumDeltas; i++)
+			Bytes += CVariableInt::Decompress(pBench->m_aaVarInt[i], pBench->m_aVarIntSize[i], pBench->m_aBuffer, sizeof(pBench->m_aBuffer));
+	return Bytes;
+}
+
+static int64 BenchHuffmanCompress(void *pUser, int Iterations)
+{
+	CCompressionBench *pBench = (CCompressionBench *)pUser;
+	int64 Bytes = 0;
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pBench->m_NumPackets; i++)
+			Bytes += pBench->m_Huffman.Compress(pBench->m_apPacket[i], pBench->m_aPacketSize[i], pBench->m_aBuffer, sizeof(pBench->m_aBuffer));
+	return Bytes;
+}
+
+static int64 BenchHuffmanDecompress(void *pUser, int Iterations)
+{
+	CCompressionBench *pBench = (CCompressionBench *)pUser;
+	int64 Bytes = 0;
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pBench->m_NumPackets; i++)
+			Bytes += pBench->m_Huffman.Decompress(pBench->m_aaHuffman[i], pBench->m_aHuffmanSize[i], pBench->m_aBuffer, sizeof(pBench->m_aBuffer));
+	return Bytes;
+}
+
+// one side of a stream that keeps adapting to the packets
+static int64 BenchHuffmanAdaptive(void *pUser, int Iterations)
+{
+	CCompressionBench *pBench = (CCompressionBench *)pUser;
+	int64 Bytes = 0;
+	char aPacked[MAX_SNAPSHOT_PACKSIZE*2];
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pBench->m_NumPackets; i++)
+		{
+			int Size = pBench->m_AdaptiveSender.Compress(pBench->m_apPacket[i], pBench->m_aPacketSize[i], aPacked, sizeof(aPacked));
+			if(pBench->m_AdaptiveReceiver.Decompress(aPacked, Size, pBench->m_aBuffer, sizeof(pBench->m_aBuffer)) != pBench->m_aPacketSize[i])
+			{
+				BenchFail("huffman_adaptive", "Decompress doesn't restore the packet");
+				return 0;
+			}
+			Bytes += Size;
+		}
+	return Bytes;
+}
+
+static void CheckCompression(CCompressionBench *pBench)
+{
+	for(int i = 0; i < pBench->m_NumDeltas; i++)
+	{
+		int Size = (int)CVariableInt::Decompress(pBench->m_aaVarInt[i], pBench->m_aVarIntSize[i], pBench->m_aBuffer, sizeof(pBench->m_aBuffer));
+		if(Size != pBench->m_aDeltaSize[i] || mem_comp(pBench->m_aBuffer, pBench->m_aaDelta[i], Size) != 0)
+		{
+			BenchFail("varint", "Decompress doesn't restore the delta");
+			return;
+		}
+	}
+	for(int i = 0; i < pBench->m_NumPackets; i++)
+	{
+		int Size = pBench->m_Huffman.Decompress(pBench->m_aaHuffman[i], pBench->m_aHuffmanSize[i], pBench->m_aBuffer, sizeof(pBench->m_aBuffer));
+		if(Size != pBench->m_aPacketSize[i] || mem_comp(pBench->m_aBuffer, pBench->m_apPacket[i], Size) != 0)
+		{
+			BenchFail("huffman", "Decompress doesn't restore the packet");
+			return;
+		}
+	}
+}
+
+void BenchCompression()
+{
+	CCompressionBench *pBench = new CCompressionBench;
+	CheckCompression(pBench);
+	BenchRun("varint_compress", BenchVarIntCompress, pBench);
+	BenchRun("varint_decompress", BenchVarIntDecompress, pBench);
+	BenchRun("huffman_compress", BenchHuffmanCompress, pBench);
+	BenchRun("huffman_decompress", BenchHuffmanDecompress, pBench);
+	BenchRun("huffman_adaptive_roundtrip", BenchHuffmanAdaptive, pBench);
+	delete pBench;
+}
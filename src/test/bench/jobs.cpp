@@ -0,0 +1,231 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <engine/shared/jobs.h>
+
+#include "bench.h"
+
+// the job pool before work stealing: one locked list all workers take from
+class CLegacyJobPool
+{
+	struct CLegacyJob
+	{
+		CLegacyJob *m_pNext;
+		volatile int m_Done;
+		JOBFUNC m_pfnFunc;
+		void *m_pFuncData;
+	};
+
+	enum
+	{
+		MAX_THREADS=32,
+		MAX_JOBS=1024,
+	};
+
+	int m_NumThreads;
+	void *m_apThreads[MAX_THREADS];
+	volatile bool m_Shutdown;
+	LOCK m_Lock;
+	SEMAPHORE m_Semaphore;
+	CLegacyJob *m_pFirstJob;
+	CLegacyJob *m_pLastJob;
+	CLegacyJob m_aJobs[MAX_JOBS];
+
+	CLegacyJob *PopJob()
+	{
+		lock_wait(m_Lock);
+		CLegacyJob *pJob = m_pFirstJob;
+		if(pJob)
+		{
+			m_pFirstJob = pJob->m_pNext;
+			if(!m_pFirstJob)
+				m_pLastJob = 0;
+		}
+		lock_unlock(m_Lock);
+		return pJob;
+	}
+
+	static void RunJob(CLegacyJob *pJob)
+	{
+		pJob->m_pfnFunc(pJob->m_pFuncData);
+		pJob->m_Done = 1;
+	}
+
+	static void WorkerThread(void *pUser)
+	{
+		CLegacyJobPool *pPool = (CLegacyJobPool *)pUser;
+		while(!pPool->m_Shutdown)
+		{
+			sphore_wait(&pPool->m_Semaphore);
+			CLegacyJob *pJob = pPool->PopJob();
+			if(pJob)
+				RunJob(pJob);
+		}
+	}
+
+public:
+	CLegacyJobPool(int NumThreads)
+	{
+		m_NumThreads = NumThreads;
+		m_Shutdown = false;
+		m_Lock = lock_create();
+		sphore_init(&m_Semaphore);
+		m_pFirstJob = 0;
+		m_pLastJob = 0;
+		for(int i = 0; i < m_NumThreads; i++)
+			m_apThreads[i] = thread_init(WorkerThread, this);
+	}
+
+	~CLegacyJobPool()
+	{
+		m_Shutdown = true;
+		for(int i = 0; i < m_NumThreads; i++)
+			sphore_signal(&m_Semaphore);
+		for(int i = 0; i < m_NumThreads; i++)
+		{
+			thread_wait(m_apThreads[i]);
+			thread_destroy(m_apThreads[i]);
+		}
+		sphore_destroy(&m_Semaphore);
+		lock_destroy(m_Lock);
+	}
+
+	void Add(int Index, JOBFUNC pfnFunc, void *pData)
+	{
+		CLegacyJob *pJob = &m_aJobs[Index];
+		pJob->m_pNext = 0;
+		pJob->m_Done = 0;
+		pJob->m_pfnFunc = pfnFunc;
+		pJob->m_pFuncData = pData;
+
+		lock_wait(m_Lock);
+		if(m_pLastJob)
+			m_pLastJob->m_pNext = pJob;
+		else
+			m_pFirstJob = pJob;
+		m_pLastJob = pJob;
+		lock_unlock(m_Lock);
+		sphore_signal(&m_Semaphore);
+	}
+
+	void Wait(int Index)
+	{
+		while(!m_aJobs[Index].m_Done)
+		{
+			CLegacyJob *pOther = PopJob();
+			if(pOther)
+				RunJob(pOther);
+			else
+				thread_yield();
+		}
+	}
+};
+
+enum
+{
+	JOBS_THREADS=4,
+	JOBS_PER_BATCH=256,
+	JOBS_FANOUT=16,
+};
+
+// a bit of work, roughly what one snapshot delta of a small game costs
+static int HashJob(void *pUser)
+{
+	unsigned *pValue = (unsigned *)pUser;
+	unsigned State = *pValue | 1;
+	for(int i = 0; i < 2000; i++)
+	{
+		State ^= State << 13;
+		State ^= State >> 17;
+		State ^= State << 5;
+	}
+	*pValue = State;
+	return 0;
+}
+
+static int EmptyJob(void *pUser)
+{
+	return 0;
+}
+
+struct CJobsBench
+{
+	CJobPool m_Pool;
+	CLegacyJobPool m_LegacyPool;
+	CJob m_aJobs[JOBS_PER_BATCH];
+	CJob m_aaSubJobs[JOBS_PER_BATCH/JOBS_FANOUT][JOBS_FANOUT];
+	unsigned m_aValues[JOBS_PER_BATCH];
+
+	CJobsBench() : m_LegacyPool(JOBS_THREADS)
+	{
+		m_Pool.Init(JOBS_THREADS);
+		for(int i = 0; i < JOBS_PER_BATCH; i++)
+			m_aValues[i] = i;
+	}
+};
+
+static CJobsBench *s_pBench = 0;
+
+// a batch of jobs added by one thread that waits for all of them in order
+static int64 RunLegacyBatch(JOBFUNC pfnFunc, int Iterations)
+{
+	for(int n = 0; n < Iterations; n++)
+	{
+		for(int i = 0; i < JOBS_PER_BATCH; i++)
+			s_pBench->m_LegacyPool.Add(i, pfnFunc, &s_pBench->m_aValues[i]);
+		for(int i = 0; i < JOBS_PER_BATCH; i++)
+			s_pBench->m_LegacyPool.Wait(i);
+	}
+	return 0;
+}
+
+static int64 RunBatch(JOBFUNC pfnFunc, int Iterations)
+{
+	for(int n = 0; n < Iterations; n++)
+	{
+		for(int i = 0; i < JOBS_PER_BATCH; i++)
+			s_pBench->m_Pool.Add(&s_pBench->m_aJobs[i], pfnFunc, &s_pBench->m_aValues[i]);
+		for(int i = 0; i < JOBS_PER_BATCH; i++)
+			s_pBench->m_Pool.Wait(&s_pBench->m_aJobs[i]);
+	}
+	return 0;
+}
+
+static int64 BenchLegacyEmpty(void *pUser, int Iterations) { return RunLegacyBatch(EmptyJob, Iterations); }
+static int64 BenchLegacyHash(void *pUser, int Iterations) { return RunLegacyBatch(HashJob, Iterations); }
+static int64 BenchEmpty(void *pUser, int Iterations) { return RunBatch(EmptyJob, Iterations); }
+static int64 BenchHash(void *pUser, int Iterations) { return RunBatch(HashJob, Iterations); }
+
+// every job of the batch adds its own sub jobs and waits for them as a group
+static int FanOutJob(void *pUser)
+{
+	int Index = (int)(size_t)pUser;
+	CJobGroup Group;
+	for(int i = 0; i < JOBS_FANOUT; i++)
+		s_pBench->m_Pool.Add(&s_pBench->m_aaSubJobs[Index][i], HashJob, &s_pBench->m_aValues[Index*JOBS_FANOUT+i], &Group);
+	s_pBench->m_Pool.Wait(&Group);
+	return 0;
+}
+
+static int64 BenchFanOut(void *pUser, int Iterations)
+{
+	for(int n = 0; n < Iterations; n++)
+	{
+		CJobGroup Group;
+		for(int i = 0; i < JOBS_PER_BATCH/JOBS_FANOUT; i++)
+			s_pBench->m_Pool.Add(&s_pBench->m_aJobs[i], FanOutJob, (void *)(size_t)i, &Group);
+		s_pBench->m_Pool.Wait(&Group);
+	}
+	return 0;
+}
+
+void BenchJobs()
+{
+	s_pBench = new CJobsBench;
+	BenchRun("jobs_batch_empty_legacy", BenchLegacyEmpty, 0);
+	BenchRun("jobs_batch_empty", BenchEmpty, 0);
+	BenchRun("jobs_batch_hash_legacy", BenchLegacyHash, 0);
+	BenchRun("jobs_batch_hash", BenchHash, 0);
+	BenchRun("jobs_fanout_hash", BenchFanOut, 0);
+	delete s_pBench;
+	s_pBench = 0;
+}
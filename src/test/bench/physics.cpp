@@ -0,0 +1,111 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/mapitems.h>
+
+#include "bench.h"
+
+enum
+{
+	PHYSICS_WIDTH=100,
+	PHYSICS_HEIGHT=50,
+};
+
+struct CPhysicsBench
+{
+	CTile m_aTiles[PHYSICS_WIDTH*PHYSICS_HEIGHT];
+	CCollision m_Collision;
+	CWorldCore m_World;
+	CCharacterCore m_aCores[BENCH_MAX_CHARACTERS];
+	CNetObj_PlayerInput m_aInputs[BENCH_MAX_CHARACTERS];
+	bool m_aUseInput[MAX_CLIENTS];
+
+	CPhysicsBench()
+	{
+		// a closed room with platforms, the characters stay in the middle of it
+		mem_zero(m_aTiles, sizeof(m_aTiles));
+		for(int y = 0; y < PHYSICS_HEIGHT; y++)
+			for(int x = 0; x < PHYSICS_WIDTH; x++)
+				if(x == 0 || y == 0 || x == PHYSICS_WIDTH-1 || y == PHYSICS_HEIGHT-1 || (y%8 == 0 && x%12 < 6))
+					m_aTiles[y*PHYSICS_WIDTH+x].m_Index = TILE_SOLID;
+		m_Collision.Init(m_aTiles, PHYSICS_WIDTH, PHYSICS_HEIGHT);
+
+		CBenchRandom Random(1234);
+		mem_zero(m_aUseInput, sizeof(m_aUseInput));
+		mem_zero(m_aCores, sizeof(m_aCores));
+		int Num = minimum(g_BenchConfig.m_NumCharacters, (int)MAX_CLIENTS);
+		for(int i = 0; i < Num; i++)
+		{
+			m_aCores[i].Init(&m_World, &m_Collision);
+			m_aCores[i].Reset();
+			m_aCores[i].m_Pos = vec2(Random.Range(64, PHYSICS_WIDTH*32-64), Random.Range(64, PHYSICS_HEIGHT*32-64));
+			m_World.m_apCharacters[i] = &m_aCores[i];
+			m_aUseInput[i] = true;
+
+			mem_zero(&m_aInputs[i], sizeof(m_aInputs[i]));
+			m_aInputs[i].m_Direction = Random.Range(-1, 1);
+			m_aInputs[i].m_TargetX = Random.Range(-200, 200);
+			m_aInputs[i].m_TargetY = Random.Range(-200, 200);
+			m_aInputs[i].m_Hook = Random.Range(0, 1);
+		}
+	}
+
+	// same inputs every tick, jumping now and then so nobody settles
+	void SetInputs(int Tick)
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			if(m_World.m_apCharacters[i])
+			{
+				m_aCores[i].m_Input = m_aInputs[i];
+				m_aCores[i].m_Input.m_Jump = (Tick+i)%16 == 0;
+			}
+	}
+};
+
+static int64 BenchSingle(void *pUser, int Iterations)
+{
+	CPhysicsBench *pBench = (CPhysicsBench *)pUser;
+	for(int n = 0; n < Iterations; n++)
+	{
+		pBench->SetInputs(n);
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			if(pBench->m_World.m_apCharacters[i])
+				pBench->m_World.m_apCharacters[i]->Tick(pBench->m_aUseInput[i]);
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			CCharacterCore *pCore = pBench->m_World.m_apCharacters[i];
+			if(!pCore)
+				continue;
+			pCore->AddDragVelocity();
+			pCore->ResetDragVelocity();
+			pCore->Move();
+			pCore->Quantize();
+		}
+	}
+	return 0;
+}
+
+static int64 BenchBatched(void *pUser, int Iterations)
+{
+	CPhysicsBench *pBench = (CPhysicsBench *)pUser;
+	for(int n = 0; n < Iterations; n++)
+	{
+		pBench->SetInputs(n);
+		pBench->m_World.Tick(pBench->m_aUseInput);
+	}
+	return 0;
+}
+
+void BenchPhysics()
+{
+	CPhysicsBench *pBench = new CPhysicsBench;
+	BenchRun("physics_tick_single", BenchSingle, pBench);
+	delete pBench;
+
+	pBench = new CPhysicsBench;
+	BenchRun("physics_tick_batched", BenchBatched, pBench);
+	delete pBench;
+}
@@ -0,0 +1,243 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "world.h"
+
+// the hash based CreateDelta that was used up to now, kept as reference
+namespace legacy
+{
+	enum
+	{
+		HASHLIST_SIZE = 256,
+		HASHLIST_BUCKET_SIZE = 64,
+	};
+
+	struct CItemList
+	{
+		int m_Num;
+		int m_aKeys[HASHLIST_BUCKET_SIZE];
+		int m_aIndex[HASHLIST_BUCKET_SIZE];
+	};
+
+	static unsigned CalcHashID(int Key)
+	{
+		unsigned Hash = 5381;
+		for(unsigned Shift = 0; Shift < sizeof(int); Shift++)
+			Hash = ((Hash << 5) + Hash) + ((Key >> (Shift * 8)) & 0xFF);
+		return Hash % HASHLIST_SIZE;
+	}
+
+	static void GenerateHash(CItemList *pHashlist, const CSnapshot *pSnapshot)
+	{
+		for(int i = 0; i < HASHLIST_SIZE; i++)
+			pHashlist[i].m_Num = 0;
+
+		for(int i = 0; i < pSnapshot->NumItems(); i++)
+		{
+			int Key = pSnapshot->GetItem(i)->Key();
+			unsigned HashID = CalcHashID(Key);
+			if(pHashlist[HashID].m_Num < HASHLIST_BUCKET_SIZE)
+			{
+				pHashlist[HashID].m_aIndex[pHashlist[HashID].m_Num] = i;
+				pHashlist[HashID].m_aKeys[pHashlist[HashID].m_Num] = Key;
+				pHashlist[HashID].m_Num++;
+			}
+		}
+	}
+
+	static int GetItemIndexHashed(int Key, const CItemList *pHashlist)
+	{
+		unsigned HashID = CalcHashID(Key);
+		for(int i = 0; i < pHashlist[HashID].m_Num; i++)
+			if(pHashlist[HashID].m_aKeys[i] == Key)
+				return pHashlist[HashID].m_aIndex[i];
+		return -1;
+	}
+
+	static int DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
+	{
+		int Needed = 0;
+		for(; Size; Size--, pOut++, pPast++, pCurrent++)
+		{
+			*pOut = *pCurrent-*pPast;
+			Needed |= *pOut;
+		}
+		return Needed;
+	}
+
+	static int CreateDelta(const short *pItemSizes, const CSnapshot *pFrom, const CSnapshot *pTo, void *pDstData)
+	{
+		CSnapshotDelta::CData *pDelta = (CSnapshotDelta::CData *)pDstData;
+		int *pData = (int *)pDelta->m_aData;
+
+		pDelta->m_NumDeletedItems = 0;
+		pDelta->m_NumUpdateItems = 0;
+		pDelta->m_NumTempItems = 0;
+
+		static CItemList s_aHashlist[HASHLIST_SIZE];
+		GenerateHash(s_aHashlist, pTo);
+
+		for(int i = 0; i < pFrom->NumItems(); i++)
+		{
+			const CSnapshotItem *pFromItem = pFrom->GetItem(i);
+			if(GetItemIndexHashed(pFromItem->Key(), s_aHashlist) == -1)
+			{
+				pDelta->m_NumDeletedItems++;
+				*pData++ = pFromItem->Key();
+			}
+		}
+
+		GenerateHash(s_aHashlist, pFrom);
+		int aPastIndecies[1024];
+		const int NumItems = pTo->NumItems();
+		for(int i = 0; i < NumItems; i++)
+			aPastIndecies[i] = GetItemIndexHashed(pTo->GetItem(i)->Key(), s_aHashlist);
+
+		for(int i = 0; i < NumItems; i++)
+		{
+			int ItemSize = pTo->GetItemSize(i);
+			const CSnapshotItem *pCurItem = pTo->GetItem(i);
+			int PastIndex = aPastIndecies[i];
+			bool IncludeSize = pCurItem->Type() >= NUM_NETOBJTYPES || !pItemSizes[pCurItem->Type()];
+
+			if(PastIndex != -1)
+			{
+				int *pItemDataDst = IncludeSize ? pData+3 : pData+2;
+				if(DiffItem(pFrom->GetItem(PastIndex)->Data(), pCurItem->Data(), pItemDataDst, ItemSize/4))
+				{
+					*pData++ = pCurItem->Type();
+					*pData++ = pCurItem->ID();
+					if(IncludeSize)
+						*pData++ = ItemSize/4;
+					pData += ItemSize/4;
+					pDelta->m_NumUpdateItems++;
+				}
+			}
+			else
+			{
+				*pData++ = pCurItem->Type();
+				*pData++ = pCurItem->ID();
+				if(IncludeSize)
+					*pData++ = ItemSize/4;
+				mem_copy(pData, pCurItem->Data(), ItemSize);
+				pData += ItemSize/4;
+				pDelta->m_NumUpdateItems++;
+			}
+		}
+
+		if(!pDelta->m_NumDeletedItems && !pDelta->m_NumUpdateItems && !pDelta->m_NumTempItems)
+			return 0;
+		return (int)((char*)pData-(char*)pDstData);
+	}
+}
+
+struct CSnapshotBench
+{
+	CBenchSnapshots m_Snapshots;
+	CSnapshotBuilder m_Builder;
+	CBenchWorld m_World;
+	char m_aSnapData[CSnapshot::MAX_SIZE];
+	char m_aDeltaData[CSnapshot::MAX_SIZE];
+	int m_aDeltaSize[BENCH_MAX_CHARACTERS];
+	char m_aaDelta[BENCH_MAX_CHARACTERS][CSnapshot::MAX_SIZE];
+
+	CSnapshotBench() : m_World(4711)
+	{
+		for(int i = 0; i < m_Snapshots.m_NumClients; i++)
+			m_aDeltaSize[i] = m_Snapshots.m_SnapshotDelta.CreateDelta(m_Snapshots.From(i), m_Snapshots.To(i), m_aaDelta[i]);
+	}
+};
+
+// one operation is a full round over all clients, like a server tick
+static int64 BenchFinish(void *pUser, int Iterations)
+{
+	CSnapshotBench *pBench = (CSnapshotBench *)pUser;
+	int64 Bytes = 0;
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pBench->m_Snapshots.m_NumClients; i++)
+			Bytes += pBench->m_World.Snap(&pBench->m_Builder, i, pBench->m_aSnapData);
+	return Bytes;
+}
+
+static int64 BenchCrc(void *pUser, int Iterations)
+{
+	CSnapshotBench *pBench = (CSnapshotBench *)pUser;
+	int64 Bytes = 0;
+	int Crc = 0;
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pBench->m_Snapshots.m_NumClients; i++)
+		{
+			Crc += pBench->m_Snapshots.To(i)->Crc();
+			Bytes += pBench->m_Snapshots.m_aToSize[i];
+		}
+	// keep the result alive
+	if(Crc == 0x7fffffff)
+		dbg_msg("bench", "crc %d", Crc);
+	return Bytes;
+}
+
+static int64 BenchCreateDelta(void *pUser, int Iterations)
+{
+	CSnapshotBench *pBench = (CSnapshotBench *)pUser;
+	CBenchSnapshots *pSnaps = &pBench->m_Snapshots;
+	int64 Bytes = 0;
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pSnaps->m_NumClients; i++)
+			Bytes += pSnaps->m_SnapshotDelta.CreateDelta(pSnaps->From(i), pSnaps->To(i), pBench->m_aDeltaData);
+	return Bytes;
+}
+
+static int64 BenchCreateDeltaLegacy(void *pUser, int Iterations)
+{
+	CSnapshotBench *pBench = (CSnapshotBench *)pUser;
+	CBenchSnapshots *pSnaps = &pBench->m_Snapshots;
+	int64 Bytes = 0;
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pSnaps->m_NumClients; i++)
+			Bytes += legacy::CreateDelta(pSnaps->m_aItemSizes, pSnaps->From(i), pSnaps->To(i), pBench->m_aDeltaData);
+	return Bytes;
+}
+
+static int64 BenchUnpackDelta(void *pUser, int Iterations)
+{
+	CSnapshotBench *pBench = (CSnapshotBench *)pUser;
+	CBenchSnapshots *pSnaps = &pBench->m_Snapshots;
+	int64 Bytes = 0;
+	for(int n = 0; n < Iterations; n++)
+		for(int i = 0; i < pSnaps->m_NumClients; i++)
+			Bytes += pSnaps->m_SnapshotDelta.UnpackDelta(pSnaps->From(i), (CSnapshot *)pBench->m_aSnapData, pBench->m_aaDelta[i], pBench->m_aDeltaSize[i]);
+	return Bytes;
+}
+
+static void CheckDelta(CSnapshotBench *pBench)
+{
+	CBenchSnapshots *pSnaps = &pBench->m_Snapshots;
+	static char s_aLegacyData[CSnapshot::MAX_SIZE];
+	for(int i = 0; i < pSnaps->m_NumClients; i++)
+	{
+		int LegacySize = legacy::CreateDelta(pSnaps->m_aItemSizes, pSnaps->From(i), pSnaps->To(i), s_aLegacyData);
+		if(pBench->m_aDeltaSize[i] != LegacySize || mem_comp(pBench->m_aaDelta[i], s_aLegacyData, LegacySize) != 0)
+		{
+			BenchFail("snapshot_delta", "CreateDelta differs from the legacy implementation");
+			return;
+		}
+
+		int Size = pSnaps->m_SnapshotDelta.UnpackDelta(pSnaps->From(i), (CSnapshot *)pBench->m_aSnapData, pBench->m_aaDelta[i], pBench->m_aDeltaSize[i]);
+		if(Size != pSnaps->m_aToSize[i] || mem_comp(pBench->m_aSnapData, pSnaps->m_aaTo[i], Size) != 0)
+		{
+			BenchFail("snapshot_delta", "UnpackDelta doesn't restore the snapshot");
+			return;
+		}
+	}
+}
+
+void BenchSnapshot()
+{
+	CSnapshotBench *pBench = new CSnapshotBench;
+	CheckDelta(pBench);
+	BenchRun("snapshot_finish", BenchFinish, pBench);
+	BenchRun("snapshot_crc", BenchCrc, pBench);
+	BenchRun("snapshot_delta_create_legacy", BenchCreateDeltaLegacy, pBench);
+	BenchRun("snapshot_delta_create", BenchCreateDelta, pBench);
+	BenchRun("snapshot_delta_unpack", BenchUnpackDelta, pBench);
+	delete pBench;
+}
@@ -0,0 +1,136 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include <engine/sound.h>
+#include <engine/shared/soundmixer.h>
+
+#include "bench.h"
+
+#include <math.h>
+#include <limits.h>
+
+// a busy fight: every voice plays, most of them explosions around the
+// listener and some too far away to be heard
+struct CSoundBench
+{
+	enum
+	{
+		NUM_FRAMES=512,
+		SAMPLE_FRAMES=48000*2,
+	};
+
+	CSoundSample m_Mono;
+	CSoundSample m_Stereo;
+	int m_aX[CSoundMixer::NUM_VOICES];
+	int m_aY[CSoundMixer::NUM_VOICES];
+	short m_aOut[NUM_FRAMES*2];
+	int m_aMix[NUM_FRAMES*2];
+	CSoundMixer m_Mixer;
+	LOCK m_Lock;
+
+	CSoundBench()
+	{
+		CBenchRandom Random(5);
+		CreateSample(&m_Mono, 1, &Random);
+		CreateSample(&m_Stereo, 2, &Random);
+		for(int i = 0; i < CSoundMixer::NUM_VOICES; i++)
+		{
+			m_aX[i] = Random.Range(-1800, 1800);
+			m_aY[i] = Random.Range(-1000, 1000);
+		}
+
+		m_Mixer.Init(NUM_FRAMES);
+		for(int i = 0; i < CSoundMixer::NUM_VOICES; i++)
+			m_Mixer.Play(0, i%8 ? &m_Mono : &m_Stereo, ISound::FLAG_POS|ISound::FLAG_LOOP, m_aX[i], m_aY[i]);
+		m_Lock = lock_create();
+	}
+
+	~CSoundBench()
+	{
+		lock_destroy(m_Lock);
+		mem_free(m_Mono.m_pData);
+		mem_free(m_Stereo.m_pData);
+	}
+
+	static void CreateSample(CSoundSample *pSample, int Channels, CBenchRandom *pRandom)
+	{
+		mem_zero(pSample, sizeof(*pSample));
+		pSample->m_pData = (short *)mem_alloc(SAMPLE_FRAMES*Channels*sizeof(short));
+		for(int i = 0; i < SAMPLE_FRAMES*Channels; i++)
+			pSample->m_pData[i] = pRandom->Range(-32768, 32767);
+		pSample->m_NumFrames = SAMPLE_FRAMES;
+		pSample->m_Channels = Channels;
+	}
+};
+
+// the mixer before the voice queue: locked, one frame at a time and
+// the volumes of every voice computed in every callback
+static void LegacyMix(CSoundBench *pBench, int Tick)
+{
+	mem_zero(pBench->m_aMix, sizeof(pBench->m_aMix));
+	const float MaxDistance = 1500.0f;
+
+	lock_wait(pBench->m_Lock);
+	for(int i = 0; i < CSoundMixer::NUM_VOICES; i++)
+	{
+		const CSoundSample *pSample = i%8 ? &pBench->m_Mono : &pBench->m_Stereo;
+		int Step = pSample->m_Channels;
+		const short *pInL = &pSample->m_pData[Tick*Step];
+		const short *pInR = &pSample->m_pData[Tick*Step+Step-1];
+		int *pOut = pBench->m_aMix;
+
+		int Lvol = 0;
+		int Rvol = 0;
+		int dx = pBench->m_aX[i];
+		int dy = pBench->m_aY[i];
+		float Dist = sqrtf((float)dx*dx+dy*dy);
+		if(Dist >= 0.0f && Dist < MaxDistance)
+		{
+			float FalloffAmp = 255 * (1.0f - Dist/MaxDistance);
+			float Lpan = 0.5f - dx/MaxDistance/2.0f;
+			Lvol = FalloffAmp*sqrt(Lpan);
+			Rvol = FalloffAmp*sqrt(1.0f - Lpan);
+		}
+
+		for(unsigned s = 0; s < CSoundBench::NUM_FRAMES; s++)
+		{
+			*pOut++ += (*pInL)*Lvol;
+			*pOut++ += (*pInR)*Rvol;
+			pInL += Step;
+			pInR += Step;
+		}
+	}
+	lock_unlock(pBench->m_Lock);
+
+	for(unsigned i = 0; i < CSoundBench::NUM_FRAMES; ++i)
+	{
+		int j = i<<1;
+		pBench->m_aOut[j] = clamp(((pBench->m_aMix[j]*100)/101)>>8, SHRT_MIN, SHRT_MAX);
+		pBench->m_aOut[j+1] = clamp(((pBench->m_aMix[j+1]*100)/101)>>8, SHRT_MIN, SHRT_MAX);
+	}
+}
+
+static int64 BenchLegacy(void *pUser, int Iterations)
+{
+	CSoundBench *pBench = (CSoundBench *)pUser;
+	for(int n = 0; n < Iterations; n++)
+		LegacyMix(pBench, (n*CSoundBench::NUM_FRAMES)%(CSoundBench::SAMPLE_FRAMES-CSoundBench::NUM_FRAMES));
+	return 0;
+}
+
+static int64 BenchMixer(void *pUser, int Iterations)
+{
+	CSoundBench *pBench = (CSoundBench *)pUser;
+	for(int n = 0; n < Iterations; n++)
+		pBench->m_Mixer.Mix(pBench->m_aOut, CSoundBench::NUM_FRAMES);
+	return 0;
+}
+
+void BenchSound()
+{
+	CSoundBench *pBench = new CSoundBench;
+	BenchRun("sound_mix_64_voices_legacy", BenchLegacy, pBench);
+	BenchRun("sound_mix_64_voices", BenchMixer, pBench);
+	delete pBench;
+}
@@ -0,0 +1,167 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include "world.h"
+
+CBenchWorld::CBenchWorld(unsigned Seed) : m_Random(Seed)
+{
+	m_Tick = 1000;
+	m_NextID = 0;
+	for(int i = 0; i < g_BenchConfig.m_NumCharacters; i++)
+		Spawn(&m_aCharacters[i], 0);
+	for(int i = 0; i < g_BenchConfig.m_NumProjectiles; i++)
+		Spawn(&m_aProjectiles[i], m_Random.Range(10, 60));
+	for(int i = 0; i < g_BenchConfig.m_NumPickups; i++)
+		Spawn(&m_aPickups[i], 0);
+	for(int i = 0; i < g_BenchConfig.m_NumLasers; i++)
+		Spawn(&m_aLasers[i], m_Random.Range(3, 8));
+}
+
+void CBenchWorld::Spawn(CObject *pObj, int LifeTime)
+{
+	pObj->m_ID = m_NextID++ & 0x3fff;
+	pObj->m_X = m_Random.Range(0, 200*32);
+	pObj->m_Y = m_Random.Range(0, 100*32);
+	pObj->m_VelX = m_Random.Range(-600, 600);
+	pObj->m_VelY = m_Random.Range(-600, 600);
+	pObj->m_StartTick = m_Tick;
+	pObj->m_LifeTime = LifeTime;
+}
+
+bool CBenchWorld::Visible(const CObject *pViewer, int X, int Y)
+{
+	return absolute(pViewer->m_X - X) < 1000 && absolute(pViewer->m_Y - Y) < 800;
+}
+
+void CBenchWorld::Step()
+{
+	m_Tick++;
+	for(int i = 0; i < g_BenchConfig.m_NumCharacters; i++)
+	{
+		CObject *pChr = &m_aCharacters[i];
+		pChr->m_VelX = clamp(pChr->m_VelX + m_Random.Range(-40, 40), -1000, 1000);
+		pChr->m_VelY = clamp(pChr->m_VelY + m_Random.Range(-30, 50), -1000, 1000);
+		pChr->m_X = clamp(pChr->m_X + pChr->m_VelX/100, 0, 200*32);
+		pChr->m_Y = clamp(pChr->m_Y + pChr->m_VelY/100, 0, 100*32);
+	}
+	for(int i = 0; i < g_BenchConfig.m_NumProjectiles; i++)
+		if(m_Tick - m_aProjectiles[i].m_StartTick > m_aProjectiles[i].m_LifeTime)
+			Spawn(&m_aProjectiles[i], m_Random.Range(10, 60));
+	for(int i = 0; i < g_BenchConfig.m_NumLasers; i++)
+		if(m_Tick - m_aLasers[i].m_StartTick > m_aLasers[i].m_LifeTime)
+			Spawn(&m_aLasers[i], m_Random.Range(3, 8));
+}
+
+int CBenchWorld::Snap(CSnapshotBuilder *pBuilder, int ClientID, void *pSnapData)
+{
+	const CObject *pViewer = ClientID >= 0 ? &m_aCharacters[ClientID] : 0;
+	pBuilder->Init();
+
+	CNetObj_GameData *pGameData = (CNetObj_GameData *)pBuilder->NewItem(NETOBJTYPE_GAMEDATA, 0, sizeof(CNetObj_GameData));
+	pGameData->m_GameStartTick = 0;
+
+	for(int i = 0; i < g_BenchConfig.m_NumPickups; i++)
+	{
+		const CObject *pObj = &m_aPickups[i];
+		if(pViewer && !Visible(pViewer, pObj->m_X, pObj->m_Y))
+			continue;
+		CNetObj_Pickup *pPickup = (CNetObj_Pickup *)pBuilder->NewItem(NETOBJTYPE_PICKUP, pObj->m_ID, sizeof(CNetObj_Pickup));
+		pPickup->m_X = pObj->m_X;
+		pPickup->m_Y = pObj->m_Y;
+		pPickup->m_Type = i%4;
+	}
+
+	for(int i = 0; i < g_BenchConfig.m_NumProjectiles; i++)
+	{
+		const CObject *pObj = &m_aProjectiles[i];
+		int Ct = m_Tick - pObj->m_StartTick;
+		if(pViewer && !Visible(pViewer, pObj->m_X + pObj->m_VelX*Ct/50, pObj->m_Y + pObj->m_VelY*Ct/50))
+			continue;
+		CNetObj_Projectile *pProj = (CNetObj_Projectile *)pBuilder->NewItem(NETOBJTYPE_PROJECTILE, pObj->m_ID, sizeof(CNetObj_Projectile));
+		pProj->m_X = pObj->m_X;
+		pProj->m_Y = pObj->m_Y;
+		pProj->m_VelX = pObj->m_VelX;
+		pProj->m_VelY = pObj->m_VelY;
+		pProj->m_Type = i%3;
+		pProj->m_StartTick = pObj->m_StartTick;
+	}
+
+	for(int i = 0; i < g_BenchConfig.m_NumLasers; i++)
+	{
+		const CObject *pObj = &m_aLasers[i];
+		if(pViewer && !Visible(pViewer, pObj->m_X, pObj->m_Y))
+			continue;
+		CNetObj_Laser *pLaser = (CNetObj_Laser *)pBuilder->NewItem(NETOBJTYPE_LASER, pObj->m_ID, sizeof(CNetObj_Laser));
+		pLaser->m_X = pObj->m_X;
+		pLaser->m_Y = pObj->m_Y;
+		pLaser->m_FromX = pObj->m_X - pObj->m_VelX/2;
+		pLaser->m_FromY = pObj->m_Y - pObj->m_VelY/2;
+		pLaser->m_StartTick = pObj->m_StartTick;
+	}
+
+	for(int i = 0; i < g_BenchConfig.m_NumCharacters; i++)
+	{
+		const CObject *pObj = &m_aCharacters[i];
+		CNetObj_PlayerInfo *pInfo = (CNetObj_PlayerInfo *)pBuilder->NewItem(NETOBJTYPE_PLAYERINFO, i, sizeof(CNetObj_PlayerInfo));
+		pInfo->m_PlayerFlags = 0;
+		pInfo->m_Score = i;
+		pInfo->m_Latency = 20 + m_Random.Range(0, 3);
+
+		if(pViewer && !Visible(pViewer, pObj->m_X, pObj->m_Y))
+			continue;
+		CNetObj_Character *pChr = (CNetObj_Character *)pBuilder->NewItem(NETOBJTYPE_CHARACTER, i, sizeof(CNetObj_Character));
+		pChr->m_Tick = m_Tick;
+		pChr->m_X = pObj->m_X;
+		pChr->m_Y = pObj->m_Y;
+		pChr->m_VelX = pObj->m_VelX;
+		pChr->m_VelY = pObj->m_VelY;
+		pChr->m_Angle = m_Random.Range(0, 628);
+		pChr->m_Direction = pObj->m_VelX < 0 ? -1 : 1;
+		pChr->m_HookedPlayer = -1;
+		if(pObj == pViewer)
+		{
+			pChr->m_Health = 10;
+			pChr->m_Armor = 5;
+			pChr->m_AmmoCount = 10;
+		}
+		pChr->m_Weapon = i%5;
+	}
+
+	return pBuilder->Finish(pSnapData);
+}
+
+CBenchSnapshots::CBenchSnapshots()
+{
+	CNetObjHandler NetObjHandler;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+	{
+		m_aItemSizes[i] = NetObjHandler.GetObjSize(i);
+		m_SnapshotDelta.SetStaticsize(i, m_aItemSizes[i]);
+	}
+
+	// remember the last few ticks so every client can have its own delta base
+	enum { HISTORY = 8 };
+	const int Jitter = clamp(g_BenchConfig.m_JitterTicks, 1, (int)HISTORY);
+	CBenchWorld *pWorld = new CBenchWorld(1337);
+	CBenchRandom Random(7);
+	CSnapshotBuilder *pBuilder = new CSnapshotBuilder;
+	int aBaseAge[BENCH_MAX_CHARACTERS];
+
+	m_NumClients = g_BenchConfig.m_NumCharacters;
+	for(int i = 0; i < m_NumClients; i++)
+		aBaseAge[i] = Random.Range(1, Jitter);
+
+	for(int Age = HISTORY; Age > 0; Age--)
+	{
+		for(int i = 0; i < m_NumClients; i++)
+			if(aBaseAge[i] == Age)
+				m_aFromSize[i] = pWorld->Snap(pBuilder, i, m_aaFrom[i]);
+		pWorld->Step();
+	}
+	for(int i = 0; i < m_NumClients; i++)
+		m_aToSize[i] = pWorld->Snap(pBuilder, i, m_aaTo[i]);
+
+	delete pBuilder;
+	delete pWorld;
+}
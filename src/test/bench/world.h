@@ -0,0 +1,74 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef TEST_BENCH_WORLD_H
+#define TEST_BENCH_WORLD_H
+
+#include <engine/shared/snapshot.h>
+#include <generated/protocol.h>
+
+#include "bench.h"
+
+/*
+	Class: CBenchWorld
+		A small game world that produces snapshots looking like the
+		ones of a full server: moving characters, short living
+		projectiles and lasers, static pickups and player infos.
+		Sizes come from the benchmark config.
+*/
+class CBenchWorld
+{
+	struct CObject
+	{
+		int m_ID;
+		int m_X;
+		int m_Y;
+		int m_VelX;
+		int m_VelY;
+		int m_StartTick;
+		int m_LifeTime;
+	};
+
+	CBenchRandom m_Random;
+	int m_Tick;
+	int m_NextID;
+	CObject m_aCharacters[BENCH_MAX_CHARACTERS];
+	CObject m_aProjectiles[BENCH_MAX_PROJECTILES];
+	CObject m_aPickups[BENCH_MAX_PICKUPS];
+	CObject m_aLasers[BENCH_MAX_LASERS];
+
+	void Spawn(CObject *pObj, int LifeTime);
+	static bool Visible(const CObject *pViewer, int X, int Y);
+
+public:
+	CBenchWorld(unsigned Seed);
+
+	int Tick() const { return m_Tick; }
+	void Step();
+
+	// builds the snapshot the given client would get, -1 for everything
+	int Snap(CSnapshotBuilder *pBuilder, int ClientID, void *pSnapData);
+};
+
+/*
+	Class: CBenchSnapshots
+		The snapshots of every client for two ticks, the delta base of
+		each client is a few ticks old like on a server with jitter.
+*/
+class CBenchSnapshots
+{
+public:
+	CSnapshotDelta m_SnapshotDelta;
+	short m_aItemSizes[NUM_NETOBJTYPES];
+	int m_NumClients;
+	int m_aFromSize[BENCH_MAX_CHARACTERS];
+	int m_aToSize[BENCH_MAX_CHARACTERS];
+	char m_aaFrom[BENCH_MAX_CHARACTERS][CSnapshot::MAX_SIZE];
+	char m_aaTo[BENCH_MAX_CHARACTERS][CSnapshot::MAX_SIZE];
+
+	CBenchSnapshots();
+
+	CSnapshot *From(int ClientID) { return (CSnapshot *)m_aaFrom[ClientID]; }
+	CSnapshot *To(int ClientID) { return (CSnapshot *)m_aaTo[ClientID]; }
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <game/collision.h>
+#include <game/mapitems.h>
+
+// the per unit sampler IntersectLine used before
+static int IntersectLineSampled(const CCollision *pCollision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	const int End = distance(Pos0, Pos1)+1;
+	const float InverseEnd = 1.0f/End;
+	vec2 Last = Pos0;
+
+	for(int i = 0; i <= End; i++)
+	{
+		vec2 Pos = mix(Pos0, Pos1, i*InverseEnd);
+		if(pCollision->CheckPoint(Pos.x, Pos.y))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return pCollision->GetCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+// MoveBox testing the box after every step
+static void MoveBoxStepped(const CCollision *pCollision, vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath)
+{
+	vec2 Pos = *pInoutPos;
+	vec2 Vel = *pInoutVel;
+
+	const float Distance = length(Vel);
+	const int Max = (int)Distance;
+
+	*pDeath = false;
+
+	if(Distance > 0.00001f)
+	{
+		const float Fraction = 1.0f/(Max+1);
+		for(int i = 0; i <= Max; i++)
+		{
+			vec2 NewPos = Pos + Vel*Fraction;
+
+			if(pCollision->TestBox(vec2(NewPos.x, NewPos.y), Size*(2.0f/3.0f), CCollision::COLFLAG_DEATH))
+				*pDeath = true;
+
+			if(pCollision->TestBox(vec2(NewPos.x, NewPos.y), Size))
+			{
+				int Hits = 0;
+
+				if(pCollision->TestBox(vec2(Pos.x, NewPos.y), Size))
+				{
+					NewPos.y = Pos.y;
+					Vel.y *= -Elasticity;
+					Hits++;
+				}
+
+				if(pCollision->TestBox(vec2(NewPos.x, Pos.y), Size))
+				{
+					NewPos.x = Pos.x;
+					Vel.x *= -Elasticity;
+					Hits++;
+				}
+
+				if(Hits == 0)
+				{
+					NewPos.y = Pos.y;
+					Vel.y *= -Elasticity;
+					NewPos.x = Pos.x;
+					Vel.x *= -Elasticity;
+				}
+			}
+
+			Pos = NewPos;
+		}
+	}
+
+	*pInoutPos = Pos;
+	*pInoutVel = Vel;
+}
+
+static unsigned s_Seed = 4711;
+static int Random(int Max)
+{
+	s_Seed = s_Seed*1103515245+12345;
+	return (s_Seed >> 8) % Max;
+}
+
+static float RandomCoord(int Size)
+{
+	switch(Random(4))
+	{
+	// close to a tile border
+	case 0: return Random(Size/32+2)*32.0f - 1.0f + Random(2000)/1000.0f;
+	// exactly on a rounding border
+	case 1: return Random(Size)+0.5f;
+	default: return Random(Size+400)-200+Random(1000)/1000.0f;
+	}
+}
+
+static const int WIDTH = 60;
+static const int HEIGHT = 40;
+
+static CTile *RandomTiles()
+{
+	CTile *pTiles = new CTile[WIDTH*HEIGHT];
+	mem_zero(pTiles, sizeof(CTile)*WIDTH*HEIGHT);
+	for(int y = 0; y < HEIGHT; y++)
+		for(int x = 0; x < WIDTH; x++)
+		{
+			int r = Random(100);
+			if(x == 0 || y == 0 || x == WIDTH-1 || y == HEIGHT-1 ? r < 50 : r < 6)
+				pTiles[y*WIDTH+x].m_Index = TILE_SOLID;
+			else if(r < 8)
+				pTiles[y*WIDTH+x].m_Index = TILE_NOHOOK;
+			else if(r < 10)
+				pTiles[y*WIDTH+x].m_Index = TILE_DEATH;
+			else if(r < 11)
+				pTiles[y*WIDTH+x].m_Index = 200;
+		}
+	// an open area so boxes can move freely
+	for(int y = 5; y < 25; y++)
+		for(int x = 5; x < 35; x++)
+			pTiles[y*WIDTH+x].m_Index = 0;
+	return pTiles;
+}
+
+TEST(Collision, IntersectLineMatchesSampler)
+{
+	const int Width = WIDTH;
+	const int Height = HEIGHT;
+	CTile *pTiles = RandomTiles();
+	CCollision Collision;
+	Collision.Init(pTiles, Width, Height);
+
+	for(int i = 0; i < 50000; i++)
+	{
+		vec2 Pos0(RandomCoord(Width*32), RandomCoord(Height*32));
+		vec2 Pos1;
+		switch(Random(4))
+		{
+		case 0: Pos1 = vec2(Pos0.x, RandomCoord(Height*32)); break;
+		case 1: Pos1 = Pos0 + vec2(Random(200)-100, Random(200)-100) / 8.0f; break;
+		default: Pos1 = vec2(RandomCoord(Width*32), RandomCoord(Height*32));
+		}
+
+		vec2 Col, Before, SampledCol, SampledBefore;
+		int Hit = Collision.IntersectLine(Pos0, Pos1, &Col, &Before);
+		int SampledHit = IntersectLineSampled(&Collision, Pos0, Pos1, &SampledCol, &SampledBefore);
+		ASSERT_EQ(Hit, SampledHit) << Pos0.x << " " << Pos0.y << " " << Pos1.x << " " << Pos1.y;
+		ASSERT_EQ(mem_comp(&Col, &SampledCol, sizeof(vec2)), 0) << Pos0.x << " " << Pos0.y << " " << Pos1.x << " " << Pos1.y;
+		ASSERT_EQ(mem_comp(&Before, &SampledBefore, sizeof(vec2)), 0) << Pos0.x << " " << Pos0.y << " " << Pos1.x << " " << Pos1.y;
+	}
+
+	delete[] pTiles;
+}
+
+TEST(Collision, MoveBoxMatchesStepping)
+{
+	CTile *pTiles = RandomTiles();
+	CCollision Collision;
+	Collision.Init(pTiles, WIDTH, HEIGHT);
+
+	for(int i = 0; i < 2000; i++)
+	{
+		vec2 Pos(RandomCoord(WIDTH*32), RandomCoord(HEIGHT*32));
+		vec2 Vel(Random(4001)/100.0f-20.0f, Random(4001)/100.0f-20.0f);
+		vec2 Size(28.0f, 28.0f);
+		float Elasticity = Random(2) ? 0.0f : 0.5f;
+		vec2 SteppedPos = Pos;
+		vec2 SteppedVel = Vel;
+
+		// follow the box for a while like the character core does
+		for(int Tick = 0; Tick < 50; Tick++)
+		{
+			bool Death, SteppedDeath;
+			Collision.MoveBox(&Pos, &Vel, Size, Elasticity, &Death);
+			MoveBoxStepped(&Collision, &SteppedPos, &SteppedVel, Size, Elasticity, &SteppedDeath);
+			ASSERT_EQ(Death, SteppedDeath);
+			ASSERT_EQ(mem_comp(&Pos, &SteppedPos, sizeof(vec2)), 0);
+			ASSERT_EQ(mem_comp(&Vel, &SteppedVel, sizeof(vec2)), 0);
+			Vel.y += 0.5f;
+			SteppedVel.y += 0.5f;
+		}
+	}
+
+	delete[] pTiles;
+}
+
+TEST(Collision, FreeDistance)
+{
+	CTile *pTiles = RandomTiles();
+	CCollision Collision;
+	Collision.Init(pTiles, WIDTH, HEIGHT);
+
+	int NumFree = 0;
+	for(int i = 0; i < 50000; i++)
+	{
+		vec2 Pos(RandomCoord(WIDTH*32), RandomCoord(HEIGHT*32));
+		float Free = Collision.FreeDistance(Pos);
+		if(Free <= 0.0f)
+			continue;
+		NumFree++;
+
+		// anywhere on the border of the free square
+		for(int j = 0; j < 8; j++)
+		{
+			float Along = (Random(2001)-1000)/1000.0f*Free;
+			float Side = Random(2) ? Free : -Free;
+			vec2 Move = Random(2) ? vec2(Along, Side) : vec2(Side, Along);
+			ASSERT_EQ(Collision.GetCollisionAt(Pos.x+Move.x, Pos.y+Move.y), 0) << Pos.x << " " << Pos.y << " " << Move.x << " " << Move.y;
+		}
+	}
+	EXPECT_GT(NumFree, 1000);
+
+	delete[] pTiles;
+}
@@ -65,3 +65,167 @@ TEST(Datafile, RoundtripItemDataAndSize)
 
 	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
 }
+
+TEST(Datafile, SharedMapping)
+{
+	CTestInfo Info;
+	char aFilename[64];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	IStorage *pStorage = CreateTestStorage();
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, aFilename));
+
+	char aData[4096];
+	for(unsigned i = 0; i < sizeof(aData); i++)
+		aData[i] = i%7;
+	int Index = Writer.AddData(sizeof(aData), aData);
+	int aItem[2] = {Index, 5};
+	Writer.AddItem(3, 1, sizeof(aItem), aItem);
+	EXPECT_TRUE(Writer.Finish());
+
+	CDataFileReader First;
+	CDataFileReader Second;
+	ASSERT_TRUE(First.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+	ASSERT_TRUE(Second.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+
+	// items come from the same mapping, data is decompressed per reader
+	void *pItem = First.FindItem(3, 1);
+	ASSERT_TRUE(pItem);
+	EXPECT_EQ(pItem, Second.FindItem(3, 1));
+	EXPECT_TRUE(mem_comp(pItem, aItem, sizeof(aItem)) == 0);
+	EXPECT_EQ(sha256_comp(First.Sha256(), Second.Sha256()), 0);
+	EXPECT_EQ(First.Crc(), Second.Crc());
+
+	void *pData = First.GetData(Index);
+	ASSERT_TRUE(pData);
+	EXPECT_NE(pData, Second.GetData(Index));
+	ASSERT_EQ(First.GetDataSize(Index), (int)sizeof(aData));
+	EXPECT_TRUE(mem_comp(pData, aData, sizeof(aData)) == 0);
+
+	// the mapping outlives the first reader
+	EXPECT_TRUE(First.Close());
+	pItem = Second.FindItem(3, 1);
+	ASSERT_TRUE(pItem);
+	EXPECT_TRUE(mem_comp(pItem, aItem, sizeof(aItem)) == 0);
+	EXPECT_TRUE(mem_comp(Second.GetData(Index), aData, sizeof(aData)) == 0);
+	EXPECT_TRUE(Second.Close());
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+}
+
+// the test storage with the save directory moved away, its files count as data files
+class CDataDirStorage : public IStorage
+{
+	IStorage *m_pStorage;
+
+public:
+	CDataDirStorage() : m_pStorage(CreateTestStorage()) {}
+	~CDataDirStorage() { delete m_pStorage; }
+
+	virtual void ListDirectory(int Type, const char *pPath, FS_LISTDIR_CALLBACK pfnCallback, void *pUser) { m_pStorage->ListDirectory(Type, pPath, pfnCallback, pUser); }
+	virtual void ListDirectoryFileInfo(int Type, const char *pPath, FS_LISTDIR_CALLBACK_FILEINFO pfnCallback, void *pUser) { m_pStorage->ListDirectoryFileInfo(Type, pPath, pfnCallback, pUser); }
+	virtual IOHANDLE OpenFile(const char *pFilename, int Flags, int Type, char *pBuffer = 0, int BufferSize = 0, FCheckCallback pfnCheckCB = 0, const void *pCheckCBData = 0) { return m_pStorage->OpenFile(pFilename, Flags, Type, pBuffer, BufferSize, pfnCheckCB, pCheckCBData); }
+	virtual bool ReadFile(const char *pFilename, int Type, void **ppResult, unsigned *pResultLen) { return m_pStorage->ReadFile(pFilename, Type, ppResult, pResultLen); }
+	virtual char *ReadFileStr(const char *pFilename, int Type) { return m_pStorage->ReadFileStr(pFilename, Type); }
+	virtual bool FindFile(const char *pFilename, const char *pPath, int Type, char *pBuffer, int BufferSize) { return m_pStorage->FindFile(pFilename, pPath, Type, pBuffer, BufferSize); }
+	virtual bool FindFile(const char *pFilename, const char *pPath, int Type, char *pBuffer, int BufferSize, const SHA256_DIGEST *pWantedSha256, unsigned WantedCrc, unsigned WantedSize) { return m_pStorage->FindFile(pFilename, pPath, Type, pBuffer, BufferSize, pWantedSha256, WantedCrc, WantedSize); }
+	virtual bool RemoveFile(const char *pFilename, int Type) { return m_pStorage->RemoveFile(pFilename, Type); }
+	virtual bool RenameFile(const char *pOldFilename, const char *pNewFilename, int Type) { return m_pStorage->RenameFile(pOldFilename, pNewFilename, Type); }
+	virtual bool CreateFolder(const char *pFoldername, int Type) { return m_pStorage->CreateFolder(pFoldername, Type); }
+	virtual bool GetHashAndSize(const char *pFilename, int StorageType, SHA256_DIGEST *pSha256, unsigned *pCrc, unsigned *pSize) { return m_pStorage->GetHashAndSize(pFilename, StorageType, pSha256, pCrc, pSize); }
+	virtual bool GetFileTime(const char *pFilename, int StorageType, time_t *pCreated, time_t *pModified) { return m_pStorage->GetFileTime(pFilename, StorageType, pCreated, pModified); }
+
+	virtual void GetCompletePath(int Type, const char *pDir, char *pBuffer, unsigned BufferSize)
+	{
+		if(Type == TYPE_SAVE)
+			str_format(pBuffer, BufferSize, "elsewhere/%s", pDir);
+		else
+			m_pStorage->GetCompletePath(Type, pDir, pBuffer, BufferSize);
+	}
+};
+
+TEST(Datafile, MappedDataFile)
+{
+	CTestInfo Info;
+	char aFilename[64];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	IStorage *pStorage = CreateTestStorage();
+	CDataDirStorage DataStorage;
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, aFilename));
+
+	static int s_aItem[64*1024];
+	for(unsigned i = 0; i < sizeof(s_aItem)/sizeof(s_aItem[0]); i++)
+		s_aItem[i] = i*3;
+	Writer.AddItem(3, 1, sizeof(s_aItem), s_aItem);
+	EXPECT_TRUE(Writer.Finish());
+
+	// two readers of a large data file share one mapping
+	const int NumShared = CDataFileReader::NumSharedFiles();
+	CDataFileReader First;
+	CDataFileReader Second;
+	ASSERT_TRUE(First.Open(&DataStorage, aFilename, IStorage::TYPE_ALL));
+	ASSERT_TRUE(Second.Open(&DataStorage, aFilename, IStorage::TYPE_ALL));
+	EXPECT_TRUE(First.Mapped());
+	EXPECT_TRUE(Second.Mapped());
+	EXPECT_EQ(CDataFileReader::NumSharedFiles(), NumShared+1);
+
+	void *pItem = First.FindItem(3, 1);
+	ASSERT_TRUE(pItem);
+	EXPECT_EQ(pItem, Second.FindItem(3, 1));
+	EXPECT_TRUE(mem_comp(pItem, s_aItem, sizeof(s_aItem)) == 0);
+
+	// the mapping is released with the last reader
+	EXPECT_TRUE(First.Close());
+	EXPECT_EQ(CDataFileReader::NumSharedFiles(), NumShared+1);
+	pItem = Second.FindItem(3, 1);
+	ASSERT_TRUE(pItem);
+	EXPECT_TRUE(mem_comp(pItem, s_aItem, sizeof(s_aItem)) == 0);
+	EXPECT_TRUE(Second.Close());
+	EXPECT_EQ(CDataFileReader::NumSharedFiles(), NumShared);
+
+	// the same file from the save directory is read into memory
+	CDataFileReader Saved;
+	ASSERT_TRUE(Saved.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+	EXPECT_FALSE(Saved.Mapped());
+	EXPECT_EQ(CDataFileReader::NumSharedFiles(), NumShared+1);
+	EXPECT_TRUE(mem_comp(Saved.FindItem(3, 1), s_aItem, sizeof(s_aItem)) == 0);
+	EXPECT_TRUE(Saved.Close());
+	EXPECT_EQ(CDataFileReader::NumSharedFiles(), NumShared);
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+}
+
+TEST(Datafile, RewrittenWhileOpen)
+{
+	CTestInfo Info;
+	char aFilename[64];
+	Info.Filename(aFilename, sizeof(aFilename), ".datafile");
+	IStorage *pStorage = CreateTestStorage();
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, aFilename));
+
+	// large enough to be mapped if it wasn't in the save directory
+	static int s_aItem[64*1024];
+	for(unsigned i = 0; i < sizeof(s_aItem)/sizeof(s_aItem[0]); i++)
+		s_aItem[i] = i;
+	Writer.AddItem(3, 1, sizeof(s_aItem), s_aItem);
+	EXPECT_TRUE(Writer.Finish());
+
+	CDataFileReader Reader;
+	ASSERT_TRUE(Reader.Open(pStorage, aFilename, IStorage::TYPE_ALL));
+
+	// the editor saves over the file in place
+	CDataFileWriter Truncate;
+	ASSERT_TRUE(Truncate.Open(pStorage, aFilename));
+	int aSmall[2] = {1, 2};
+	Truncate.AddItem(3, 1, sizeof(aSmall), aSmall);
+	EXPECT_TRUE(Truncate.Finish());
+
+	void *pItem = Reader.FindItem(3, 1);
+	ASSERT_TRUE(pItem);
+	EXPECT_TRUE(mem_comp(pItem, s_aItem, sizeof(s_aItem)) == 0);
+	EXPECT_TRUE(Reader.Close());
+
+	EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+}
@@ -0,0 +1,293 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/hash.h>
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/snapshot.h>
+
+static const char *NETVERSION = "0.7 test";
+
+class CTestListener : public CDemoPlayer::IListener
+{
+public:
+	int m_NumSnapshots;
+	int m_NumMessages;
+	int m_SnapshotSize;
+	char m_aSnapshot[CSnapshot::MAX_SIZE];
+
+	CTestListener() : m_NumSnapshots(0), m_NumMessages(0), m_SnapshotSize(0) {}
+
+	void OnDemoPlayerSnapshot(void *pData, int Size)
+	{
+		m_NumSnapshots++;
+		m_SnapshotSize = Size;
+		mem_copy(m_aSnapshot, pData, Size);
+	}
+
+	void OnDemoPlayerMessage(void *pData, int Size)
+	{
+		m_NumMessages++;
+	}
+};
+
+class Demo : public ::testing::Test
+{
+protected:
+	CTestInfo m_Info;
+	IStorage *m_pStorage;
+	IConsole *m_pConsole;
+	CSnapshotDelta m_SnapshotDelta;
+	char m_aMapFilename[128];
+	char m_aDemoFilename[64];
+	char m_aStrippedFilename[64];
+
+	void SetUp()
+	{
+		m_pStorage = CreateTestStorage();
+		m_pConsole = CreateConsole(CFGFLAG_SERVER);
+
+		// an empty map is enough for the recorder
+		m_pStorage->CreateFolder("maps", IStorage::TYPE_SAVE);
+		str_format(m_aMapFilename, sizeof(m_aMapFilename), "maps/%s.map", m_Info.m_aFilenamePrefix);
+		io_close(m_pStorage->OpenFile(m_aMapFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE));
+
+		m_Info.Filename(m_aDemoFilename, sizeof(m_aDemoFilename), ".demo");
+		m_Info.Filename(m_aStrippedFilename, sizeof(m_aStrippedFilename), "-stripped.demo");
+	}
+
+	void TearDown()
+	{
+		m_pStorage->RemoveFile(m_aMapFilename, IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile(m_aDemoFilename, IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile(m_aStrippedFilename, IStorage::TYPE_SAVE);
+		delete m_pConsole;
+		delete m_pStorage;
+	}
+
+	void Record(int NumTicks, int KeyFrameInterval = SERVER_TICK_SPEED*5)
+	{
+		CDemoRecorder Recorder(&m_SnapshotDelta);
+		Recorder.Init(m_pConsole, m_pStorage);
+		ASSERT_EQ(Recorder.Start(m_aDemoFilename, NETVERSION, m_Info.m_aFilenamePrefix, sha256("", 0), 0, "server", KeyFrameInterval), 0);
+
+		char aSnap[CSnapshot::MAX_SIZE];
+		for(int Tick = 100; Tick < 100+NumTicks; Tick++)
+		{
+			CSnapshotBuilder Builder;
+			Builder.Init();
+			for(int i = 0; i < 8; i++)
+			{
+				int *pData = (int *)Builder.NewItem(1, i, sizeof(int)*2);
+				pData[0] = Tick/(i+1);
+				pData[1] = i;
+			}
+			int Size = Builder.Finish(aSnap);
+			Recorder.RecordSnapshot(Tick, aSnap, Size);
+			if(Tick%7 == 0)
+				Recorder.RecordMessage(&Tick, sizeof(Tick));
+		}
+		Recorder.Stop();
+	}
+
+	// write the demo without the trailing index, the way it looked before there was one
+	void Strip()
+	{
+		void *pData;
+		unsigned Size;
+		ASSERT_TRUE(m_pStorage->ReadFile(m_aDemoFilename, IStorage::TYPE_ALL, &pData, &Size));
+		ASSERT_GT(Size, 8u);
+		ASSERT_EQ(mem_comp((char *)pData+Size-4, "TWIX", 4), 0);
+		int IndexPos = bytes_be_to_int((unsigned char *)pData+Size-8);
+		ASSERT_LT(IndexPos, (int)Size);
+
+		IOHANDLE File = m_pStorage->OpenFile(m_aStrippedFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		io_write(File, pData, IndexPos);
+		io_close(File);
+		mem_free(pData);
+	}
+
+	void PlayToEnd(CDemoPlayer *pPlayer)
+	{
+		pPlayer->SetSpeed(1000000.0f);
+		for(int i = 0; i < 100000 && pPlayer->IsPlaying() && !pPlayer->BaseInfo()->m_Paused; i++)
+			pPlayer->Update();
+	}
+};
+
+TEST_F(Demo, IndexMatchesScan)
+{
+	Record(3000);
+	Strip();
+
+	CTestListener IndexedListener, ScannedListener;
+	CDemoPlayer *pIndexed = new CDemoPlayer(&m_SnapshotDelta);
+	CDemoPlayer *pScanned = new CDemoPlayer(&m_SnapshotDelta);
+	pIndexed->Init(m_pConsole, m_pStorage);
+	pScanned->Init(m_pConsole, m_pStorage);
+	pIndexed->SetListener(&IndexedListener);
+	pScanned->SetListener(&ScannedListener);
+	ASSERT_EQ(pIndexed->Load(m_aDemoFilename, IStorage::TYPE_ALL, NETVERSION), (const char *)0);
+	ASSERT_EQ(pScanned->Load(m_aStrippedFilename, IStorage::TYPE_ALL, NETVERSION), (const char *)0);
+
+	EXPECT_TRUE(pIndexed->Info()->m_HasIndex);
+	EXPECT_FALSE(pScanned->Info()->m_HasIndex);
+	EXPECT_EQ(pIndexed->Info()->m_SeekablePoints, pScanned->Info()->m_SeekablePoints);
+	EXPECT_GT(pIndexed->Info()->m_SeekablePoints, 1);
+	EXPECT_EQ(pIndexed->BaseInfo()->m_FirstTick, 100);
+	EXPECT_EQ(pIndexed->BaseInfo()->m_LastTick, 3099);
+	EXPECT_EQ(pScanned->BaseInfo()->m_FirstTick, 100);
+	EXPECT_EQ(pScanned->BaseInfo()->m_LastTick, 3099);
+
+	// seeking ends up at the same snapshots
+	pIndexed->Play();
+	pScanned->Play();
+	static const int s_aSeekTicks[] = {2000, 100, 3099, 777, 1351, 2600};
+	for(unsigned i = 0; i < sizeof(s_aSeekTicks)/sizeof(s_aSeekTicks[0]); i++)
+	{
+		pIndexed->SetPos(s_aSeekTicks[i]);
+		pScanned->SetPos(s_aSeekTicks[i]);
+		EXPECT_EQ(pIndexed->BaseInfo()->m_CurrentTick, pScanned->BaseInfo()->m_CurrentTick);
+		ASSERT_EQ(IndexedListener.m_SnapshotSize, ScannedListener.m_SnapshotSize);
+		EXPECT_EQ(mem_comp(IndexedListener.m_aSnapshot, ScannedListener.m_aSnapshot, IndexedListener.m_SnapshotSize), 0);
+	}
+
+	// the index is not played back
+	pIndexed->SetPos(100);
+	pScanned->SetPos(100);
+	IndexedListener = ScannedListener = CTestListener();
+	PlayToEnd(pIndexed);
+	PlayToEnd(pScanned);
+	EXPECT_TRUE(pIndexed->IsPlaying());
+	EXPECT_TRUE(pIndexed->BaseInfo()->m_Paused);
+	EXPECT_EQ(IndexedListener.m_NumSnapshots, ScannedListener.m_NumSnapshots);
+	EXPECT_EQ(IndexedListener.m_NumMessages, ScannedListener.m_NumMessages);
+	EXPECT_GT(IndexedListener.m_NumMessages, 0);
+
+	pIndexed->Stop();
+	pScanned->Stop();
+	delete pIndexed;
+	delete pScanned;
+}
+
+TEST_F(Demo, AddIndex)
+{
+	Record(1000);
+	Strip();
+
+	CDemoPlayer *pPlayer = new CDemoPlayer(&m_SnapshotDelta);
+	pPlayer->Init(m_pConsole, m_pStorage);
+	ASSERT_EQ(pPlayer->Load(m_aStrippedFilename, IStorage::TYPE_ALL, NETVERSION), (const char *)0);
+	ASSERT_FALSE(pPlayer->Info()->m_HasIndex);
+
+	char aPath[IO_MAX_PATH_LENGTH];
+	m_pStorage->GetCompletePath(IStorage::TYPE_SAVE, m_aStrippedFilename, aPath, sizeof(aPath));
+	IOHANDLE File = io_open(aPath, IOFLAG_APPEND);
+	ASSERT_TRUE(File);
+	io_seek(File, 0, IOSEEK_END);
+	EXPECT_TRUE(pPlayer->WriteIndex(File));
+	io_close(File);
+	pPlayer->Stop();
+	delete pPlayer;
+
+	// same as what the recorder wrote
+	void *pRecorded, *pAdded;
+	unsigned RecordedSize, AddedSize;
+	ASSERT_TRUE(m_pStorage->ReadFile(m_aDemoFilename, IStorage::TYPE_ALL, &pRecorded, &RecordedSize));
+	ASSERT_TRUE(m_pStorage->ReadFile(m_aStrippedFilename, IStorage::TYPE_ALL, &pAdded, &AddedSize));
+	ASSERT_EQ(RecordedSize, AddedSize);
+	EXPECT_EQ(mem_comp(pRecorded, pAdded, RecordedSize), 0);
+	mem_free(pRecorded);
+	mem_free(pAdded);
+}
+
+TEST_F(Demo, BrokenIndex)
+{
+	Record(1000);
+
+	// point the footer into the header, the player has to scan the file instead
+	void *pData;
+	unsigned Size;
+	ASSERT_TRUE(m_pStorage->ReadFile(m_aDemoFilename, IStorage::TYPE_ALL, &pData, &Size));
+	int_to_bytes_be((unsigned char *)pData+Size-8, 16);
+	IOHANDLE File = m_pStorage->OpenFile(m_aStrippedFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, pData, Size);
+	io_close(File);
+	mem_free(pData);
+
+	CDemoPlayer *pPlayer = new CDemoPlayer(&m_SnapshotDelta);
+	pPlayer->Init(m_pConsole, m_pStorage);
+	ASSERT_EQ(pPlayer->Load(m_aStrippedFilename, IStorage::TYPE_ALL, NETVERSION), (const char *)0);
+	EXPECT_FALSE(pPlayer->Info()->m_HasIndex);
+	EXPECT_EQ(pPlayer->BaseInfo()->m_FirstTick, 100);
+	EXPECT_EQ(pPlayer->BaseInfo()->m_LastTick, 1099);
+	pPlayer->Stop();
+	delete pPlayer;
+}
+
+TEST_F(Demo, KeyFrameInterval)
+{
+	Record(1000, 50);
+
+	CDemoPlayer *pPlayer = new CDemoPlayer(&m_SnapshotDelta);
+	pPlayer->Init(m_pConsole, m_pStorage);
+	ASSERT_EQ(pPlayer->Load(m_aDemoFilename, IStorage::TYPE_ALL, NETVERSION), (const char *)0);
+	EXPECT_EQ(pPlayer->Info()->m_SeekablePoints, 20);
+	pPlayer->Stop();
+	delete pPlayer;
+}
+
+TEST_F(Demo, SeekCache)
+{
+	Record(3000);
+
+	// seek around in one player so the later seeks start from cached snapshots
+	CTestListener CachedListener, FreshListener;
+	CDemoPlayer *pCached = new CDemoPlayer(&m_SnapshotDelta);
+	pCached->Init(m_pConsole, m_pStorage);
+	pCached->SetListener(&CachedListener);
+	ASSERT_EQ(pCached->Load(m_aDemoFilename, IStorage::TYPE_ALL, NETVERSION), (const char *)0);
+	pCached->Play();
+	pCached->SetPos(1000);
+	PlayToEnd(pCached);
+
+	// stepping backwards and forwards like the demo menu does
+	int Tick = 2000;
+	static const int s_aSteps[] = {0, -1, -1, -1, 3, 3, -1, -230, -1, 3, 400, -5, -1};
+	for(unsigned i = 0; i < sizeof(s_aSteps)/sizeof(s_aSteps[0]); i++)
+	{
+		Tick += s_aSteps[i];
+		pCached->SetPos(Tick);
+
+		CDemoPlayer *pFresh = new CDemoPlayer(&m_SnapshotDelta);
+		pFresh->Init(m_pConsole, m_pStorage);
+		pFresh->SetListener(&FreshListener);
+		ASSERT_EQ(pFresh->Load(m_aDemoFilename, IStorage::TYPE_ALL, NETVERSION), (const char *)0);
+		pFresh->Play();
+		pFresh->SetPos(Tick);
+
+		EXPECT_EQ(pCached->BaseInfo()->m_CurrentTick, pFresh->BaseInfo()->m_CurrentTick) << "tick " << Tick;
+		EXPECT_EQ(pCached->Info()->m_PreviousTick, pFresh->Info()->m_PreviousTick) << "tick " << Tick;
+		EXPECT_EQ(pCached->Info()->m_NextTick, pFresh->Info()->m_NextTick) << "tick " << Tick;
+		ASSERT_EQ(CachedListener.m_SnapshotSize, FreshListener.m_SnapshotSize) << "tick " << Tick;
+		EXPECT_EQ(mem_comp(CachedListener.m_aSnapshot, FreshListener.m_aSnapshot, CachedListener.m_SnapshotSize), 0) << "tick " << Tick;
+
+		pFresh->Stop();
+		delete pFresh;
+	}
+
+	// playing on from a cached snapshot gives the rest of the demo
+	CachedListener = CTestListener();
+	pCached->Unpause();
+	PlayToEnd(pCached);
+	EXPECT_EQ(pCached->BaseInfo()->m_CurrentTick, 3099);
+	EXPECT_EQ(CachedListener.m_NumSnapshots, 3099-Tick+1);
+
+	pCached->Stop();
+	delete pCached;
+}
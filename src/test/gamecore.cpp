@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/mapitems.h>
+
+static const int WIDTH = 40;
+static const int HEIGHT = 30;
+static const int NUM_CHARACTERS = 24;
+
+static unsigned s_RandomState = 1;
+static int Random(int Max)
+{
+	s_RandomState ^= s_RandomState << 13;
+	s_RandomState ^= s_RandomState >> 17;
+	s_RandomState ^= s_RandomState << 5;
+	return s_RandomState % Max;
+}
+
+// a closed room with a few platforms, small enough to keep everyone crowded
+static CTile *RoomTiles()
+{
+	CTile *pTiles = new CTile[WIDTH*HEIGHT];
+	mem_zero(pTiles, sizeof(CTile)*WIDTH*HEIGHT);
+	for(int y = 0; y < HEIGHT; y++)
+		for(int x = 0; x < WIDTH; x++)
+		{
+			if(x == 0 || y == 0 || x == WIDTH-1 || y == HEIGHT-1)
+				pTiles[y*WIDTH+x].m_Index = TILE_SOLID;
+			else if(y%6 == 0 && x%10 < 5)
+				pTiles[y*WIDTH+x].m_Index = TILE_SOLID;
+		}
+	return pTiles;
+}
+
+struct CTestWorld
+{
+	CWorldCore m_World;
+	CCharacterCore m_aCores[NUM_CHARACTERS];
+
+	void Init(CCollision *pCollision)
+	{
+		// Reset doesn't touch everything
+		mem_zero(m_aCores, sizeof(m_aCores));
+
+		// leave some slots empty
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+		{
+			m_aCores[i].Init(&m_World, pCollision);
+			m_aCores[i].Reset();
+			m_World.m_apCharacters[i*2] = &m_aCores[i];
+		}
+	}
+};
+
+// the core state that gets sent to clients plus what stays local
+static void ExpectEqual(const CCharacterCore *pA, const CCharacterCore *pB, int Tick, int ID)
+{
+	CNetObj_CharacterCore A, B;
+	mem_zero(&A, sizeof(A));
+	mem_zero(&B, sizeof(B));
+	pA->Write(&A);
+	pB->Write(&B);
+	EXPECT_EQ(mem_comp(&A, &B, sizeof(A)), 0) << "tick " << Tick << " character " << ID;
+	EXPECT_EQ(mem_comp(&pA->m_Pos, &pB->m_Pos, sizeof(vec2)), 0) << "tick " << Tick << " character " << ID;
+	EXPECT_EQ(mem_comp(&pA->m_Vel, &pB->m_Vel, sizeof(vec2)), 0) << "tick " << Tick << " character " << ID;
+	EXPECT_EQ(mem_comp(&pA->m_HookPos, &pB->m_HookPos, sizeof(vec2)), 0) << "tick " << Tick << " character " << ID;
+	EXPECT_EQ(pA->m_HookedPlayer, pB->m_HookedPlayer) << "tick " << Tick << " character " << ID;
+	EXPECT_EQ(pA->m_TriggeredEvents, pB->m_TriggeredEvents) << "tick " << Tick << " character " << ID;
+}
+
+TEST(GameCore, BatchedTickMatchesSingle)
+{
+	CTile *pTiles = RoomTiles();
+	CCollision Collision;
+	Collision.Init(pTiles, WIDTH, HEIGHT);
+
+	CTestWorld *pSingle = new CTestWorld;
+	CTestWorld *pBatched = new CTestWorld;
+	pSingle->Init(&Collision);
+	pBatched->Init(&Collision);
+
+	for(int i = 0; i < NUM_CHARACTERS; i++)
+	{
+		vec2 Pos = vec2(64.0f + Random(WIDTH*32-128), 64.0f + Random(HEIGHT*32-128));
+		pSingle->m_aCores[i].m_Pos = Pos;
+		pBatched->m_aCores[i].m_Pos = Pos;
+	}
+
+	for(int Tick = 0; Tick < 1000 && !::testing::Test::HasFailure(); Tick++)
+	{
+		bool aUseInput[MAX_CLIENTS] = { false };
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+		{
+			CNetObj_PlayerInput Input;
+			mem_zero(&Input, sizeof(Input));
+			Input.m_Direction = Random(3)-1;
+			Input.m_TargetX = Random(401)-200;
+			Input.m_TargetY = Random(401)-200;
+			Input.m_Jump = Random(8) == 0;
+			Input.m_Hook = Random(3) != 0;
+			pSingle->m_aCores[i].m_Input = Input;
+			pBatched->m_aCores[i].m_Input = Input;
+			aUseInput[i*2] = Random(4) != 0;
+		}
+
+		// one character at a time like the server does it
+		for(int c = 0; c < MAX_CLIENTS; c++)
+			if(pSingle->m_World.m_apCharacters[c])
+				pSingle->m_World.m_apCharacters[c]->Tick(aUseInput[c]);
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			CCharacterCore *pCore = pSingle->m_World.m_apCharacters[c];
+			if(!pCore)
+				continue;
+			pCore->AddDragVelocity();
+			pCore->ResetDragVelocity();
+			pCore->Move();
+			pCore->Quantize();
+		}
+
+		pBatched->m_World.Tick(aUseInput);
+
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+			ExpectEqual(&pSingle->m_aCores[i], &pBatched->m_aCores[i], Tick, i);
+	}
+
+	delete pSingle;
+	delete pBatched;
+	delete[] pTiles;
+}
+
+TEST(GameCore, FindCharacters)
+{
+	CWorldCore World;
+	CCharacterCore aCores[4];
+	mem_zero(aCores, sizeof(aCores));
+	for(int i = 0; i < 4; i++)
+	{
+		aCores[i].Init(&World, 0);
+		aCores[i].Reset();
+		aCores[i].m_Pos = vec2(100.0f*i, 0.0f);
+		World.m_apCharacters[i*3] = &aCores[i];
+	}
+
+	int aIDs[MAX_CLIENTS];
+	int Num = World.FindCharacters(vec2(0.0f, 0.0f), 150.0f, &aCores[0], aIDs);
+	ASSERT_EQ(Num, 1);
+	EXPECT_EQ(aIDs[0], 3);
+
+	Num = World.FindCharacters(vec2(150.0f, 0.0f), 60.0f, 0, aIDs);
+	ASSERT_EQ(Num, 2);
+	EXPECT_EQ(aIDs[0], 3);
+	EXPECT_EQ(aIDs[1], 6);
+}
+
+TEST(GameCore, FindCharactersMatchesBruteForce)
+{
+	CWorldCore World;
+	CCharacterCore aCores[NUM_CHARACTERS];
+	mem_zero(aCores, sizeof(aCores));
+	for(int i = 0; i < NUM_CHARACTERS; i++)
+	{
+		aCores[i].Init(&World, 0);
+		aCores[i].Reset();
+	}
+
+	int aIDs[MAX_CLIENTS];
+	for(int Round = 0; Round < 2000 && !::testing::Test::HasFailure(); Round++)
+	{
+		// a new crowd every round, some slots stay empty
+		mem_zero(World.m_apCharacters, sizeof(World.m_apCharacters));
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+			World.m_apCharacters[Random(MAX_CLIENTS)] = &aCores[i];
+
+		// far out on the map, where floats get coarse
+		vec2 Center = vec2((float)Random(20000), (float)Random(20000));
+		float Radius = 1.0f + Random(2000)/10.0f;
+
+		// many of them right at the radius, the others anywhere around
+		for(int i = 0; i < NUM_CHARACTERS; i++)
+		{
+			float Angle = Random(3600)/3600.0f*2*pi;
+			float Dist = Random(2) ? Radius*(0.999f+Random(21)/10000.0f) : (float)Random((int)Radius*3+1);
+			aCores[i].m_Pos = Center + vec2(cosf(Angle), sinf(Angle))*Dist;
+		}
+
+		const CCharacterCore *pExclude = Random(2) ? &aCores[Random(NUM_CHARACTERS)] : 0;
+		int Num = World.FindCharacters(Center, Radius, pExclude, aIDs);
+
+		// a plain loop over everyone with the exact check the callers do
+		int Found = 0;
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			const CCharacterCore *pCore = World.m_apCharacters[i];
+			if(!pCore || pCore == pExclude || !(distance(Center, pCore->m_Pos) < Radius))
+				continue;
+			while(Found < Num && aIDs[Found] < i)
+				Found++;
+			ASSERT_TRUE(Found < Num && aIDs[Found] == i) << "round " << Round << " missed character " << i;
+		}
+
+		// anything extra is only a candidate, but it has to be a valid one in client id order
+		for(int n = 0; n < Num; n++)
+		{
+			EXPECT_TRUE(World.m_apCharacters[aIDs[n]]) << "round " << Round;
+			EXPECT_NE(World.m_apCharacters[aIDs[n]], pExclude) << "round " << Round;
+			if(n > 0)
+			{
+				EXPECT_LT(aIDs[n-1], aIDs[n]) << "round " << Round;
+			}
+		}
+	}
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/huffman.h>
+
+static unsigned s_Seed = 1;
+static int Random(int Max)
+{
+	s_Seed = s_Seed*1103515245+12345;
+	return (s_Seed >> 8) % Max;
+}
+
+// random bytes, mostly zeros like snapshot deltas, or small values
+static void FillBuffer(unsigned char *pData, int Size, int Kind)
+{
+	for(int i = 0; i < Size; i++)
+	{
+		if(Kind == 0)
+			pData[i] = Random(256);
+		else if(Kind == 1)
+			pData[i] = Random(4) ? 0 : Random(256);
+		else
+			pData[i] = Random(3) ? Random(8) : 128+Random(4);
+	}
+}
+
+TEST(Huffman, KnownOutput)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+	unsigned char aOut[64];
+
+	static const unsigned char s_aEmpty[] = {0x8a, 0x1b};
+	static const unsigned char s_aZeros[] = {0xff, 0x8a, 0x1b};
+	static const unsigned char s_aText[] = {0x50, 0xc2, 0x09, 0x9c, 0xa0, 0xb8, 0xb5, 0x45, 0x70, 0x72, 0x25, 0x38, 0x91, 0x4e, 0x15, 0x37, 0x00};
+
+	ASSERT_EQ(Huffman.Compress("", 0, aOut, sizeof(aOut)), (int)sizeof(s_aEmpty));
+	EXPECT_EQ(mem_comp(aOut, s_aEmpty, sizeof(s_aEmpty)), 0);
+	ASSERT_EQ(Huffman.Compress("\0\0\0\0\0\0\0\0", 8, aOut, sizeof(aOut)), (int)sizeof(s_aZeros));
+	EXPECT_EQ(mem_comp(aOut, s_aZeros, sizeof(s_aZeros)), 0);
+	ASSERT_EQ(Huffman.Compress("teeworlds", 9, aOut, sizeof(aOut)), (int)sizeof(s_aText));
+	EXPECT_EQ(mem_comp(aOut, s_aText, sizeof(s_aText)), 0);
+}
+
+// the output of the bit at a time coder this one replaced
+TEST(Huffman, SameOutputAsBefore)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+	unsigned char aIn[2048], aOut[4096];
+	unsigned Hash = 2166136261u;
+	int Total = 0;
+
+	s_Seed = 1;
+	for(int n = 0; n < 300; n++)
+	{
+		int Size = Random(n < 100 ? 16 : 1400);
+		FillBuffer(aIn, Size, n%3);
+		int OutSize = Huffman.Compress(aIn, Size, aOut, sizeof(aOut));
+		Total += OutSize;
+		for(int i = 0; i < OutSize; i++)
+			Hash = (Hash^aOut[i])*16777619u;
+	}
+	EXPECT_EQ(Total, 124411);
+	EXPECT_EQ(Hash, 3122883417u);
+}
+
+TEST(Huffman, Roundtrip)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+	unsigned char aIn[2048], aPacked[4096], aOut[2048];
+
+	for(int n = 0; n < 500; n++)
+	{
+		int Size = Random(n%2 ? 8 : 2048);
+		FillBuffer(aIn, Size, n%3);
+		int PackedSize = Huffman.Compress(aIn, Size, aPacked, sizeof(aPacked));
+		ASSERT_GT(PackedSize, 0);
+		ASSERT_EQ(Huffman.Decompress(aPacked, PackedSize, aOut, sizeof(aOut)), Size);
+		ASSERT_EQ(mem_comp(aIn, aOut, Size), 0);
+
+		// exactly enough room
+		ASSERT_EQ(Huffman.Decompress(aPacked, PackedSize, aOut, Size), Size);
+		if(Size > 0)
+		{
+			ASSERT_EQ(Huffman.Decompress(aPacked, PackedSize, aOut, Size-1), -1);
+		}
+		ASSERT_EQ(Huffman.Compress(aIn, Size, aPacked, PackedSize), PackedSize);
+		ASSERT_EQ(Huffman.Compress(aIn, Size, aPacked, PackedSize-1), -1);
+	}
+}
+
+TEST(Huffman, BrokenInput)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+	unsigned char aIn[512], aPacked[1024], aOut[512];
+
+	for(int n = 0; n < 500; n++)
+	{
+		int Size = Random(512);
+		FillBuffer(aIn, Size, n%3);
+		int PackedSize = Huffman.Compress(aIn, Size, aPacked, sizeof(aPacked));
+
+		// cut off before the eof symbol
+		int Cut = Random(PackedSize-1);
+		int Result = Huffman.Decompress(aPacked, Cut, aOut, sizeof(aOut));
+		ASSERT_LE(Result, Size);
+
+		// garbage has to stay inside of the output
+		FillBuffer(aPacked, PackedSize, 0);
+		Result = Huffman.Decompress(aPacked, PackedSize, aOut, Size);
+		ASSERT_LE(Result, Size);
+	}
+}
+
+TEST(Huffman, Adaptive)
+{
+	CAdaptiveHuffman Sender;
+	CAdaptiveHuffman Receiver;
+	CHuffman Static;
+	Sender.Init();
+	Receiver.Init();
+	Static.Init();
+	unsigned char aIn[1400], aPacked[2048], aOut[1400];
+	int AdaptiveTotal = 0;
+	int StaticTotal = 0;
+
+	// text compresses badly with the table made for snapshots
+	for(int n = 0; n < 200; n++)
+	{
+		int Size = 200+Random(1200);
+		for(int i = 0; i < Size; i++)
+			aIn[i] = "etaoin shrdlu"[Random(13)];
+
+		int PackedSize = Sender.Compress(aIn, Size, aPacked, sizeof(aPacked));
+		ASSERT_GT(PackedSize, 0);
+		ASSERT_EQ(Receiver.Decompress(aPacked, PackedSize, aOut, sizeof(aOut)), Size);
+		ASSERT_EQ(mem_comp(aIn, aOut, Size), 0);
+
+		AdaptiveTotal += PackedSize;
+		StaticTotal += Static.Compress(aIn, Size, aPacked, sizeof(aPacked));
+	}
+	EXPECT_LT(AdaptiveTotal, StaticTotal*2/3);
+}
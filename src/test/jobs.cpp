@@ -0,0 +1,103 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/jobs.h>
+
+static int Square(void *pUser)
+{
+	int *pValue = (int *)pUser;
+	*pValue = *pValue * *pValue;
+	return *pValue;
+}
+
+static void RunSquares(int NumThreads)
+{
+	CJobPool Pool;
+	Pool.Init(NumThreads);
+
+	CJob aJobs[64];
+	int aValues[64];
+	for(int i = 0; i < 64; i++)
+	{
+		aValues[i] = i;
+		Pool.Add(&aJobs[i], Square, &aValues[i]);
+	}
+	for(int i = 0; i < 64; i++)
+	{
+		Pool.Wait(&aJobs[i]);
+		EXPECT_EQ(aJobs[i].Status(), CJob::STATE_DONE);
+		EXPECT_EQ(aJobs[i].Result(), i*i);
+		EXPECT_EQ(aValues[i], i*i);
+	}
+	Pool.Shutdown();
+}
+
+struct CFanOut
+{
+	CJobPool *m_pPool;
+	CJob m_aJobs[16];
+	int m_aValues[16];
+};
+
+// fans out into more jobs from inside a job and joins them again
+static int SumOfSquares(void *pUser)
+{
+	CFanOut *pFanOut = (CFanOut *)pUser;
+	CJobGroup Group;
+	for(int i = 0; i < 16; i++)
+	{
+		pFanOut->m_aValues[i] = i;
+		pFanOut->m_pPool->Add(&pFanOut->m_aJobs[i], Square, &pFanOut->m_aValues[i], &Group);
+	}
+	pFanOut->m_pPool->Wait(&Group);
+
+	int Sum = 0;
+	for(int i = 0; i < 16; i++)
+		Sum += pFanOut->m_aValues[i];
+	return Sum;
+}
+
+static void RunGroups(int NumThreads)
+{
+	CJobPool Pool;
+	Pool.Init(NumThreads);
+
+	CJobGroup Group;
+	CJob aJobs[8];
+	CFanOut aFanOuts[8];
+	for(int i = 0; i < 8; i++)
+	{
+		aFanOuts[i].m_pPool = &Pool;
+		Pool.Add(&aJobs[i], SumOfSquares, &aFanOuts[i], &Group);
+	}
+	Pool.Wait(&Group);
+	EXPECT_TRUE(Group.Done());
+	for(int i = 0; i < 8; i++)
+	{
+		EXPECT_EQ(aJobs[i].Status(), CJob::STATE_DONE);
+		EXPECT_EQ(aJobs[i].Result(), 1240);
+	}
+	Pool.Shutdown();
+}
+
+TEST(Jobs, WaitWithoutThreads)
+{
+	RunSquares(0);
+}
+
+TEST(Jobs, WaitWithThreads)
+{
+	RunSquares(3);
+}
+
+TEST(Jobs, GroupsWithoutThreads)
+{
+	RunGroups(0);
+}
+
+TEST(Jobs, GroupsWithThreads)
+{
+	RunGroups(4);
+}
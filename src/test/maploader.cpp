@@ -0,0 +1,141 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/engine.h>
+#include <engine/map.h>
+#include <engine/message.h>
+#include <engine/storage.h>
+#include <engine/shared/datafile.h>
+#include <engine/shared/maploader.h>
+#include <engine/shared/network.h>
+#include <engine/shared/protocol.h>
+#include <game/mapitems.h>
+
+// only the job pool of the engine is needed
+class CTestEngine : public IEngine
+{
+public:
+	CTestEngine() { m_JobPool.Init(1); }
+	~CTestEngine() { m_JobPool.Shutdown(); }
+
+	virtual void Init() {}
+	virtual void ShutdownJobs() { m_JobPool.Shutdown(); }
+	virtual void InitLogfile() {}
+	virtual void QueryNetLogHandles(IOHANDLE *pHDLSend, IOHANDLE *pHDLRecv) { *pHDLSend = 0; *pHDLRecv = 0; }
+	virtual void HostLookup(CHostLookup *pLookup, const char *pHostname, int Nettype) {}
+	virtual void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData) { m_JobPool.Add(pJob, pfnFunc, pData); }
+};
+
+static void WriteMap(IStorage *pStorage, const char *pFilename, int NumBlocks, int Seed)
+{
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, pFilename));
+
+	CMapItemVersion Version;
+	Version.m_Version = CMapItemVersion::CURRENT_VERSION;
+	Writer.AddItem(MAPITEMTYPE_VERSION, 0, sizeof(Version), &Version);
+
+	// big and badly compressible, so hashing and reading it takes a while
+	enum { BLOCK_SIZE=1024*1024 };
+	unsigned *pBlock = (unsigned *)mem_alloc(BLOCK_SIZE);
+	unsigned State = Seed;
+	for(int b = 0; b < NumBlocks; b++)
+	{
+		for(unsigned i = 0; i < BLOCK_SIZE/sizeof(unsigned); i++)
+		{
+			State ^= State<<13; State ^= State>>17; State ^= State<<5;
+			pBlock[i] = State;
+		}
+		Writer.AddData(BLOCK_SIZE, pBlock);
+	}
+	mem_free(pBlock);
+	EXPECT_TRUE(Writer.Finish());
+}
+
+TEST(MapLoader, KeepMapWhileLoading)
+{
+	enum { CHUNK_SIZE=NET_MAX_PAYLOAD-NET_MAX_CHUNKHEADERSIZE-4 };
+	CTestInfo Info;
+	char aName[2][64];
+	char aFilename[2][IO_MAX_PATH_LENGTH];
+	IStorage *pStorage = CreateTestStorage();
+	pStorage->CreateFolder("maps", IStorage::TYPE_SAVE);
+	for(int i = 0; i < 2; i++)
+	{
+		str_format(aName[i], sizeof(aName[i]), "%s-%d", Info.m_aFilenamePrefix, i);
+		str_format(aFilename[i], sizeof(aFilename[i]), "maps/%s.map", aName[i]);
+		WriteMap(pStorage, aFilename[i], 16-i*8, i+1);
+	}
+
+	CTestEngine Engine;
+	CMapLoader Loader;
+	Loader.Init(pStorage, 0, CHUNK_SIZE);
+	IEngineMap *pMap = CreateEngineMap();
+	CMapChunks Chunks;
+
+	// the first map is loaded right away like on server start
+	Loader.Start(aName[0], 0);
+	EXPECT_TRUE(Loader.Done());
+	ASSERT_TRUE(Loader.Finish(pMap, &Chunks));
+	EXPECT_FALSE(Loader.Pending());
+	ASSERT_TRUE(pMap->IsLoaded());
+	SHA256_DIGEST FirstSha256 = pMap->Sha256();
+	int FirstFileSize = Chunks.FileSize();
+
+	// change to the second one while ticking, the current map and its
+	// chunks stay untouched until the load reports completion
+	Loader.Start(aName[1], &Engine);
+	EXPECT_TRUE(Loader.Pending());
+	while(!Loader.Done())
+	{
+		ASSERT_TRUE(Loader.Pending());
+		ASSERT_TRUE(pMap->IsLoaded());
+		ASSERT_TRUE(pMap->FindItem(MAPITEMTYPE_VERSION, 0) != 0);
+		ASSERT_EQ(sha256_comp(FirstSha256, pMap->Sha256()), 0);
+		ASSERT_EQ(Chunks.FileSize(), FirstFileSize);
+		thread_sleep(1);
+	}
+	EXPECT_FALSE(Loader.Error());
+
+	// being done alone does not swap anything
+	EXPECT_TRUE(Loader.Pending());
+	EXPECT_EQ(sha256_comp(FirstSha256, pMap->Sha256()), 0);
+	EXPECT_EQ(Chunks.FileSize(), FirstFileSize);
+
+	ASSERT_TRUE(Loader.Finish(pMap, &Chunks));
+	EXPECT_FALSE(Loader.Pending());
+	EXPECT_FALSE(Loader.Done());
+	ASSERT_TRUE(pMap->IsLoaded());
+	EXPECT_NE(sha256_comp(FirstSha256, pMap->Sha256()), 0);
+
+	// the chunks put back together are the map file
+	IOHANDLE File = pStorage->OpenFile(aFilename[1], IOFLAG_READ, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	int FileSize = (int)io_length(File);
+	EXPECT_EQ(Chunks.FileSize(), FileSize);
+	EXPECT_EQ(Chunks.NumChunks(), (FileSize+CHUNK_SIZE-1)/CHUNK_SIZE);
+	unsigned char aBuf[CHUNK_SIZE];
+	for(int i = 0; i < Chunks.NumChunks(); i++)
+	{
+		int Size = minimum((int)CHUNK_SIZE, FileSize-i*CHUNK_SIZE);
+		CMsgUnpacker Unpacker(Chunks.Msg(i), Chunks.MsgSize(i));
+		ASSERT_FALSE(Unpacker.Error());
+		EXPECT_TRUE(Unpacker.System());
+		EXPECT_EQ(Unpacker.Type(), NETMSG_MAP_DATA);
+		const unsigned char *pData = Unpacker.GetRaw(Size);
+		ASSERT_FALSE(Unpacker.Error());
+		ASSERT_EQ(io_read(File, aBuf, Size), (unsigned)Size);
+		ASSERT_EQ(mem_comp(pData, aBuf, Size), 0);
+	}
+	io_close(File);
+
+	pMap->Unload();
+	delete pMap;
+	for(int i = 0; i < 2; i++)
+		EXPECT_TRUE(pStorage->RemoveFile(aFilename[i], IStorage::TYPE_SAVE));
+}
@@ -0,0 +1,216 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/config.h>
+#include <engine/shared/network.h>
+
+// one end of a connection on a loopback socket, keeps the vital chunks it got
+class CTestPeer
+{
+public:
+	CConfig m_Config;
+	CNetBase m_Base;
+	CNetConnection m_Conn;
+	CNetRecvUnpacker m_Unpacker;
+	NETADDR m_Addr;
+	int m_aReceived[NET_MAX_SEQUENCE*2];
+	int m_NumReceived;
+	bool m_Open;
+
+	CTestPeer() : m_NumReceived(0), m_Open(false) { mem_zero(&m_Config, sizeof(m_Config)); }
+	~CTestPeer() { if(m_Open) m_Base.Shutdown(); }
+
+	bool Open(int FirstPort)
+	{
+		mem_zero(&m_Addr, sizeof(m_Addr));
+		m_Addr.type = NETTYPE_IPV4;
+		for(int Port = FirstPort; Port < FirstPort+100; Port++)
+		{
+			m_Addr.port = Port;
+			NETSOCKET Socket = net_udp_create(m_Addr, 0);
+			if(Socket.type != NETTYPE_INVALID)
+			{
+				net_addr_from_str(&m_Addr, "127.0.0.1");
+				m_Addr.port = Port;
+				m_Base.Init(Socket, &m_Config, 0, 0);
+				m_Conn.Init(&m_Base, false);
+				m_Open = true;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// feeds everything that arrived to the connection like the net client does
+	void Receive()
+	{
+		m_Base.Wait(50);
+		while(1)
+		{
+			NETADDR Addr;
+			int Result = m_Base.UnpackPacket(&Addr, m_Unpacker.m_aBuffer, &m_Unpacker.m_Data);
+			if(Result > 0)
+				break;
+			if(Result < 0 || !m_Conn.Feed(&m_Unpacker.m_Data, &Addr))
+				continue;
+
+			m_Unpacker.Start(&Addr, &m_Conn, 0);
+			CNetChunk Chunk;
+			while(m_Unpacker.FetchChunk(&Chunk))
+			{
+				if(Chunk.m_Flags&NETSENDFLAG_VITAL && Chunk.m_DataSize == sizeof(int) && m_NumReceived < NET_MAX_SEQUENCE*2)
+					mem_copy(&m_aReceived[m_NumReceived++], Chunk.m_pData, sizeof(int));
+			}
+		}
+	}
+
+	// throws away everything that arrived, as if it got lost
+	void Drop()
+	{
+		m_Base.Wait(50);
+		NETADDR Addr;
+		while(m_Base.UnpackPacket(&Addr, m_Unpacker.m_aBuffer, &m_Unpacker.m_Data) <= 0);
+	}
+
+	void Send(int Value)
+	{
+		m_Conn.QueueChunk(NET_CHUNKFLAG_VITAL, sizeof(Value), &Value);
+	}
+
+	// sends an ack without new vital data
+	void Ack()
+	{
+		m_Conn.QueueChunk(0, 0, 0);
+		m_Conn.Flush();
+	}
+};
+
+// runs the handshake, the client end takes the token from the server without a token manager
+static void Connect(CTestPeer *pClient, CTestPeer *pServer)
+{
+	pServer->m_Conn.SetToken(0x12345678);
+	ASSERT_EQ(pClient->m_Conn.Connect(&pServer->m_Addr), 0);
+	pServer->Drop();
+
+	CNetPacketConstruct Token;
+	mem_zero(&Token, sizeof(Token));
+	Token.m_Flags = NET_PACKETFLAG_CONTROL;
+	Token.m_Token = pClient->m_Conn.Token();
+	Token.m_ResponseToken = pServer->m_Conn.Token();
+	Token.m_aChunkData[0] = NET_CTRLMSG_TOKEN;
+	Token.m_DataSize = 1;
+	pClient->m_Conn.Feed(&Token, &pServer->m_Addr);
+	ASSERT_EQ(pClient->m_Conn.State(), (unsigned)NET_CONNSTATE_CONNECT);
+
+	pServer->Receive();
+	ASSERT_EQ(pServer->m_Conn.State(), (unsigned)NET_CONNSTATE_PENDING);
+	pClient->Receive();
+	ASSERT_EQ(pClient->m_Conn.State(), (unsigned)NET_CONNSTATE_ONLINE);
+	pClient->Ack();
+	pServer->Receive();
+	ASSERT_EQ(pServer->m_Conn.State(), (unsigned)NET_CONNSTATE_ONLINE);
+}
+
+TEST(NetConnection, FullWindow)
+{
+	enum
+	{
+		WINDOW=NET_MAX_SEQUENCE/2,
+		NUM_CHUNKS=WINDOW+100,
+	};
+
+	CTestPeer Client, Server;
+	ASSERT_TRUE(Client.Open(38503));
+	ASSERT_TRUE(Server.Open(38603));
+	ASSERT_NO_FATAL_FAILURE(Connect(&Client, &Server));
+
+	// only half the sequence space goes out, the rest is held back
+	for(int i = 0; i < NUM_CHUNKS; i++)
+		Client.Send(i);
+	Client.m_Conn.Flush();
+	EXPECT_EQ(Client.m_Conn.NumInFlight(), (int)WINDOW);
+	EXPECT_EQ(Client.m_Conn.NumHeld(), NUM_CHUNKS-WINDOW);
+
+	Server.Receive();
+	ASSERT_EQ(Server.m_NumReceived, (int)WINDOW);
+
+	// the ack releases the held chunks
+	Server.Ack();
+	Client.Receive();
+	EXPECT_EQ(Client.m_Conn.NumInFlight(), NUM_CHUNKS-WINDOW);
+	EXPECT_EQ(Client.m_Conn.NumHeld(), 0);
+	Client.m_Conn.Flush();
+
+	Server.Receive();
+	ASSERT_EQ(Server.m_NumReceived, (int)NUM_CHUNKS);
+	for(int i = 0; i < NUM_CHUNKS; i++)
+		EXPECT_EQ(Server.m_aReceived[i], i);
+
+	Server.Ack();
+	Client.Receive();
+	EXPECT_EQ(Client.m_Conn.NumInFlight(), 0);
+	EXPECT_STREQ(Client.m_Conn.ErrorString(), "");
+}
+
+TEST(NetConnection, Resend)
+{
+	CTestPeer Client, Server;
+	ASSERT_TRUE(Client.Open(38503));
+	ASSERT_TRUE(Server.Open(38603));
+	ASSERT_NO_FATAL_FAILURE(Connect(&Client, &Server));
+
+	// the first chunk gets lost, the second one arrives out of sequence
+	Client.Send(1);
+	Client.m_Conn.Flush();
+	Server.Drop();
+	Client.Send(2);
+	Client.m_Conn.Flush();
+	Server.Receive();
+	EXPECT_EQ(Server.m_NumReceived, 0);
+
+	// the server asks for a resend, which sends both again in order
+	Server.Ack();
+	Client.Receive();
+	EXPECT_EQ(Client.m_Conn.NumInFlight(), 2);
+	Client.m_Conn.Flush();
+	Server.Receive();
+	ASSERT_EQ(Server.m_NumReceived, 2);
+	EXPECT_EQ(Server.m_aReceived[0], 1);
+	EXPECT_EQ(Server.m_aReceived[1], 2);
+
+	Server.Ack();
+	Client.Receive();
+	EXPECT_EQ(Client.m_Conn.NumInFlight(), 0);
+}
+
+TEST(NetConnection, ResendTimeout)
+{
+	CTestPeer Client, Server;
+	ASSERT_TRUE(Client.Open(38503));
+	ASSERT_TRUE(Server.Open(38603));
+	ASSERT_NO_FATAL_FAILURE(Connect(&Client, &Server));
+
+	// one second without a round trip time
+	EXPECT_EQ(Client.m_Conn.ResendTimeout(), time_freq());
+
+	// a fast round trip is held at 200ms
+	Client.Send(1);
+	Client.m_Conn.Flush();
+	Server.Receive();
+	Server.Ack();
+	Client.Receive();
+	ASSERT_EQ(Client.m_Conn.NumInFlight(), 0);
+	EXPECT_EQ(Client.m_Conn.ResendTimeout(), time_freq()/5);
+
+	// a slow one at one second
+	Client.Send(2);
+	Client.m_Conn.Flush();
+	Server.Receive();
+	thread_sleep(1100);
+	Server.Ack();
+	Client.Receive();
+	ASSERT_EQ(Client.m_Conn.NumInFlight(), 0);
+	EXPECT_EQ(Client.m_Conn.ResendTimeout(), time_freq());
+}
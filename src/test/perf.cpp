@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <engine/shared/perf.h>
+
+TEST(Perf, Buckets)
+{
+	for(int Time = 0; Time < 100000; Time++)
+	{
+		int Bucket = CPerfTimers::Bucket(Time);
+		ASSERT_LT(Bucket, (int)CPerfTimers::NUM_BUCKETS);
+		ASSERT_GE(CPerfTimers::BucketMax(Bucket), Time);
+		if(Bucket > 0)
+		{
+			ASSERT_LT(CPerfTimers::BucketMax(Bucket-1), Time);
+		}
+	}
+	EXPECT_LT(CPerfTimers::Bucket(0x7fffffff), (int)CPerfTimers::NUM_BUCKETS);
+}
+
+TEST(Perf, Percentiles)
+{
+	CPerfTimers Timers;
+	int Section = Timers.Register("tick");
+	EXPECT_EQ(Timers.Register("tick"), Section);
+	Timers.SetEnabled(true);
+
+	int64 Now = time_get();
+	Timers.Update(Now);
+	for(int i = 1; i <= 1000; i++)
+		Timers.Add(Section, time_freq()*i/1000000);
+	Timers.Add(Section, time_freq()/100);
+
+	// nothing before the second is over
+	Timers.Update(Now+time_freq()/2);
+	EXPECT_EQ(Timers.Result(Section)->m_Count, 0);
+
+	Timers.Update(Now+time_freq());
+	const CPerfTimers::CResult *pResult = Timers.Result(Section);
+	EXPECT_EQ(pResult->m_Count, 1001);
+	EXPECT_EQ(pResult->m_Max, 10000);
+	// within the bucket precision of one eighth
+	EXPECT_GE(pResult->m_P50, 490);
+	EXPECT_LE(pResult->m_P50, 500*9/8);
+	EXPECT_GE(pResult->m_P99, 980);
+	EXPECT_LE(pResult->m_P99, 1000*9/8);
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/snapshot.h>
+
+static void AddItem(CSnapshotBuilder *pBuilder, int Type, int ID, int Value)
+{
+	int *pData = (int *)pBuilder->NewItem(Type, ID, sizeof(int)*2);
+	ASSERT_TRUE(pData);
+	pData[0] = Value;
+	pData[1] = -Value;
+}
+
+static int Key(int Type, int ID)
+{
+	return (Type<<16)|ID;
+}
+
+TEST(Snapshot, SharedBase)
+{
+	CSnapshotBuilder *pShared = new CSnapshotBuilder;
+	CSnapshotBuilder *pDirect = new CSnapshotBuilder;
+	char *pSharedData = new char[CSnapshot::MAX_SIZE];
+	char *pDirectData = new char[CSnapshot::MAX_SIZE];
+
+	pShared->Init();
+	AddItem(pShared, 4, 7, 100);
+	AddItem(pShared, 2, 1, 200);
+	AddItem(pShared, 4, 3, 300);
+	pShared->HideItems(2, 1);
+	pShared->FinishBase();
+
+	// first client doesn't see the second base item and gets an own item
+	pShared->InitFromBase();
+	pShared->SkipItem(1);
+	pShared->KeepItem(2);
+	AddItem(pShared, 1, 5, 400);
+	int SharedSize = pShared->Finish(pSharedData);
+
+	pDirect->Init();
+	AddItem(pDirect, 1, 5, 400);
+	AddItem(pDirect, 4, 3, 300);
+	AddItem(pDirect, 4, 7, 100);
+	int DirectSize = pDirect->Finish(pDirectData);
+
+	EXPECT_EQ(DirectSize, SharedSize);
+	EXPECT_EQ(mem_comp(pDirectData, pSharedData, DirectSize), 0);
+
+	// second client sees the whole base again, with the hidden item
+	pShared->InitFromBase();
+	pShared->KeepItem(2);
+	AddItem(pShared, 3, 0, 500);
+	SharedSize = pShared->Finish(pSharedData);
+
+	pDirect->Init();
+	AddItem(pDirect, 4, 7, 100);
+	AddItem(pDirect, 2, 1, 200);
+	AddItem(pDirect, 4, 3, 300);
+	AddItem(pDirect, 3, 0, 500);
+	DirectSize = pDirect->Finish(pDirectData);
+
+	EXPECT_EQ(DirectSize, SharedSize);
+	EXPECT_EQ(mem_comp(pDirectData, pSharedData, DirectSize), 0);
+	EXPECT_EQ(((CSnapshot *)pSharedData)->NumItems(), 4);
+
+	// third client skips the first item and keeps the hidden one only once
+	pShared->InitFromBase();
+	pShared->KeepItem(2);
+	pShared->KeepItem(2);
+	pShared->SkipItem(0);
+	pShared->SkipItem(2);
+	pShared->KeepItem(2);
+	SharedSize = pShared->Finish(pSharedData);
+
+	pDirect->Init();
+	AddItem(pDirect, 2, 1, 200);
+	AddItem(pDirect, 4, 3, 300);
+	DirectSize = pDirect->Finish(pDirectData);
+
+	EXPECT_EQ(DirectSize, SharedSize);
+	EXPECT_EQ(mem_comp(pDirectData, pSharedData, DirectSize), 0);
+
+	// fourth client takes back the skip and drops the kept item again
+	pShared->InitFromBase();
+	pShared->SkipItem(0);
+	pShared->KeepItem(0);
+	pShared->KeepItem(2);
+	pShared->SkipItem(2);
+	SharedSize = pShared->Finish(pSharedData);
+
+	pDirect->Init();
+	AddItem(pDirect, 4, 7, 100);
+	AddItem(pDirect, 2, 1, 200);
+	DirectSize = pDirect->Finish(pDirectData);
+
+	EXPECT_EQ(DirectSize, SharedSize);
+	EXPECT_EQ(mem_comp(pDirectData, pSharedData, DirectSize), 0);
+
+	delete[] pDirectData;
+	delete[] pSharedData;
+	delete pDirect;
+	delete pShared;
+}
+
+TEST(Snapshot, CrowdedBase)
+{
+	enum
+	{
+		NUM_CLIENTS=4,
+		NUM_SHARED=CSnapshotBuilder::MAX_ITEMS*2,
+		NUM_LARGE=CSnapshot::MAX_SIZE/256,
+		LARGE_SIZE=256,
+	};
+
+	CSnapshotBuilder *pBuilder = new CSnapshotBuilder;
+	char *pData = new char[CSnapshot::MAX_SIZE];
+	pBuilder->SetCapacity(CSnapshotBuilder::MAX_ITEMS*8, CSnapshot::MAX_SIZE*8);
+
+	// more shared items than fit into one snapshot, both by count and by size
+	pBuilder->Init();
+	for(int i = 0; i < NUM_SHARED; i++)
+		AddItem(pBuilder, 4, i, i);
+	for(int i = 0; i < NUM_LARGE; i++)
+		ASSERT_TRUE(pBuilder->NewItem(5, i, LARGE_SIZE));
+	pBuilder->HideItems(NUM_SHARED, NUM_LARGE);
+	pBuilder->FinishBase();
+
+	for(int c = 0; c < NUM_CLIENTS; c++)
+	{
+		// the first client sees the whole base, the others only the small items
+		pBuilder->InitFromBase();
+		if(c == 0)
+		{
+			for(int i = 0; i < NUM_LARGE; i++)
+				pBuilder->KeepItem(NUM_SHARED+i);
+		}
+		AddItem(pBuilder, 9, c, 100+c);
+		AddItem(pBuilder, 11, c, 200+c);
+		AddItem(pBuilder, 10, c, 300+c);
+		int Size = pBuilder->Finish(pData);
+		const CSnapshot *pSnap = (CSnapshot *)pData;
+
+		EXPECT_LE(Size, CSnapshot::MAX_SIZE);
+		EXPECT_LT(pSnap->NumItems(), CSnapshotBuilder::MAX_ITEMS);
+		EXPECT_GT(pSnap->NumItems(), CSnapshotBuilder::MAX_ITEMS/2);
+		for(int Type = 9; Type <= 11; Type++)
+		{
+			int Index = pSnap->GetItemIndex(Key(Type, c));
+			ASSERT_GE(Index, 0) << "client " << c << " type " << Type;
+			EXPECT_EQ(pSnap->GetItem(Index)->Data()[0], Type == 9 ? 100+c : Type == 11 ? 200+c : 300+c);
+		}
+		for(int Other = 0; Other < NUM_CLIENTS; Other++)
+		{
+			if(Other == c)
+				continue;
+			EXPECT_EQ(pSnap->GetItemIndex(Key(9, Other)), -1);
+		}
+
+		// keys are still sorted for the delta
+		for(int i = 1; i < pSnap->NumItems(); i++)
+			EXPECT_LT(pSnap->GetItem(i-1)->Key(), pSnap->GetItem(i)->Key());
+	}
+
+	delete[] pData;
+	delete pBuilder;
+}
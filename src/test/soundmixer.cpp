@@ -0,0 +1,304 @@
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/sound.h>
+#include <engine/shared/soundmixer.h>
+
+#include <math.h>
+#include <limits.h>
+
+static const int MAX_FRAMES = 1024;
+
+static unsigned s_RandomState = 1;
+static int Random(int Max)
+{
+	s_RandomState ^= s_RandomState << 13;
+	s_RandomState ^= s_RandomState >> 17;
+	s_RandomState ^= s_RandomState << 5;
+	return s_RandomState % Max;
+}
+
+static void CreateSample(CSoundSample *pSample, int Channels, int NumFrames)
+{
+	mem_zero(pSample, sizeof(*pSample));
+	pSample->m_pData = (short *)mem_alloc(NumFrames*Channels*sizeof(short));
+	for(int i = 0; i < NumFrames*Channels; i++)
+		pSample->m_pData[i] = Random(65536)-32768;
+	pSample->m_NumFrames = NumFrames;
+	pSample->m_Channels = Channels;
+	pSample->m_Rate = 48000;
+}
+
+// the straightforward mix, one frame at a time with the volumes computed every time
+class CReferenceMixer
+{
+public:
+	struct CVoice
+	{
+		const CSoundSample *m_pSample;
+		int m_ChannelID;
+		int m_Tick;
+		int m_Flags;
+		int m_X;
+		int m_Y;
+	};
+
+	CVoice m_aVoices[CSoundMixer::NUM_VOICES];
+	int m_aChannelVol[CSoundMixer::NUM_CHANNELS];
+	int m_CenterX;
+	int m_CenterY;
+	float m_MaxDistance;
+	int m_MasterVol;
+
+	CReferenceMixer()
+	{
+		mem_zero(m_aVoices, sizeof(m_aVoices));
+		for(int i = 0; i < CSoundMixer::NUM_CHANNELS; i++)
+			m_aChannelVol[i] = 255;
+		m_CenterX = 0;
+		m_CenterY = 0;
+		m_MaxDistance = 1500.0f;
+		m_MasterVol = 100;
+	}
+
+	void Mix(short *pFinalOut, int Frames)
+	{
+		int aMix[MAX_FRAMES*2] = {0};
+		for(int i = 0; i < CSoundMixer::NUM_VOICES; i++)
+		{
+			CVoice *v = &m_aVoices[i];
+			if(!v->m_pSample)
+				continue;
+
+			int Lvol = m_aChannelVol[v->m_ChannelID];
+			int Rvol = Lvol;
+			if(v->m_Flags&ISound::FLAG_POS)
+			{
+				int dx = v->m_X - m_CenterX;
+				int dy = v->m_Y - m_CenterY;
+				float Dist = sqrtf((float)dx*dx+(float)dy*dy);
+				if(Dist < m_MaxDistance)
+				{
+					float FalloffAmp = Lvol * (1.0f - Dist/m_MaxDistance);
+					float Lpan = 0.5f - dx/m_MaxDistance/2.0f;
+					Lvol = (int)(FalloffAmp*sqrtf(Lpan));
+					Rvol = (int)(FalloffAmp*sqrtf(1.0f - Lpan));
+				}
+				else
+					Lvol = Rvol = 0;
+			}
+
+			int Step = v->m_pSample->m_Channels;
+			for(int f = 0; f < Frames && v->m_Tick < v->m_pSample->m_NumFrames; f++, v->m_Tick++)
+			{
+				const short *pIn = &v->m_pSample->m_pData[v->m_Tick*Step];
+				aMix[f*2] += pIn[0]*Lvol;
+				aMix[f*2+1] += pIn[Step-1]*Rvol;
+			}
+
+			if(v->m_Tick == v->m_pSample->m_NumFrames)
+			{
+				if(v->m_Flags&ISound::FLAG_LOOP)
+					v->m_Tick = 0;
+				else
+					v->m_pSample = 0;
+			}
+		}
+
+		float Scale = m_MasterVol/(101.0f*256.0f);
+		for(int i = 0; i < Frames*2; i++)
+			pFinalOut[i] = clamp((int)(aMix[i]*Scale), SHRT_MIN, SHRT_MAX);
+	}
+};
+
+TEST(SoundMixer, MatchesReference)
+{
+	static const int NUM_SAMPLES = 6;
+	CSoundSample aSamples[NUM_SAMPLES];
+	for(int i = 0; i < NUM_SAMPLES; i++)
+		CreateSample(&aSamples[i], i%2+1, 300 + Random(3000));
+
+	CSoundMixer *pMixer = new CSoundMixer;
+	CReferenceMixer *pReference = new CReferenceMixer;
+	pMixer->Init(MAX_FRAMES);
+	pMixer->SetMasterVolume(70);
+	pReference->m_MasterVol = 70;
+
+	short aOut[MAX_FRAMES*2];
+	short aExpected[MAX_FRAMES*2];
+	for(int Block = 0; Block < 200 && !::testing::Test::HasFailure(); Block++)
+	{
+		// start a few voices, some of them out of hearing range
+		for(int n = Random(4); n > 0; n--)
+		{
+			CSoundSample *pSample = &aSamples[Random(NUM_SAMPLES)];
+			int Channel = Random(CSoundMixer::NUM_CHANNELS);
+			int Flags = Random(3) ? ISound::FLAG_POS : 0;
+			if(Random(20) == 0)
+				Flags |= ISound::FLAG_LOOP;
+			int x = Random(4000)-2000;
+			int y = Random(4000)-2000;
+			int VoiceID = pMixer->Play(Channel, pSample, Flags, x, y);
+			if(VoiceID == -1)
+				continue;
+			CReferenceMixer::CVoice *pVoice = &pReference->m_aVoices[VoiceID];
+			ASSERT_FALSE(pVoice->m_pSample);
+			pVoice->m_pSample = pSample;
+			pVoice->m_ChannelID = Channel;
+			pVoice->m_Tick = 0;
+			pVoice->m_Flags = Flags;
+			pVoice->m_X = x;
+			pVoice->m_Y = y;
+		}
+
+		if(Random(4) == 0)
+		{
+			pReference->m_CenterX = Random(2000)-1000;
+			pReference->m_CenterY = Random(2000)-1000;
+			pMixer->SetListenerPos(pReference->m_CenterX, pReference->m_CenterY);
+		}
+		if(Random(10) == 0)
+		{
+			int Channel = Random(CSoundMixer::NUM_CHANNELS);
+			pReference->m_aChannelVol[Channel] = Random(256);
+			pMixer->SetChannelVolume(Channel, pReference->m_aChannelVol[Channel]);
+		}
+		if(Random(20) == 0)
+		{
+			pReference->m_MaxDistance = 500.0f + Random(1500);
+			pMixer->SetMaxDistance(pReference->m_MaxDistance);
+		}
+
+		int Frames = 1 + Random(MAX_FRAMES);
+		pMixer->Mix(aOut, Frames);
+		pReference->Mix(aExpected, Frames);
+		ASSERT_EQ(mem_comp(aOut, aExpected, Frames*2*sizeof(short)), 0) << "block " << Block;
+	}
+
+	delete pMixer;
+	delete pReference;
+	for(int i = 0; i < NUM_SAMPLES; i++)
+		mem_free(aSamples[i].m_pData);
+}
+
+TEST(SoundMixer, OutOfRange)
+{
+	CSoundSample Sample;
+	CreateSample(&Sample, 1, 1000);
+
+	CSoundMixer Mixer;
+	Mixer.Init(MAX_FRAMES);
+	Mixer.SetMaxDistance(100.0f);
+	ASSERT_NE(Mixer.Play(0, &Sample, ISound::FLAG_POS, 100, 0), -1);
+	EXPECT_TRUE(Mixer.IsPlaying(&Sample));
+
+	// silent, but it still ends when it would have
+	short aOut[MAX_FRAMES*2];
+	short aSilence[MAX_FRAMES*2] = {0};
+	Mixer.Mix(aOut, 600);
+	EXPECT_EQ(mem_comp(aOut, aSilence, 600*2*sizeof(short)), 0);
+	EXPECT_TRUE(Mixer.IsPlaying(&Sample));
+
+	// coming closer makes it audible
+	Mixer.SetListenerPos(50, 0);
+	Mixer.Mix(aOut, 100);
+	EXPECT_NE(mem_comp(aOut, aSilence, 100*2*sizeof(short)), 0);
+	Mixer.Mix(aOut, 300);
+	EXPECT_FALSE(Mixer.IsPlaying(&Sample));
+
+	mem_free(Sample.m_pData);
+}
+
+TEST(SoundMixer, Commands)
+{
+	CSoundSample Loop, Shot;
+	CreateSample(&Loop, 2, 1000);
+	CreateSample(&Shot, 1, 100000);
+
+	CSoundMixer Mixer;
+	Mixer.Init(MAX_FRAMES);
+	short aOut[MAX_FRAMES*2];
+
+	// voices are taken until the mixer releases them
+	for(int i = 0; i < CSoundMixer::NUM_VOICES; i++)
+		EXPECT_NE(Mixer.Play(0, &Shot, 0, 0, 0), -1);
+	EXPECT_EQ(Mixer.Play(0, &Loop, 0, 0, 0), -1);
+	EXPECT_FALSE(Mixer.IsPlaying(&Loop));
+	Mixer.Stop(&Shot);
+	EXPECT_TRUE(Mixer.IsPlaying(&Shot));
+	Mixer.Mix(aOut, 16);
+	EXPECT_FALSE(Mixer.IsPlaying(&Shot));
+
+	// a stopped loop continues where it was
+	ASSERT_NE(Mixer.Play(0, &Loop, ISound::FLAG_LOOP, 0, 0), -1);
+	Mixer.Mix(aOut, 700);
+	Mixer.Mix(aOut, 700);
+	Mixer.Stop(&Loop);
+	Mixer.Mix(aOut, 16);
+	EXPECT_FALSE(Mixer.IsPlaying(&Loop));
+	EXPECT_EQ(Loop.m_PausedAt, 0);
+
+	Mixer.Play(0, &Loop, ISound::FLAG_LOOP, 0, 0);
+	Mixer.Mix(aOut, 250);
+	Mixer.StopAll();
+	Mixer.Mix(aOut, 16);
+	EXPECT_FALSE(Mixer.IsPlaying(&Loop));
+	EXPECT_EQ(Loop.m_PausedAt, 250);
+
+	Mixer.Play(0, &Loop, ISound::FLAG_LOOP, 0, 0);
+	Mixer.Mix(aOut, 100);
+	Mixer.StopAll();
+	Mixer.Mix(aOut, 16);
+	EXPECT_EQ(Loop.m_PausedAt, 350);
+
+	mem_free(Loop.m_pData);
+	mem_free(Shot.m_pData);
+}
+
+TEST(SoundMixer, StopOverflow)
+{
+	CSoundSample Loop, Other;
+	CreateSample(&Loop, 2, 1000);
+	CreateSample(&Other, 1, 1000);
+
+	CSoundMixer Mixer;
+	Mixer.Init(MAX_FRAMES);
+	short aOut[MAX_FRAMES*2];
+
+	ASSERT_NE(Mixer.Play(0, &Loop, ISound::FLAG_LOOP, 0, 0), -1);
+	Mixer.Mix(aOut, 100);
+
+	// the mixer doesn't run while the queue fills up, the stops still arrive
+	for(int i = 0; i < 300; i++)
+		Mixer.Stop(&Other);
+	EXPECT_EQ(Mixer.Play(0, &Other, 0, 0, 0), -1);
+	Mixer.Stop(&Loop);
+	Mixer.Mix(aOut, 16);
+	EXPECT_FALSE(Mixer.IsPlaying(&Loop));
+	EXPECT_EQ(Loop.m_PausedAt, 100);
+
+	// sounds played after an overflowed stop keep playing
+	ASSERT_NE(Mixer.Play(0, &Loop, ISound::FLAG_LOOP, 0, 0), -1);
+	Mixer.Mix(aOut, 16);
+	EXPECT_TRUE(Mixer.IsPlaying(&Loop));
+
+	for(int i = 0; i < 256; i++)
+		Mixer.Stop(&Other);
+	Mixer.StopAll();
+	Mixer.Mix(aOut, 16);
+	EXPECT_FALSE(Mixer.IsPlaying(&Loop));
+
+	// more overflowed stops than there is room for turn into stopping everything
+	ASSERT_NE(Mixer.Play(0, &Loop, ISound::FLAG_LOOP, 0, 0), -1);
+	for(int i = 0; i < 400; i++)
+		Mixer.Stop(&Other);
+	Mixer.Mix(aOut, 16);
+	EXPECT_FALSE(Mixer.IsPlaying(&Loop));
+	ASSERT_NE(Mixer.Play(0, &Loop, ISound::FLAG_LOOP, 0, 0), -1);
+	Mixer.Mix(aOut, 16);
+	EXPECT_TRUE(Mixer.IsPlaying(&Loop));
+
+	mem_free(Loop.m_pData);
+	mem_free(Other.m_pData);
+}
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <game/spatialgrid.h>
+
+static const int NUM_ITEMS = 300;
+
+struct CTestItem
+{
+	vec2 m_Pos;
+	float m_Radius;
+	bool m_Inserted;
+	CSpatialGrid::CNode m_Node;
+};
+
+// the linear walks the queries replace, over the items newest first
+class CBruteForce
+{
+public:
+	CTestItem *m_apOrder[NUM_ITEMS];
+	int m_Num;
+
+	CBruteForce() : m_Num(0) {}
+
+	void Insert(CTestItem *pItem)
+	{
+		for(int i = m_Num; i > 0; i--)
+			m_apOrder[i] = m_apOrder[i-1];
+		m_apOrder[0] = pItem;
+		m_Num++;
+	}
+
+	void Remove(CTestItem *pItem)
+	{
+		int i = 0;
+		while(m_apOrder[i] != pItem)
+			i++;
+		for(; i < m_Num-1; i++)
+			m_apOrder[i] = m_apOrder[i+1];
+		m_Num--;
+	}
+
+	int FindItems(vec2 Pos, float Radius, void **ppItems, int Max)
+	{
+		int Num = 0;
+		for(int i = 0; i < m_Num; i++)
+		{
+			if(distance(m_apOrder[i]->m_Pos, Pos) < Radius+m_apOrder[i]->m_Radius)
+			{
+				if(ppItems)
+					ppItems[Num] = m_apOrder[i];
+				Num++;
+				if(Num == Max)
+					break;
+			}
+		}
+		return Num;
+	}
+
+	// marks the items instead of listing them, the grid finds them in any order
+	int FindItemsInRect(vec2 Min, vec2 Max, bool *pFound)
+	{
+		int Num = 0;
+		for(int i = 0; i < m_Num; i++)
+		{
+			vec2 Pos = m_apOrder[i]->m_Pos;
+			vec2 Closest(clamp(Pos.x, Min.x, Max.x), clamp(Pos.y, Min.y, Max.y));
+			if(distance(Pos, Closest) <= m_apOrder[i]->m_Radius)
+			{
+				pFound[i] = true;
+				Num++;
+			}
+		}
+		return Num;
+	}
+
+	void *ClosestItem(vec2 Pos, float Radius, const void *pNotThis)
+	{
+		float ClosestRange = Radius*2;
+		CTestItem *pClosest = 0;
+		for(int i = 0; i < m_Num; i++)
+		{
+			CTestItem *p = m_apOrder[i];
+			if(p == pNotThis)
+				continue;
+			float Len = distance(Pos, p->m_Pos);
+			if(Len < p->m_Radius+Radius && Len < ClosestRange)
+			{
+				ClosestRange = Len;
+				pClosest = p;
+			}
+		}
+		return pClosest;
+	}
+
+	void *IntersectItem(vec2 Pos0, vec2 Pos1, float Radius, vec2 *pNewPos, const void *pNotThis)
+	{
+		float ClosestLen = distance(Pos0, Pos1) * 100.0f;
+		CTestItem *pClosest = 0;
+		for(int i = 0; i < m_Num; i++)
+		{
+			CTestItem *p = m_apOrder[i];
+			if(p == pNotThis)
+				continue;
+			vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, p->m_Pos);
+			float Len = distance(p->m_Pos, IntersectPos);
+			if(Len < p->m_Radius+Radius)
+			{
+				Len = distance(Pos0, IntersectPos);
+				if(Len < ClosestLen)
+				{
+					*pNewPos = IntersectPos;
+					ClosestLen = Len;
+					pClosest = p;
+				}
+			}
+		}
+		return pClosest;
+	}
+};
+
+static unsigned s_Seed = 12345;
+static int Random(int Max)
+{
+	s_Seed = s_Seed*1103515245+12345;
+	return (s_Seed >> 8) % Max;
+}
+
+// positions snap to a coarse raster now and then to provoke ties
+static vec2 RandomPos()
+{
+	if(Random(4) == 0)
+		return vec2(Random(30)*64.0f, Random(15)*64.0f);
+	return vec2(Random(2200)-100+Random(100)/100.0f, Random(1200)-100+Random(100)/100.0f);
+}
+
+TEST(SpatialGrid, MatchesBruteForce)
+{
+	CTestItem *pItems = new CTestItem[NUM_ITEMS];
+	CSpatialGrid Grid;
+	CBruteForce Brute;
+
+	// a few items before the grid is set up
+	for(int i = 0; i < 20; i++)
+	{
+		pItems[i].m_Pos = RandomPos();
+		pItems[i].m_Radius = Random(2) ? 28.0f : 0.0f;
+		pItems[i].m_Inserted = true;
+		Grid.Insert(&pItems[i].m_Node, &pItems[i], pItems[i].m_Pos, pItems[i].m_Radius);
+		Brute.Insert(&pItems[i]);
+	}
+	Grid.Init(2000.0f, 1000.0f, 256.0f);
+	for(int i = 20; i < NUM_ITEMS; i++)
+	{
+		pItems[i].m_Pos = RandomPos();
+		pItems[i].m_Radius = Random(2) ? 28.0f : 0.0f;
+		pItems[i].m_Inserted = true;
+		Grid.Insert(&pItems[i].m_Node, &pItems[i], pItems[i].m_Pos, pItems[i].m_Radius);
+		Brute.Insert(&pItems[i]);
+	}
+
+	void *apGrid[NUM_ITEMS];
+	void *apBrute[NUM_ITEMS];
+	for(int Round = 0; Round < 2000; Round++)
+	{
+		// move, remove and reinsert items
+		for(int k = 0; k < 10; k++)
+		{
+			CTestItem *pItem = &pItems[Random(NUM_ITEMS)];
+			int Action = Random(8);
+			if(!pItem->m_Inserted)
+			{
+				pItem->m_Pos = RandomPos();
+				pItem->m_Inserted = true;
+				Grid.Insert(&pItem->m_Node, pItem, pItem->m_Pos, pItem->m_Radius);
+				Brute.Insert(pItem);
+			}
+			else if(Action == 0)
+			{
+				pItem->m_Inserted = false;
+				Grid.Remove(&pItem->m_Node);
+				Brute.Remove(pItem);
+			}
+			else if(Action == 2)
+			{
+				// grow or shrink like a laser beam
+				pItem->m_Pos = RandomPos();
+				pItem->m_Radius = Random(400);
+				Grid.Move(&pItem->m_Node, pItem->m_Pos, pItem->m_Radius);
+			}
+			else
+			{
+				pItem->m_Pos = Action == 1 ? RandomPos() : pItem->m_Pos + vec2(Random(61)-30, Random(61)-30);
+				Grid.Move(&pItem->m_Node, pItem->m_Pos);
+			}
+		}
+		ASSERT_EQ(Grid.NumItems(), Brute.m_Num);
+
+		vec2 Pos = RandomPos();
+		float Radius = Random(10) == 0 ? Random(2000) : Random(200);
+		int Max = 1+Random(Random(2) ? 8 : NUM_ITEMS);
+		int NumGrid = Grid.FindItems(Pos, Radius, apGrid, Max);
+		int NumBrute = Brute.FindItems(Pos, Radius, apBrute, Max);
+		ASSERT_EQ(NumGrid, NumBrute);
+		for(int i = 0; i < NumGrid; i++)
+			ASSERT_EQ(apGrid[i], apBrute[i]);
+		ASSERT_EQ(Grid.FindItems(Pos, Radius, 0, Max), NumBrute);
+
+		vec2 Size(Random(2000), Random(1600));
+		bool aFound[NUM_ITEMS] = { false };
+		int NumRect = Grid.FindItemsInRect(Pos-Size*0.5f, Pos+Size*0.5f, apGrid, NUM_ITEMS);
+		ASSERT_EQ(NumRect, Brute.FindItemsInRect(Pos-Size*0.5f, Pos+Size*0.5f, aFound));
+		for(int i = 0; i < NumRect; i++)
+		{
+			int Index = 0;
+			while(Brute.m_apOrder[Index] != apGrid[i])
+				Index++;
+			ASSERT_TRUE(aFound[Index]);
+			aFound[Index] = false;
+		}
+
+		const void *pNotThis = Random(2) ? &pItems[Random(NUM_ITEMS)] : 0;
+		ASSERT_EQ(Grid.ClosestItem(Pos, Radius, pNotThis), Brute.ClosestItem(Pos, Radius, pNotThis));
+
+		vec2 Pos1 = Pos + vec2(Random(1601)-800, Random(1601)-800);
+		float LineRadius = Random(3) == 0 ? 0.0f : 6.0f;
+		vec2 GridPos(-1, -1), BrutePos(-1, -1);
+		ASSERT_EQ(Grid.IntersectItem(Pos, Pos1, LineRadius, &GridPos, pNotThis), Brute.IntersectItem(Pos, Pos1, LineRadius, &BrutePos, pNotThis));
+		ASSERT_EQ(GridPos.x, BrutePos.x);
+		ASSERT_EQ(GridPos.y, BrutePos.y);
+	}
+
+	delete[] pItems;
+}
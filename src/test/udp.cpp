@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+static NETSOCKET OpenLocal(NETADDR *pAddr)
+{
+	mem_zero(pAddr, sizeof(*pAddr));
+	pAddr->type = NETTYPE_IPV4;
+	for(int Port = 38303; Port < 38403; Port++)
+	{
+		pAddr->port = Port;
+		NETSOCKET Socket = net_udp_create(*pAddr, 0);
+		if(Socket.type != NETTYPE_INVALID)
+		{
+			net_addr_from_str(pAddr, "127.0.0.1");
+			pAddr->port = Port;
+			return Socket;
+		}
+	}
+	NETSOCKET Invalid;
+	net_invalidate_socket(&Invalid);
+	return Invalid;
+}
+
+TEST(Udp, Batch)
+{
+	enum
+	{
+		NUM_PACKETS=100,
+		PACKET_SIZE=48,
+	};
+
+	NETADDR Local;
+	NETSOCKET Recv = OpenLocal(&Local);
+	ASSERT_NE(Recv.type, NETTYPE_INVALID);
+	NETADDR Any = {NETTYPE_IPV4, {0}, 0};
+	NETSOCKET Send = net_udp_create(Any, 1);
+	ASSERT_NE(Send.type, NETTYPE_INVALID);
+
+	static unsigned char s_aaData[NUM_PACKETS][PACKET_SIZE];
+	NETDATAGRAM aDatagrams[NUM_PACKETS];
+	for(int i = 0; i < NUM_PACKETS; i++)
+	{
+		for(int j = 0; j < PACKET_SIZE; j++)
+			s_aaData[i][j] = i+j;
+		aDatagrams[i].addr = Local;
+		aDatagrams[i].data = s_aaData[i];
+		aDatagrams[i].size = 1+i%PACKET_SIZE;
+	}
+
+	NETSTATS Before;
+	net_stats(&Before);
+	EXPECT_EQ(net_udp_send_batch(Send, aDatagrams, NUM_PACKETS), NUM_PACKETS);
+	NETSTATS After;
+	net_stats(&After);
+	EXPECT_EQ(After.sent_packets-Before.sent_packets, NUM_PACKETS);
+
+	static unsigned char s_aaRecvData[NUM_PACKETS][PACKET_SIZE];
+	NETDATAGRAM aRecv[NUM_PACKETS];
+	int Received = 0;
+	int64 Timeout = time_get()+time_freq()*2;
+	while(Received < NUM_PACKETS && time_get() < Timeout)
+	{
+		net_socket_read_wait(Recv, 100);
+		for(int i = Received; i < NUM_PACKETS; i++)
+		{
+			aRecv[i].data = s_aaRecvData[i];
+			aRecv[i].size = PACKET_SIZE;
+		}
+		Received += net_udp_recv_batch(Recv, aRecv+Received, NUM_PACKETS-Received);
+	}
+
+	// loopback neither drops nor reorders
+	ASSERT_EQ(Received, NUM_PACKETS);
+	for(int i = 0; i < NUM_PACKETS; i++)
+	{
+		ASSERT_EQ(aRecv[i].size, 1+i%PACKET_SIZE);
+		EXPECT_EQ(mem_comp(aRecv[i].data, s_aaData[i], aRecv[i].size), 0);
+		EXPECT_EQ(net_addr_comp(&aRecv[i].addr, &Local, false), 0);
+	}
+
+	// nothing left
+	aRecv[0].data = s_aaRecvData[0];
+	aRecv[0].size = PACKET_SIZE;
+	EXPECT_EQ(net_udp_recv_batch(Recv, aRecv, 1), 0);
+
+	net_udp_close(Send);
+	net_udp_close(Recv);
+}
@@ -2,6 +2,7 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/math.h>
 #include <base/system.h>
+#include <engine/shared/linereader.h>
 
 
 struct CPacket
@@ -28,19 +29,109 @@ struct CPingConfig
 	int m_Loss;
 	int m_Delay;
 	int m_DelayFreq;
+	int m_Duration; // seconds
 };
 
-static CPingConfig m_aConfigPings[] = {
-//		base	flux	spike	loss	delay	delayfreq
-		{0,		0,		0,		0,		0,		0},
-		{40,	20,		100,		0,		0,		0},
-		{140,	40,		200,		0,		0,		0},
+static CPingConfig m_aConfigPings[32] = {
+//		base	flux	spike	loss	delay	delayfreq	duration
+		{0,		0,		0,		0,		0,		0,			10},
+		{40,	20,		100,		0,		0,		0,			10},
+		{140,	40,		200,		0,		0,		0,			10},
 };
 
-static int m_ConfigNumpingconfs = sizeof(m_aConfigPings)/sizeof(CPingConfig);
-static int m_ConfigInterval = 10; // seconds between different pingconfigs
+static int m_ConfigNumpingconfs = 3;
 static int m_ConfigLog = 0;
 static int m_ConfigReorder = 0;
+static unsigned m_ConfigSeed = 1;
+
+// traffic of the current pingconfig
+struct CStats
+{
+	int m_aPackets[2];
+	int m_aBytes[2];
+	int m_Dropped;
+};
+
+// packet loss uses its own generator, so a profile drops the same packets every run
+static int LossRandom()
+{
+	m_ConfigSeed ^= m_ConfigSeed<<13;
+	m_ConfigSeed ^= m_ConfigSeed>>17;
+	m_ConfigSeed ^= m_ConfigSeed<<5;
+	return m_ConfigSeed%100;
+}
+
+// one pingconfig per line with the columns of m_aConfigPings, # starts a comment
+static bool LoadProfile(const char *pFilename)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+	if(!File)
+		return false;
+
+	CLineReader LineReader;
+	LineReader.Init(File);
+	int Num = 0;
+	int Line = 0;
+	const char *pLine;
+	while((pLine = LineReader.Get()) && Num < (int)(sizeof(m_aConfigPings)/sizeof(m_aConfigPings[0])))
+	{
+		Line++;
+		int aValues[7];
+		int NumValues = 0;
+		pLine = str_skip_whitespaces_const(pLine);
+		while(*pLine && *pLine != '#' && NumValues < 7)
+		{
+			aValues[NumValues++] = str_toint(pLine);
+			pLine = str_skip_whitespaces_const(str_skip_to_whitespace_const(pLine));
+		}
+		if(NumValues == 0)
+			continue;
+		if(NumValues != 7)
+		{
+			dbg_msg("crapnet", "profile line %d needs 7 values", Line);
+			io_close(File);
+			return false;
+		}
+
+		CPingConfig *pConfig = &m_aConfigPings[Num++];
+		pConfig->m_Base = aValues[0];
+		pConfig->m_Flux = aValues[1];
+		pConfig->m_Spike = aValues[2];
+		pConfig->m_Loss = aValues[3];
+		pConfig->m_Delay = aValues[4];
+		pConfig->m_DelayFreq = aValues[5];
+		pConfig->m_Duration = maximum(aValues[6], 1);
+	}
+	io_close(File);
+
+	if(Num == 0)
+		return false;
+	m_ConfigNumpingconfs = Num;
+	return true;
+}
+
+// number of pingconfigs run through so far, the current one is this modulo their count
+static int CurrentStep(int64 Start)
+{
+	int Total = 0;
+	for(int i = 0; i < m_ConfigNumpingconfs; i++)
+		Total += m_aConfigPings[i].m_Duration;
+
+	int Time = (time_get()-Start)/time_freq();
+	int Step = (Time/Total)*m_ConfigNumpingconfs;
+	Time %= Total;
+	while(Time >= m_aConfigPings[Step%m_ConfigNumpingconfs].m_Duration)
+		Time -= m_aConfigPings[Step++%m_ConfigNumpingconfs].m_Duration;
+	return Step;
+}
+
+static void PrintStats(int Config, const CStats *pStats)
+{
+	const CPingConfig *pPing = &m_aConfigPings[Config];
+	dbg_msg("crapnet", "cfg %d (loss %d%%, %ds): to server %d packets %d bytes, to client %d packets %d bytes, dropped %d",
+		Config, pPing->m_Loss, pPing->m_Duration, pStats->m_aPackets[0], pStats->m_aBytes[0],
+		pStats->m_aPackets[1], pStats->m_aBytes[1], pStats->m_Dropped);
+}
 
 void Run(unsigned short Port, NETADDR Dest)
 {
@@ -50,16 +141,24 @@ void Run(unsigned short Port, NETADDR Dest)
 	char aBuffer[1024*2];
 	int ID = 0;
 	int Delaycounter = 0;
+	int64 Start = time_get();
+	CStats Stats;
+	mem_zero(&Stats, sizeof(Stats));
 
 	while(1)
 	{
-		static int Lastcfg = 0;
-		int n = ((time_get()/time_freq())/m_ConfigInterval) % m_ConfigNumpingconfs;
+		static int LastStep = 0;
+		int Step = CurrentStep(Start);
+		int n = Step%m_ConfigNumpingconfs;
 		CPingConfig Ping = m_aConfigPings[n];
 
-		if(n != Lastcfg)
+		if(Step != LastStep)
+		{
+			PrintStats(LastStep%m_ConfigNumpingconfs, &Stats);
+			mem_zero(&Stats, sizeof(Stats));
 			dbg_msg("crapnet", "cfg = %d", n);
-		Lastcfg = n;
+		}
+		LastStep = Step;
 
 		// handle incomming packets
 		while(1)
@@ -71,23 +170,27 @@ void Run(unsigned short Port, NETADDR Dest)
 			if(Bytes <= 0)
 				break;
 
-			if((random_int()%100) < Ping.m_Loss) // drop the packet
+			if(LossRandom() < Ping.m_Loss) // drop the packet
 			{
 				if(m_ConfigLog)
 					dbg_msg("crapnet", "dropped packet");
+				Stats.m_Dropped++;
 				continue;
 			}
 
 			// create new packet
 			CPacket *p = (CPacket *)mem_alloc(sizeof(CPacket)+Bytes);
 
-			if(net_addr_comp(&From, &Dest, true) == 0)
+			int ToClient = net_addr_comp(&From, &Dest, true) == 0;
+			if(ToClient)
 				p->m_SendTo = Src; // from the server
 			else
 			{
 				Src = From; // from the client
 				p->m_SendTo = Dest;
 			}
+			Stats.m_aPackets[ToClient]++;
+			Stats.m_aBytes[ToClient] += Bytes;
 
 			// queue packet
 			p->m_pPrev = m_pLast;
@@ -210,6 +313,26 @@ int main(int argc, const char **argv)
 {
 	NETADDR Addr = {NETTYPE_IPV4, {127,0,0,1},8303};
 	dbg_logger_stdout();
+
+	// crapnet [-p profile] [-s seed] [-l] [-r]
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-p") == 0 && i+1 < argc)
+		{
+			if(!LoadProfile(argv[++i]))
+			{
+				dbg_msg("crapnet", "failed to load profile '%s'", argv[i]);
+				return -1;
+			}
+		}
+		else if(str_comp(argv[i], "-s") == 0 && i+1 < argc)
+			m_ConfigSeed = maximum(str_toint(argv[++i]), 1);
+		else if(str_comp(argv[i], "-l") == 0)
+			m_ConfigLog = 1;
+		else if(str_comp(argv[i], "-r") == 0)
+			m_ConfigReorder = 1;
+	}
+
 	Run(8302, Addr);
 	return 0;
 }
@@ -0,0 +1,87 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/snapshot.h>
+
+// adds the keyframe index to demos that were recorded without one
+static bool AddIndex(IStorage *pStorage, CDemoPlayer *pPlayer, const char *pFilename)
+{
+	CDemoHeader Header;
+	if(!pPlayer->GetDemoInfo(pFilename, IStorage::TYPE_ALL, &Header))
+	{
+		dbg_msg("demo_index", "'%s' is not a demo file", pFilename);
+		return false;
+	}
+
+	if(pPlayer->Load(pFilename, IStorage::TYPE_ALL, Header.m_aNetversion))
+		return false;
+
+	if(pPlayer->Info()->m_HasIndex)
+	{
+		dbg_msg("demo_index", "'%s' already has an index", pFilename);
+		pPlayer->Stop();
+		return true;
+	}
+
+	// append to the file the player has opened
+	char aPath[IO_MAX_PATH_LENGTH];
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL, aPath, sizeof(aPath));
+	if(File)
+	{
+		io_close(File);
+		File = io_open(aPath, IOFLAG_APPEND);
+	}
+	if(!File)
+	{
+		dbg_msg("demo_index", "could not open '%s' for writing", pFilename);
+		pPlayer->Stop();
+		return false;
+	}
+
+	io_seek(File, 0, IOSEEK_END);
+	bool Written = pPlayer->WriteIndex(File);
+	io_close(File);
+
+	if(Written)
+		dbg_msg("demo_index", "added %d keyframes to '%s'", pPlayer->Info()->m_SeekablePoints, pFilename);
+	else
+		dbg_msg("demo_index", "too many keyframes in '%s'", pFilename);
+	pPlayer->Stop();
+	return Written;
+}
+
+int main(int argc, const char **argv)
+{
+	cmdline_fix(&argc, &argv);
+	dbg_logger_stdout();
+
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, argc, argv);
+	if(!pStorage || argc < 2)
+	{
+		dbg_msg("usage", "%s DEMO...", argv[0]);
+		return -1;
+	}
+
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+	CSnapshotDelta SnapshotDelta;
+	CDemoPlayer *pPlayer = new CDemoPlayer(&SnapshotDelta);
+	pPlayer->Init(pConsole, pStorage);
+
+	int NumFailed = 0;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!AddIndex(pStorage, pPlayer, argv[i]))
+			NumFailed++;
+	}
+
+	delete pPlayer;
+	delete pConsole;
+	delete pStorage;
+	cmdline_free(argc, argv);
+	return NumFailed ? -1 : 0;
+}
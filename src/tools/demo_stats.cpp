@@ -0,0 +1,442 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <base/tl/array.h>
+#include <base/tl/string.h>
+
+#include <engine/console.h>
+#include <engine/message.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/jobs.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+
+#include <game/gamecore.h>
+#include <game/version.h>
+#include <generated/protocol.h>
+
+/*
+	Replays demos without a client and writes what happened in them to
+	one json file per demo. Every table is an object of equally long
+	columns, so it loads straight into a data frame:
+
+		{"demo": ..., "players": {"tick": [...], "client": [...], ...}, ...}
+
+	players		tick, client, team, name	whenever a client joins or changes
+	positions	tick, client, x, y			every character in every tick
+	kills		tick, killer, victim, weapon
+	flags		tick, team, event, client	grab, drop, return and capture
+	chat		tick, client, mode, target, message
+*/
+
+static const char *s_apFlagEvents[] = {"grab", "drop", "return", "capture"};
+
+enum
+{
+	FLAGEVENT_GRAB=0,
+	FLAGEVENT_DROP,
+	FLAGEVENT_RETURN,
+	FLAGEVENT_CAPTURE,
+};
+
+class CDemoStats : public CDemoPlayer::IListener
+{
+	CDemoPlayer *m_pPlayer;
+	CNetObjHandler m_NetObjHandler;
+
+	bool m_aClientKnown[MAX_CLIENTS];
+	int m_aClientTeam[MAX_CLIENTS];
+	char m_aaClientName[MAX_CLIENTS][MAX_NAME_ARRAY_SIZE];
+
+	bool m_FlagsKnown;
+	int m_aFlagCarrier[2];
+
+	int Tick() const { return m_pPlayer->BaseInfo()->m_CurrentTick; }
+
+	void OnClientInfo(int ClientID, const CNetObj_De_ClientInfo *pInfo)
+	{
+		char aName[MAX_NAME_ARRAY_SIZE];
+		IntsToStr(pInfo->m_aName, 4, aName);
+		if(m_aClientKnown[ClientID] && m_aClientTeam[ClientID] == pInfo->m_Team && str_comp(m_aaClientName[ClientID], aName) == 0)
+			return;
+
+		m_aClientKnown[ClientID] = true;
+		m_aClientTeam[ClientID] = pInfo->m_Team;
+		str_copy(m_aaClientName[ClientID], aName, sizeof(m_aaClientName[ClientID]));
+		m_lPlayerTick.add(Tick());
+		m_lPlayerClient.add(ClientID);
+		m_lPlayerTeam.add(pInfo->m_Team);
+		m_lPlayerName.add(aName);
+	}
+
+	void AddFlagEvent(int Team, int Event, int ClientID)
+	{
+		m_lFlagTick.add(Tick());
+		m_lFlagTeam.add(Team);
+		m_lFlagEvent.add(Event);
+		m_lFlagClient.add(ClientID);
+	}
+
+	void OnFlags(const CNetObj_GameDataFlag *pFlags)
+	{
+		int aCarrier[2] = {pFlags->m_FlagCarrierRed, pFlags->m_FlagCarrierBlue};
+		for(int Team = 0; Team < 2 && m_FlagsKnown; Team++)
+		{
+			int Old = m_aFlagCarrier[Team];
+			int New = aCarrier[Team];
+			if(Old == New)
+				continue;
+
+			if(New >= 0)
+				AddFlagEvent(Team, FLAGEVENT_GRAB, New);
+			else if(Old >= 0 && New == FLAG_TAKEN)
+				AddFlagEvent(Team, FLAGEVENT_DROP, Old);
+			else if(Old >= 0 && New == FLAG_ATSTAND)
+				AddFlagEvent(Team, FLAGEVENT_CAPTURE, Old);
+			else if(Old == FLAG_TAKEN && New == FLAG_ATSTAND)
+				AddFlagEvent(Team, FLAGEVENT_RETURN, -1);
+		}
+		m_FlagsKnown = true;
+		m_aFlagCarrier[0] = aCarrier[0];
+		m_aFlagCarrier[1] = aCarrier[1];
+	}
+
+public:
+	array<int> m_lPlayerTick, m_lPlayerClient, m_lPlayerTeam;
+	array<string> m_lPlayerName;
+	array<int> m_lPosTick, m_lPosClient, m_lPosX, m_lPosY;
+	array<int> m_lKillTick, m_lKillKiller, m_lKillVictim, m_lKillWeapon;
+	array<int> m_lFlagTick, m_lFlagTeam, m_lFlagEvent, m_lFlagClient;
+	array<int> m_lChatTick, m_lChatClient, m_lChatMode, m_lChatTarget;
+	array<string> m_lChatMessage;
+
+	CDemoStats(CDemoPlayer *pPlayer)
+	{
+		m_pPlayer = pPlayer;
+		mem_zero(m_aClientKnown, sizeof(m_aClientKnown));
+		m_FlagsKnown = false;
+	}
+
+	void OnDemoPlayerSnapshot(void *pData, int Size)
+	{
+		const CSnapshot *pSnap = (const CSnapshot *)pData;
+		for(int i = 0; i < pSnap->NumItems(); i++)
+		{
+			const CSnapshotItem *pItem = pSnap->GetItem(i);
+			int ItemSize = pSnap->GetItemSize(i);
+			int ID = pItem->ID();
+
+			if(pItem->Type() == NETOBJTYPE_CHARACTER && ID < MAX_CLIENTS && ItemSize >= (int)sizeof(CNetObj_Character))
+			{
+				const CNetObj_Character *pChar = (const CNetObj_Character *)pItem->Data();
+				m_lPosTick.add(Tick());
+				m_lPosClient.add(ID);
+				m_lPosX.add(pChar->m_X);
+				m_lPosY.add(pChar->m_Y);
+			}
+			else if(pItem->Type() == NETOBJTYPE_DE_CLIENTINFO && ID < MAX_CLIENTS && ItemSize >= (int)sizeof(CNetObj_De_ClientInfo))
+				OnClientInfo(ID, (const CNetObj_De_ClientInfo *)pItem->Data());
+			else if(pItem->Type() == NETOBJTYPE_GAMEDATAFLAG && ItemSize >= (int)sizeof(CNetObj_GameDataFlag))
+				OnFlags((const CNetObj_GameDataFlag *)pItem->Data());
+		}
+	}
+
+	void OnDemoPlayerMessage(void *pData, int Size)
+	{
+		CMsgUnpacker Unpacker(pData, Size);
+		if(Unpacker.Error() || Unpacker.System())
+			return;
+
+		void *pRawMsg = m_NetObjHandler.SecureUnpackMsg(Unpacker.Type(), &Unpacker);
+		if(!pRawMsg)
+			return;
+
+		if(Unpacker.Type() == NETMSGTYPE_SV_KILLMSG)
+		{
+			const CNetMsg_Sv_KillMsg *pMsg = (const CNetMsg_Sv_KillMsg *)pRawMsg;
+			m_lKillTick.add(Tick());
+			m_lKillKiller.add(pMsg->m_Killer);
+			m_lKillVictim.add(pMsg->m_Victim);
+			m_lKillWeapon.add(pMsg->m_Weapon);
+		}
+		else if(Unpacker.Type() == NETMSGTYPE_SV_CHAT)
+		{
+			const CNetMsg_Sv_Chat *pMsg = (const CNetMsg_Sv_Chat *)pRawMsg;
+
+			// server demos get team and whisper messages once for every receiver
+			int Last = m_lChatTick.size()-1;
+			if(Last >= 0 && m_lChatTick[Last] == Tick() && m_lChatClient[Last] == pMsg->m_ClientID && m_lChatMode[Last] == pMsg->m_Mode &&
+				m_lChatTarget[Last] == pMsg->m_TargetID && str_comp(m_lChatMessage[Last], pMsg->m_pMessage) == 0)
+				return;
+
+			m_lChatTick.add(Tick());
+			m_lChatClient.add(pMsg->m_ClientID);
+			m_lChatMode.add(pMsg->m_Mode);
+			m_lChatTarget.add(pMsg->m_TargetID);
+			m_lChatMessage.add(pMsg->m_pMessage);
+		}
+	}
+};
+
+static void WriteString(IOHANDLE File, const char *pStr)
+{
+	char aBuf[1024];
+	int Length = 0;
+	aBuf[Length++] = '"';
+	for(; *pStr; pStr++)
+	{
+		// leave room for the longest escape and the closing quote
+		if(Length > (int)sizeof(aBuf)-8)
+		{
+			io_write(File, aBuf, Length);
+			Length = 0;
+		}
+
+		unsigned char c = *pStr;
+		if(c == '"' || c == '\\')
+		{
+			aBuf[Length++] = '\\';
+			aBuf[Length++] = c;
+		}
+		else if(c < 0x20)
+		{
+			str_format(aBuf+Length, sizeof(aBuf)-Length, "\\u%04x", c);
+			Length += 6;
+		}
+		else
+			aBuf[Length++] = c;
+	}
+	aBuf[Length++] = '"';
+	io_write(File, aBuf, Length);
+}
+
+static void WriteColumn(IOHANDLE File, const char *pName, const array<int> &lColumn, bool LastInTable)
+{
+	char aBuf[1024];
+	str_format(aBuf, sizeof(aBuf), "\"%s\": [", pName);
+	int Length = str_length(aBuf);
+	for(int i = 0; i < lColumn.size(); i++)
+	{
+		if(Length > (int)sizeof(aBuf)-16)
+		{
+			io_write(File, aBuf, Length);
+			Length = 0;
+		}
+		str_format(aBuf+Length, sizeof(aBuf)-Length, i ? ",%d" : "%d", lColumn[i]);
+		Length += str_length(aBuf+Length);
+	}
+	io_write(File, aBuf, Length);
+	io_write(File, LastInTable ? "]}" : "], ", LastInTable ? 2 : 3);
+}
+
+static void WriteColumn(IOHANDLE File, const char *pName, const array<string> &lColumn, bool LastInTable)
+{
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "\"%s\": [", pName);
+	io_write(File, aBuf, str_length(aBuf));
+	for(int i = 0; i < lColumn.size(); i++)
+	{
+		if(i)
+			io_write(File, ",", 1);
+		WriteString(File, lColumn[i]);
+	}
+	io_write(File, LastInTable ? "]}" : "], ", LastInTable ? 2 : 3);
+}
+
+static void WriteTable(IOHANDLE File, const char *pName)
+{
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), ",\n\"%s\": {", pName);
+	io_write(File, aBuf, str_length(aBuf));
+}
+
+static bool WriteStats(const char *pFilename, const CDemoPlayer *pPlayer, const CDemoStats *pStats)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_WRITE);
+	if(!File)
+		return false;
+
+	const CDemoPlayer::CPlaybackInfo *pInfo = pPlayer->Info();
+	char aName[128];
+	pPlayer->GetDemoName(aName, sizeof(aName));
+	io_write(File, "{\"demo\": ", 9);
+	WriteString(File, aName);
+	io_write(File, ", \"map\": ", 9);
+	WriteString(File, pInfo->m_Header.m_aMapName);
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), ", \"first_tick\": %d, \"last_tick\": %d, \"tick_speed\": %d",
+		pInfo->m_Info.m_FirstTick, pInfo->m_Info.m_LastTick, SERVER_TICK_SPEED);
+	io_write(File, aBuf, str_length(aBuf));
+
+	WriteTable(File, "players");
+	WriteColumn(File, "tick", pStats->m_lPlayerTick, false);
+	WriteColumn(File, "client", pStats->m_lPlayerClient, false);
+	WriteColumn(File, "team", pStats->m_lPlayerTeam, false);
+	WriteColumn(File, "name", pStats->m_lPlayerName, true);
+
+	WriteTable(File, "positions");
+	WriteColumn(File, "tick", pStats->m_lPosTick, false);
+	WriteColumn(File, "client", pStats->m_lPosClient, false);
+	WriteColumn(File, "x", pStats->m_lPosX, false);
+	WriteColumn(File, "y", pStats->m_lPosY, true);
+
+	WriteTable(File, "kills");
+	WriteColumn(File, "tick", pStats->m_lKillTick, false);
+	WriteColumn(File, "killer", pStats->m_lKillKiller, false);
+	WriteColumn(File, "victim", pStats->m_lKillVictim, false);
+	WriteColumn(File, "weapon", pStats->m_lKillWeapon, true);
+
+	array<string> lFlagEvents;
+	for(int i = 0; i < pStats->m_lFlagEvent.size(); i++)
+		lFlagEvents.add(s_apFlagEvents[pStats->m_lFlagEvent[i]]);
+	WriteTable(File, "flags");
+	WriteColumn(File, "tick", pStats->m_lFlagTick, false);
+	WriteColumn(File, "team", pStats->m_lFlagTeam, false);
+	WriteColumn(File, "event", lFlagEvents, false);
+	WriteColumn(File, "client", pStats->m_lFlagClient, true);
+
+	WriteTable(File, "chat");
+	WriteColumn(File, "tick", pStats->m_lChatTick, false);
+	WriteColumn(File, "client", pStats->m_lChatClient, false);
+	WriteColumn(File, "mode", pStats->m_lChatMode, false);
+	WriteColumn(File, "target", pStats->m_lChatTarget, false);
+	WriteColumn(File, "message", pStats->m_lChatMessage, true);
+
+	io_write(File, "}\n", 2);
+	io_close(File);
+	return true;
+}
+
+// one demo, processed by one job
+struct CDemoJob
+{
+	CJob m_Job;
+	IStorage *m_pStorage;
+	LOCK m_MapLock;
+	const char *m_pFilename;
+	const char *m_pOutputDir;
+	int m_NumTicks;
+	int64 m_Time;
+};
+
+static int ProcessDemo(void *pUser)
+{
+	CDemoJob *pJob = (CDemoJob *)pUser;
+	int64 StartTime = time_get();
+
+	CNetObjHandler NetObjHandler;
+	CSnapshotDelta *pSnapshotDelta = new CSnapshotDelta;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		pSnapshotDelta->SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	// the console isn't thread safe, every job prints through its own
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+	CDemoPlayer *pPlayer = new CDemoPlayer(pSnapshotDelta);
+	pPlayer->Init(pConsole, pJob->m_pStorage);
+	CDemoStats *pStats = new CDemoStats(pPlayer);
+	pPlayer->SetListener(pStats);
+
+	// loading writes the map of the demo to the downloaded maps when it isn't
+	// there yet. demos of the same map must not write the same file at once
+	lock_wait(pJob->m_MapLock);
+	const char *pError = pPlayer->Load(pJob->m_pFilename, IStorage::TYPE_ALL, GAME_NETVERSION);
+	lock_unlock(pJob->m_MapLock);
+
+	int Result = -1;
+	if(!pError)
+	{
+		while(pPlayer->NextTick() == 0)
+			pJob->m_NumTicks++;
+
+		char aName[128];
+		char aOutput[IO_MAX_PATH_LENGTH];
+		pPlayer->GetDemoName(aName, sizeof(aName));
+		str_format(aOutput, sizeof(aOutput), "%s/%s.json", pJob->m_pOutputDir, aName);
+		if(WriteStats(aOutput, pPlayer, pStats))
+			Result = 0;
+		else
+			dbg_msg("demo_stats", "could not write '%s'", aOutput);
+		pPlayer->Stop();
+	}
+
+	delete pStats;
+	delete pPlayer;
+	delete pConsole;
+	delete pSnapshotDelta;
+
+	pJob->m_Time = time_get()-StartTime;
+	return Result;
+}
+
+int main(int argc, const char **argv)
+{
+	cmdline_fix(&argc, &argv);
+	dbg_logger_stdout();
+
+	int NumThreads = 4;
+	const char *pOutputDir = ".";
+	int FirstDemo = 1;
+	for(; FirstDemo < argc-1; FirstDemo += 2)
+	{
+		if(str_comp(argv[FirstDemo], "-j") == 0)
+			NumThreads = str_toint(argv[FirstDemo+1]);
+		else if(str_comp(argv[FirstDemo], "-o") == 0)
+			pOutputDir = argv[FirstDemo+1];
+		else
+			break;
+	}
+
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, argc, argv);
+	if(!pStorage || FirstDemo >= argc)
+	{
+		dbg_msg("usage", "%s [-j THREADS] [-o OUTPUTDIR] DEMO...", argv[0]);
+		return -1;
+	}
+
+	LOCK MapLock = lock_create();
+	int NumDemos = argc-FirstDemo;
+	CDemoJob *pJobs = new CDemoJob[NumDemos];
+
+	// the main thread works on the demos as well while it waits
+	CJobPool Pool;
+	Pool.Init(NumThreads > 1 ? NumThreads-1 : 0);
+	CJobGroup Group;
+	int64 StartTime = time_get();
+	for(int i = 0; i < NumDemos; i++)
+	{
+		pJobs[i].m_pStorage = pStorage;
+		pJobs[i].m_MapLock = MapLock;
+		pJobs[i].m_pFilename = argv[FirstDemo+i];
+		pJobs[i].m_pOutputDir = pOutputDir;
+		pJobs[i].m_NumTicks = 0;
+		pJobs[i].m_Time = 0;
+		Pool.Add(&pJobs[i].m_Job, ProcessDemo, &pJobs[i], &Group);
+	}
+	Pool.Wait(&Group);
+	int64 Time = time_get()-StartTime;
+
+	int NumFailed = 0;
+	int TotalTicks = 0;
+	for(int i = 0; i < NumDemos; i++)
+	{
+		if(pJobs[i].m_Job.Result() != 0)
+		{
+			NumFailed++;
+			continue;
+		}
+		TotalTicks += pJobs[i].m_NumTicks;
+		dbg_msg("demo_stats", "%s: %d ticks in %.2f s, %.0f ticks/s", pJobs[i].m_pFilename, pJobs[i].m_NumTicks,
+			pJobs[i].m_Time/(double)time_freq(), pJobs[i].m_NumTicks/maximum(pJobs[i].m_Time/(double)time_freq(), 0.000001));
+	}
+	dbg_msg("demo_stats", "%d demos, %d failed, %d ticks in %.2f s", NumDemos, NumFailed, TotalTicks, Time/(double)time_freq());
+
+	Pool.Shutdown();
+	delete[] pJobs;
+	lock_destroy(MapLock);
+	delete pStorage;
+	cmdline_free(argc, argv);
+	return NumFailed ? -1 : 0;
+}
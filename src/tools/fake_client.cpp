@@ -0,0 +1,622 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <math.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/message.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/config.h>
+#include <engine/shared/network.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+#include <game/version.h>
+#include <generated/protocol.h>
+
+// headless clients that connect to a server, download the map, join the game
+// and send scripted input every tick. meant to put a server under load and
+// to watch what it sends back, e.g. behind crapnet.
+
+enum
+{
+	MAX_FAKE_CLIENTS=256,
+	PREDICTION_MARGIN=2, // ticks
+};
+
+class CFakeClient
+{
+public:
+	enum
+	{
+		STATE_OFFLINE=0,
+		STATE_CONNECTING,
+		STATE_LOADING,
+		STATE_READY,
+		STATE_INGAME,
+	};
+
+	int m_ID;
+	int m_State;
+	CNetClient m_Net;
+
+	// map download
+	int m_MapdownloadChunk;
+	int m_MapdownloadChunkNum;
+	int m_MapdownloadChunkSize;
+	int m_MapdownloadAmount;
+	int m_MapdownloadTotalsize;
+
+	// snapshots
+	CSnapshotStorage m_SnapshotStorage;
+	char m_aSnapshotIncomingData[CSnapshot::MAX_SIZE];
+	unsigned m_SnapshotParts;
+	int m_CurrentRecvTick;
+	int m_AckGameTick;
+	int m_SnapCrcErrors;
+	int64 m_AckTime;
+
+	// input
+	int m_InputTick;
+	int m_PredMargin;
+	int64 m_NextInput;
+};
+
+struct CStats
+{
+	int m_Snapshots;
+	int m_EmptySnapshots;
+	int64 m_SnapshotBytes;
+	int64 m_DeltaBytes;
+	int m_CrcErrors;
+	int m_MissingDeltas;
+	int m_Inputs;
+	int m_InputTimings;
+	int m_LateInputs;
+	int64 m_TimeLeftSum;
+	int m_TimeLeftMin;
+	int m_TimeLeftMax;
+	int64 m_MapBytes;
+	int m_MapDownloads;
+};
+
+CConfig Config;
+CNetObjHandler NetObjHandler;
+CSnapshotDelta SnapshotDelta;
+CFakeClient aClients[MAX_FAKE_CLIENTS];
+int NumClients = 1;
+CStats Stats;
+CStats TotalStats;
+
+NETADDR ServerAddr;
+bool SkipDownload = false;
+bool Idle = false;
+const char *pPassword = "";
+
+static void ResetStats(CStats *pStats)
+{
+	mem_zero(pStats, sizeof(*pStats));
+	pStats->m_TimeLeftMin = 0x7fffffff;
+	pStats->m_TimeLeftMax = -0x7fffffff;
+}
+
+static void AddStats(CStats *pTotal, const CStats *pStats)
+{
+	pTotal->m_Snapshots += pStats->m_Snapshots;
+	pTotal->m_EmptySnapshots += pStats->m_EmptySnapshots;
+	pTotal->m_SnapshotBytes += pStats->m_SnapshotBytes;
+	pTotal->m_DeltaBytes += pStats->m_DeltaBytes;
+	pTotal->m_CrcErrors += pStats->m_CrcErrors;
+	pTotal->m_MissingDeltas += pStats->m_MissingDeltas;
+	pTotal->m_Inputs += pStats->m_Inputs;
+	pTotal->m_InputTimings += pStats->m_InputTimings;
+	pTotal->m_LateInputs += pStats->m_LateInputs;
+	pTotal->m_TimeLeftSum += pStats->m_TimeLeftSum;
+	pTotal->m_TimeLeftMin = minimum(pTotal->m_TimeLeftMin, pStats->m_TimeLeftMin);
+	pTotal->m_TimeLeftMax = maximum(pTotal->m_TimeLeftMax, pStats->m_TimeLeftMax);
+	pTotal->m_MapBytes += pStats->m_MapBytes;
+	pTotal->m_MapDownloads += pStats->m_MapDownloads;
+}
+
+static void SendMsg(CFakeClient *pClient, CMsgPacker *pMsg, int Flags)
+{
+	CNetChunk Packet;
+	mem_zero(&Packet, sizeof(Packet));
+	Packet.m_ClientID = 0;
+	Packet.m_pData = pMsg->Data();
+	Packet.m_DataSize = pMsg->Size();
+	if(Flags&MSGFLAG_VITAL)
+		Packet.m_Flags |= NETSENDFLAG_VITAL;
+	if(Flags&MSGFLAG_FLUSH)
+		Packet.m_Flags |= NETSENDFLAG_FLUSH;
+	pClient->m_Net.Send(&Packet);
+}
+
+static void SendReady(CFakeClient *pClient)
+{
+	CMsgPacker Msg(NETMSG_READY, true);
+	SendMsg(pClient, &Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+	pClient->m_State = CFakeClient::STATE_READY;
+}
+
+static void SendStartInfo(CFakeClient *pClient)
+{
+	char aName[16];
+	str_format(aName, sizeof(aName), "fake %d", pClient->m_ID);
+
+	CNetMsg_Cl_StartInfo Msg;
+	Msg.m_pName = aName;
+	Msg.m_pClan = "";
+	Msg.m_Country = -1;
+	Msg.m_apSkinPartNames[SKINPART_BODY] = "standard";
+	Msg.m_apSkinPartNames[SKINPART_MARKING] = "";
+	Msg.m_apSkinPartNames[SKINPART_DECORATION] = "";
+	Msg.m_apSkinPartNames[SKINPART_HANDS] = "standard";
+	Msg.m_apSkinPartNames[SKINPART_FEET] = "standard";
+	Msg.m_apSkinPartNames[SKINPART_EYES] = "standard";
+	for(int p = 0; p < NUM_SKINPARTS; p++)
+	{
+		Msg.m_aUseCustomColors[p] = 0;
+		Msg.m_aSkinPartColors[p] = 0;
+	}
+
+	CMsgPacker Packer(Msg.MsgID(), false);
+	Msg.Pack(&Packer);
+	SendMsg(pClient, &Packer, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+}
+
+// every client runs the same pattern shifted by its id: walk for a second in
+// one direction, jump every 40 ticks, swing the hook and aim in a circle
+static void ScriptInput(const CFakeClient *pClient, CNetObj_PlayerInput *pInput)
+{
+	mem_zero(pInput, sizeof(*pInput));
+	if(Idle)
+		return;
+
+	const int Tick = pClient->m_InputTick + pClient->m_ID*17;
+	const float Angle = Tick*0.05f;
+	pInput->m_Direction = (Tick/SERVER_TICK_SPEED)%3 - 1;
+	pInput->m_TargetX = (int)(cosf(Angle)*100.0f);
+	pInput->m_TargetY = (int)(sinf(Angle)*100.0f);
+	pInput->m_Jump = Tick%40 < 2;
+	pInput->m_Fire = Tick/10;
+	pInput->m_Hook = (Tick/75)%2;
+}
+
+static void SendInput(CFakeClient *pClient, int64 Now)
+{
+	// guess the current server tick from the last snapshot and stay a few ticks ahead
+	if(!pClient->m_AckTime)
+		return;
+	const int PredTick = pClient->m_CurrentRecvTick + pClient->m_PredMargin + (int)((Now-pClient->m_AckTime)*SERVER_TICK_SPEED/time_freq());
+
+	CNetObj_PlayerInput Input;
+	ScriptInput(pClient, &Input);
+
+	CMsgPacker Msg(NETMSG_INPUT, true);
+	Msg.AddInt(pClient->m_AckGameTick);
+	Msg.AddInt(PredTick);
+	Msg.AddInt(sizeof(Input));
+	const int *pData = (const int *)&Input;
+	for(unsigned i = 0; i < sizeof(Input)/sizeof(int); i++)
+		Msg.AddInt(pData[i]);
+
+	int PingCorrection = 0;
+	int64 TagTime;
+	if(pClient->m_SnapshotStorage.Get(pClient->m_AckGameTick, &TagTime, 0, 0) >= 0)
+		PingCorrection = (int)(((Now-TagTime)*1000)/time_freq());
+	Msg.AddInt(PingCorrection);
+
+	SendMsg(pClient, &Msg, MSGFLAG_FLUSH);
+	pClient->m_InputTick++;
+	Stats.m_Inputs++;
+}
+
+static void ProcessSnapshot(CFakeClient *pClient, CMsgUnpacker *pUnpacker)
+{
+	const int Type = pUnpacker->Type();
+	const int GameTick = pUnpacker->GetInt();
+	const int DeltaTick = GameTick - pUnpacker->GetInt();
+
+	int NumParts = 1;
+	int Part = 0;
+	if(Type == NETMSG_SNAP)
+	{
+		NumParts = pUnpacker->GetInt();
+		Part = pUnpacker->GetInt();
+		if(NumParts < 1 || NumParts > CSnapshot::MAX_PARTS || Part < 0 || Part >= NumParts)
+			return;
+	}
+
+	int PartSize = 0;
+	int Crc = 0;
+	const char *pData = 0;
+	if(Type != NETMSG_SNAPEMPTY)
+	{
+		Crc = pUnpacker->GetInt();
+		PartSize = pUnpacker->GetInt();
+		if(PartSize < 0 || PartSize > MAX_SNAPSHOT_PACKSIZE)
+			return;
+		if(PartSize > 0)
+			pData = (const char *)pUnpacker->GetRaw(PartSize);
+	}
+
+	if(pUnpacker->Error() || GameTick < pClient->m_CurrentRecvTick)
+		return;
+
+	if(GameTick != pClient->m_CurrentRecvTick)
+	{
+		pClient->m_SnapshotParts = 0;
+		pClient->m_CurrentRecvTick = GameTick;
+		pClient->m_AckTime = time_get();
+	}
+
+	if(pData)
+		mem_copy(pClient->m_aSnapshotIncomingData + Part*MAX_SNAPSHOT_PACKSIZE, pData, PartSize);
+	pClient->m_SnapshotParts |= 1<<Part;
+	if(pClient->m_SnapshotParts != (unsigned)((1<<NumParts)-1))
+		return;
+	pClient->m_SnapshotParts = 0;
+
+	static CSnapshot s_EmptySnap;
+	s_EmptySnap.Clear();
+	CSnapshot *pDeltaShot = &s_EmptySnap;
+	if(DeltaTick >= 0 && pClient->m_SnapshotStorage.Get(DeltaTick, 0, &pDeltaShot, 0) < 0)
+	{
+		// the server has to resend a full snapshot
+		Stats.m_MissingDeltas++;
+		pClient->m_AckGameTick = -1;
+		return;
+	}
+
+	static unsigned char s_aDeltaData[CSnapshot::MAX_SIZE];
+	static unsigned char s_aSnapData[CSnapshot::MAX_SIZE];
+	const void *pDeltaData = SnapshotDelta.EmptyDelta();
+	int DeltaSize = sizeof(int)*3;
+	const int CompleteSize = (NumParts-1)*MAX_SNAPSHOT_PACKSIZE + PartSize;
+	if(CompleteSize)
+	{
+		DeltaSize = CVariableInt::Decompress(pClient->m_aSnapshotIncomingData, CompleteSize, s_aDeltaData, sizeof(s_aDeltaData));
+		if(DeltaSize < 0)
+			return;
+		pDeltaData = s_aDeltaData;
+	}
+
+	CSnapshot *pSnap = (CSnapshot *)s_aSnapData;
+	const int SnapSize = SnapshotDelta.UnpackDelta(pDeltaShot, pSnap, pDeltaData, DeltaSize);
+	if(SnapSize < 0)
+		return;
+	if(Type != NETMSG_SNAPEMPTY && pSnap->Crc() != Crc)
+	{
+		Stats.m_CrcErrors++;
+		if(++pClient->m_SnapCrcErrors > 10)
+		{
+			pClient->m_AckGameTick = -1;
+			pClient->m_SnapCrcErrors = 0;
+		}
+		return;
+	}
+	if(pClient->m_SnapCrcErrors)
+		pClient->m_SnapCrcErrors--;
+
+	// the server deltas against acked ticks only, keep what it still might use
+	pClient->m_SnapshotStorage.PurgeUntil(minimum(DeltaTick, pClient->m_AckGameTick));
+	pClient->m_SnapshotStorage.Add(GameTick, time_get(), SnapSize, pSnap, false);
+	pClient->m_AckGameTick = GameTick;
+
+	Stats.m_Snapshots++;
+	if(Type == NETMSG_SNAPEMPTY)
+		Stats.m_EmptySnapshots++;
+	Stats.m_SnapshotBytes += CompleteSize;
+	Stats.m_DeltaBytes += DeltaSize;
+}
+
+static void ProcessPacket(CFakeClient *pClient, CNetChunk *pPacket)
+{
+	CMsgUnpacker Unpacker(pPacket->m_pData, pPacket->m_DataSize);
+	if(Unpacker.Error())
+		return;
+
+	const bool Vital = (pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0;
+	if(!Unpacker.System())
+	{
+		if(Vital && Unpacker.Type() == NETMSGTYPE_SV_READYTOENTER)
+		{
+			CMsgPacker Msg(NETMSG_ENTERGAME, true);
+			SendMsg(pClient, &Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+			pClient->m_State = CFakeClient::STATE_INGAME;
+			pClient->m_NextInput = time_get();
+		}
+		return;
+	}
+
+	if(Vital && Unpacker.Type() == NETMSG_MAP_CHANGE)
+	{
+		const char *pMap = Unpacker.GetString(CUnpacker::SANITIZE_CC|CUnpacker::SKIP_START_WHITESPACES);
+		Unpacker.GetInt(); // crc
+		const int MapSize = Unpacker.GetInt();
+		const int MapChunkNum = Unpacker.GetInt();
+		const int MapChunkSize = Unpacker.GetInt();
+		if(Unpacker.Error() || MapSize <= 0 || MapChunkNum <= 0 || MapChunkSize <= 0)
+			return;
+
+		pClient->m_SnapshotStorage.PurgeAll();
+		pClient->m_CurrentRecvTick = 0;
+		pClient->m_AckGameTick = -1;
+		pClient->m_AckTime = 0;
+		if(SkipDownload)
+		{
+			SendReady(pClient);
+			return;
+		}
+
+		if(pClient->m_ID == 0)
+			dbg_msg("fake_client", "downloading map '%s' (%d bytes)", pMap, MapSize);
+		pClient->m_State = CFakeClient::STATE_LOADING;
+		pClient->m_MapdownloadChunk = 0;
+		pClient->m_MapdownloadChunkNum = MapChunkNum;
+		pClient->m_MapdownloadChunkSize = MapChunkSize;
+		pClient->m_MapdownloadAmount = 0;
+		pClient->m_MapdownloadTotalsize = MapSize;
+
+		CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA, true);
+		SendMsg(pClient, &Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+	}
+	else if(Vital && Unpacker.Type() == NETMSG_MAP_DATA)
+	{
+		if(pClient->m_State != CFakeClient::STATE_LOADING)
+			return;
+
+		const int Size = minimum(pClient->m_MapdownloadChunkSize, pClient->m_MapdownloadTotalsize-pClient->m_MapdownloadAmount);
+		if(Size <= 0)
+			return;
+		Unpacker.GetRaw(Size);
+		if(Unpacker.Error())
+			return;
+
+		pClient->m_MapdownloadChunk++;
+		pClient->m_MapdownloadAmount += Size;
+		Stats.m_MapBytes += Size;
+		if(pClient->m_MapdownloadAmount == pClient->m_MapdownloadTotalsize)
+		{
+			Stats.m_MapDownloads++;
+			SendReady(pClient);
+		}
+		else if(pClient->m_MapdownloadChunk%pClient->m_MapdownloadChunkNum == 0)
+		{
+			CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA, true);
+			SendMsg(pClient, &Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+		}
+	}
+	else if(Vital && Unpacker.Type() == NETMSG_CON_READY)
+		SendStartInfo(pClient);
+	else if(Unpacker.Type() == NETMSG_PING)
+	{
+		CMsgPacker Msg(NETMSG_PING_REPLY, true);
+		SendMsg(pClient, &Msg, MSGFLAG_FLUSH);
+	}
+	else if(Unpacker.Type() == NETMSG_INPUTTIMING)
+	{
+		Unpacker.GetInt(); // tick of the input
+		const int TimeLeft = Unpacker.GetInt();
+		if(Unpacker.Error())
+			return;
+
+		Stats.m_InputTimings++;
+		Stats.m_TimeLeftSum += TimeLeft;
+		Stats.m_TimeLeftMin = minimum(Stats.m_TimeLeftMin, TimeLeft);
+		Stats.m_TimeLeftMax = maximum(Stats.m_TimeLeftMax, TimeLeft);
+		if(TimeLeft < 0)
+			Stats.m_LateInputs++;
+
+		// keep the input between one and three ticks ahead of the server
+		const int TickMs = 1000/SERVER_TICK_SPEED;
+		if(TimeLeft < TickMs/2)
+			pClient->m_PredMargin++;
+		else if(TimeLeft > TickMs*3 && pClient->m_PredMargin > 1)
+			pClient->m_PredMargin--;
+	}
+	else if(Unpacker.Type() == NETMSG_SNAP || Unpacker.Type() == NETMSG_SNAPSINGLE || Unpacker.Type() == NETMSG_SNAPEMPTY)
+	{
+		if(pClient->m_State >= CFakeClient::STATE_READY)
+			ProcessSnapshot(pClient, &Unpacker);
+	}
+}
+
+static void PrintStats(const CStats *pStats, float Seconds, const NETSTATS *pNetStats)
+{
+	int Ingame = 0;
+	for(int i = 0; i < NumClients; i++)
+		if(aClients[i].m_State == CFakeClient::STATE_INGAME)
+			Ingame++;
+
+	const int Snapshots = maximum(pStats->m_Snapshots, 1);
+	const int Timings = maximum(pStats->m_InputTimings, 1);
+	dbg_msg("fake_client", "%d/%d ingame, %.1f snaps/s, avg %d bytes packed, %d bytes delta, %.1f KB/s snapshots, %d%% empty, %d crc errors, %d missing deltas",
+		Ingame, NumClients, pStats->m_Snapshots/Seconds,
+		(int)(pStats->m_SnapshotBytes/Snapshots), (int)(pStats->m_DeltaBytes/Snapshots),
+		pStats->m_SnapshotBytes/Seconds/1024.0f, pStats->m_EmptySnapshots*100/Snapshots,
+		pStats->m_CrcErrors, pStats->m_MissingDeltas);
+	dbg_msg("fake_client", "%.1f inputs/s, time left avg %d ms, min %d ms, max %d ms, %d late, net in %.1f KB/s, out %.1f KB/s",
+		pStats->m_Inputs/Seconds, (int)(pStats->m_TimeLeftSum/Timings),
+		pStats->m_InputTimings ? pStats->m_TimeLeftMin : 0, pStats->m_InputTimings ? pStats->m_TimeLeftMax : 0,
+		pStats->m_LateInputs, pNetStats->recv_bytes/Seconds/1024.0f, pNetStats->sent_bytes/Seconds/1024.0f);
+	if(pStats->m_MapDownloads)
+		dbg_msg("fake_client", "%d map downloads, %.1f KB/s map data", pStats->m_MapDownloads, pStats->m_MapBytes/Seconds/1024.0f);
+}
+
+static int Run(int Seconds)
+{
+	NETADDR BindAddr;
+	mem_zero(&BindAddr, sizeof(BindAddr));
+	BindAddr.type = ServerAddr.type;
+
+	for(int i = 0; i < NumClients; i++)
+	{
+		CFakeClient *pClient = &aClients[i];
+		pClient->m_ID = i;
+		pClient->m_State = CFakeClient::STATE_OFFLINE;
+		pClient->m_SnapshotStorage.Init();
+		pClient->m_SnapshotParts = 0;
+		pClient->m_CurrentRecvTick = 0;
+		pClient->m_AckGameTick = -1;
+		pClient->m_SnapCrcErrors = 0;
+		pClient->m_AckTime = 0;
+		pClient->m_InputTick = 0;
+		pClient->m_PredMargin = PREDICTION_MARGIN;
+		if(!pClient->m_Net.Open(BindAddr, &Config, 0, 0, NETCREATE_FLAG_RANDOMPORT))
+		{
+			dbg_msg("fake_client", "couldn't open socket for client %d", i);
+			return -1;
+		}
+	}
+
+	const int64 Start = time_get();
+	const int64 End = Seconds ? Start+Seconds*time_freq() : 0;
+	int64 LastStats = Start;
+	int64 NextConnect = Start;
+	int Connected = 0;
+	NETSTATS PrevNetStats;
+	net_stats(&PrevNetStats);
+	NETSTATS StartNetStats = PrevNetStats;
+	ResetStats(&Stats);
+	ResetStats(&TotalStats);
+
+	while(!End || time_get() < End)
+	{
+		int64 Now = time_get();
+
+		// don't hit the server with all connects in the same tick
+		if(Connected < NumClients && Now >= NextConnect)
+		{
+			aClients[Connected].m_Net.Connect(&ServerAddr);
+			aClients[Connected].m_State = CFakeClient::STATE_CONNECTING;
+			Connected++;
+			NextConnect = Now + time_freq()/50;
+		}
+
+		for(int i = 0; i < Connected; i++)
+		{
+			CFakeClient *pClient = &aClients[i];
+			if(pClient->m_State == CFakeClient::STATE_OFFLINE)
+				continue;
+
+			pClient->m_Net.Update();
+			if(pClient->m_Net.State() == NETSTATE_OFFLINE)
+			{
+				dbg_msg("fake_client", "client %d dropped: %s", i, pClient->m_Net.ErrorString());
+				pClient->m_State = CFakeClient::STATE_OFFLINE;
+				continue;
+			}
+
+			if(pClient->m_State == CFakeClient::STATE_CONNECTING && pClient->m_Net.State() == NETSTATE_ONLINE)
+			{
+				CMsgPacker Msg(NETMSG_INFO, true);
+				Msg.AddString(GAME_NETVERSION, 128);
+				Msg.AddString(pPassword, 128);
+				Msg.AddInt(CLIENT_VERSION);
+				SendMsg(pClient, &Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+				pClient->m_State = CFakeClient::STATE_LOADING;
+			}
+
+			CNetChunk Packet;
+			while(pClient->m_Net.Recv(&Packet))
+			{
+				if(Packet.m_ClientID != -1)
+					ProcessPacket(pClient, &Packet);
+			}
+
+			if(pClient->m_State == CFakeClient::STATE_INGAME && Now >= pClient->m_NextInput)
+			{
+				SendInput(pClient, Now);
+				pClient->m_NextInput += time_freq()/SERVER_TICK_SPEED;
+				if(pClient->m_NextInput < Now)
+					pClient->m_NextInput = Now;
+			}
+		}
+
+		if(Now-LastStats >= time_freq())
+		{
+			NETSTATS NetStats, Diff;
+			net_stats(&NetStats);
+			Diff.recv_bytes = NetStats.recv_bytes-PrevNetStats.recv_bytes;
+			Diff.sent_bytes = NetStats.sent_bytes-PrevNetStats.sent_bytes;
+			PrintStats(&Stats, (Now-LastStats)/(float)time_freq(), &Diff);
+			AddStats(&TotalStats, &Stats);
+			ResetStats(&Stats);
+			PrevNetStats = NetStats;
+			LastStats = Now;
+		}
+
+		thread_sleep(1);
+	}
+
+	NETSTATS NetStats;
+	net_stats(&NetStats);
+	NetStats.recv_bytes -= StartNetStats.recv_bytes;
+	NetStats.sent_bytes -= StartNetStats.sent_bytes;
+	AddStats(&TotalStats, &Stats);
+	dbg_msg("fake_client", "total over %d seconds:", Seconds);
+	PrintStats(&TotalStats, (time_get()-Start)/(float)time_freq(), &NetStats);
+
+	for(int i = 0; i < NumClients; i++)
+	{
+		aClients[i].m_Net.Disconnect("done");
+		aClients[i].m_Net.Close();
+	}
+	return 0;
+}
+
+int main(int argc, const char **argv)
+{
+	cmdline_fix(&argc, &argv);
+	dbg_logger_stdout();
+	if(secure_random_init() != 0)
+	{
+		dbg_msg("secure", "could not initialize secure RNG");
+		return -1;
+	}
+
+	int Seconds = 0;
+	const char *pAddress = 0;
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-n") == 0 && i+1 < argc)
+			NumClients = clamp(str_toint(argv[++i]), 1, (int)MAX_FAKE_CLIENTS);
+		else if(str_comp(argv[i], "-t") == 0 && i+1 < argc)
+			Seconds = str_toint(argv[++i]);
+		else if(str_comp(argv[i], "-p") == 0 && i+1 < argc)
+			pPassword = argv[++i];
+		else if(str_comp(argv[i], "-m") == 0)
+			SkipDownload = true;
+		else if(str_comp(argv[i], "-i") == 0)
+			Idle = true;
+		else
+			pAddress = argv[i];
+	}
+
+	if(!pAddress)
+	{
+		dbg_msg("usage", "%s [-n clients] [-t seconds] [-p password] [-m] [-i] host[:port]", argv[0]);
+		dbg_msg("usage", "  -m  don't download the map, report it as loaded right away");
+		dbg_msg("usage", "  -i  send idle input instead of the scripted movement");
+		cmdline_free(argc, argv);
+		return -1;
+	}
+
+	if(net_host_lookup(pAddress, &ServerAddr, NETTYPE_ALL) != 0)
+	{
+		dbg_msg("fake_client", "couldn't resolve '%s'", pAddress);
+		cmdline_free(argc, argv);
+		return -1;
+	}
+	if(!ServerAddr.port)
+		ServerAddr.port = 8303;
+
+	mem_zero(&Config, sizeof(Config));
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		SnapshotDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	int Result = Run(Seconds);
+	cmdline_free(argc, argv);
+	return Result;
+}
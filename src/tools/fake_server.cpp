@@ -24,6 +24,8 @@ int PlayerScores[16] = {0};
 int NumPlayers = 0;
 int MaxPlayers = 0;
 
+bool ShowStats = false;
+
 char aInfoMsg[1024];
 int aInfoMsgSize;
 
@@ -108,9 +110,27 @@ static void SendFWCheckResponse(NETADDR *pAddr)
 	pNet->Send(&p);
 }
 
+static void PrintStats(NETSTATS *pPrev, int64 Elapsed)
+{
+	NETSTATS Stats;
+	net_stats(&Stats);
+
+	float Seconds = Elapsed/(float)time_freq();
+	int RecvPackets = Stats.recv_packets-pPrev->recv_packets;
+	int SentPackets = Stats.sent_packets-pPrev->sent_packets;
+	int RecvCalls = Stats.recv_calls-pPrev->recv_calls;
+	int SentCalls = Stats.sent_calls-pPrev->sent_calls;
+	dbg_msg("fake_server", "recv %.0f packets/s in %.0f calls/s, sent %.0f packets/s in %.0f calls/s",
+		RecvPackets/Seconds, RecvCalls/Seconds, SentPackets/Seconds, SentCalls/Seconds);
+	*pPrev = Stats;
+}
+
 static int Run()
 {
 	int64 NextHeartBeat = 0;
+	int64 LastStats = time_get();
+	NETSTATS PrevStats;
+	net_stats(&PrevStats);
 	NETADDR BindAddr = {NETTYPE_IPV4, {0},0};
 
 	if(!pNet->Open(BindAddr, 0, 0, 0, 0, 0, 0, 0, 0, 0))
@@ -144,13 +164,21 @@ static int Run()
 			SendHeartBeats();
 		}
 
-		thread_sleep(100);
+		if(ShowStats && time_get()-LastStats > time_freq())
+		{
+			PrintStats(&PrevStats, time_get()-LastStats);
+			LastStats = time_get();
+		}
+
+		// sends the queued replies
+		pNet->Wait(100);
 	}
 }
 
 int main(int argc, const char **argv)
 {
 	cmdline_fix(&argc, &argv);
+	dbg_logger_stdout();
 
 	pNet = new CNetServer;
 
@@ -202,6 +230,10 @@ int main(int argc, const char **argv)
 			argc--; argv++;
 			pServerName = *argv;
 		}
+		else if(str_comp(*argv, "-s") == 0)
+		{
+			ShowStats = true;
+		}
 
 		argc--; argv++;
 	}